@@ -95,6 +95,14 @@ extern "C"  {     /*}*/
  */
 #define  _TN_FFS(x)     ffs_asm(x)
 int ffs_asm(int x);
+#else
+/*
+ * ARMv6-M has no CLZ instruction, so, the kernel uses generic constant-time
+ * implementation: de Bruijn multiplication. Note that Cortex-M0/M0+ might be
+ * implemented with small (32-cycle) multiplier: in this case,
+ * `_TN_FFS_GENERIC__LUT` is faster.
+ */
+#define  _TN_FFS_GENERIC   _TN_FFS_GENERIC__DEBRUIJN
 #endif
 
 /**
@@ -307,6 +315,20 @@ typedef  unsigned int               TN_UIntPtr;
  */
 #define _TN_SIZE_BYTES_TO_UWORDS(size_in_bytes)    ((size_in_bytes) >> 2)
 
+#if defined(__TN_ARCHFEAT_CORTEX_M_ARMv7M_ISA__)
+/**
+ * Atomic compare-and-swap: if the word pointed to by `p` is equal to
+ * `old_val`, store `new_val` there and return non-zero; otherwise, return 0.
+ * Used by the mutex fast path (see `#TN_MUTEX_FAST_LOCK`).
+ *
+ * Implemented with LDREX/STREX. ARMv6-M has no exclusive access
+ * instructions, so the generic implementation is used there (see
+ * `_tn_cas_generic()` in tn_mutex.c)
+ */
+#define _TN_CAS(p, old_val, new_val)   _tn_arch_cas_asm(p, old_val, new_val)
+int _tn_arch_cas_asm(volatile TN_UWord *p, TN_UWord old_val, TN_UWord new_val);
+#endif
+
 #if defined(__TN_COMPILER_ARMCC__)
 #  if TN_FORCED_INLINE
 #     define _TN_INLINE             __forceinline
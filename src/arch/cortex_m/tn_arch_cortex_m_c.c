@@ -107,6 +107,38 @@
  *    CORTEX-M SPECIFIC FUNCTIONS
  ******************************************************************************/
 
+#if defined(__TN_ARCHFEAT_CORTEX_M_ARMv7M_ISA__)
+
+//-- Debug Exception and Monitor Control Register, and its bit TRCENA which
+//   enables DWT
+#define _TN_CM_DEMCR             (*(volatile unsigned long *)0xE000EDFC)
+#define _TN_CM_DEMCR_TRCENA      (1UL << 24)
+
+//-- DWT Control Register, and its bit CYCCNTENA which enables cycle counter
+#define _TN_CM_DWT_CTRL          (*(volatile unsigned long *)0xE0001000)
+#define _TN_CM_DWT_CTRL_CYCCNTENA   (1UL << 0)
+
+//-- DWT cycle counter
+#define _TN_CM_DWT_CYCCNT        (*(volatile unsigned long *)0xE0001004)
+
+#if TN_MAX_SYSCALL_PRIORITY && TN_DEBUG
+
+//-- Interrupt Control and State Register, and its field VECTACTIVE which
+//   contains the number of currently active exception
+#define _TN_CM_ICSR              (*(volatile unsigned long *)0xE000ED04)
+#define _TN_CM_ICSR_VECTACTIVE   0x1FFUL
+
+//-- Priorities of system exceptions 4 .. 15, one byte per exception;
+//   the array is indexed by the exception number
+#define _TN_CM_SHPR              ((volatile unsigned char *)0xE000ED14)
+
+//-- Priorities of external interrupts, one byte per interrupt
+#define _TN_CM_NVIC_IPR          ((volatile unsigned char *)0xE000E400)
+
+#endif
+
+#endif
+
 
 /*******************************************************************************
  *    IMPLEMENTATION
@@ -176,4 +208,61 @@ TN_UWord *_tn_arch_stack_init(
    return cur_stack_pt;
 }
 
+#if defined(__TN_ARCHFEAT_CORTEX_M_ARMv7M_ISA__)
+/*
+ * See comments in the file `tn_arch.h`
+ */
+unsigned long tn_arch_timestamp_get(void)
+{
+   if (!(_TN_CM_DWT_CTRL & _TN_CM_DWT_CTRL_CYCCNTENA)){
+      //-- cycle counter isn't yet enabled: enable DWT and the counter
+      _TN_CM_DEMCR     |= _TN_CM_DEMCR_TRCENA;
+      _TN_CM_DWT_CTRL  |= _TN_CM_DWT_CTRL_CYCCNTENA;
+   }
+
+   return _TN_CM_DWT_CYCCNT;
+}
+#endif
+
+#if defined(__TN_ARCHFEAT_CORTEX_M_ARMv7M_ISA__) && TN_MAX_SYSCALL_PRIORITY && TN_DEBUG
+/**
+ * Called by `_tn_arch_inside_isr()` if it is called from ISR: checks that
+ * priority of the ISR isn't higher than `#TN_MAX_SYSCALL_PRIORITY`, since
+ * such ISRs (<i>user interrupts</i>) aren't masked by the kernel critical
+ * sections, and therefore aren't allowed to call kernel services.
+ *
+ * @return
+ *    Always 1 (result of `_tn_arch_inside_isr()`)
+ */
+int _tn_arch_isr_pri_check(void)
+{
+   unsigned int exc_num = _TN_CM_ICSR & _TN_CM_ICSR_VECTACTIVE;
+   unsigned int priority;
+
+   if (exc_num >= 16){
+      //-- external interrupt
+      priority = _TN_CM_NVIC_IPR[exc_num - 16];
+   } else if (exc_num >= 4){
+      //-- system exception with configurable priority
+      priority = _TN_CM_SHPR[exc_num];
+   } else if (exc_num != 0){
+      //-- NMI or HardFault: the priority is fixed and is higher than any
+      //   configurable one
+      priority = 0;
+   } else {
+      //-- thread mode (MSP is used before the kernel is started)
+      priority = 0xFF;
+   }
+
+   if (priority < TN_MAX_SYSCALL_PRIORITY){
+      _TN_FATAL_ERROR(
+            "kernel service is called from ISR with priority higher than "
+            "TN_MAX_SYSCALL_PRIORITY"
+            );
+   }
+
+   return 1;
+}
+#endif
+
 
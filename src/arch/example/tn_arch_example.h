@@ -48,10 +48,24 @@
  * FFS - find first set bit. Used in `_find_next_task_to_run()` function.
  * Say, for `0xa8` it should return `3`.
  *
- * May be not defined: in this case, naive algorithm will be used.
+ * May be not defined: in this case, generic algorithm will be used, see
+ * `_TN_FFS_GENERIC` below.
  */
 #define  _TN_FFS(x) (32 - __builtin_clz((x) & (0 - (x))))
 
+/**
+ * Generic find-first-set algorithm to use if `_TN_FFS()` is not defined:
+ *
+ * - `_TN_FFS_GENERIC__DEBRUIJN` (default): de Bruijn multiplication, constant
+ *   time, good if multiplication is fast;
+ * - `_TN_FFS_GENERIC__LUT`: binary search down to the nibble plus
+ *   16-entry table lookup; good if multiplication is slow;
+ * - `_TN_FFS_GENERIC__LOOP`: naive bit-by-bit loop.
+ *
+ * Ignored if `_TN_FFS()` is defined.
+ */
+#define  _TN_FFS_GENERIC  _TN_FFS_GENERIC__DEBRUIJN
+
 /**
  * Used by the kernel as a signal that something really bad happened.
  * Indicates TNeo bugs as well as illegal kernel usage, e.g. sleeping in
@@ -212,6 +226,24 @@ typedef  unsigned int               TN_UIntPtr;
  */
 #define _TN_SIZE_BYTES_TO_UWORDS(size_in_bytes)    ((size_in_bytes) >> 2)
 
+/*
+ * `_TN_CAS()`: atomic compare-and-swap: if the word pointed to by `p` is equal to
+ * `old_val`, store `new_val` there and return non-zero; otherwise, return 0.
+ * Used by the mutex fast path (see `#TN_MUTEX_FAST_LOCK`), so it should be
+ * atomic with respect to interrupts (on a single core, LL/SC-like
+ * instructions are perfect for that).
+ *
+ * May be not defined: in this case, the kernel implements it by disabling
+ * interrupts for a few instructions (see `_tn_cas_generic()` in
+ * tn_mutex.c). It isn't defined in this example; an architecture with
+ * exclusive access instructions would define it like this:
+ *
+ *     #define _TN_CAS(p, old, new)   _tn_arch_cas_asm(p, old, new)
+ *     int _tn_arch_cas_asm(
+ *           volatile TN_UWord *p, TN_UWord old_val, TN_UWord new_val
+ *           );
+ */
+
 /**
  * If compiler does not conform to c99 standard, there's no inline keyword.
  * So, there's a special macro for that.
@@ -291,4 +291,15 @@ void tn_arch_sched_restore(TN_UWord sched_state)
 
 
 
+/*
+ * See comments in the file `tn_arch.h`
+ */
+unsigned long tn_arch_timestamp_get(void)
+{
+   //-- CP0 Count register (register 9, select 0)
+   return __builtin_mfc0(9, 0);
+}
+
+
+
 
@@ -299,6 +299,16 @@ typedef  unsigned int               TN_UIntPtr;
  */
 #define _TN_SIZE_BYTES_TO_UWORDS(size_in_bytes)    ((size_in_bytes) >> 2)
 
+/**
+ * Atomic compare-and-swap: if the word pointed to by `p` is equal to
+ * `old_val`, store `new_val` there and return non-zero; otherwise, return 0.
+ * Used by the mutex fast path (see `#TN_MUTEX_FAST_LOCK`).
+ *
+ * Implemented with LL/SC.
+ */
+#define _TN_CAS(p, old_val, new_val)   _tn_arch_cas_asm(p, old_val, new_val)
+int _tn_arch_cas_asm(volatile TN_UWord *p, TN_UWord old_val, TN_UWord new_val);
+
 #if TN_FORCED_INLINE
 #  define _TN_INLINE             inline __attribute__ ((always_inline))
 #else
@@ -0,0 +1,533 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/*
+ * POSIX (Linux host) port.
+ *
+ * Task context is a `ucontext_t` structure which is stored at the very top of
+ * the task's stack; the rest of the stack is given to `makecontext()` as the
+ * machine stack for the task. So, `stack_cur_pt` of each task just points to
+ * its `ucontext_t`, and it never changes after `_tn_arch_stack_init()`.
+ *
+ * <i>System interrupts</i> are the signals `SIGALRM`, `SIGUSR1` and
+ * `SIGUSR2`: "disabling interrupts" means blocking them by
+ * `sigprocmask()`. The value of "status register" returned by
+ * `tn_arch_sr_save_int_dis()` is a bitmask of system signals which were
+ * blocked before the call.
+ *
+ * Signal handlers are executed on the stack of the interrupted task, so,
+ * when the context switch is needed at the end of the ISR, we just
+ * `swapcontext()` right from the handler: the interrupted task will return
+ * from the handler when it gets running again.
+ */
+
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include <signal.h>
+#include <ucontext.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "_tn_tasks.h"
+#include "_tn_sys.h"
+
+#include "tn_sys.h"
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+/// Signals that are used as <i>system interrupts</i>; index of the signal in
+/// this array is the bit number in the "status register".
+static const int _sys_signals[] = { SIGALRM, SIGUSR1, SIGUSR2 };
+
+#define _SYS_SIGNALS_CNT   (sizeof(_sys_signals) / sizeof(_sys_signals[0]))
+#define _SYS_SIGNALS_ALL   ((TN_UWord)((1 << _SYS_SIGNALS_CNT) - 1))
+
+/// User-provided handlers for system signals, see `tn_posix_isr_set()`
+static TN_PosixIsr *_isr_handlers[_SYS_SIGNALS_CNT];
+
+/// ISR nesting counter: non-zero while some system signal handler is running
+static volatile int _isr_nest_cnt = 0;
+
+/// Non-zero if scheduler is disabled by `tn_arch_sched_dis_save()`
+static volatile int _sched_dis = 0;
+
+/// Non-zero if context switch was requested while it was impossible to
+/// switch context immediately (from ISR, or when scheduler is disabled)
+static volatile int _switch_pending = 0;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Returns index of the given signal in the `_sys_signals` array, or -1 if
+ * it isn't a system signal.
+ */
+static int _sys_signal_idx(int signum)
+{
+   int ret = -1;
+   int i;
+
+   for (i = 0; i < (int)_SYS_SIGNALS_CNT; i++){
+      if (_sys_signals[i] == signum){
+         ret = i;
+         break;
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * Fill given signal set with system signals whose bits are set in `bits`.
+ */
+static void _sys_sigset_get(sigset_t *set, TN_UWord bits)
+{
+   int i;
+
+   sigemptyset(set);
+   for (i = 0; i < (int)_SYS_SIGNALS_CNT; i++){
+      if (bits & (1 << i)){
+         sigaddset(set, _sys_signals[i]);
+      }
+   }
+}
+
+/**
+ * Returns bitmask of system signals that are members of the given set.
+ */
+static TN_UWord _sys_sigset_bits(const sigset_t *set)
+{
+   TN_UWord bits = 0;
+   int i;
+
+   for (i = 0; i < (int)_SYS_SIGNALS_CNT; i++){
+      if (sigismember(set, _sys_signals[i])){
+         bits |= (1 << i);
+      }
+   }
+
+   return bits;
+}
+
+/**
+ * Block system signals whose bits are set in `bits`.
+ */
+static void _sys_signals_block(TN_UWord bits)
+{
+   sigset_t set;
+   _sys_sigset_get(&set, bits);
+   sigprocmask(SIG_BLOCK, &set, TN_NULL);
+}
+
+/**
+ * Unblock system signals whose bits are set in `bits`.
+ */
+static void _sys_signals_unblock(TN_UWord bits)
+{
+   sigset_t set;
+   _sys_sigset_get(&set, bits);
+   sigprocmask(SIG_UNBLOCK, &set, TN_NULL);
+}
+
+/**
+ * Entry point of each task: call task body function, and if it returns,
+ * exit the task (just like it is done via LR on Cortex-M).
+ *
+ * We don't pass any arguments through `makecontext()`, because passing
+ * pointers as `int` arguments isn't portable; instead, we take body function
+ * and its parameter from `_tn_curr_run_task`, which is already set to the
+ * new task at this point.
+ */
+static void _task_entry(void)
+{
+   struct TN_Task *task = _tn_curr_run_task;
+
+   //-- new task is started with interrupts disabled (see 
+   //   `_tn_arch_stack_init()`), so, enable them now
+   tn_arch_int_en();
+
+   task->task_func_addr(task->task_func_param);
+
+   _tn_task_exit_nodelete();
+}
+
+/**
+ * Actually switch context from `_tn_curr_run_task` to `_tn_next_task_to_run`.
+ *
+ * Interrupts should be disabled.
+ */
+static void _context_switch(void)
+{
+   struct TN_Task *task_prev = _tn_curr_run_task;
+
+#if _TN_ON_CONTEXT_SWITCH_HANDLER
+   _tn_sys_on_context_switch(_tn_curr_run_task, _tn_next_task_to_run);
+#endif
+
+   _tn_curr_run_task = _tn_next_task_to_run;
+
+   //-- save current context and restore the new one. Note that signal mask
+   //   is a part of the context, so the interrupts state is saved and
+   //   restored here as well.
+   swapcontext(
+         (ucontext_t *)task_prev->stack_cur_pt,
+         (ucontext_t *)_tn_curr_run_task->stack_cur_pt
+         );
+
+   //-- now, previous task is running again.
+}
+
+/**
+ * If context switch is pending and it is allowed, switch context.
+ *
+ * Interrupts should be disabled.
+ */
+static void _context_switch_if_pending(void)
+{
+   if (_switch_pending && !_sched_dis && _isr_nest_cnt == 0){
+      _switch_pending = 0;
+
+      if (_tn_curr_run_task != _tn_next_task_to_run){
+         _context_switch();
+      }
+   }
+}
+
+/**
+ * Handler for all system signals: it calls user-provided handler, and
+ * switches context at the end of outermost ISR, if needed.
+ */
+static void _sys_signal_handler(int signum)
+{
+   int saved_errno = errno;
+   int idx = _sys_signal_idx(signum);
+
+   //-- the kernel blocks current signal for us, on top of the mask of the
+   //   interrupted code (sigaction's mask is empty, see
+   //   `tn_posix_isr_set()`). So ISRs of different signals can nest, just
+   //   like ISRs of different priorities on the real hardware, but if we
+   //   have interrupted some other ISR, its signal stays blocked: we must
+   //   not unblock other system signals here, otherwise that ISR could be
+   //   re-entered.
+   _isr_nest_cnt++;
+
+   if (_isr_handlers[idx] != TN_NULL){
+      _isr_handlers[idx]();
+   }
+
+   tn_arch_int_dis();
+   _isr_nest_cnt--;
+
+   //-- if we're leaving outermost ISR, and some ISR has pended context
+   //   switch, do it now.
+   _context_switch_if_pending();
+
+   //-- when we return from the handler, signal mask gets restored by the
+   //   kernel to the one of the interrupted task.
+   errno = saved_errno;
+}
+
+/**
+ * Tick "ISR", used by `tn_posix_tick_start()`.
+ */
+static void _tick_isr(void)
+{
+   tn_tick_int_processing();
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+void tn_arch_int_dis(void)
+{
+   _sys_signals_block(_SYS_SIGNALS_ALL);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+void tn_arch_int_en(void)
+{
+   _sys_signals_unblock(_SYS_SIGNALS_ALL);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+TN_UWord tn_arch_sr_save_int_dis(void)
+{
+   sigset_t set;
+   sigset_t old_set;
+
+   _sys_sigset_get(&set, _SYS_SIGNALS_ALL);
+   sigprocmask(SIG_BLOCK, &set, &old_set);
+
+   return _sys_sigset_bits(&old_set);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+void tn_arch_sr_restore(TN_UWord sr)
+{
+   _sys_signals_block(sr & _SYS_SIGNALS_ALL);
+   _sys_signals_unblock(~sr & _SYS_SIGNALS_ALL);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+TN_UWord tn_arch_sched_dis_save(void)
+{
+   TN_UWord ret = _sched_dis;
+   _sched_dis = 1;
+   return ret;
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+void tn_arch_sched_restore(TN_UWord sched_state)
+{
+   TN_UWord sr = tn_arch_sr_save_int_dis();
+
+   _sched_dis = sched_state;
+   _context_switch_if_pending();
+
+   tn_arch_sr_restore(sr);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+TN_UWord *_tn_arch_stack_init(
+      TN_TaskBody   *task_func,
+      TN_UWord      *stack_low_addr,
+      TN_UWord      *stack_high_addr,
+      void          *param
+      )
+{
+   ucontext_t *ctx;
+   int i;
+
+   //-- context is stored at the top of the stack ('full desc stack' model),
+   //   aligned by 16 bytes
+   ctx = (ucontext_t *)(
+         ((TN_UIntPtr)(stack_high_addr + 1) - sizeof(ucontext_t))
+         & ~(TN_UIntPtr)0x0f
+         );
+
+   getcontext(ctx);
+
+   //-- the rest of the stack is used as a machine stack for the task
+   ctx->uc_stack.ss_sp     = stack_low_addr;
+   ctx->uc_stack.ss_size   = (char *)ctx - (char *)stack_low_addr;
+   ctx->uc_stack.ss_flags  = 0;
+   ctx->uc_link            = TN_NULL;
+
+   //-- NOTE: interrupts should be enabled when task starts, but we can't
+   //   just unblock system signals in the context: `swapcontext()` and
+   //   `setcontext()` restore signal mask *before* they switch stack, so the
+   //   signal could be handled on the stack of previous task while
+   //   `_tn_curr_run_task` already points to the new one. So, task is started
+   //   with interrupts disabled, and `_task_entry()` enables them.
+   for (i = 0; i < (int)_SYS_SIGNALS_CNT; i++){
+      sigaddset(&ctx->uc_sigmask, _sys_signals[i]);
+   }
+
+   makecontext(ctx, _task_entry, 0);
+
+   //-- body function and its param are taken from `_tn_curr_run_task`
+   //   by `_task_entry()`
+   _TN_UNUSED(task_func);
+   _TN_UNUSED(param);
+
+   return (TN_UWord *)ctx;
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+unsigned long tn_arch_timestamp_get(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec;
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+int _tn_arch_inside_isr(void)
+{
+   return (_isr_nest_cnt > 0);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+int _tn_arch_is_int_disabled(void)
+{
+   sigset_t cur_set;
+
+   sigprocmask(SIG_BLOCK, TN_NULL, &cur_set);
+
+   //-- interrupts are considered disabled if all system signals are blocked:
+   //   inside the ISR, its own signal is blocked, but interrupts are still
+   //   enabled.
+   return (_sys_sigset_bits(&cur_set) == _SYS_SIGNALS_ALL);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+void _tn_arch_context_switch_pend(void)
+{
+   TN_UWord sr = tn_arch_sr_save_int_dis();
+
+   //-- context switch is performed when leaving outermost ISR or when
+   //   scheduler gets enabled; from the task context, it is performed
+   //   immediately.
+   _switch_pending = 1;
+   _context_switch_if_pending();
+
+   tn_arch_sr_restore(sr);
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+void _tn_arch_context_switch_now_nosave(void)
+{
+   //-- interrupts should already be disabled, but let's make sure
+   tn_arch_int_dis();
+
+   _switch_pending = 0;
+
+#if _TN_ON_CONTEXT_SWITCH_HANDLER
+   _tn_sys_on_context_switch(_tn_curr_run_task, _tn_next_task_to_run);
+#endif
+
+   _tn_curr_run_task = _tn_next_task_to_run;
+
+   //-- interrupts get enabled by restoring signal mask of the new context
+   setcontext((ucontext_t *)_tn_curr_run_task->stack_cur_pt);
+
+   //-- should never be here
+   _TN_FATAL_ERROR("setcontext() failed");
+}
+
+/*
+ * See comments in the file `tn_arch.h`
+ */
+void _tn_arch_sys_start(
+      TN_UWord      *int_stack,
+      TN_UWord       int_stack_size
+      )
+{
+   //-- signal handlers are executed on the stack of the interrupted task,
+   //   so interrupt stack isn't used on the host.
+   _TN_UNUSED(int_stack);
+   _TN_UNUSED(int_stack_size);
+
+   tn_arch_int_dis();
+   _tn_arch_context_switch_now_nosave();
+}
+
+/*
+ * See comments in the file `tn_arch_posix.h`
+ */
+int tn_posix_isr_set(int signum, TN_PosixIsr *isr)
+{
+   int ret = -1;
+   int idx = _sys_signal_idx(signum);
+
+   if (idx >= 0){
+      struct sigaction sa;
+
+      _isr_handlers[idx] = isr;
+
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = _sys_signal_handler;
+      sa.sa_flags = SA_RESTART;
+      sigemptyset(&sa.sa_mask);
+
+      ret = sigaction(signum, &sa, TN_NULL);
+   }
+
+   return ret;
+}
+
+/*
+ * See comments in the file `tn_arch_posix.h`
+ */
+int tn_posix_tick_start(unsigned long period_us)
+{
+   int ret = tn_posix_isr_set(SIGALRM, _tick_isr);
+
+   if (ret == 0){
+      struct itimerval itv;
+
+      itv.it_interval.tv_sec  = period_us / 1000000;
+      itv.it_interval.tv_usec = period_us % 1000000;
+      itv.it_value            = itv.it_interval;
+
+      ret = setitimer(ITIMER_REAL, &itv, TN_NULL);
+   }
+
+   return ret;
+}
+
@@ -0,0 +1,390 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/**
+ *
+ * \file
+ *
+ * POSIX (Linux host) architecture-dependent routines.
+ *
+ * This port allows to run the kernel as a regular process on the host
+ * machine: tasks are `ucontext`-based coroutines, <i>system interrupts</i>
+ * are POSIX signals, and system tick is driven by the `SIGALRM` timer signal.
+ * It is mainly intended for debugging of application logic and for unit
+ * testing, not for real-time usage.
+ *
+ */
+
+#ifndef  _TN_ARCH_POSIX_H
+#define  _TN_ARCH_POSIX_H
+
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "../tn_arch_detect.h"
+#include "../../core/tn_cfg_dispatch.h"
+
+
+
+
+#ifdef __cplusplus
+extern "C"  {     /*}*/
+#endif
+
+
+/*******************************************************************************
+ *    ARCH-DEPENDENT DEFINITIONS
+ ******************************************************************************/
+
+
+
+
+
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+#define  _TN_POSIX_INTSAVE_DATA_INVALID   (~(TN_UWord)0)
+
+#if TN_DEBUG
+#  define   _TN_POSIX_INTSAVE_CHECK()                          \
+{                                                              \
+   if (TN_INTSAVE_VAR == _TN_POSIX_INTSAVE_DATA_INVALID){      \
+      _TN_FATAL_ERROR("");                                     \
+   }                                                           \
+}
+#else
+#  define   _TN_POSIX_INTSAVE_CHECK()  /* nothing */
+#endif
+
+/**
+ * FFS - find first set bit. Used in `_find_next_task_to_run()` function.
+ * Say, for `0xa8` it should return `3`.
+ *
+ * May be not defined: in this case, generic algorithm will be used. On the
+ * host, generic algorithm can be forced by defining `TN_POSIX_FFS_GENERIC`
+ * to one of `_TN_FFS_GENERIC__...` values: it allows to benchmark them
+ * (see `stuff/posix_tests`).
+ */
+#if defined(TN_POSIX_FFS_GENERIC)
+#  define  _TN_FFS_GENERIC    TN_POSIX_FFS_GENERIC
+#else
+#  define  _TN_FFS(x)     __builtin_ffs(x)
+#endif
+
+/**
+ * Used by the kernel as a signal that something really bad happened.
+ * Indicates TNeo bugs as well as illegal kernel usage
+ * (e.g. sleeping in the idle task callback)
+ *
+ * On the host, we just raise `SIGTRAP`-like trap, so that debugger halts
+ * (or the process gets terminated, if there's no debugger)
+ */
+#define  _TN_FATAL_ERROR(error_msg, ...)         \
+      {__builtin_trap();}
+
+
+
+/**
+ * \def TN_ARCH_STK_ATTR_BEFORE
+ *
+ * Compiler-specific attribute that should be placed **before** declaration of
+ * array used for stack. It is needed because there are often additional 
+ * restrictions applied to alignment of stack, so, to meet them, stack arrays
+ * need to be declared with these macros.
+ *
+ * @see TN_ARCH_STK_ATTR_AFTER
+ */
+
+/**
+ * \def TN_ARCH_STK_ATTR_AFTER
+ *
+ * Compiler-specific attribute that should be placed **after** declaration of
+ * array used for stack. It is needed because there are often additional 
+ * restrictions applied to alignment of stack, so, to meet them, stack arrays
+ * need to be declared with these macros.
+ *
+ * @see TN_ARCH_STK_ATTR_BEFORE
+ */
+
+#define TN_ARCH_STK_ATTR_BEFORE
+#define TN_ARCH_STK_ATTR_AFTER      __attribute__((aligned(0x10)))
+
+
+/**
+ * Minimum task's stack size, in words, not in bytes.
+ *
+ * Context of the task (`ucontext_t`) is stored at the top of the task's
+ * stack, and signal handlers (i.e. ISRs) are executed on the stack of the
+ * interrupted task, so the minimum is much larger than on the real hardware.
+ */
+#define  TN_MIN_STACK_SIZE          (_TN_SIZE_BYTES_TO_UWORDS(16384)      \
+      + _TN_STACK_OVERFLOW_SIZE_ADD                               \
+      )
+
+/**
+ * Width of `int` type.
+ */
+#define  TN_INT_WIDTH               32
+
+/**
+ * Unsigned integer type whose size is equal to the size of CPU register.
+ * On the host, it is `unsigned long`, so that it is able to hold a pointer
+ * on both 32- and 64-bit machines.
+ */
+typedef  unsigned long              TN_UWord;
+
+/**
+ * Unsigned integer type that is able to store pointers.
+ * We need it because some platforms don't define `uintptr_t`.
+ */
+typedef  unsigned long              TN_UIntPtr;
+
+/**
+ * Maximum number of priorities available, this value usually matches
+ * `#TN_INT_WIDTH`.
+ *
+ * @see TN_PRIORITIES_CNT
+ */
+#define  TN_PRIORITIES_MAX_CNT      TN_INT_WIDTH
+
+/**
+ * Value for infinite waiting, usually matches `ULONG_MAX`,
+ * because `#TN_TickCnt` is declared as `unsigned long`.
+ */
+#define  TN_WAIT_INFINITE           (TN_TickCnt)(~0UL)
+
+/**
+ * Value for initializing the task's stack
+ */
+#define  TN_FILL_STACK_VAL          0xFEEDFACE
+
+
+
+
+/**
+ * Variable name that is used for storing interrupts state
+ * by macros TN_INTSAVE_DATA and friends
+ */
+#define TN_INTSAVE_VAR              tn_save_status_reg
+
+/**
+ * Declares variable that is used by macros `TN_INT_DIS_SAVE()` and
+ * `TN_INT_RESTORE()` for storing status register value.
+ *
+ * On the host, "status register" is a bitmask of the blocked signals used
+ * as <i>system interrupts</i>, see `tn_arch_sr_save_int_dis()`.
+ *
+ * @see `TN_INT_DIS_SAVE()`
+ * @see `TN_INT_RESTORE()`
+ */
+#define  TN_INTSAVE_DATA            \
+   TN_UWord TN_INTSAVE_VAR = _TN_POSIX_INTSAVE_DATA_INVALID;
+
+/**
+ * The same as `#TN_INTSAVE_DATA` but for using in ISR together with
+ * `TN_INT_IDIS_SAVE()`, `TN_INT_IRESTORE()`.
+ *
+ * @see `TN_INT_IDIS_SAVE()`
+ * @see `TN_INT_IRESTORE()`
+ */
+#define  TN_INTSAVE_DATA_INT        TN_INTSAVE_DATA
+
+/**
+ * \def TN_INT_DIS_SAVE()
+ *
+ * Disable interrupts and return previous value of status register,
+ * atomically. Similar `tn_arch_sr_save_int_dis()`, but implemented
+ * as a macro, so it is potentially faster.
+ *
+ * Uses `#TN_INTSAVE_DATA` as a temporary storage.
+ *
+ * @see `#TN_INTSAVE_DATA`
+ * @see `tn_arch_sr_save_int_dis()`
+ */
+
+/**
+ * \def TN_INT_RESTORE()
+ *
+ * Restore previously saved status register.
+ * Similar to `tn_arch_sr_restore()`, but implemented as a macro,
+ * so it is potentially faster.
+ *
+ * Uses `#TN_INTSAVE_DATA` as a temporary storage.
+ *
+ * @see `#TN_INTSAVE_DATA`
+ * @see `tn_arch_sr_save_int_dis()`
+ */
+
+#define TN_INT_DIS_SAVE()   TN_INTSAVE_VAR = tn_arch_sr_save_int_dis()
+#define TN_INT_RESTORE()    _TN_POSIX_INTSAVE_CHECK();                      \
+                            tn_arch_sr_restore(TN_INTSAVE_VAR)
+
+/**
+ * The same as `TN_INT_DIS_SAVE()` but for using in ISR.
+ *
+ * Uses `#TN_INTSAVE_DATA_INT` as a temporary storage.
+ *
+ * @see `#TN_INTSAVE_DATA_INT`
+ */
+#define TN_INT_IDIS_SAVE()       TN_INT_DIS_SAVE()
+
+/**
+ * The same as `TN_INT_RESTORE()` but for using in ISR.
+ *
+ * Uses `#TN_INTSAVE_DATA_INT` as a temporary storage.
+ *
+ * @see `#TN_INTSAVE_DATA_INT`
+ */
+#define TN_INT_IRESTORE()        TN_INT_RESTORE()
+
+/**
+ * Returns nonzero if interrupts are disabled, zero otherwise.
+ */
+#define TN_IS_INT_DISABLED()     (_tn_arch_is_int_disabled())
+
+/**
+ * Pend context switch from interrupt.
+ */
+#define _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED()          \
+   _tn_context_switch_pend_if_needed()
+
+/**
+ * Converts size in bytes to size in `#TN_UWord`.
+ * Since `#TN_UWord` is `unsigned long` here, its size depends on the host,
+ * so we just divide by its size.
+ */
+#define _TN_SIZE_BYTES_TO_UWORDS(size_in_bytes)    \
+   ((size_in_bytes) / sizeof(TN_UWord))
+
+/**
+ * Atomic compare-and-swap: if the word pointed to by `p` is equal to
+ * `old_val`, store `new_val` there and return non-zero; otherwise, return 0.
+ * Used by the mutex fast path (see `#TN_MUTEX_FAST_LOCK`).
+ *
+ * "Interrupts" are signals here, and the builtin is a single instruction,
+ * so it can't be interrupted in the middle.
+ */
+#define _TN_CAS(p, old_val, new_val)                                    \
+   __sync_bool_compare_and_swap((p), (old_val), (new_val))
+
+#if TN_FORCED_INLINE
+#  define _TN_INLINE             inline __attribute__ ((always_inline))
+#else
+#  define _TN_INLINE             inline
+#endif
+#define _TN_STATIC_INLINE         static _TN_INLINE
+#define _TN_VOLATILE_WORKAROUND   /* nothing */
+
+#define _TN_ARCH_STACK_PT_TYPE   _TN_ARCH_STACK_PT_TYPE__FULL
+#define _TN_ARCH_STACK_DIR       _TN_ARCH_STACK_DIR__DESC
+
+#endif   //-- DOXYGEN_SHOULD_SKIP_THIS
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Prototype of the host "ISR", see `tn_posix_isr_set()`.
+ */
+typedef void (TN_PosixIsr)(void);
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Set handler for the given <i>system interrupt</i>. On the host, system
+ * interrupts are the following signals: `SIGALRM`, `SIGUSR1` and `SIGUSR2`.
+ * These signals are blocked whenever the kernel disables interrupts, and
+ * the handler is called in the ISR context, so all the `tn_...i...()`
+ * services are available from it.
+ *
+ * Handlers of different signals may nest (just like ISRs with different
+ * priorities on the real hardware), but the handler of the given signal is
+ * never reentered.
+ *
+ * @param signum
+ *    One of `SIGALRM`, `SIGUSR1`, `SIGUSR2`
+ * @param isr
+ *    Handler to call whenever the signal is delivered.
+ *
+ * @return
+ *    - 0 on success
+ *    - -1 if `signum` is not a system interrupt signal or if `sigaction()`
+ *      has failed.
+ */
+int tn_posix_isr_set(int signum, TN_PosixIsr *isr);
+
+/**
+ * Start system tick timer: `SIGALRM` handler that calls
+ * `tn_tick_int_processing()` is set (by means of `tn_posix_isr_set()`), and
+ * periodic `ITIMER_REAL` timer is started.
+ *
+ * Typically it should be called from the `cb_user_task_create` callback given
+ * to `tn_sys_start()`.
+ *
+ * \attention It is suitable for static tick mode only: if
+ * `#TN_DYNAMIC_TICK` is set, application should handle `SIGALRM` itself,
+ * arming one-shot timer from the `#TN_CBTickSchedule` callback.
+ *
+ * @param period_us
+ *    System tick period, in microseconds.
+ *
+ * @return
+ *    - 0 on success
+ *    - -1 on failure
+ */
+int tn_posix_tick_start(unsigned long period_us);
+
+
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif   // _TN_ARCH_POSIX_H
+
@@ -81,6 +81,16 @@
 //-- Note: the macro _TN_ARCH_STACK_IMPL is defined below in this file
 
 
+
+#define _TN_FFS_GENERIC__LOOP                9
+#define _TN_FFS_GENERIC__DEBRUIJN           10
+#define _TN_FFS_GENERIC__LUT                11
+
+//-- Note: the macro _TN_FFS_GENERIC may be defined in the header for each
+//   particular achitecture which doesn't define `_TN_FFS()`; if it isn't,
+//   it is defined below in this file
+
+
 #endif
 
 
@@ -97,6 +107,8 @@
 #  include "pic24_dspic/tn_arch_pic24.h"
 #elif defined(__TN_ARCH_CORTEX_M__)
 #  include "cortex_m/tn_arch_cortex_m.h"
+#elif defined(__TN_ARCH_POSIX__)
+#  include "posix/tn_arch_posix.h"
 #else
 #  error "unknown platform"
 #endif
@@ -137,6 +149,17 @@
 #  error wrong _TN_ARCH_STACK_DIR
 #endif
 
+//-- If architecture doesn't provide `_TN_FFS()`, the kernel uses generic
+//   find-first-set implementation. By default, it is a de Bruijn sequence
+//   multiplication, which takes constant time (one multiplication and one
+//   table lookup). Architectures with slow multiplier may choose
+//   `_TN_FFS_GENERIC__LUT` instead: binary search down to the nibble plus
+//   16-entry table lookup, which takes at most (log2(TN_INT_WIDTH) - 2)
+//   steps. `_TN_FFS_GENERIC__LOOP` is the naive bit-by-bit loop.
+#if !defined(_TN_FFS) && !defined(_TN_FFS_GENERIC)
+#  define _TN_FFS_GENERIC      _TN_FFS_GENERIC__DEBRUIJN
+#endif
+
 #endif
 
 
@@ -203,6 +226,25 @@ TN_UWord tn_arch_sched_dis_save(void);
  */
 void tn_arch_sched_restore(TN_UWord sched_state);
 
+/**
+ * Get current value of free-running high-resolution counter, which may be
+ * used as a timestamp source for the profiler: see `#TN_PROFILER_TIMESTAMP`
+ * and `tn_callback_profiler_timestamp_set()`.
+ *
+ * It is implemented on architectures which have a counter that the kernel
+ * may use without occupying any peripheral:
+ *
+ * - Cortex-M3/M4/M4F/M7: DWT cycle counter `CYCCNT` (it is enabled on the
+ *   first call), counts CPU cycles;
+ * - PIC32: CP0 `Count` register, counts at half the CPU clock;
+ * - POSIX: `CLOCK_MONOTONIC`, in nanoseconds.
+ *
+ * On Cortex-M0/M0+ and PIC24/dsPIC, there's no such counter: provide your own
+ * callback which reads some free-running timer (for PIC24, it's good idea to
+ * use a pair of 16-bit timers in 32-bit mode).
+ */
+unsigned long tn_arch_timestamp_get(void);
+
 /**
  * Should put initial CPU context to the provided stack pointer for new task
  * and return current stack pointer.
@@ -328,6 +370,13 @@ void _tn_arch_sys_start(
 #endif
 
 
+//-- If `#TN_INT_DIS_STAT` is set, critical section macros provided by the
+//   port are overridden, so that each critical section gets timestamped.
+#if TN_INT_DIS_STAT
+#  include "../core/tn_int_dis_stat.h"
+#endif
+
+
 
 
 
@@ -57,6 +57,7 @@
 #undef __TN_ARCH_CORTEX_M3__
 #undef __TN_ARCH_CORTEX_M4__
 #undef __TN_ARCH_CORTEX_M4_FP__
+#undef __TN_ARCH_POSIX__
 
 #undef __TN_ARCHFEAT_CORTEX_M_FPU__
 #undef __TN_ARCHFEAT_CORTEX_M_ARMv6M_ISA__
@@ -185,7 +186,16 @@
 #     define __TN_COMPILER_GCC__
 #  endif
 
-#  if defined(__ARM_ARCH)
+#  if defined(__linux__) || defined(__unix__)
+
+/*
+ * Host build: the kernel runs as a regular process, see
+ * `src/arch/posix/tn_arch_posix.h`. Bare-metal Cortex-M toolchains don't
+ * define these macros, so it should be checked before `__ARM_ARCH`.
+ */
+#     define __TN_ARCH_POSIX__
+
+#  elif defined(__ARM_ARCH)
 
 #     define __TN_ARCH_CORTEX_M__
 
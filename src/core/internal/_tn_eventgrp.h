@@ -124,6 +124,19 @@ enum TN_RCode _tn_eventgrp_link_manage(
       TN_BOOL              set
       );
 
+#if TN_EVENTGRP_BIT_INDEX
+/**
+ * Should be called when the task waiting for the event group ordered by
+ * priority (see `#TN_EVENTGRP_ATTR_WAIT_PRIO`) is moved in its wait queue
+ * because its priority has changed: the task gets new sequence number, so
+ * that it stands after the tasks with the same priority in other wait queues
+ * of the event group as well.
+ *
+ * \attention Caller must disable interrupts.
+ */
+void _tn_eventgrp_on_task_requeue(struct TN_Task *task);
+#endif
+
 
 
 /*******************************************************************************
@@ -71,6 +71,31 @@ extern "C"  {     /*}*/
  ******************************************************************************/
 
 
+/*******************************************************************************
+ *    PROTECTED FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Take a block from the pool, if there is any free one; otherwise,
+ * `#TN_RC_TIMEOUT` is returned. Doesn't check params and doesn't disable
+ * interrupts: the caller should do that.
+ *
+ * Used by the \ref tn_slab.h "slab allocator", which needs to update its
+ * bitmap of non-empty pools atomically with taking the block.
+ */
+enum TN_RCode _tn_fmem_get(struct TN_FMem *fmem, void **p_data);
+
+/**
+ * Return the block to the pool (or give it to the first waiting task).
+ * Doesn't check params and doesn't disable interrupts: the caller should do
+ * that, as well as pend context switch if needed.
+ *
+ * @see `_tn_fmem_get()`
+ */
+enum TN_RCode _tn_fmem_release(struct TN_FMem *fmem, void *p_data);
+
+
+
 /*******************************************************************************
  *    PROTECTED INLINE FUNCTIONS
  ******************************************************************************/
@@ -65,6 +65,13 @@ extern "C"  {     /*}*/
  *    DEFINITIONS
  ******************************************************************************/
 
+#if TN_MUTEX_FAST_LOCK
+//-- lowest bit of the `owner` field: if set, the mutex is managed by the
+//   kernel, i.e. it can't be unlocked through the fast path.
+//   (pointers to tasks are always aligned, so the bit is never set in them)
+#  define _TN_MUTEX_OWNER_KERNEL    ((TN_UWord)1)
+#endif
+
 
 /*******************************************************************************
  *    PROTECTED FUNCTION PROTOTYPES
@@ -88,6 +95,16 @@ void _tn_mutex_unlock_all_by_task(struct TN_Task *task);
  */
 void _tn_mutex_i_on_task_wait_complete(struct TN_Task *task);
 
+/**
+ * Should be called when priority of the task which waits for mutex with
+ * priority inheritance is changed: the task is moved in the mutex's
+ * `prio_wait_queue`, and the mutex is moved in its holder's `mutex_queue`
+ * if needed.
+ *
+ * NOTE: priority of the holder is NOT updated here: it's up to the caller.
+ */
+void _tn_mutex_i_on_task_priority_change(struct TN_Task *task);
+
 /**
  * Should be called when task winishes waiting
  * for any mutex (no matter which algorithm it uses)
@@ -103,6 +120,7 @@ void _tn_mutex_on_task_wait_complete(struct TN_Task *task);
 
 _TN_STATIC_INLINE void _tn_mutex_unlock_all_by_task(struct TN_Task *task) {}
 _TN_STATIC_INLINE void _tn_mutex_i_on_task_wait_complete(struct TN_Task *task) {}
+_TN_STATIC_INLINE void _tn_mutex_i_on_task_priority_change(struct TN_Task *task) {}
 _TN_STATIC_INLINE void _tn_mutex_on_task_wait_complete(struct TN_Task *task) {}
 #endif
 
@@ -84,11 +84,49 @@ extern struct TN_Task *_tn_next_task_to_run;
 /// lowest priority bit (1 << (TN_PRIORITIES_CNT - 1)) should always be set,
 /// since this priority is used by idle task which should be always runnable,
 /// by design.
+///
+/// If `#TN_PRIORITIES_2LEVEL_BMP` is non-zero, it is a top-level bitmask
+/// instead: each bit corresponds to the group of `#TN_INT_WIDTH` priorities,
+/// and it is set if there is at least one runnable task in the group. See
+/// `_tn_ready_to_run_bmp_lvl2`.
 extern volatile unsigned int _tn_ready_to_run_bmp;
 
+#if TN_PRIORITIES_2LEVEL_BMP
+/// Number of priority groups, see `#TN_PRIORITIES_2LEVEL_BMP`
+#define _TN_READY_BMP_GROUPS_CNT                                     \
+   ((TN_PRIORITIES_CNT + TN_INT_WIDTH - 1) / TN_INT_WIDTH)
+
+/// Second-level bitmasks of priorities with runnable tasks: one word for
+/// each group of `#TN_INT_WIDTH` priorities.
+/// Used if only `#TN_PRIORITIES_2LEVEL_BMP` is non-zero.
+extern volatile unsigned int _tn_ready_to_run_bmp_lvl2[
+   _TN_READY_BMP_GROUPS_CNT
+];
+#endif
+
 /// idle task structure
 extern struct TN_Task _tn_idle_task;
 
+#if !defined(_TN_FFS)
+#  if (_TN_FFS_GENERIC == _TN_FFS_GENERIC__DEBRUIJN)
+/// Table for de Bruijn find-first-set (see `_tn_bmp_ffs()`): index is the
+/// top bits of the product of isolated lowest set bit and de Bruijn sequence,
+/// value is the bit number plus one.
+extern const unsigned char _tn_ffs_debruijn_tbl[TN_INT_WIDTH];
+#  elif (_TN_FFS_GENERIC == _TN_FFS_GENERIC__LUT)
+/// Table for the nibble find-first-set (see `_tn_bmp_ffs()`): index is a
+/// nibble, value is the number of its lowest set bit plus one (or 0 for the
+/// zero nibble).
+extern const unsigned char _tn_ffs_nibble_tbl[16];
+#  endif
+#endif
+
+#if TN_PROFILER_TIMESTAMP
+/// User-provided callback function that returns high-resolution timestamp
+/// for the profiler, see `tn_callback_profiler_timestamp_set()`
+extern TN_CBProfilerTimestampGet *_tn_cb_profiler_timestamp_get;
+#endif
+
 
 
 
@@ -174,6 +212,24 @@ void _tn_cry_deadlock(TN_BOOL active, struct TN_Mutex *mutex, struct TN_Task *ta
 #endif
 
 
+#if TN_DYNAMIC_TICK
+/**
+ * In dynamic tick mode, round-robin is driven by the timer instead of
+ * periodic system ticks. This function should be called whenever
+ * `_tn_next_task_to_run` or ready queues might change: it starts the timer
+ * if only there is time slice set for the priority of `_tn_next_task_to_run`
+ * (see `tn_sys_tslice_set()`) and there are other runnable tasks with the
+ * same priority; otherwise, it cancels the timer.
+ *
+ * Interrupts should be disabled when calling it.
+ */
+void _tn_tslice_manage(void);
+#else
+/// When `#TN_DYNAMIC_TICK` is zero, round-robin is managed by
+/// `tn_tick_int_processing()`, so there's nothing to do here.
+#  define _tn_tslice_manage()   /* nothing */
+#endif
+
 #if _TN_ON_CONTEXT_SWITCH_HANDLER
 /**
  * This function is called at every context switch, if needed
@@ -201,6 +257,73 @@ void _tn_sys_on_context_switch(
  *    PROTECTED INLINE FUNCTIONS
  ******************************************************************************/
 
+/**
+ * Find first set bit in the given bitmask: the same as `_TN_FFS()`, i.e. for
+ * `0xa8` it returns `4` (bit number plus one).
+ *
+ * Given bitmask should be non-zero.
+ */
+_TN_STATIC_INLINE int _tn_bmp_ffs(unsigned int bmp)
+{
+#if defined(_TN_FFS)
+   //-- architecture-dependent way to find-first-set-bit is available,
+   //   so use it.
+   return _TN_FFS(bmp);
+
+#elif (_TN_FFS_GENERIC == _TN_FFS_GENERIC__DEBRUIJN)
+   //-- isolate the lowest set bit: `(bmp & -bmp)` is a power of two, so the
+   //   multiplication just shifts de Bruijn sequence, and its top bits
+   //   are unique for each bit position.
+#if (TN_INT_WIDTH == 32)
+   return _tn_ffs_debruijn_tbl[
+      ((bmp & (0 - bmp)) * 0x077CB531u) >> 27
+   ];
+#else
+   return _tn_ffs_debruijn_tbl[
+      (((bmp & (0 - bmp)) * 0x09AFu) & 0xffffu) >> 12
+   ];
+#endif
+
+#elif (_TN_FFS_GENERIC == _TN_FFS_GENERIC__LUT)
+   //-- binary search for the lowest non-zero nibble, and then table lookup
+   int ret = 0;
+
+#if (TN_INT_WIDTH == 32)
+   if ((bmp & 0xffff) == 0){
+      bmp >>= 16;
+      ret += 16;
+   }
+#endif
+   if ((bmp & 0xff) == 0){
+      bmp >>= 8;
+      ret += 8;
+   }
+   if ((bmp & 0x0f) == 0){
+      bmp >>= 4;
+      ret += 4;
+   }
+
+   return ret + _tn_ffs_nibble_tbl[bmp & 0x0f];
+
+#else
+   //-- naive algorithm: bit-by-bit loop
+   int i;
+   unsigned int mask;
+
+   mask = 1;
+
+   for (i = 0; i < TN_INT_WIDTH; i++){
+      //-- for each bit in bmp
+      if (bmp & mask){
+         break;
+      }
+      mask = (mask << 1);
+   }
+
+   return (i + 1);
+#endif
+}
+
 /**
  * Checks whether context switch is needed (that is, if currently running task 
  * is not the highest-priority task in the $(TN_TASK_STATE_RUNNABLE) state)
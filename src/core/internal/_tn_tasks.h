@@ -129,6 +129,9 @@ _TN_STATIC_INLINE TN_BOOL _tn_task_is_runnable(struct TN_Task *task)
  *    Wait queue to put task in, may be `#TN_NULL`. If not `#TN_NULL`, task is
  *    included in that list by `task_queue` member of `struct #TN_Task`.
  *
+ * @param wait_order
+ *    Order of tasks in the `wait_que`, see `enum #TN_WaitOrder`.
+ *
  * @param wait_reason
  *    Reason of waiting, see `enum #TN_WaitReason`.
  *
@@ -139,6 +142,7 @@ _TN_STATIC_INLINE TN_BOOL _tn_task_is_runnable(struct TN_Task *task)
 void _tn_task_set_waiting(
       struct TN_Task      *task,
       struct TN_ListItem  *wait_que,
+      enum TN_WaitOrder    wait_order,
       enum TN_WaitReason   wait_reason,
       TN_TickCnt           timeout
       );
@@ -294,12 +298,46 @@ _TN_STATIC_INLINE void _tn_task_curr_to_wait_action(
       )
 {
    _tn_task_clear_runnable(_tn_curr_run_task);
-   _tn_task_set_waiting(_tn_curr_run_task, wait_que, wait_reason, timeout);
+   _tn_task_set_waiting(
+         _tn_curr_run_task, wait_que, TN_WAIT_ORDER_FIFO, wait_reason, timeout
+         );
+}
+
+/**
+ * Returns whether given value is a valid `enum #TN_WaitOrder`; used by the
+ * param checking of the object creation services.
+ */
+_TN_STATIC_INLINE TN_BOOL _tn_wait_order_is_valid(enum TN_WaitOrder wait_order)
+{
+   return (0
+         || wait_order == TN_WAIT_ORDER_FIFO
+         || wait_order == TN_WAIT_ORDER_PRIORITY
+         );
+}
+
+/**
+ * The same as `#_tn_task_curr_to_wait_action()`, but the task is put to the
+ * `wait_que` in the given order (see `enum #TN_WaitOrder`): used by the
+ * objects which may be created with `#TN_WAIT_ORDER_PRIORITY`.
+ */
+_TN_STATIC_INLINE void _tn_task_curr_to_wait_action_ordered(
+      struct TN_ListItem *wait_que,
+      enum TN_WaitOrder wait_order,
+      enum TN_WaitReason wait_reason,
+      TN_TickCnt timeout
+      )
+{
+   _tn_task_clear_runnable(_tn_curr_run_task);
+   _tn_task_set_waiting(
+         _tn_curr_run_task, wait_que, wait_order, wait_reason, timeout
+         );
 }
 
 
 /**
- * Change priority of any task (either runnable or non-runnable)
+ * Change priority of any task (either runnable or non-runnable). If the task
+ * waits in the wait queue ordered by priority (see `#TN_WAIT_ORDER_PRIORITY`),
+ * it is moved in that queue accordingly.
  */
 void _tn_change_task_priority(struct TN_Task *task, int new_priority);
 
@@ -137,6 +137,18 @@ TN_BOOL _tn_timer_is_active(struct TN_Timer *timer);
  */
 TN_TickCnt _tn_timer_time_left(struct TN_Timer *timer);
 
+#if TN_TIMER_TASK
+/**
+ * If the timer is a user's one, and the timer task is created, add the timer
+ * to the list of timers whose callbacks should be called by the timer task,
+ * and wake the timer task up. Interrupts should be disabled when calling it.
+ *
+ * @return `TN_TRUE` if the timer was added to the list, `TN_FALSE` otherwise
+ *    (then, the callback should be called right away).
+ */
+TN_BOOL _tn_timer_pending_add(struct TN_Timer *timer);
+#endif
+
 
 
 
@@ -157,17 +169,16 @@ _TN_STATIC_INLINE TN_BOOL _tn_timer_is_valid(
 }
 
 /**
- * Called by `_tn_timers_tick_proceed()`, which is implemented differently
- * depending on `TN_DYNAMIC_TICK` option.
- * 
- * Enables interrupts, calls callback function, disables interrupts back.
- * 
+ * Enables interrupts, calls callback function of the timer right from the
+ * current context, disables interrupts back. Used by
+ * `_tn_timer_callback_call()`.
+ *
  * @param timer
  *    Timer to operate on
  * @param TN_INTSAVE_VAR
  *    Status of interrupts, used by `TN_INT_IDIS_SAVE()` and friends.
  */
-_TN_STATIC_INLINE void _tn_timer_callback_call(
+_TN_STATIC_INLINE void _tn_timer_callback_call_direct(
       struct TN_Timer  *timer,
       TN_UWord          TN_INTSAVE_VAR
       )
@@ -189,6 +200,101 @@ _TN_STATIC_INLINE void _tn_timer_callback_call(
    TN_INT_IDIS_SAVE();
 }
 
+/**
+ * Called by `_tn_timers_tick_proceed()`, which is implemented differently
+ * depending on `TN_DYNAMIC_TICK` option.
+ * 
+ * Enables interrupts, calls callback function, disables interrupts back.
+ * If the callback should be called by the timer task (see `#TN_TIMER_TASK`),
+ * it merely adds the timer to the list of pending callbacks.
+ * 
+ * @param timer
+ *    Timer to operate on
+ * @param TN_INTSAVE_VAR
+ *    Status of interrupts, used by `TN_INT_IDIS_SAVE()` and friends.
+ */
+_TN_STATIC_INLINE void _tn_timer_callback_call(
+      struct TN_Timer  *timer,
+      TN_UWord          TN_INTSAVE_VAR
+      )
+{
+#if TN_TIMER_TASK
+   //-- if the timer task is created, the callback will be called by it;
+   //   otherwise, call it right from here
+   if (!_tn_timer_pending_add(timer)){
+      _tn_timer_callback_call_direct(timer, TN_INTSAVE_VAR);
+   }
+#else
+   _tn_timer_callback_call_direct(timer, TN_INTSAVE_VAR);
+#endif
+}
+
+/**
+ * Get current time for the profiler, the event trace and DPC latency
+ * statistics: either high-resolution timestamp (if `#TN_PROFILER_TIMESTAMP`
+ * is non-zero) or system tick count.
+ */
+_TN_STATIC_INLINE unsigned long _tn_profiler_time_get(void)
+{
+#if TN_PROFILER_TIMESTAMP
+   return _tn_cb_profiler_timestamp_get();
+#else
+   return _tn_timer_sys_time_get();
+#endif
+}
+
+/**
+ * Convert absolute `deadline` (in terms of `tn_sys_time_get()`) to the
+ * timeout relative to `cur_tick_cnt`, handling wraparound of `#TN_TickCnt`:
+ * the deadline is considered to be in the future if only it is less than
+ * half of the `#TN_TickCnt` range ahead of `cur_tick_cnt`, otherwise it is
+ * considered to be already reached.
+ *
+ * @return
+ *    Number of ticks left until the deadline, or `0` if the deadline is
+ *    already reached. Never returns `#TN_WAIT_INFINITE`.
+ */
+_TN_STATIC_INLINE TN_TickCnt _tn_timeout_until(
+      TN_TickCnt deadline,
+      TN_TickCnt cur_tick_cnt
+      )
+{
+   TN_TickCnt timeout = deadline - cur_tick_cnt;
+
+   if (timeout > (TN_WAIT_INFINITE / 2)){
+      //-- deadline is in the past
+      timeout = 0;
+   }
+
+   return timeout;
+}
+
+/**
+ * Used by services which take either relative timeout or absolute deadline
+ * (say, `tn_sem_wait()` and `tn_sem_wait_until()`): if `is_deadline` is
+ * `TN_FALSE`, `timeout` is returned as it is; otherwise, `timeout` is the
+ * deadline (in terms of `tn_sys_time_get()`), and the number of ticks left
+ * until it is returned (see `_tn_timeout_until()`).
+ *
+ * Interrupts should be disabled, and the caller should put the task to wait
+ * in the same critical section: otherwise, system tick might happen between
+ * getting the current time and putting the task to wait, and the task would
+ * wake up after the deadline.
+ */
+_TN_STATIC_INLINE TN_TickCnt _tn_timeout_resolve(
+      TN_TickCnt  timeout,
+      TN_BOOL     is_deadline
+      )
+{
+   TN_TickCnt ret = timeout;
+
+   if (is_deadline){
+      ret = _tn_timeout_until(timeout, _tn_timer_sys_time_get());
+   }
+
+   return ret;
+}
+
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+#ifndef __TN_TRACE_H
+#define __TN_TRACE_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "_tn_timer.h"
+#include "tn_trace.h"
+
+
+
+
+#ifdef __cplusplus
+extern "C"  {     /*}*/
+#endif
+
+/*******************************************************************************
+ *    EXTERNAL TYPES
+ ******************************************************************************/
+
+
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+#if TN_TRACE
+/// Kernel event trace ring buffer, see `tn_trace.h`
+extern struct TN_TraceBuf _tn_trace_buf;
+#endif
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+
+/*******************************************************************************
+ *    PROTECTED INLINE FUNCTIONS
+ ******************************************************************************/
+
+#if TN_TRACE
+/**
+ * Write record about the kernel event to the trace ring buffer (if only
+ * tracing is active), overwriting the oldest record if the buffer is full.
+ *
+ * Should be called with interrupts disabled.
+ *
+ * @param event
+ *    Kernel event, see `enum #TN_TraceEvent`
+ * @param p_obj
+ *    Kernel object the event is related to
+ * @param param
+ *    Event-specific parameter
+ */
+_TN_STATIC_INLINE void _tn_trace(
+      enum TN_TraceEvent   event,
+      const void          *p_obj,
+      TN_UWord             param
+      )
+{
+   if (_tn_trace_buf.active){
+      TN_UWord wr_cnt = _tn_trace_buf.wr_cnt;
+      struct TN_TraceRec *rec
+         = &_tn_trace_buf.recs[ wr_cnt & (TN_TRACE_RECS_CNT - 1) ];
+
+      rec->timestamp = _tn_profiler_time_get();
+      rec->p_obj     = p_obj;
+      rec->param     = param;
+      rec->event     = (TN_UWord)event;
+
+      //-- the record is complete, now make it visible to the decoder
+      _tn_trace_buf.wr_cnt = wr_cnt + 1;
+   }
+}
+#else
+#  define _tn_trace(event, p_obj, param)  /* nothing */
+#endif
+
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+
+#endif // __TN_TRACE_H
+
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
+
+
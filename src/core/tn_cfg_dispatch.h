@@ -91,6 +91,10 @@
 #  error TN_PRIORITIES_CNT is not defined
 #endif
 
+#if !defined(TN_PRIORITIES_2LEVEL_BMP)
+#  error TN_PRIORITIES_2LEVEL_BMP is not defined
+#endif
+
 
 #if !defined(TN_CHECK_PARAM)
 #  error TN_CHECK_PARAM is not defined
@@ -115,12 +119,23 @@
 #  if !defined(TN_MUTEX_DEADLOCK_DETECT)
 #     error TN_MUTEX_DEADLOCK_DETECT is not defined
 #  endif
+#  if !defined(TN_MUTEX_FAST_LOCK)
+#     error TN_MUTEX_FAST_LOCK is not defined
+#  endif
 #endif
 
 #if !defined(TN_TICK_LISTS_CNT)
 #  error TN_TICK_LISTS_CNT is not defined
 #endif
 
+#if !defined(TN_TICK_WHEEL_LEVELS)
+#  error TN_TICK_WHEEL_LEVELS is not defined
+#endif
+
+#if !defined(TN_TIMER_TASK)
+#  error TN_TIMER_TASK is not defined
+#endif
+
 #if !defined(TN_API_MAKE_ALIG_ARG)
 #  error TN_API_MAKE_ALIG_ARG is not defined
 #endif
@@ -133,6 +148,30 @@
 #  error TN_PROFILER_WAIT_TIME is not defined
 #endif
 
+#if !defined(TN_PROFILER_TIMESTAMP)
+#  error TN_PROFILER_TIMESTAMP is not defined
+#endif
+
+#if !defined(TN_TRACE)
+#  error TN_TRACE is not defined
+#endif
+
+#if !defined(TN_TRACE_RECS_CNT)
+#  error TN_TRACE_RECS_CNT is not defined
+#endif
+
+#if !defined(TN_INT_DIS_STAT)
+#  error TN_INT_DIS_STAT is not defined
+#endif
+
+#if !defined(TN_TASK_NOTIFY)
+#  error TN_TASK_NOTIFY is not defined
+#endif
+
+#if !defined(TN_EVENTGRP_BIT_INDEX)
+#  error TN_EVENTGRP_BIT_INDEX is not defined
+#endif
+
 #if !defined(TN_INIT_INTERRUPT_STACK_SPACE)
 #  error TN_INIT_INTERRUPT_STACK_SPACE is not defined
 #endif
@@ -147,6 +186,12 @@
 #  endif
 #endif
 
+#if defined (__TN_ARCH_CORTEX_M__)
+#  if !defined(TN_MAX_SYSCALL_PRIORITY)
+#     error TN_MAX_SYSCALL_PRIORITY is not defined
+#  endif
+#endif
+
 #if !defined(TN_DYNAMIC_TICK)
 #  error TN_DYNAMIC_TICK is not defined
 #endif
@@ -168,6 +213,17 @@
 
 
 
+//-- check TN_MAX_SYSCALL_PRIORITY: BASEPRI is available on ARMv7-M only,
+//   and the priority should fit in 8 bits.
+#if defined(__TN_ARCH_CORTEX_M__) && TN_MAX_SYSCALL_PRIORITY
+#  if !defined(__TN_ARCHFEAT_CORTEX_M_ARMv7M_ISA__)
+#     error TN_MAX_SYSCALL_PRIORITY is supported on Cortex-M3/M4/M4F only
+#  endif
+#  if TN_MAX_SYSCALL_PRIORITY > 0xFF
+#     error TN_MAX_SYSCALL_PRIORITY must be less than 0x100
+#  endif
+#endif
+
 //-- check TN_P24_SYS_IPL: should be 1 .. 6.
 #if defined (__TN_ARCH_PIC24_DSPIC__)
 #  if TN_P24_SYS_IPL >= 7
@@ -178,6 +234,19 @@
 #  endif
 #endif
 
+//-- check TN_TRACE_RECS_CNT: should be a power of two
+#if TN_TRACE
+#  if TN_TRACE_RECS_CNT <= 0 || (TN_TRACE_RECS_CNT & (TN_TRACE_RECS_CNT - 1))
+#     error TN_TRACE_RECS_CNT must be a power of two
+#  endif
+#endif
+
+//-- check TN_INT_DIS_STAT: durations are measured by the high-resolution
+//   timestamp only
+#if TN_INT_DIS_STAT && !TN_PROFILER_TIMESTAMP
+#  error TN_INT_DIS_STAT requires TN_PROFILER_TIMESTAMP to be set
+#endif
+
 //-- NOTE: TN_TICK_LISTS_CNT is checked in tn_timer_static.c
 //-- NOTE: TN_PRIORITIES_CNT is checked in tn_sys.c
 //-- NOTE: TN_API_MAKE_ALIG_ARG is checked in tn_common.h
@@ -187,7 +256,7 @@
  * Internal kernel definition: set to non-zero if `_tn_sys_on_context_switch()`
  * should be called on context switch. 
  */
-#if TN_PROFILER || TN_STACK_OVERFLOW_CHECK
+#if TN_PROFILER || TN_STACK_OVERFLOW_CHECK || TN_TRACE
 #  define   _TN_ON_CONTEXT_SWITCH_HANDLER  1
 #else
 #  define   _TN_ON_CONTEXT_SWITCH_HANDLER  0
@@ -73,6 +73,12 @@ enum TN_ObjId {
    TN_ID_TIMER          = (unsigned int)0x1A937FBC,  //!< id for timers
    TN_ID_EXCHANGE       = (unsigned int)0x32b7c072,  //!< id for exchange objects
    TN_ID_EXCHANGE_LINK  = (unsigned int)0x24d36f35,  //!< id for exchange link
+   TN_ID_DPC            = (unsigned int)0x4E8D2A17,  //!< id for DPC objects
+   TN_ID_MSGQUEUE       = (unsigned int)0x7B1E5C93,  //!< id for message queues
+   TN_ID_RING           = (unsigned int)0x3C5D91A6,  //!< id for ring buffers
+   TN_ID_STREAMBUF      = (unsigned int)0x5A2E7F31,  //!< id for stream buffers
+   TN_ID_HEAP           = (unsigned int)0x6C3D1E87,  //!< id for heaps
+   TN_ID_SLAB           = (unsigned int)0x1F6B4D29,  //!< id for slab allocators
 };
 
 /**
@@ -139,6 +145,29 @@ enum TN_RCode {
    TN_RC_INTERNAL             = -10,
 };
 
+/**
+ * Order in which tasks are queued when they wait for some kernel object
+ * (semaphore, data queue, etc). It is given to the object creation services
+ * such as `tn_sem_create_worder()`.
+ */
+enum TN_WaitOrder {
+   ///
+   /// Waiting tasks are queued in FIFO order, regardless of their
+   /// priorities: the task that started waiting first is woken up first.
+   /// This is the default.
+   TN_WAIT_ORDER_FIFO,
+   ///
+   /// Waiting tasks are queued in order of their priorities, so that the
+   /// task with highest priority is woken up first; tasks with equal
+   /// priorities are queued in FIFO order. If priority of the waiting task
+   /// is changed (by `tn_task_change_priority()` or by mutex priority
+   /// inheritance), the task is moved accordingly.
+   ///
+   /// Starting to wait takes time proportional to the number of tasks
+   /// already waiting with the same or higher priority.
+   TN_WAIT_ORDER_PRIORITY,
+};
+
 /**
  * Prototype for task body function.
  */
@@ -0,0 +1,433 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include <string.h>
+
+//-- common tnkernel headers
+#include "tn_common.h"
+#include "tn_sys.h"
+
+//-- internal tnkernel headers
+#include "_tn_tasks.h"
+#include "_tn_timer.h"
+
+
+//-- header of current module
+#include "tn_dpc.h"
+#include "_tn_dpc.h"
+
+//-- header of other needed modules
+#include "tn_tasks.h"
+
+
+
+/*******************************************************************************
+ *    EXTERNAL DATA
+ ******************************************************************************/
+
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+//-- Additional param checking {{{
+#if TN_CHECK_PARAM
+_TN_STATIC_INLINE enum TN_RCode _check_param_create(
+      const struct TN_DPC *dpc,
+      struct TN_DPCItem *items,
+      int items_cnt
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (dpc == TN_NULL || items == TN_NULL || items_cnt <= 0){
+      rc = TN_RC_WPARAM;
+   } else if (_tn_dpc_is_valid(dpc)){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_post(
+      const struct TN_DPC *dpc,
+      TN_DPCFunc *func
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (dpc == TN_NULL || func == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_dpc_is_valid(dpc)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_generic(
+      const struct TN_DPC *dpc
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (dpc == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_dpc_is_valid(dpc)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+#else
+#  define _check_param_create(dpc, items, items_cnt)     (TN_RC_OK)
+#  define _check_param_post(dpc, func)                   (TN_RC_OK)
+#  define _check_param_generic(dpc)                      (TN_RC_OK)
+#endif
+// }}}
+
+
+/**
+ * Write the call to the next slot of the ring buffer, and wake the worker
+ * task up if it waits for the work. Interrupts should be disabled when
+ * calling it.
+ */
+static enum TN_RCode _dpc_post(
+      struct TN_DPC    *dpc,
+      TN_DPCFunc       *func,
+      void             *p_user_data
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (dpc->filled_cnt >= dpc->items_cnt){
+      //-- no free slots: the call is discarded
+      dpc->stat.overflow_cnt++;
+      rc = TN_RC_OVERFLOW;
+   } else {
+      struct TN_DPCItem *item = &dpc->items[ dpc->tail_idx ];
+
+      item->func        = func;
+      item->p_user_data = p_user_data;
+      item->post_time   = _tn_profiler_time_get();
+
+      dpc->tail_idx++;
+      if (dpc->tail_idx >= dpc->items_cnt){
+         dpc->tail_idx = 0;
+      }
+
+      dpc->filled_cnt++;
+      if (dpc->filled_cnt > dpc->stat.backlog_max){
+         dpc->stat.backlog_max = dpc->filled_cnt;
+      }
+
+      //-- wake the worker task up, if it waits for the work.
+      //   (it may be woken up by someone else, so the flag alone isn't
+      //   enough: check the state of the task as well)
+      if (     dpc->worker_waiting
+            && _tn_task_is_waiting(&dpc->worker)
+         )
+      {
+         dpc->worker_waiting = TN_FALSE;
+         _tn_task_wait_complete(&dpc->worker, TN_RC_OK);
+      }
+   }
+
+   return rc;
+}
+
+/**
+ * Call the batch of `batch_cnt` functions, starting from `head_idx`, and
+ * then release their slots. Called by the worker task with interrupts
+ * enabled: ISRs don't touch these slots until they are released.
+ */
+static void _dpc_batch_run(struct TN_DPC *dpc, int batch_cnt)
+{
+   unsigned long latency = 0;
+   unsigned long latency_max = 0;
+   int i;
+   TN_INTSAVE_DATA;
+
+   for (i = 0; i < batch_cnt; i++){
+      struct TN_DPCItem *item = &dpc->items[ dpc->head_idx ];
+
+      latency = _tn_profiler_time_get() - item->post_time;
+      if (latency > latency_max){
+         latency_max = latency;
+      }
+
+      //-- call user function
+      item->func(item->p_user_data);
+
+      dpc->head_idx++;
+      if (dpc->head_idx >= dpc->items_cnt){
+         dpc->head_idx = 0;
+      }
+   }
+
+   TN_INT_DIS_SAVE();
+
+   dpc->filled_cnt -= batch_cnt;
+
+   dpc->stat.done_cnt += batch_cnt;
+   dpc->stat.latency_last = latency;
+   if (latency_max > dpc->stat.latency_max){
+      dpc->stat.latency_max = latency_max;
+   }
+   if (batch_cnt > dpc->stat.batch_max){
+      dpc->stat.batch_max = batch_cnt;
+   }
+
+   TN_INT_RESTORE();
+}
+
+/**
+ * Body of the worker task: take all the pending calls as a batch and call
+ * them; when there are no pending calls, sleep until `_dpc_post()` wakes the
+ * task up.
+ */
+static void _dpc_worker_body(void *par)
+{
+   struct TN_DPC *dpc = (struct TN_DPC *)par;
+
+   for (;;){
+      int batch_cnt;
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      //-- the task might be woken up by someone else (say, by
+      //   `tn_task_wakeup()`), so, clear the flag here as well
+      dpc->worker_waiting = TN_FALSE;
+      batch_cnt = dpc->filled_cnt;
+
+      if (batch_cnt == 0){
+         //-- no pending calls: put current task to sleep
+         dpc->worker_waiting = TN_TRUE;
+         _tn_task_curr_to_wait_action(
+               TN_NULL, TN_WAIT_REASON_SLEEP, TN_WAIT_INFINITE
+               );
+
+         TN_INT_RESTORE();
+         _tn_context_switch_pend_if_needed();
+
+      } else {
+         TN_INT_RESTORE();
+
+         _dpc_batch_run(dpc, batch_cnt);
+      }
+   }
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * See comments in the header file (tn_dpc.h)
+ */
+enum TN_RCode tn_dpc_create(
+      struct TN_DPC       *dpc,
+      struct TN_DPCItem   *items,
+      int                  items_cnt,
+      TN_UWord            *task_stack_low_addr,
+      int                  task_stack_size,
+      int                  priority
+      )
+{
+   enum TN_RCode rc = _check_param_create(dpc, items, items_cnt);
+   enum TN_Context context = tn_sys_context_get();
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (context != TN_CONTEXT_TASK && context != TN_CONTEXT_NONE){
+      //-- Note: just like `tn_task_create()`, it is allowed to have
+      //   `#TN_CONTEXT_NONE` here, since it might be called from
+      //   `tn_sys_start()`
+      rc = TN_RC_WCONTEXT;
+   } else {
+      dpc->items           = items;
+      dpc->items_cnt       = items_cnt;
+      dpc->filled_cnt      = 0;
+      dpc->tail_idx        = 0;
+      dpc->head_idx        = 0;
+      dpc->worker_waiting  = TN_FALSE;
+
+      memset(&dpc->stat, 0x00, sizeof(dpc->stat));
+
+      rc = tn_task_create_wname(
+            &dpc->worker,                 //-- task TCB
+            _dpc_worker_body,             //-- task function
+            priority,                     //-- task priority
+            task_stack_low_addr,          //-- task stack
+            task_stack_size,              //-- task stack size
+                                          //   (in int, not bytes)
+            dpc,                          //-- task function parameter
+            TN_TASK_CREATE_OPT_START,     //-- Creation option
+            "DPC"                         //-- Task name
+            );
+
+      if (rc == TN_RC_OK){
+         dpc->id_dpc = TN_ID_DPC;
+      }
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_dpc.h)
+ */
+enum TN_RCode tn_dpc_delete(struct TN_DPC *dpc)
+{
+   enum TN_RCode rc = _check_param_generic(dpc);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context() || _tn_curr_run_task == &dpc->worker){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+      dpc->id_dpc = TN_ID_NONE;     //-- DPC object does not exist now
+      TN_INT_RESTORE();
+
+      rc = tn_task_terminate(&dpc->worker);
+      if (rc == TN_RC_OK){
+         rc = tn_task_delete(&dpc->worker);
+      }
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_dpc.h)
+ */
+enum TN_RCode tn_dpc_post(
+      struct TN_DPC    *dpc,
+      TN_DPCFunc       *func,
+      void             *p_user_data
+      )
+{
+   enum TN_RCode rc = _check_param_post(dpc, func);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+      rc = _dpc_post(dpc, func, p_user_data);
+      TN_INT_RESTORE();
+
+      //-- worker task might have been woken up
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_dpc.h)
+ */
+enum TN_RCode tn_dpc_ipost(
+      struct TN_DPC    *dpc,
+      TN_DPCFunc       *func,
+      void             *p_user_data
+      )
+{
+   enum TN_RCode rc = _check_param_post(dpc, func);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+      rc = _dpc_post(dpc, func, p_user_data);
+      TN_INT_IRESTORE();
+
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_dpc.h)
+ */
+enum TN_RCode tn_dpc_stat_get(
+      struct TN_DPC       *dpc,
+      struct TN_DPCStat   *p_stat,
+      TN_BOOL              reset
+      )
+{
+   enum TN_RCode rc = _check_param_generic(dpc);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (p_stat == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      *p_stat = dpc->stat;
+      if (reset){
+         memset(&dpc->stat, 0x00, sizeof(dpc->stat));
+      }
+
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
@@ -0,0 +1,366 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/**
+ * \file
+ *
+ * Deferred procedure calls (DPC): a way for ISR to defer the heavy work to
+ * the task.
+ *
+ * A DPC object has a ring buffer of pending calls (each call is a function
+ * and an argument for it) and the dedicated worker task, which is created
+ * together with the object. ISR posts the call by `tn_dpc_ipost()`, and the
+ * worker task calls functions in the order they were posted, with interrupts
+ * enabled.
+ *
+ * Posting the call is as cheap as possible: the call is written to the next
+ * slot of the ring buffer, and if the worker task waits for the work, it is
+ * woken up; there are no wait queues to walk through. Interrupts are disabled
+ * for just a few instructions, only to serialize nested ISRs. The worker task
+ * doesn't disable interrupts while calling functions: it takes all the calls
+ * pending at the moment as a batch, calls them one by one, and only then
+ * releases the whole batch of slots.
+ *
+ * The priority of the worker task is given to `tn_dpc_create()`. If
+ * different calls need different priorities, create several DPC objects:
+ * each of them has its own ring buffer and its own worker task.
+ *
+ * Since the worker task calls all the functions one by one, they must never
+ * wait: otherwise, the calls posted later are delayed.
+ *
+ * Drain latency, i.e. the time from the moment call is posted until the
+ * function is called, is measured for each call: see `struct #TN_DPCStat`.
+ * It is measured in the same units as the profiler does: in system ticks, or
+ * by the high-resolution timestamp if `#TN_PROFILER_TIMESTAMP` is non-zero.
+ *
+ * Example:
+ *
+ * \code{.c}
+ *    #define MY_DPC_ITEMS_CNT      16
+ *    #define MY_DPC_STACK_SIZE     (TN_MIN_STACK_SIZE + 64)
+ *    #define MY_DPC_PRIORITY       1
+ *
+ *    TN_STACK_ARR_DEF(my_dpc_stack, MY_DPC_STACK_SIZE);
+ *
+ *    static struct TN_DPCItem my_dpc_items[ MY_DPC_ITEMS_CNT ];
+ *    static struct TN_DPC my_dpc;
+ *
+ *    static void uart_rx_process(void *p_user_data)
+ *    {
+ *       //-- heavy work here: called by the worker task,
+ *       //   with interrupts enabled
+ *    }
+ *
+ *    void init_task_create(void)
+ *    {
+ *       tn_dpc_create(
+ *             &my_dpc, my_dpc_items, MY_DPC_ITEMS_CNT,
+ *             my_dpc_stack, MY_DPC_STACK_SIZE, MY_DPC_PRIORITY
+ *             );
+ *    }
+ *
+ *    void uart_rx_isr(void)
+ *    {
+ *       //-- do the minimum, and defer the rest to the worker task
+ *       tn_dpc_ipost(&my_dpc, uart_rx_process, TN_NULL);
+ *    }
+ * \endcode
+ */
+
+#ifndef _TN_DPC_H
+#define _TN_DPC_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_common.h"
+#include "tn_tasks.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {     /*}*/
+#endif
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Prototype of the function which is called by the worker task of DPC
+ * object, see `tn_dpc_ipost()`.
+ *
+ * @param p_user_data
+ *    User data as it was given to `tn_dpc_ipost()` or `tn_dpc_post()`.
+ */
+typedef void (TN_DPCFunc)(void *p_user_data);
+
+/**
+ * One slot of the ring buffer of DPC object. The application should just
+ * provide an array of these, see `tn_dpc_create()`.
+ */
+struct TN_DPCItem {
+   ///
+   /// Function to call
+   TN_DPCFunc       *func;
+   ///
+   /// User data to give to `func`
+   void             *p_user_data;
+   ///
+   /// Time when the call was posted (see `_tn_profiler_time_get()`)
+   unsigned long     post_time;
+};
+
+/**
+ * Statistics of DPC object, see `tn_dpc_stat_get()`.
+ */
+struct TN_DPCStat {
+   ///
+   /// Maximum number of calls which were pending at once
+   int               backlog_max;
+   ///
+   /// Maximum number of calls taken by the worker task as a single batch
+   int               batch_max;
+   ///
+   /// Number of calls which were discarded because the ring buffer was full
+   unsigned long     overflow_cnt;
+   ///
+   /// Number of calls done by the worker task
+   unsigned long     done_cnt;
+   ///
+   /// Latency of the last call done: time from the moment call was posted
+   /// until the function was called
+   unsigned long     latency_last;
+   ///
+   /// Maximum latency of call, see `latency_last`
+   unsigned long     latency_max;
+};
+
+/**
+ * DPC object
+ */
+struct TN_DPC {
+   ///
+   /// id for object validity verification.
+   /// This field is in the beginning of the structure to make it easier
+   /// to detect memory corruption.
+   enum TN_ObjId        id_dpc;
+   ///
+   /// Ring buffer of pending calls
+   struct TN_DPCItem   *items;
+   ///
+   /// Capacity of the ring buffer (count of elements in `items` array)
+   int                  items_cnt;
+   ///
+   /// Number of slots taken: pending calls plus the calls of the batch which
+   /// is being handled by the worker task
+   int                  filled_cnt;
+   ///
+   /// Index of the slot to write the next call to; modified by `ipost`
+   int                  tail_idx;
+   ///
+   /// Index of the next call to be done; modified by the worker task only
+   int                  head_idx;
+   ///
+   /// Whether the worker task sleeps waiting for the calls
+   TN_BOOL              worker_waiting;
+   ///
+   /// Statistics, see `tn_dpc_stat_get()`
+   struct TN_DPCStat    stat;
+   ///
+   /// The worker task
+   struct TN_Task       worker;
+};
+
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Construct DPC object, and create and start its worker task. `id_dpc`
+ * member should not contain `#TN_ID_DPC`, otherwise, `#TN_RC_WPARAM` is
+ * returned.
+ *
+ * Just like `tn_task_create()`, it may be called from the callback
+ * `#TN_CBUserTaskCreate` given to `tn_sys_start()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param dpc
+ *    Pointer to already allocated `struct #TN_DPC`
+ * @param items
+ *    Pointer to already allocated array of `struct #TN_DPCItem`: the ring
+ *    buffer of pending calls
+ * @param items_cnt
+ *    Count of elements in the `items` array: maximum number of pending
+ *    calls. Should be more than 0.
+ * @param task_stack_low_addr
+ *    Pointer to the stack for the worker task, see `tn_task_create()`
+ * @param task_stack_size
+ *    Size of the stack for the worker task, in words (not bytes)
+ * @param priority
+ *    Priority of the worker task
+ *
+ * @return
+ *    * `#TN_RC_OK` if DPC object was successfully created;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Otherwise, the code returned by `tn_task_create()`;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
+ *      is available: `#TN_RC_WPARAM`.
+ */
+enum TN_RCode tn_dpc_create(
+      struct TN_DPC       *dpc,
+      struct TN_DPCItem   *items,
+      int                  items_cnt,
+      TN_UWord            *task_stack_low_addr,
+      int                  task_stack_size,
+      int                  priority
+      );
+
+/**
+ * Destruct DPC object: terminate and delete its worker task. The calls which
+ * are pending at the moment are discarded; if the worker task is in the
+ * middle of some function (i.e. it was preempted), the function is aborted,
+ * so it's better to delete DPC object when there is nothing to do for it.
+ *
+ * Must not be called from the function called by the worker task of the same
+ * DPC object.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param dpc     DPC object to delete
+ *
+ * @return
+ *    * `#TN_RC_OK` if DPC object was successfully deleted;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_dpc_delete(struct TN_DPC *dpc);
+
+/**
+ * Post the call: `func(p_user_data)` will be called by the worker task of
+ * the DPC object, after all the calls posted earlier. Never waits: if the
+ * ring buffer is full, the call is discarded and counted in
+ * `#TN_DPCStat::overflow_cnt`.
+ *
+ * Typically, calls are posted from ISR by `tn_dpc_ipost()`; this function
+ * is the same, but it should be called from task.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param dpc           DPC object
+ * @param func          function to call, must not be `#TN_NULL`
+ * @param p_user_data   user data to give to `func`
+ *
+ * @return
+ *    * `#TN_RC_OK` if the call was successfully posted;
+ *    * `#TN_RC_OVERFLOW` if the ring buffer is full;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_dpc_post(
+      struct TN_DPC    *dpc,
+      TN_DPCFunc       *func,
+      void             *p_user_data
+      );
+
+/**
+ * The same as `tn_dpc_post()`, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_dpc_ipost(
+      struct TN_DPC    *dpc,
+      TN_DPCFunc       *func,
+      void             *p_user_data
+      );
+
+/**
+ * Get statistics of DPC object: backlog, overflows and drain latency.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param dpc        DPC object
+ * @param p_stat     pointer to the structure where statistics is stored
+ * @param reset      if `TN_TRUE`, statistics is reset after it is copied
+ *                   to `p_stat`
+ *
+ * @return
+ *    * `#TN_RC_OK` if statistics was successfully copied;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_dpc_stat_get(
+      struct TN_DPC       *dpc,
+      struct TN_DPCStat   *p_stat,
+      TN_BOOL              reset
+      );
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_DPC_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
+
+
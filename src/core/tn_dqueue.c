@@ -45,7 +45,9 @@
 //-- internal tnkernel headers
 #include "_tn_eventgrp.h"
 #include "_tn_tasks.h"
+#include "_tn_timer.h"
 #include "_tn_list.h"
+#include "_tn_trace.h"
 
 
 #include "tn_dqueue.h"
@@ -95,14 +97,20 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_generic(
 _TN_STATIC_INLINE enum TN_RCode _check_param_create(
       const struct TN_DQueue *dque,
       void **data_fifo,
-      int items_cnt
+      int items_cnt,
+      enum TN_WaitOrder wait_order
       )
 {
    enum TN_RCode rc = TN_RC_OK;
 
    if (dque == TN_NULL){
       rc = TN_RC_WPARAM;
-   } else if (items_cnt < 0 || _tn_dqueue_is_valid(dque)){
+   } else if (0
+         || items_cnt < 0
+         || _tn_dqueue_is_valid(dque)
+         || !_tn_wait_order_is_valid(wait_order)
+         )
+   {
       rc = TN_RC_WPARAM;
    }
 
@@ -118,10 +126,31 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_read(
    return (pp_data == TN_NULL) ? TN_RC_WPARAM : TN_RC_OK;
 }
 
+_TN_STATIC_INLINE enum TN_RCode _check_param_multi(
+      const struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt,
+      int *p_done_cnt
+      )
+{
+   enum TN_RCode rc = _check_param_generic(dque);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (p_data_arr == TN_NULL || data_cnt <= 0 || p_done_cnt == TN_NULL){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
 #else
 #  define _check_param_generic(dque)                        (TN_RC_OK)
-#  define _check_param_create(dque, data_fifo, items_cnt)   (TN_RC_OK)
+#  define _check_param_create(dque, data_fifo, items_cnt, wait_order)  \
+                                                            (TN_RC_OK)
 #  define _check_param_read(pp_data)                        (TN_RC_OK)
+#  define _check_param_multi(dque, p_data_arr, data_cnt, p_done_cnt)   \
+                                                            (TN_RC_OK)
 #endif
 // }}}
 
@@ -206,6 +235,83 @@ static enum TN_RCode _fifo_read(struct TN_DQueue *dque, void **pp_data)
 
    return rc;
 }
+
+/**
+ * Write as many items from `p_data_arr` to the FIFO as there is room for,
+ * but not more than `data_cnt`. The connected event group (if any) is
+ * updated once.
+ *
+ * @return
+ *    Number of items written
+ */
+static int _fifo_write_multi(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt
+      )
+{
+   int free_cnt = dque->items_cnt - dque->filled_items_cnt;
+   int cnt = (data_cnt < free_cnt) ? data_cnt : free_cnt;
+   int i;
+
+   for (i = 0; i < cnt; i++){
+      dque->data_fifo[dque->head_idx] = p_data_arr[i];
+      dque->head_idx++;
+      if (dque->head_idx >= dque->items_cnt){
+         dque->head_idx = 0;
+      }
+   }
+
+   if (cnt > 0){
+      dque->filled_items_cnt += cnt;
+
+      //-- set flag in the connected event group (if any),
+      //   indicating that there are messages in the queue
+      _tn_eventgrp_link_manage(&dque->eventgrp_link, TN_TRUE);
+   }
+
+   return cnt;
+}
+
+/**
+ * Read as many items from the FIFO to `pp_data_arr` as there are in the
+ * FIFO, but not more than `data_cnt`. The connected event group (if any) is
+ * updated once.
+ *
+ * @return
+ *    Number of items read
+ */
+static int _fifo_read_multi(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt
+      )
+{
+   int cnt = (data_cnt < dque->filled_items_cnt)
+      ? data_cnt
+      : dque->filled_items_cnt;
+   int i;
+
+   for (i = 0; i < cnt; i++){
+      pp_data_arr[i] = dque->data_fifo[dque->tail_idx];
+      dque->tail_idx++;
+      if (dque->tail_idx >= dque->items_cnt){
+         dque->tail_idx = 0;
+      }
+   }
+
+   if (cnt > 0){
+      dque->filled_items_cnt -= cnt;
+
+      if (dque->filled_items_cnt == 0){
+         //-- clear flag in the connected event group (if any),
+         //   indicating that there are no messages in the queue
+         _tn_eventgrp_link_manage(&dque->eventgrp_link, TN_FALSE);
+      }
+   }
+
+   return cnt;
+}
 // }}}
 
 /**
@@ -222,6 +328,11 @@ static void _cb_before_task_wait_complete__send(
 {
    //-- before task is woken up, set data that it is waiting for
    task->subsys_wait.dqueue.data_elem = user_data_1;
+
+   //-- user_data_2 is the queue, it's needed for the trace only: the data
+   //   bypasses the FIFO, so, trace both sending and receiving here
+   _tn_trace(TN_TRACE_EV_QUEUE_SEND, user_data_2, (TN_UWord)user_data_1);
+   _tn_trace(TN_TRACE_EV_QUEUE_RECEIVE, user_data_2, (TN_UWord)user_data_1);
    _TN_UNUSED(user_data_2);
 }
 
@@ -244,6 +355,10 @@ static void _cb_before_task_wait_complete__receive_ok(
    if (rc != TN_RC_OK){
       _TN_FATAL_ERROR("rc should always be TN_RC_OK here");
    }
+   _tn_trace(
+         TN_TRACE_EV_QUEUE_SEND, dque,
+         (TN_UWord)task->subsys_wait.dqueue.data_elem
+         );
    _TN_UNUSED(user_data_2);
 }
 
@@ -264,6 +379,9 @@ static void _cb_before_task_wait_complete__receive_timeout(
    void **pp_data = (void **)user_data_1;
 
    *pp_data = task->subsys_wait.dqueue.data_elem; //-- Return to caller
+
+   //-- user_data_2 is the queue, it's needed for the trace only
+   _tn_trace(TN_TRACE_EV_QUEUE_SEND, user_data_2, (TN_UWord)*pp_data);
    _TN_UNUSED(user_data_2);
 }
 
@@ -311,12 +429,16 @@ static enum TN_RCode _queue_send(
 
    if (  !_tn_task_first_wait_complete(
             &dque->wait_receive_list, TN_RC_OK,
-            _cb_before_task_wait_complete__send, p_data, TN_NULL
+            _cb_before_task_wait_complete__send, p_data, dque
             )
       )
    {
       //-- the data queue's wait_receive list is empty
       rc = _fifo_write(dque, p_data);
+
+      if (rc == TN_RC_OK){
+         _tn_trace(TN_TRACE_EV_QUEUE_SEND, dque, (TN_UWord)p_data);
+      }
    }
 
    return rc;
@@ -373,7 +495,7 @@ static enum TN_RCode _queue_receive(
          //   (that might happen if only dque->items_cnt is 0)
          if (  _tn_task_first_wait_complete(
                   &dque->wait_send_list, TN_RC_OK,
-                  _cb_before_task_wait_complete__receive_timeout, pp_data, TN_NULL
+                  _cb_before_task_wait_complete__receive_timeout, pp_data, dque
                   )
             )
          {
@@ -395,9 +517,132 @@ static enum TN_RCode _queue_receive(
          break;
    }
 
+   if (rc == TN_RC_OK){
+      _tn_trace(TN_TRACE_EV_QUEUE_RECEIVE, dque, (TN_UWord)*pp_data);
+   }
+
    return rc;
 }
 
+/**
+ * Actual worker function that sends a batch of items through the queue.
+ * Eventually called when user calls one of these functions:
+ *
+ * - `tn_queue_send_multi()`
+ * - `tn_queue_send_multi_polling()`
+ * - `tn_queue_isend_multi_polling()`
+ *
+ * Just like `_queue_send()`, first of all, it gives items to the tasks that
+ * wait for new data, one item per task; then, the rest of items is written
+ * to the FIFO, as many as there is room for. Interrupts should be disabled
+ * when calling it.
+ *
+ * @return
+ *    Number of items sent
+ */
+static int _queue_send_multi(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt
+      )
+{
+   int sent_cnt = 0;
+   int i;
+
+   //-- if there are tasks waiting for data, the FIFO is empty: give items
+   //   to these tasks right away
+   while (     sent_cnt < data_cnt
+            && _tn_task_first_wait_complete(
+               &dque->wait_receive_list, TN_RC_OK,
+               _cb_before_task_wait_complete__send,
+               p_data_arr[sent_cnt], dque
+               )
+         )
+   {
+      sent_cnt++;
+   }
+
+   //-- write the rest to the FIFO
+   i = sent_cnt;
+   sent_cnt += _fifo_write_multi(
+         dque, p_data_arr + sent_cnt, data_cnt - sent_cnt
+         );
+
+   for (; i < sent_cnt; i++){
+      _tn_trace(TN_TRACE_EV_QUEUE_SEND, dque, (TN_UWord)p_data_arr[i]);
+   }
+
+   return sent_cnt;
+}
+
+/**
+ * Actual worker function that receives a batch of items from the queue.
+ * Eventually called when user calls one of these functions:
+ *
+ * - `tn_queue_receive_multi()`
+ * - `tn_queue_receive_multi_polling()`
+ * - `tn_queue_ireceive_multi_polling()`
+ *
+ * It reads as many items from the FIFO as there are, but not more than
+ * `data_cnt`; as room is freed, data of the tasks which wait to send is
+ * moved to the FIFO, and these tasks are woken up. If the FIFO has no room
+ * at all (`items_cnt` is 0), data is taken right from the waiting tasks.
+ * Interrupts should be disabled when calling it.
+ *
+ * @return
+ *    Number of items received
+ */
+static int _queue_receive_multi(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt
+      )
+{
+   int received_cnt = 0;
+   int moved_cnt;
+   int i;
+
+   do {
+      received_cnt += _fifo_read_multi(
+            dque, pp_data_arr + received_cnt, data_cnt - received_cnt
+            );
+
+      //-- there is room now: move data of the tasks that wait to send
+      //   to the FIFO, and wake them up
+      moved_cnt = 0;
+      while (     dque->filled_items_cnt < dque->items_cnt
+               && _tn_task_first_wait_complete(
+                  &dque->wait_send_list, TN_RC_OK,
+                  _cb_before_task_wait_complete__receive_ok, dque, TN_NULL
+                  )
+            )
+      {
+         moved_cnt++;
+      }
+
+      //-- if some data was moved, and we still want more, read it as well
+   } while (moved_cnt > 0 && received_cnt < data_cnt);
+
+   //-- take data right from the tasks that wait to send
+   //   (that might happen if only dque->items_cnt is 0)
+   while (     received_cnt < data_cnt
+            && _tn_task_first_wait_complete(
+               &dque->wait_send_list, TN_RC_OK,
+               _cb_before_task_wait_complete__receive_timeout,
+               &pp_data_arr[received_cnt], dque
+               )
+         )
+   {
+      received_cnt++;
+   }
+
+   for (i = 0; i < received_cnt; i++){
+      _tn_trace(TN_TRACE_EV_QUEUE_RECEIVE, dque, (TN_UWord)pp_data_arr[i]);
+   }
+
+   return received_cnt;
+}
+
 
 /**
  * Intermediary function that is called by queue-related services
@@ -421,13 +666,17 @@ static enum TN_RCode _queue_receive(
  *    - `_JOB_TYPE__SEND`: data to send;
  *    - `_JOB_TYPE__RECEIVE`: pointer at which data should be received.
  * @param timeout
- *    Refer to `#TN_TickCnt`.
+ *    Refer to `#TN_TickCnt`; if `is_deadline` is `TN_TRUE`, it is the
+ *    absolute deadline instead.
+ * @param is_deadline
+ *    Whether `timeout` is the deadline, see `_tn_timeout_resolve()`.
  */
 static enum TN_RCode _dqueue_job_perform(
       struct TN_DQueue *dque,
       enum _JobType job_type,
       void *p_data,
-      TN_TickCnt timeout
+      TN_TickCnt timeout,
+      TN_BOOL is_deadline
       )
 {
    TN_BOOL waited = TN_FALSE;
@@ -449,6 +698,12 @@ static enum TN_RCode _dqueue_job_perform(
             //-- try to put new item to the queue
             rc = _queue_send(dque, p_data);
 
+            //-- if deadline is given, it is converted to timeout right here,
+            //   with interrupts disabled
+            if (rc == TN_RC_TIMEOUT){
+               timeout = _tn_timeout_resolve(timeout, is_deadline);
+            }
+
             if (rc == TN_RC_TIMEOUT && timeout != 0){
                //-- We can't put new item to the queue right now (queue is
                //   full), and user asked to wait if that happens.
@@ -457,8 +712,9 @@ static enum TN_RCode _dqueue_job_perform(
                //   field, and put current task to wait until there's room in
                //   the queue.
                _tn_curr_run_task->subsys_wait.dqueue.data_elem = p_data;
-               _tn_task_curr_to_wait_action(
+               _tn_task_curr_to_wait_action_ordered(
                      &(dque->wait_send_list),
+                     dque->wait_order,
                      TN_WAIT_REASON_DQUE_WSEND,
                      timeout
                      );
@@ -471,13 +727,18 @@ static enum TN_RCode _dqueue_job_perform(
             //-- try to get the item from the queue
             rc = _queue_receive(dque, pp_data);
 
+            if (rc == TN_RC_TIMEOUT){
+               timeout = _tn_timeout_resolve(timeout, is_deadline);
+            }
+
             if (rc == TN_RC_TIMEOUT && timeout != 0){
                //-- Queue is empty right now, and user asked to wait if that
                //   happens.
                //
                //   Put current task to wait until new data comes.
-               _tn_task_curr_to_wait_action(
+               _tn_task_curr_to_wait_action_ordered(
                      &(dque->wait_receive_list),
+                     dque->wait_order,
                      TN_WAIT_REASON_DQUE_WRECEIVE,
                      timeout
                      );
@@ -572,6 +833,217 @@ static enum TN_RCode _dqueue_job_iperform(
    return rc;
 }
 
+/**
+ * Intermediary function that is called by batch queue-related services
+ * (`tn_queue_send_multi()`, `tn_queue_receive_multi()`, etc), which performs
+ * all necessary housekeeping and calls `_queue_send_multi()` or
+ * `_queue_receive_multi()` depending on given `job_type`.
+ *
+ * Sending is done when all the items are sent: if the queue gets full, the
+ * task waits for the room until all the items are sent or `timeout` expires
+ * (`timeout` is for the whole batch, not for each item).
+ *
+ * Receiving is done when at least one item is received: the task waits
+ * if only the queue is empty.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param dque
+ *    Data queue on which job should be performed.
+ * @param job_type
+ *    Type of job to perform.
+ * @param pp_data_arr
+ *    Items to send or array to receive items to, depending on `job_type`.
+ * @param data_cnt
+ *    Number of items in the `pp_data_arr`.
+ * @param p_done_cnt
+ *    Location to store number of items actually sent or received.
+ * @param timeout
+ *    Refer to `#TN_TickCnt`.
+ */
+static enum TN_RCode _dqueue_multi_job_perform(
+      struct TN_DQueue *dque,
+      enum _JobType job_type,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_done_cnt,
+      TN_TickCnt timeout
+      )
+{
+   int done_cnt = 0;
+   enum TN_RCode rc = _check_param_multi(
+         dque, pp_data_arr, data_cnt, p_done_cnt
+         );
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_TickCnt start_tick_cnt = tn_sys_time_get();
+      TN_TickCnt timeout_left = timeout;
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      switch (job_type){
+
+         case _JOB_TYPE__SEND:
+            for (;;){
+               done_cnt += _queue_send_multi(
+                     dque, pp_data_arr + done_cnt, data_cnt - done_cnt
+                     );
+
+               if (done_cnt == data_cnt || timeout_left == 0){
+                  TN_INT_RESTORE();
+                  _tn_context_switch_pend_if_needed();
+
+                  rc = (done_cnt == data_cnt) ? TN_RC_OK : TN_RC_TIMEOUT;
+                  break;
+               }
+
+               //-- The queue is full, and user asked to wait if that
+               //   happens: wait until the next item is taken by the
+               //   receiver, just like `tn_queue_send()` does.
+               _tn_curr_run_task->subsys_wait.dqueue.data_elem
+                  = pp_data_arr[done_cnt];
+               _tn_task_curr_to_wait_action_ordered(
+                     &(dque->wait_send_list),
+                     dque->wait_order,
+                     TN_WAIT_REASON_DQUE_WSEND,
+                     timeout_left
+                     );
+
+               TN_INT_RESTORE();
+               _tn_context_switch_pend_if_needed();
+
+               rc = _tn_curr_run_task->task_wait_rc;
+               if (rc != TN_RC_OK){
+                  break;
+               }
+               done_cnt++;
+
+               //-- the rest of timeout is for the rest of items
+               if (timeout != TN_WAIT_INFINITE){
+                  TN_TickCnt elapsed = tn_sys_time_get() - start_tick_cnt;
+                  timeout_left = (elapsed < timeout) ? (timeout - elapsed) : 0;
+               }
+
+               TN_INT_DIS_SAVE();
+
+               if (!_tn_dqueue_is_valid(dque)){
+                  //-- the queue is deleted while we were running
+                  TN_INT_RESTORE();
+                  rc = TN_RC_DELETED;
+                  break;
+               }
+            }
+            break;
+
+         case _JOB_TYPE__RECEIVE:
+            done_cnt = _queue_receive_multi(dque, pp_data_arr, data_cnt);
+
+            if (done_cnt == 0 && timeout != 0){
+               //-- Queue is empty right now, and user asked to wait if that
+               //   happens.
+               //
+               //   Put current task to wait until new data comes.
+               _tn_task_curr_to_wait_action_ordered(
+                     &(dque->wait_receive_list),
+                     dque->wait_order,
+                     TN_WAIT_REASON_DQUE_WRECEIVE,
+                     timeout
+                     );
+
+               TN_INT_RESTORE();
+               _tn_context_switch_pend_if_needed();
+
+               rc = _tn_curr_run_task->task_wait_rc;
+               if (rc == TN_RC_OK){
+                  pp_data_arr[0]
+                     = _tn_curr_run_task->subsys_wait.dqueue.data_elem;
+                  done_cnt = 1;
+
+                  //-- more data might have come while we were waking up:
+                  //   take it as well
+                  TN_INT_DIS_SAVE();
+                  if (_tn_dqueue_is_valid(dque)){
+                     done_cnt += _queue_receive_multi(
+                           dque, pp_data_arr + 1, data_cnt - 1
+                           );
+                  }
+                  TN_INT_RESTORE();
+                  _tn_context_switch_pend_if_needed();
+               }
+            } else {
+               TN_INT_RESTORE();
+               _tn_context_switch_pend_if_needed();
+
+               rc = (done_cnt > 0) ? TN_RC_OK : TN_RC_TIMEOUT;
+            }
+            break;
+      }
+
+      *p_done_cnt = done_cnt;
+   }
+
+   return rc;
+}
+
+/**
+ * The same as `_dqueue_multi_job_perform()` with zero timeout, but for using
+ * in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+static enum TN_RCode _dqueue_multi_job_iperform(
+      struct TN_DQueue *dque,
+      enum _JobType job_type,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_done_cnt
+      )
+{
+   int done_cnt = 0;
+   enum TN_RCode rc = _check_param_multi(
+         dque, pp_data_arr, data_cnt, p_done_cnt
+         );
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      //-- wrong context
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      switch (job_type){
+         case _JOB_TYPE__SEND:
+            done_cnt = _queue_send_multi(dque, pp_data_arr, data_cnt);
+            rc = (done_cnt == data_cnt) ? TN_RC_OK : TN_RC_TIMEOUT;
+            break;
+
+         case _JOB_TYPE__RECEIVE:
+            done_cnt = _queue_receive_multi(dque, pp_data_arr, data_cnt);
+            rc = (done_cnt > 0) ? TN_RC_OK : TN_RC_TIMEOUT;
+            break;
+      }
+
+      TN_INT_IRESTORE();
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+
+      *p_done_cnt = done_cnt;
+   }
+
+   return rc;
+}
+
 
 
 
@@ -583,15 +1055,16 @@ static enum TN_RCode _dqueue_job_iperform(
 /*
  * See comments in the header file (tn_dqueue.h)
  */
-enum TN_RCode tn_queue_create(
+enum TN_RCode tn_queue_create_worder(
       struct TN_DQueue *dque,
       void **data_fifo,
-      int items_cnt
+      int items_cnt,
+      enum TN_WaitOrder wait_order
       )
 {
    enum TN_RCode rc = TN_RC_OK;
 
-   rc = _check_param_create(dque, data_fifo, items_cnt);
+   rc = _check_param_create(dque, data_fifo, items_cnt, wait_order);
    if (rc != TN_RC_OK){
       //-- just return rc as it is
    } else {
@@ -600,6 +1073,7 @@ enum TN_RCode tn_queue_create(
 
       dque->data_fifo         = data_fifo;
       dque->items_cnt         = items_cnt;
+      dque->wait_order        = wait_order;
 
       _tn_eventgrp_link_reset(&dque->eventgrp_link);
 
@@ -664,7 +1138,9 @@ enum TN_RCode tn_queue_send(
       TN_TickCnt timeout
       )
 {
-   return _dqueue_job_perform(dque, _JOB_TYPE__SEND, p_data, timeout);
+   return _dqueue_job_perform(
+         dque, _JOB_TYPE__SEND, p_data, timeout, TN_FALSE
+         );
 }
 
 
@@ -673,7 +1149,7 @@ enum TN_RCode tn_queue_send(
  */
 enum TN_RCode tn_queue_send_polling(struct TN_DQueue *dque, void *p_data)
 {
-   return _dqueue_job_perform(dque, _JOB_TYPE__SEND, p_data, 0);
+   return _dqueue_job_perform(dque, _JOB_TYPE__SEND, p_data, 0, TN_FALSE);
 }
 
 
@@ -695,7 +1171,23 @@ enum TN_RCode tn_queue_receive(
       TN_TickCnt timeout
       )
 {
-   return _dqueue_job_perform(dque, _JOB_TYPE__RECEIVE, pp_data, timeout);
+   return _dqueue_job_perform(
+         dque, _JOB_TYPE__RECEIVE, pp_data, timeout, TN_FALSE
+         );
+}
+
+/*
+ * See comments in the header file (tn_dqueue.h)
+ */
+enum TN_RCode tn_queue_receive_until(
+      struct TN_DQueue *dque,
+      void **pp_data,
+      TN_TickCnt deadline
+      )
+{
+   return _dqueue_job_perform(
+         dque, _JOB_TYPE__RECEIVE, pp_data, deadline, TN_TRUE
+         );
 }
 
 
@@ -704,7 +1196,9 @@ enum TN_RCode tn_queue_receive(
  */
 enum TN_RCode tn_queue_receive_polling(struct TN_DQueue *dque, void **pp_data)
 {
-   return _dqueue_job_perform(dque, _JOB_TYPE__RECEIVE, pp_data, 0);
+   return _dqueue_job_perform(
+         dque, _JOB_TYPE__RECEIVE, pp_data, 0, TN_FALSE
+         );
 }
 
 
@@ -716,6 +1210,100 @@ enum TN_RCode tn_queue_ireceive_polling(struct TN_DQueue *dque, void **pp_data)
    return _dqueue_job_iperform(dque, _JOB_TYPE__RECEIVE, pp_data);
 }
 
+/*
+ * See comments in the header file (tn_dqueue.h)
+ */
+enum TN_RCode tn_queue_send_multi(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt,
+      int *p_sent_cnt,
+      TN_TickCnt timeout
+      )
+{
+   return _dqueue_multi_job_perform(
+         dque, _JOB_TYPE__SEND, (void **)p_data_arr, data_cnt, p_sent_cnt,
+         timeout
+         );
+}
+
+/*
+ * See comments in the header file (tn_dqueue.h)
+ */
+enum TN_RCode tn_queue_send_multi_polling(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt,
+      int *p_sent_cnt
+      )
+{
+   return _dqueue_multi_job_perform(
+         dque, _JOB_TYPE__SEND, (void **)p_data_arr, data_cnt, p_sent_cnt, 0
+         );
+}
+
+/*
+ * See comments in the header file (tn_dqueue.h)
+ */
+enum TN_RCode tn_queue_isend_multi_polling(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt,
+      int *p_sent_cnt
+      )
+{
+   return _dqueue_multi_job_iperform(
+         dque, _JOB_TYPE__SEND, (void **)p_data_arr, data_cnt, p_sent_cnt
+         );
+}
+
+/*
+ * See comments in the header file (tn_dqueue.h)
+ */
+enum TN_RCode tn_queue_receive_multi(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_received_cnt,
+      TN_TickCnt timeout
+      )
+{
+   return _dqueue_multi_job_perform(
+         dque, _JOB_TYPE__RECEIVE, pp_data_arr, data_cnt, p_received_cnt,
+         timeout
+         );
+}
+
+/*
+ * See comments in the header file (tn_dqueue.h)
+ */
+enum TN_RCode tn_queue_receive_multi_polling(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_received_cnt
+      )
+{
+   return _dqueue_multi_job_perform(
+         dque, _JOB_TYPE__RECEIVE, pp_data_arr, data_cnt, p_received_cnt, 0
+         );
+}
+
+/*
+ * See comments in the header file (tn_dqueue.h)
+ */
+enum TN_RCode tn_queue_ireceive_multi_polling(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_received_cnt
+      )
+{
+   return _dqueue_multi_job_iperform(
+         dque, _JOB_TYPE__RECEIVE, pp_data_arr, data_cnt, p_received_cnt
+         );
+}
+
 /*
  * See comments in the header file (tn_dqueue.h)
  */
@@ -764,13 +1352,13 @@ enum TN_RCode tn_queue_eventgrp_connect(
       TN_UWord             pattern
       )
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(dque);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
       rc = _tn_eventgrp_link_set(&dque->eventgrp_link, eventgrp, pattern);
-      tn_arch_sr_restore(sr_saved);
+      TN_INT_RESTORE();
    }
 
    return rc;
@@ -783,13 +1371,13 @@ enum TN_RCode tn_queue_eventgrp_disconnect(
       struct TN_DQueue    *dque
       )
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(dque);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
       rc = _tn_eventgrp_link_reset(&dque->eventgrp_link);
-      tn_arch_sr_restore(sr_saved);
+      TN_INT_RESTORE();
    }
 
    return rc;
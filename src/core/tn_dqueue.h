@@ -133,6 +133,9 @@ struct TN_DQueue {
    ///
    /// connected event group
    struct TN_EGrpLink eventgrp_link;
+   ///
+   /// Order of tasks in the `wait_send_list` and `wait_receive_list`
+   enum TN_WaitOrder wait_order;
 };
 
 /**
@@ -159,10 +162,33 @@ struct TN_DQueueTaskWait {
  *    PUBLIC FUNCTION PROTOTYPES
  ******************************************************************************/
 
+/**
+ * The same as `tn_queue_create()`, but takes additional argument:
+ * `wait_order`, so that tasks waiting to send or receive data may be queued
+ * in order of their priorities.
+ *
+ * @param dque       pointer to already allocated struct TN_DQueue.
+ * @param data_fifo  pointer to already allocated array of `void *` to store
+ *                   data queue items. Can be `#TN_NULL`.
+ * @param items_cnt  capacity of queue
+ *                   (count of elements in the `data_fifo` array)
+ *                   Can be 0.
+ * @param wait_order order of waiting tasks, see `enum #TN_WaitOrder`
+ */
+enum TN_RCode tn_queue_create_worder(
+      struct TN_DQueue *dque,
+      void **data_fifo,
+      int items_cnt,
+      enum TN_WaitOrder wait_order
+      );
+
 /**
  * Construct data queue. `id_dque` member should not contain `#TN_ID_DATAQUEUE`,
  * otherwise, `#TN_RC_WPARAM` is returned.
  *
+ * Waiting tasks are queued in FIFO order; if you need them to be queued
+ * by priority, use `tn_queue_create_worder()`.
+ *
  * $(TN_CALL_FROM_TASK)
  * $(TN_CALL_FROM_ISR)
  * $(TN_LEGEND_LINK)
@@ -179,11 +205,16 @@ struct TN_DQueueTaskWait {
  *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
  *      is available: `#TN_RC_WPARAM`.
  */
-enum TN_RCode tn_queue_create(
+_TN_STATIC_INLINE enum TN_RCode tn_queue_create(
       struct TN_DQueue *dque,
       void **data_fifo,
       int items_cnt
-      );
+      )
+{
+   return tn_queue_create_worder(
+         dque, data_fifo, items_cnt, TN_WAIT_ORDER_FIFO
+         );
+}
 
 
 /**
@@ -306,6 +337,25 @@ enum TN_RCode tn_queue_receive(
       TN_TickCnt timeout
       );
 
+/**
+ * The same as `tn_queue_receive()`, but instead of relative timeout, the
+ * absolute `deadline` (in terms of `tn_sys_time_get()`) is given. It is
+ * converted to timeout (as `tn_sys_timeout_until()` does) with interrupts
+ * disabled, right before the task is put to wait, so the task never wakes up
+ * later than the deadline. If the `deadline` is already reached, it behaves
+ * like `tn_queue_receive_polling()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_queue_receive_until(
+      struct TN_DQueue *dque,
+      void **pp_data,
+      TN_TickCnt deadline
+      );
+
 /**
  * The same as `tn_queue_receive()` with zero timeout
  *
@@ -331,6 +381,154 @@ enum TN_RCode tn_queue_ireceive_polling(
       );
 
 
+/**
+ * Send a batch of `data_cnt` items from the array `p_data_arr` to the data
+ * queue specified by the `dque`, in order, within a single critical section
+ * (as long as there is no need to wait): it is much cheaper than calling
+ * `tn_queue_send()` for each item.
+ *
+ * Just like `tn_queue_send()`, items are given to the tasks in the queue's
+ * `wait_receive` list first (one item per task, and as many tasks are woken
+ * up as there are items), and the rest of items is placed to the tail of
+ * data FIFO. If the FIFO gets full before all the items are sent, behavior
+ * depends on the `timeout` value: refer to `#TN_TickCnt`. Note that
+ * `timeout` is for the whole batch, not for each item.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param dque          pointer to data queue to send data to
+ * @param p_data_arr    array of values to send
+ * @param data_cnt      number of items in `p_data_arr`, should be more than 0
+ * @param p_sent_cnt    location to store number of items actually sent: all
+ *                      of them if `#TN_RC_OK` is returned, and possibly less
+ *                      otherwise
+ * @param timeout       refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK`   if all the items were successfully sent;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_queue_send_multi(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt,
+      int *p_sent_cnt,
+      TN_TickCnt timeout
+      );
+
+/**
+ * The same as `tn_queue_send_multi()` with zero timeout: as many items are
+ * sent as there is room for.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_queue_send_multi_polling(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt,
+      int *p_sent_cnt
+      );
+
+/**
+ * The same as `tn_queue_send_multi()` with zero timeout, but for using in
+ * the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_queue_isend_multi_polling(
+      struct TN_DQueue *dque,
+      void * const *p_data_arr,
+      int data_cnt,
+      int *p_sent_cnt
+      );
+
+/**
+ * Receive up to `data_cnt` items from the data queue specified by the `dque`
+ * to the array `pp_data_arr`, within a single critical section: it is much
+ * cheaper than calling `tn_queue_receive()` for each item.
+ *
+ * All the items which are in the FIFO are received (but not more than
+ * `data_cnt`); as room is freed, tasks in the queue's `wait_send` list are
+ * woken up and their items are put to the FIFO, just like
+ * `tn_queue_receive()` does. The function doesn't wait for all the
+ * `data_cnt` items: it waits if only there are no items at all, and behavior
+ * depends on the `timeout` value then: refer to `#TN_TickCnt`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param dque             pointer to data queue to receive data from
+ * @param pp_data_arr      array to store received values
+ * @param data_cnt         number of items in `pp_data_arr`, should be more
+ *                         than 0
+ * @param p_received_cnt   location to store number of items actually
+ *                         received: from 1 to `data_cnt` if `#TN_RC_OK` is
+ *                         returned, 0 otherwise
+ * @param timeout          refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK`   if at least one item was successfully received;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_queue_receive_multi(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_received_cnt,
+      TN_TickCnt timeout
+      );
+
+/**
+ * The same as `tn_queue_receive_multi()` with zero timeout
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_queue_receive_multi_polling(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_received_cnt
+      );
+
+/**
+ * The same as `tn_queue_receive_multi()` with zero timeout, but for using in
+ * the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_queue_ireceive_multi_polling(
+      struct TN_DQueue *dque,
+      void **pp_data_arr,
+      int data_cnt,
+      int *p_received_cnt
+      );
+
+
 /**
  * Returns number of free items in the queue
  *
@@ -44,6 +44,7 @@
 //-- internal tnkernel headers
 #include "_tn_eventgrp.h"
 #include "_tn_tasks.h"
+#include "_tn_timer.h"
 #include "_tn_list.h"
 
 
@@ -224,14 +225,290 @@ static void _clear_pattern_if_needed(
 }
 
 
+/**
+ * Check if waiting condition of the given task is satisfied, and if so, wake
+ * the task up (and clear flag(s) if needed).
+ *
+ * @param eventgrp
+ *    Event group which the task waits for
+ * @param task
+ *    Task waiting for the event group
+ */
+static void _waiter_check(
+      struct TN_EventGrp  *eventgrp,
+      struct TN_Task      *task
+      )
+{
+   if ( _cond_check(
+            eventgrp,
+            task->subsys_wait.eventgrp.wait_mode,
+            task->subsys_wait.eventgrp.wait_pattern
+            )
+      )
+   {
+      //-- Condition is satisfied, so, wake the task up.
+      //   We should also remember actual pattern that caused
+      //   task to wake up.
+
+      task->subsys_wait.eventgrp.actual_pattern = eventgrp->pattern;
+      _tn_task_wait_complete(task, TN_RC_OK);
+
+      //-- Atomically clear flag(s) if we need to.
+      _clear_pattern_if_needed(
+            eventgrp,
+            task->subsys_wait.eventgrp.wait_mode,
+            task->subsys_wait.eventgrp.wait_pattern
+            );
+   }
+}
+
+#if TN_EVENTGRP_BIT_INDEX
+
+/**
+ * If given pattern has exactly one bit set, return the number of that bit;
+ * otherwise, return -1.
+ */
+static int _single_bit_num(TN_UWord pattern)
+{
+   int ret = -1;
+
+   if (pattern != 0 && (pattern & (pattern - 1)) == 0){
+      //-- `_tn_bmp_ffs()` takes `unsigned int` which may be narrower than
+      //   `TN_UWord` (say, on 64-bit host), so skip zero chunks first.
+      //   Typically `TN_UWord` is `unsigned int`, and the loop is never run.
+      int shift = 0;
+
+      while ((unsigned int)(pattern >> shift) == 0){
+         shift += (int)(sizeof(unsigned int) * 8);
+      }
+
+      ret = shift + _tn_bmp_ffs((unsigned int)(pattern >> shift)) - 1;
+   }
+
+   return ret;
+}
+
+/**
+ * Returns wait queue in which the current task should wait for the given
+ * pattern: the queue of the particular bit if the pattern has exactly one bit
+ * set, or the common queue otherwise.
+ */
+static struct TN_ListItem *_wait_queue_get(
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             wait_pattern
+      )
+{
+   int bit = _single_bit_num(wait_pattern);
+
+   return (bit >= 0)
+      ? &(eventgrp->bit_wait_queue[bit])
+      : &(eventgrp->wait_queue);
+}
+
+/**
+ * Returns whether `task_a` would stand before `task_b` if all the waiting
+ * tasks were in the single wait queue: that is, `task_a` has higher priority
+ * (if the event group orders waiting tasks by priority), or `task_a` started
+ * waiting earlier.
+ */
+_TN_STATIC_INLINE TN_BOOL _waits_before(
+      struct TN_EventGrp  *eventgrp,
+      struct TN_Task      *task_a,
+      struct TN_Task      *task_b
+      )
+{
+   TN_BOOL ret;
+
+   if (     eventgrp->wait_order == TN_WAIT_ORDER_PRIORITY
+         && task_a->priority != task_b->priority
+      )
+   {
+      ret = (task_a->priority < task_b->priority);
+   } else {
+      //-- sequence numbers may wrap around, so compare the difference:
+      //   if it is "negative", then `task_a` started waiting earlier.
+      ret = ((TN_UWord)(
+               task_a->subsys_wait.eventgrp.wait_seq
+               - task_b->subsys_wait.eventgrp.wait_seq
+               ) > ((TN_UWord)-1 >> 1));
+   }
+
+   return ret;
+}
+
+/**
+ * Wake up tasks whose waiting condition is satisfied after the bits
+ * `set_pattern` were set.
+ *
+ * Tasks which wait for exactly one bit are in the wait queue of that bit, so
+ * only queues of the bits just set are visited. Besides, for such a task the
+ * condition is satisfied as long as the bit is set, and bits can only be
+ * cleared (by `#TN_EVENTGRP_WMODE_AUTOCLR`) during the scan; so, the next
+ * task to check in each queue is always the first one.
+ *
+ * Tasks which wait for several bits are in the common wait queue, and those
+ * of them whose wait pattern doesn't intersect with `set_pattern` are
+ * skipped.
+ *
+ * Queues are merged by `_waits_before()`, so that tasks are checked and woken
+ * up in the same order as if they all were in the single queue.
+ *
+ * @param eventgrp
+ *    Event group to handle.
+ * @param set_pattern
+ *    Bits which have just been set.
+ */
+static void _scan_event_waitqueue(
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             set_pattern
+      )
+{
+   //-- interrupts should be disabled here
+   _TN_BUG_ON( !TN_IS_INT_DISABLED() );
+
+   struct TN_ListItem *multi_cur = eventgrp->wait_queue.next;
+   TN_UWord idx_pattern = 0;
+   TN_UWord bits;
+   int bit;
+
+   //-- determine which bits that were set have waiting tasks
+   for (bit = 0, bits = set_pattern; bits != 0; bit++, bits >>= 1){
+      if (     (bits & 1)
+            && !_tn_list_is_empty(&(eventgrp->bit_wait_queue[bit]))
+         )
+      {
+         idx_pattern |= ((TN_UWord)1 << bit);
+      }
+   }
+
+   for (;;){
+      struct TN_Task *task = TN_NULL;
+      int task_bit = -1;
+
+      //-- skip tasks waiting for several bits which don't wait for any of
+      //   the bits that were set: their condition couldn't become satisfied
+      while (     multi_cur != &(eventgrp->wait_queue)
+               && !(_tn_get_task_by_tsk_queue(multi_cur)
+                  ->subsys_wait.eventgrp.wait_pattern & set_pattern)
+            )
+      {
+         multi_cur = multi_cur->next;
+      }
+
+      if (multi_cur != &(eventgrp->wait_queue)){
+         task = _tn_get_task_by_tsk_queue(multi_cur);
+      }
+
+      //-- check first tasks of the queues of bits that are still set
+      for (
+            bit = 0, bits = (idx_pattern & eventgrp->pattern);
+            bits != 0;
+            bit++, bits >>= 1
+          )
+      {
+         if (bits & 1){
+            struct TN_Task *bit_task = _tn_list_first_entry(
+                  &(eventgrp->bit_wait_queue[bit]), struct TN_Task, task_queue
+                  );
+
+            if (task == TN_NULL || _waits_before(eventgrp, bit_task, task)){
+               task = bit_task;
+               task_bit = bit;
+            }
+         }
+      }
+
+      if (task == TN_NULL){
+         //-- no more tasks to check
+         break;
+      }
+
+      if (task_bit < 0){
+         //-- task is from the common queue: move cursor before the task
+         //   is possibly removed from the queue
+         multi_cur = multi_cur->next;
+      }
+
+      _waiter_check(eventgrp, task);
+
+      if (     task_bit >= 0
+            && _tn_list_is_empty(&(eventgrp->bit_wait_queue[task_bit]))
+         )
+      {
+         idx_pattern &= ~((TN_UWord)1 << task_bit);
+      }
+   }
+}
+
+/**
+ * Returns whether there are tasks waiting for the event group.
+ */
+_TN_STATIC_INLINE TN_BOOL _waiters_exist(struct TN_EventGrp *eventgrp)
+{
+   TN_BOOL ret = !_tn_list_is_empty(&(eventgrp->wait_queue));
+   int bit;
+
+   for (bit = 0; !ret && bit < (int)_TN_EVENTGRP_BITS_CNT; bit++){
+      ret = !_tn_list_is_empty(&(eventgrp->bit_wait_queue[bit]));
+   }
+
+   return ret;
+}
+
+/**
+ * Wake up all waiting tasks with `#TN_RC_DELETED`, in the same order as if
+ * they all were in the single wait queue (see `_waits_before()`), so that
+ * tasks of equal priority run in the same order as without the index.
+ */
+static void _waiters_notify_deleted(struct TN_EventGrp *eventgrp)
+{
+   for (;;){
+      struct TN_Task *task = TN_NULL;
+      int bit;
+
+      if (!_tn_list_is_empty(&(eventgrp->wait_queue))){
+         task = _tn_list_first_entry(
+               &(eventgrp->wait_queue), struct TN_Task, task_queue
+               );
+      }
+
+      for (bit = 0; bit < (int)_TN_EVENTGRP_BITS_CNT; bit++){
+         if (!_tn_list_is_empty(&(eventgrp->bit_wait_queue[bit]))){
+            struct TN_Task *bit_task = _tn_list_first_entry(
+                  &(eventgrp->bit_wait_queue[bit]), struct TN_Task, task_queue
+                  );
+
+            if (task == TN_NULL || _waits_before(eventgrp, bit_task, task)){
+               task = bit_task;
+            }
+         }
+      }
+
+      if (task == TN_NULL){
+         //-- no more waiting tasks
+         break;
+      }
+
+      _tn_task_wait_complete(task, TN_RC_DELETED);
+   }
+}
+
+#else
+
 /**
  * Walk through all tasks waiting for some event, wake up tasks whose waiting
  * condition is already satisfied.
  *
  * @param eventgrp
  *    Event group to handle.
+ * @param set_pattern
+ *    Bits which have just been set: tasks which don't wait for any of them
+ *    are skipped, since their condition couldn't become satisfied.
  */
-static void _scan_event_waitqueue(struct TN_EventGrp *eventgrp)
+static void _scan_event_waitqueue(
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             set_pattern
+      )
 {
    //-- interrupts should be disabled here
    _TN_BUG_ON( !TN_IS_INT_DISABLED() );
@@ -245,31 +522,20 @@ static void _scan_event_waitqueue(struct TN_EventGrp *eventgrp)
          task, struct TN_Task, tmp_task, &(eventgrp->wait_queue), task_queue
          )
    {
-
-      if ( _cond_check(
-               eventgrp,
-               task->subsys_wait.eventgrp.wait_mode,
-               task->subsys_wait.eventgrp.wait_pattern
-               )
-         )
-      {
-         //-- Condition is satisfied, so, wake the task up.
-         //   We should also remember actual pattern that caused
-         //   task to wake up.
-
-         task->subsys_wait.eventgrp.actual_pattern = eventgrp->pattern;
-         _tn_task_wait_complete(task, TN_RC_OK);
-
-         //-- Atomically clear flag(s) if we need to.
-         _clear_pattern_if_needed(
-               eventgrp,
-               task->subsys_wait.eventgrp.wait_mode,
-               task->subsys_wait.eventgrp.wait_pattern
-               );
+      if (task->subsys_wait.eventgrp.wait_pattern & set_pattern){
+         _waiter_check(eventgrp, task);
       }
    }
 }
 
+#  define _wait_queue_get(eventgrp, wait_pattern)  (&(eventgrp)->wait_queue)
+#  define _waiters_exist(eventgrp)                                      \
+   (!_tn_list_is_empty(&(eventgrp)->wait_queue))
+#  define _waiters_notify_deleted(eventgrp)                             \
+   _tn_wait_queue_notify_deleted(&(eventgrp)->wait_queue)
+
+#endif
+
 
 /**
  * Actual worker function that is eventually called when user calls
@@ -305,7 +571,7 @@ static enum TN_RCode _eventgrp_wait(
       if (
             (eventgrp->attr & TN_EVENTGRP_ATTR_SINGLE) 
             &&
-            !_tn_list_is_empty(&(eventgrp->wait_queue))
+            _waiters_exist(eventgrp)
          )
       {
          rc = TN_RC_ILLEGAL_USE;
@@ -346,9 +612,14 @@ static enum TN_RCode _eventgrp_wait(
  * Modify current events pattern: set, clear or toggle flags. 
  *
  * If flags are cleared, there aren't any side effects: flags are just got
- * cleared. If, however, flags are set or toggled, then all the tasks waiting
- * for some particular event are checked whether the condition is met now. It
- * is done by `_scan_event_waitqueue()`.
+ * cleared. If, however, flags are set or toggled, then the tasks waiting
+ * for the flags that have just been set are checked whether the condition is
+ * met now. It is done by `_scan_event_waitqueue()`.
+ *
+ * NOTE: tasks which wait for other flags don't need to be checked: the
+ * condition of each waiting task is not satisfied (otherwise, the task
+ * would have been woken up already), and clearing flags can't make it
+ * satisfied.
  *
  * For params documentation, refer to `tn_eventgrp_modify()`.
  */
@@ -361,6 +632,8 @@ static enum TN_RCode _eventgrp_modify(
    //-- interrupts should be disabled here
    _TN_BUG_ON( !TN_IS_INT_DISABLED() );
 
+   TN_UWord set_pattern;
+
    switch (operation){
       case TN_EVENTGRP_OP_CLEAR:
          //-- clear flags: there aren't any side effects: just clear flags.
@@ -370,19 +643,25 @@ static enum TN_RCode _eventgrp_modify(
       case TN_EVENTGRP_OP_SET:
          //-- set flags: do that if only given flags aren't already set.
          //   (otherwise, there's no need to spend time walking through
-         //   all the waiting tasks)
-         if ((eventgrp->pattern & pattern) != pattern){
-            //-- flags aren't already set: so, set flags and check all tasks.
+         //   the waiting tasks)
+         set_pattern = pattern & ~eventgrp->pattern;
+         if (set_pattern != 0){
+            //-- flags aren't already set: so, set flags and check tasks
+            //   waiting for them.
 
             eventgrp->pattern |= pattern;
-            _scan_event_waitqueue(eventgrp);
+            _scan_event_waitqueue(eventgrp, set_pattern);
          }
          break;
 
       case TN_EVENTGRP_OP_TOGGLE:
-         //-- toggle flags: after flags are toggled, check all waiting tasks.
+         //-- toggle flags: after flags are toggled, check tasks waiting
+         //   for the flags that became set (if any).
+         set_pattern = pattern & ~eventgrp->pattern;
          eventgrp->pattern ^= pattern;
-         _scan_event_waitqueue(eventgrp);
+         if (set_pattern != 0){
+            _scan_event_waitqueue(eventgrp, set_pattern);
+         }
          break;
    }
 
@@ -414,8 +693,20 @@ enum TN_RCode tn_eventgrp_create_wattr(
    } else {
 
       _tn_list_reset(&(eventgrp->wait_queue));
+#if TN_EVENTGRP_BIT_INDEX
+      {
+         int bit;
+         for (bit = 0; bit < (int)_TN_EVENTGRP_BITS_CNT; bit++){
+            _tn_list_reset(&(eventgrp->bit_wait_queue[bit]));
+         }
+      }
+      eventgrp->wait_seq   = 0;
+#endif
 
       eventgrp->pattern    = initial_pattern;
+      eventgrp->wait_order = (attr & TN_EVENTGRP_ATTR_WAIT_PRIO)
+         ? TN_WAIT_ORDER_PRIORITY
+         : TN_WAIT_ORDER_FIFO;
       eventgrp->id_event   = TN_ID_EVENTGRP;
 #if TN_OLD_EVENT_API
       eventgrp->attr       = attr;
@@ -444,7 +735,7 @@ enum TN_RCode tn_eventgrp_delete(struct TN_EventGrp *eventgrp)
 
       // remove all waiting tasks from wait list (if any), returning the
       // TN_RC_DELETED code.
-      _tn_wait_queue_notify_deleted(&(eventgrp->wait_queue));
+      _waiters_notify_deleted(eventgrp);
 
       eventgrp->id_event = TN_ID_NONE; //-- event does not exist now
 
@@ -459,15 +750,21 @@ enum TN_RCode tn_eventgrp_delete(struct TN_EventGrp *eventgrp)
 }
 
 
-/*
- * See comments in the header file (tn_eventgrp.h)
+/**
+ * Generic function that performs waiting from task context: called by
+ * `tn_eventgrp_wait()` and `tn_eventgrp_wait_until()`.
+ *
+ * For params documentation, refer to the `tn_eventgrp_wait()`; if
+ * `is_deadline` is `TN_TRUE`, `timeout` is the absolute deadline instead,
+ * see `_tn_timeout_resolve()`.
  */
-enum TN_RCode tn_eventgrp_wait(
+static enum TN_RCode _eventgrp_job_perform(
       struct TN_EventGrp  *eventgrp,
       TN_UWord             wait_pattern,
       enum TN_EGrpWaitMode wait_mode,
       TN_UWord            *p_flags_pattern,
-      TN_TickCnt           timeout
+      TN_TickCnt           timeout,
+      TN_BOOL              is_deadline
       )
 {
    TN_BOOL waited_for_event = TN_FALSE;
@@ -486,6 +783,12 @@ enum TN_RCode tn_eventgrp_wait(
       //   and return result
       rc = _eventgrp_wait(eventgrp, wait_pattern, wait_mode, p_flags_pattern);
 
+      //-- if deadline is given, it is converted to timeout right here, with
+      //   interrupts disabled
+      if (rc == TN_RC_TIMEOUT){
+         timeout = _tn_timeout_resolve(timeout, is_deadline);
+      }
+
       if (rc == TN_RC_TIMEOUT && timeout != 0){
          //-- condition isn't met, and user wants to wait in this case.
          //   So, remember waiting parameters (mode, pattern), and put
@@ -493,8 +796,13 @@ enum TN_RCode tn_eventgrp_wait(
 
          _tn_curr_run_task->subsys_wait.eventgrp.wait_mode = wait_mode;
          _tn_curr_run_task->subsys_wait.eventgrp.wait_pattern = wait_pattern;
-         _tn_task_curr_to_wait_action(
-               &(eventgrp->wait_queue),
+#if TN_EVENTGRP_BIT_INDEX
+         _tn_curr_run_task->subsys_wait.eventgrp.wait_seq =
+            eventgrp->wait_seq++;
+#endif
+         _tn_task_curr_to_wait_action_ordered(
+               _wait_queue_get(eventgrp, wait_pattern),
+               eventgrp->wait_order,
                TN_WAIT_REASON_EVENT,
                timeout
                );
@@ -531,6 +839,41 @@ enum TN_RCode tn_eventgrp_wait(
 }
 
 
+/*
+ * See comments in the header file (tn_eventgrp.h)
+ */
+enum TN_RCode tn_eventgrp_wait(
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             wait_pattern,
+      enum TN_EGrpWaitMode wait_mode,
+      TN_UWord            *p_flags_pattern,
+      TN_TickCnt           timeout
+      )
+{
+   return _eventgrp_job_perform(
+         eventgrp, wait_pattern, wait_mode, p_flags_pattern,
+         timeout, TN_FALSE
+         );
+}
+
+/*
+ * See comments in the header file (tn_eventgrp.h)
+ */
+enum TN_RCode tn_eventgrp_wait_until(
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             wait_pattern,
+      enum TN_EGrpWaitMode wait_mode,
+      TN_UWord            *p_flags_pattern,
+      TN_TickCnt           deadline
+      )
+{
+   return _eventgrp_job_perform(
+         eventgrp, wait_pattern, wait_mode, p_flags_pattern,
+         deadline, TN_TRUE
+         );
+}
+
+
 /*
  * See comments in the header file (tn_eventgrp.h)
  */
@@ -729,4 +1072,31 @@ enum TN_RCode _tn_eventgrp_link_manage(
    return rc;
 }
 
+#if TN_EVENTGRP_BIT_INDEX
+/*
+ * See comments in the file _tn_eventgrp.h
+ */
+void _tn_eventgrp_on_task_requeue(struct TN_Task *task)
+{
+   //-- interrupts should be disabled here
+   _TN_BUG_ON( !TN_IS_INT_DISABLED() );
+
+   struct TN_EventGrp *eventgrp;
+   int bit = _single_bit_num(task->subsys_wait.eventgrp.wait_pattern);
+
+   //-- get event group by the wait queue of the task (see _wait_queue_get())
+   if (bit >= 0){
+      eventgrp = container_of(
+            task->pwait_queue - bit, struct TN_EventGrp, bit_wait_queue
+            );
+   } else {
+      eventgrp = container_of(
+            task->pwait_queue, struct TN_EventGrp, wait_queue
+            );
+   }
+
+   task->subsys_wait.eventgrp.wait_seq = eventgrp->wait_seq++;
+}
+#endif
+
 
@@ -88,7 +88,8 @@
  * non-empty, the flag is set. If the queue becomes empty, the flag is cleared.
  * 
  * For the information on system services related to queue, refer to the \ref 
- * tn_dqueue.h "queue reference".
+ * tn_dqueue.h "queue reference". \ref tn_msgq.h "Message queue" can be
+ * connected to the event group in the same way.
  *
  * There is an example project available that demonstrates event group
  * connection technique: `examples/queue_eventgrp_conn`. Be sure to examine the
@@ -203,8 +204,23 @@ enum TN_EGrpAttr {
    /// `#TN_OLD_EVENT_API`)
    TN_EVENTGRP_ATTR_NONE      = (0),
 #endif
+
+   ///
+   /// Tasks waiting for the event group are queued in order of their
+   /// priorities instead of FIFO order (see `#TN_WAIT_ORDER_PRIORITY`): if
+   /// several tasks wait for the same events, the task with highest priority
+   /// is checked (and woken up) first. It matters when waiting tasks consume
+   /// events by `#TN_EVENTGRP_WMODE_AUTOCLR`.
+   TN_EVENTGRP_ATTR_WAIT_PRIO = (1 << 3),
 };
 
+#if TN_EVENTGRP_BIT_INDEX || defined(DOXYGEN_ACTIVE)
+/**
+ * Number of event bits in the event group, i.e. number of bits in
+ * `#TN_UWord`; used if only `#TN_EVENTGRP_BIT_INDEX` is set.
+ */
+#define _TN_EVENTGRP_BITS_CNT    (sizeof(TN_UWord) * 8)
+#endif
 
 /**
  * Event group
@@ -216,12 +232,29 @@ struct TN_EventGrp {
    /// to detect memory corruption.
    enum TN_ObjId        id_event;
    ///
-   /// task wait queue
+   /// task wait queue (if `#TN_EVENTGRP_BIT_INDEX` is set, it contains only
+   /// tasks which wait for several bits at once)
    struct TN_ListItem   wait_queue;
    ///
    /// current flags pattern
    TN_UWord             pattern;
 
+#if TN_EVENTGRP_BIT_INDEX || defined(DOXYGEN_ACTIVE)
+   ///
+   /// wait queues of tasks which wait for exactly one bit, indexed by the
+   /// bit number. Available if only `#TN_EVENTGRP_BIT_INDEX` is set.
+   struct TN_ListItem   bit_wait_queue[ _TN_EVENTGRP_BITS_CNT ];
+   ///
+   /// sequence number for the next waiting task: it is needed to wake up
+   /// tasks from different wait queues in the same order as they would be
+   /// woken up from the single queue. Available if only
+   /// `#TN_EVENTGRP_BIT_INDEX` is set.
+   TN_UWord             wait_seq;
+#endif
+   ///
+   /// Order of tasks in the `wait_queue`, see `#TN_EVENTGRP_ATTR_WAIT_PRIO`
+   enum TN_WaitOrder    wait_order;
+
 #if TN_OLD_EVENT_API || defined(DOXYGEN_ACTIVE)
    ///
    /// Attributes that are given to that events group,
@@ -245,6 +278,12 @@ struct TN_EGrpTaskWait {
    ///
    /// pattern that caused task to finish waiting
    TN_UWord actual_pattern;
+#if TN_EVENTGRP_BIT_INDEX || defined(DOXYGEN_ACTIVE)
+   ///
+   /// sequence number of the wait, see `struct #TN_EventGrp`. Available if
+   /// only `#TN_EVENTGRP_BIT_INDEX` is set.
+   TN_UWord wait_seq;
+#endif
 };
 
 /**
@@ -277,7 +316,8 @@ struct TN_EGrpLink {
 
 /**
  * The same as `#tn_eventgrp_create()`, but takes additional argument: `attr`.
- * It makes sense if only `#TN_OLD_EVENT_API` option is non-zero.
+ * It makes sense if either `#TN_OLD_EVENT_API` option is non-zero, or
+ * waiting tasks should be queued by priority (`#TN_EVENTGRP_ATTR_WAIT_PRIO`).
  *
  * @param eventgrp
  *    Pointer to already allocated struct TN_EventGrp
@@ -389,6 +429,27 @@ enum TN_RCode tn_eventgrp_wait(
       TN_TickCnt           timeout
       );
 
+/**
+ * The same as `tn_eventgrp_wait()`, but instead of relative timeout, the
+ * absolute `deadline` (in terms of `tn_sys_time_get()`) is given. It is
+ * converted to timeout (as `tn_sys_timeout_until()` does) with interrupts
+ * disabled, right before the task is put to wait, so the task never wakes up
+ * later than the deadline. If the `deadline` is already reached, it behaves
+ * like `tn_eventgrp_wait_polling()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_eventgrp_wait_until(
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             wait_pattern,
+      enum TN_EGrpWaitMode wait_mode,
+      TN_UWord            *p_flags_pattern,
+      TN_TickCnt           deadline
+      );
+
 /**
  * The same as `tn_eventgrp_wait()` with zero timeout.
  *
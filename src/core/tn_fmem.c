@@ -71,14 +71,15 @@
 //-- Additional param checking {{{
 #if TN_CHECK_PARAM
 _TN_STATIC_INLINE enum TN_RCode _check_param_fmem_create(
-      const struct TN_FMem *fmem
+      const struct TN_FMem *fmem,
+      enum TN_WaitOrder     wait_order
       )
 {
    enum TN_RCode rc = TN_RC_OK;
 
    if (fmem == TN_NULL){
       rc = TN_RC_WPARAM;
-   } else if (_tn_fmem_is_valid(fmem)){
+   } else if (_tn_fmem_is_valid(fmem) || !_tn_wait_order_is_valid(wait_order)){
       rc = TN_RC_WPARAM;
    }
 
@@ -131,7 +132,7 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_generic(
    return rc;
 }
 #else
-#  define _check_param_fmem_create(fmem)               (TN_RC_OK)
+#  define _check_param_fmem_create(fmem, wait_order)   (TN_RC_OK)
 #  define _check_param_fmem_delete(fmem)               (TN_RC_OK)
 #  define _check_param_job_perform(fmem, p_data)       (TN_RC_OK)
 #  define _check_param_generic(fmem)                   (TN_RC_OK)
@@ -270,16 +271,17 @@ _TN_STATIC_INLINE enum TN_RCode _fmem_release(struct TN_FMem *fmem, void *p_data
 /*
  * See comments in the header file (tn_dqueue.h)
  */
-enum TN_RCode tn_fmem_create(
+enum TN_RCode tn_fmem_create_worder(
       struct TN_FMem   *fmem,
       void             *start_addr,
       unsigned int      block_size,
-      int               blocks_cnt
+      int               blocks_cnt,
+      enum TN_WaitOrder wait_order
       )
 {
    enum TN_RCode rc;
 
-   rc = _check_param_fmem_create(fmem);
+   rc = _check_param_fmem_create(fmem, wait_order);
    if (rc != TN_RC_OK){
       goto out;
    }
@@ -316,6 +318,7 @@ enum TN_RCode tn_fmem_create(
    fmem->start_addr = start_addr;
    fmem->block_size = block_size;
    fmem->blocks_cnt = blocks_cnt;
+   fmem->wait_order = wait_order;
 
    //-- reset wait_queue
    _tn_list_reset(&(fmem->wait_queue));
@@ -403,8 +406,9 @@ enum TN_RCode tn_fmem_get(
       rc = _fmem_get(fmem, p_data);
 
       if (rc == TN_RC_TIMEOUT && timeout > 0){
-         _tn_task_curr_to_wait_action(
+         _tn_task_curr_to_wait_action_ordered(
                &(fmem->wait_queue),
+               fmem->wait_order,
                TN_WAIT_REASON_WFIXMEM,
                timeout
                );
@@ -564,3 +568,26 @@ int tn_fmem_used_blocks_cnt_get(struct TN_FMem *fmem)
    return ret;
 }
 
+
+
+
+/*******************************************************************************
+ *    PROTECTED FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * See comments in the file _tn_fmem.h
+ */
+enum TN_RCode _tn_fmem_get(struct TN_FMem *fmem, void **p_data)
+{
+   return _fmem_get(fmem, p_data);
+}
+
+/**
+ * See comments in the file _tn_fmem.h
+ */
+enum TN_RCode _tn_fmem_release(struct TN_FMem *fmem, void *p_data)
+{
+   return _fmem_release(fmem, p_data);
+}
+
@@ -108,6 +108,9 @@ struct TN_FMem {
    /// pointer to the next free memory block as the first word, or `NULL` if
    /// this is the last block.
    void                *free_list;
+   ///
+   /// Order of tasks in the `wait_queue`
+   enum TN_WaitOrder    wait_order;
 };
 
 
@@ -156,10 +159,33 @@ struct TN_FMemTaskWait {
  *    PUBLIC FUNCTION PROTOTYPES
  ******************************************************************************/
 
+/**
+ * The same as `tn_fmem_create()`, but takes additional argument:
+ * `wait_order`, so that tasks waiting for free memory block may be queued
+ * in order of their priorities.
+ *
+ * @param fmem       pointer to already allocated `struct TN_FMem`.
+ * @param start_addr pointer to start of the array; should be aligned properly
+ * @param block_size size of memory block; should be a multiple of 
+ *                   `sizeof(#TN_UWord)`
+ * @param blocks_cnt capacity (total number of blocks in the memory pool)
+ * @param wait_order order of waiting tasks, see `enum #TN_WaitOrder`
+ */
+enum TN_RCode tn_fmem_create_worder(
+      struct TN_FMem   *fmem,
+      void             *start_addr,
+      unsigned int      block_size,
+      int               blocks_cnt,
+      enum TN_WaitOrder wait_order
+      );
+
 /**
  * Construct fixed memory blocks pool. `id_fmp` field should not contain
  * `#TN_ID_FSMEMORYPOOL`, otherwise, `#TN_RC_WPARAM` is returned.
  *
+ * Waiting tasks are queued in FIFO order; if you need them to be queued
+ * by priority, use `tn_fmem_create_worder()`.
+ *
  * Note that `start_addr` and `block_size` should be a multiple of
  * `sizeof(#TN_UWord)`.
  *
@@ -218,12 +244,17 @@ struct TN_FMemTaskWait {
  *
  * @see TN_MAKE_ALIG_SIZE
  */
-enum TN_RCode tn_fmem_create(
+_TN_STATIC_INLINE enum TN_RCode tn_fmem_create(
       struct TN_FMem   *fmem,
       void             *start_addr,
       unsigned int      block_size,
       int               blocks_cnt
-      );
+      )
+{
+   return tn_fmem_create_worder(
+         fmem, start_addr, block_size, blocks_cnt, TN_WAIT_ORDER_FIFO
+         );
+}
 
 /**
  * Destruct fixed memory blocks pool.
@@ -0,0 +1,1011 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+
+//-- common tnkernel headers
+#include "tn_common.h"
+#include "tn_sys.h"
+
+//-- internal tnkernel headers
+#include "_tn_tasks.h"
+#include "_tn_list.h"
+
+
+//-- header of current module
+#include "tn_heap.h"
+#include "_tn_heap.h"
+
+//-- header of other needed modules
+#include "tn_tasks.h"
+
+//-- for offsetof()
+#include <stddef.h>
+
+
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/**
+ * Granularity of block sizes: it is at least 4, so that two lowest bits of
+ * size are always zero and can be used as flags, see `#_HEAP_BLOCK_FREE` and
+ * `#_HEAP_BLOCK_PREV_FREE`.
+ */
+#define _HEAP_ALIGN_LOG2      ((sizeof(TN_UWord) >= 8) ? 3 : 2)
+#define _HEAP_ALIGN           ((unsigned int)1 << _HEAP_ALIGN_LOG2)
+
+/**
+ * Block header.
+ *
+ * Only the `size` field is always valid; the other ones are valid if only
+ * the block is free (`next_free` and `prev_free`), or the previous block is
+ * free (`prev_phys`):
+ *
+ * - `prev_phys` overlaps the last word of the previous block, so, it's
+ *   written when the previous block is freed;
+ * - `next_free` and `prev_free` overlap the data of the block itself.
+ *
+ * So, used block costs just `#_HEAP_BLOCK_OVERHEAD` bytes.
+ */
+struct _TN_HeapBlock {
+   ///
+   /// Previous block in memory; valid if only the previous block is free
+   struct _TN_HeapBlock *prev_phys;
+   ///
+   /// Size of the block data (not including header) plus flags in the
+   /// two lowest bits. It's padded to `#_HEAP_ALIGN` bytes, so that data of
+   /// the block is always at the `#_HEAP_ALIGN` boundary from the previous
+   /// block data.
+   union {
+      TN_UWord       size;
+      unsigned char  _pad[ _HEAP_ALIGN ];
+   } u;
+   ///
+   /// Next free block in the same list; valid if only the block is free
+   struct _TN_HeapBlock *next_free;
+   ///
+   /// Previous free block in the same list; valid if only the block is free
+   struct _TN_HeapBlock *prev_free;
+};
+
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+//-- Flags in the `size` field of the block
+#define _HEAP_BLOCK_FREE         ((TN_UWord)1)
+#define _HEAP_BLOCK_PREV_FREE    ((TN_UWord)2)
+#define _HEAP_BLOCK_FLAGS        (_HEAP_BLOCK_FREE | _HEAP_BLOCK_PREV_FREE)
+
+/**
+ * Offset of the block data from the beginning of the block header
+ */
+#define _HEAP_BLOCK_DATA_OFFSET  (offsetof(struct _TN_HeapBlock, next_free))
+
+/**
+ * Memory taken by the header of the used block: the `prev_phys` field
+ * doesn't count, since it overlaps the previous block.
+ */
+#define _HEAP_BLOCK_OVERHEAD                                            \
+   (_HEAP_BLOCK_DATA_OFFSET - sizeof(struct _TN_HeapBlock *))
+
+/**
+ * Minimum size of the block data: free block should have room for
+ * `next_free`, `prev_free`, and `prev_phys` of the next block.
+ */
+#define _HEAP_BLOCK_SIZE_MIN                                            \
+   _heap_size_align(                                                    \
+         sizeof(struct _TN_HeapBlock) - sizeof(struct _TN_HeapBlock *)  \
+         )
+
+/**
+ * Second-level classes: each power of two is split into
+ * `#_HEAP_SL_CNT` ranges.
+ */
+#define _HEAP_SL_LOG2         3
+#define _HEAP_SL_CNT          (1 << _HEAP_SL_LOG2)
+
+/**
+ * Sizes less than `#_HEAP_SMALL_SIZE` fall into the first-level class 0,
+ * whose second-level classes are just `#_HEAP_ALIGN` bytes wide each.
+ * Larger sizes fall into the first-level class which corresponds to the
+ * most significant bit of size.
+ */
+#define _HEAP_FL_SHIFT        (_HEAP_SL_LOG2 + _HEAP_ALIGN_LOG2)
+#define _HEAP_SMALL_SIZE      ((unsigned int)1 << _HEAP_FL_SHIFT)
+
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Round given size up to the `#_HEAP_ALIGN` boundary
+ */
+_TN_STATIC_INLINE unsigned int _heap_size_align(unsigned int size)
+{
+   return (size + (_HEAP_ALIGN - 1)) & ~(_HEAP_ALIGN - 1);
+}
+
+/**
+ * Find last set bit: returns the number of the most significant set bit,
+ * i.e. for `0xa8` it returns `7`.
+ *
+ * Given value should be non-zero.
+ */
+_TN_STATIC_INLINE int _heap_fls(unsigned int x)
+{
+   int ret = 0;
+
+#if (TN_INT_WIDTH == 32)
+   if (x & 0xffff0000u){
+      x >>= 16;
+      ret += 16;
+   }
+#endif
+   if (x & 0xff00u){
+      x >>= 8;
+      ret += 8;
+   }
+   if (x & 0xf0u){
+      x >>= 4;
+      ret += 4;
+   }
+   if (x & 0x0cu){
+      x >>= 2;
+      ret += 2;
+   }
+   if (x & 0x02u){
+      ret += 1;
+   }
+
+   return ret;
+}
+
+_TN_STATIC_INLINE unsigned int _block_size(const struct _TN_HeapBlock *block)
+{
+   return (unsigned int)(block->u.size & ~_HEAP_BLOCK_FLAGS);
+}
+
+_TN_STATIC_INLINE TN_BOOL _block_is_free(const struct _TN_HeapBlock *block)
+{
+   return !!(block->u.size & _HEAP_BLOCK_FREE);
+}
+
+_TN_STATIC_INLINE void *_block_to_ptr(struct _TN_HeapBlock *block)
+{
+   return (void *)((unsigned char *)block + _HEAP_BLOCK_DATA_OFFSET);
+}
+
+_TN_STATIC_INLINE struct _TN_HeapBlock *_block_from_ptr(void *ptr)
+{
+   return (struct _TN_HeapBlock *)(
+         (unsigned char *)ptr - _HEAP_BLOCK_DATA_OFFSET
+         );
+}
+
+/**
+ * Returns the next block in memory: its `prev_phys` field overlaps the
+ * last word of the given block's data.
+ */
+_TN_STATIC_INLINE struct _TN_HeapBlock *_block_next(
+      struct _TN_HeapBlock *block
+      )
+{
+   return (struct _TN_HeapBlock *)(
+           (unsigned char *)_block_to_ptr(block)
+         + _block_size(block)
+         - sizeof(struct _TN_HeapBlock *)
+         );
+}
+
+/**
+ * Get first-level and second-level indexes of the list to which the free
+ * block of given size belongs.
+ */
+_TN_STATIC_INLINE void _mapping_insert(
+      unsigned int size, int *p_fl, int *p_sl
+      )
+{
+   if (size < _HEAP_SMALL_SIZE){
+      //-- small blocks: linear classes
+      *p_fl = 0;
+      *p_sl = (int)(size >> _HEAP_ALIGN_LOG2);
+   } else {
+      int msb = _heap_fls(size);
+
+      //-- the second-level index is given by the `_HEAP_SL_LOG2` bits
+      //   which follow the most significant bit
+      *p_sl = (int)(size >> (msb - _HEAP_SL_LOG2)) ^ _HEAP_SL_CNT;
+      *p_fl = msb - _HEAP_FL_SHIFT + 1;
+   }
+}
+
+/**
+ * Get first-level and second-level indexes of the list in which any free
+ * block is large enough for the given size: that is, round size up to the
+ * next class boundary, so that we never need to walk the list.
+ */
+_TN_STATIC_INLINE void _mapping_search(
+      unsigned int size, int *p_fl, int *p_sl
+      )
+{
+   if (size >= _HEAP_SMALL_SIZE){
+      size += ((unsigned int)1 << (_heap_fls(size) - _HEAP_SL_LOG2)) - 1;
+   }
+   _mapping_insert(size, p_fl, p_sl);
+}
+
+_TN_STATIC_INLINE struct _TN_HeapBlock **_free_list_head(
+      struct TN_Heap *heap, int fl, int sl
+      )
+{
+   return &heap->free_lists[fl * _HEAP_SL_CNT + sl];
+}
+
+/**
+ * Find the non-empty list of free blocks with the class not less than given
+ * one, and return its first block, or `TN_NULL` if there are no such lists.
+ */
+static struct _TN_HeapBlock *_free_block_find(
+      struct TN_Heap *heap, int fl, int sl
+      )
+{
+   struct _TN_HeapBlock *ret = TN_NULL;
+   unsigned int sl_map;
+
+   if (fl < heap->fl_cnt){
+      //-- first, try the lists of the same first-level class
+      sl_map = heap->sl_bitmap[fl] & (~0u << sl);
+
+      if (sl_map == 0){
+         //-- no luck: get the next non-empty first-level class
+         unsigned int fl_map = (fl + 1 < TN_INT_WIDTH)
+            ? (heap->fl_bitmap & (~0u << (fl + 1)))
+            : 0;
+
+         if (fl_map != 0){
+            fl = _tn_bmp_ffs(fl_map) - 1;
+            sl_map = heap->sl_bitmap[fl];
+         }
+      }
+
+      if (sl_map != 0){
+         sl = _tn_bmp_ffs(sl_map) - 1;
+         ret = *_free_list_head(heap, fl, sl);
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * Insert free block to the appropriate list
+ */
+static void _free_block_insert(
+      struct TN_Heap *heap,
+      struct _TN_HeapBlock *block
+      )
+{
+   int fl, sl;
+   struct _TN_HeapBlock **p_head;
+
+   _mapping_insert(_block_size(block), &fl, &sl);
+   p_head = _free_list_head(heap, fl, sl);
+
+   block->prev_free = TN_NULL;
+   block->next_free = *p_head;
+   if (*p_head != TN_NULL){
+      (*p_head)->prev_free = block;
+   }
+   *p_head = block;
+
+   heap->fl_bitmap     |= (1u << fl);
+   heap->sl_bitmap[fl] |= (1u << sl);
+}
+
+/**
+ * Remove free block from its list
+ */
+static void _free_block_remove(
+      struct TN_Heap *heap,
+      struct _TN_HeapBlock *block
+      )
+{
+   int fl, sl;
+
+   if (block->next_free != TN_NULL){
+      block->next_free->prev_free = block->prev_free;
+   }
+
+   if (block->prev_free != TN_NULL){
+      block->prev_free->next_free = block->next_free;
+   } else {
+      //-- the block is the head of the list
+      struct _TN_HeapBlock **p_head;
+
+      _mapping_insert(_block_size(block), &fl, &sl);
+      p_head = _free_list_head(heap, fl, sl);
+      *p_head = block->next_free;
+
+      if (*p_head == TN_NULL){
+         //-- the list is empty now, so, clear bits
+         heap->sl_bitmap[fl] &= ~(1u << sl);
+         if (heap->sl_bitmap[fl] == 0){
+            heap->fl_bitmap &= ~(1u << fl);
+         }
+      }
+   }
+}
+
+/**
+ * Adjust requested size: round it up to the `#_HEAP_ALIGN` boundary, and
+ * make it not less than `#_HEAP_BLOCK_SIZE_MIN`. If the heap can never
+ * provide the block of such size, 0 is returned.
+ */
+static unsigned int _size_adjust(struct TN_Heap *heap, unsigned int size)
+{
+   unsigned int ret = 0;
+
+   if (size != 0 && size <= heap->total_size){
+      ret = _heap_size_align(size);
+      if (ret < _HEAP_BLOCK_SIZE_MIN){
+         ret = _HEAP_BLOCK_SIZE_MIN;
+      }
+      if (ret > heap->total_size - _HEAP_BLOCK_OVERHEAD){
+         ret = 0;
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * Try to allocate block of given size (which should be already adjusted by
+ * `_size_adjust()`).
+ *
+ * If there is suitable free block, it is allocated and the address of it is
+ * stored at the provided location (`p_data`). Otherwise, `#TN_RC_TIMEOUT`
+ * is returned, and this case can be handled by the caller.
+ */
+static enum TN_RCode _heap_alloc(
+      struct TN_Heap *heap,
+      unsigned int size,
+      void **p_data
+      )
+{
+   enum TN_RCode rc = TN_RC_TIMEOUT;
+   struct _TN_HeapBlock *block;
+   int fl, sl;
+
+   _mapping_search(size, &fl, &sl);
+   block = _free_block_find(heap, fl, sl);
+
+   if (block == TN_NULL){
+      //-- There are no classes in which any block is large enough, but
+      //   the class of the requested size itself may still contain a
+      //   suitable block (which is the case e.g. when the block of exactly
+      //   the same size was just freed: freed blocks are inserted to the
+      //   head of the list). Only the first block is checked, so that
+      //   allocation stays constant-time.
+      _mapping_insert(size, &fl, &sl);
+      if (fl < heap->fl_cnt){
+         block = *_free_list_head(heap, fl, sl);
+         if (block != TN_NULL && _block_size(block) < size){
+            block = TN_NULL;
+         }
+      }
+   }
+
+   if (block != TN_NULL){
+      unsigned int block_size = _block_size(block);
+
+      _free_block_remove(heap, block);
+
+      if (block_size >= size + _HEAP_BLOCK_OVERHEAD + _HEAP_BLOCK_SIZE_MIN){
+         //-- the block is large enough, so, split it: the remaining part
+         //   becomes a new free block, right after the allocated part.
+         struct _TN_HeapBlock *rest;
+
+         block->u.size = size | (block->u.size & _HEAP_BLOCK_PREV_FREE);
+         rest = _block_next(block);
+         rest->u.size
+            = (block_size - size - _HEAP_BLOCK_OVERHEAD) | _HEAP_BLOCK_FREE;
+
+         //-- the block after the `rest` keeps its `PREV_FREE` flag,
+         //   but now its previous block is `rest`
+         _block_next(rest)->prev_phys = rest;
+
+         _free_block_insert(heap, rest);
+      } else {
+         //-- the block is taken entirely
+         block->u.size &= ~_HEAP_BLOCK_FREE;
+         _block_next(block)->u.size &= ~_HEAP_BLOCK_PREV_FREE;
+         heap->free_blocks_cnt--;
+      }
+
+      heap->used_size += _block_size(block) + _HEAP_BLOCK_OVERHEAD;
+      heap->used_blocks_cnt++;
+      if (heap->used_size > heap->used_size_max){
+         heap->used_size_max = heap->used_size;
+      }
+
+      *p_data = _block_to_ptr(block);
+      rc = TN_RC_OK;
+   }
+
+   return rc;
+}
+
+/**
+ * Callback function that is given to `_tn_task_first_wait_complete()`
+ * when task finishes waiting for memory in the heap.
+ *
+ * See `#_TN_CBBeforeTaskWaitComplete` for details on function signature.
+ */
+static void _cb_before_task_wait_complete(
+      struct TN_Task   *task,
+      void             *user_data_1,
+      void             *user_data_2
+      )
+{
+   task->subsys_wait.heap.data_elem = user_data_1;
+   _TN_UNUSED(user_data_2);
+}
+
+/**
+ * Give memory to the waiting tasks in the order of the wait queue, until
+ * the first task whose request can't be satisfied (or until the queue is
+ * over). So, each call takes constant time plus constant time per task
+ * woken up.
+ */
+static void _waiters_serve(struct TN_Heap *heap)
+{
+   TN_BOOL served = TN_TRUE;
+   void *ptr;
+
+   while (served && !_tn_list_is_empty(&(heap->wait_queue))){
+      struct TN_Task *task = _tn_list_first_entry(
+            &(heap->wait_queue), struct TN_Task, task_queue
+            );
+
+      served = (
+            _heap_alloc(heap, task->subsys_wait.heap.size, &ptr) == TN_RC_OK
+            );
+
+      if (served){
+         _cb_before_task_wait_complete(task, ptr, TN_NULL);
+         _tn_task_wait_complete(task, TN_RC_OK);
+      }
+   }
+}
+
+/**
+ * Return block to the heap, merging it with free neighbours (if any), and
+ * then give memory to the waiting tasks, if possible.
+ */
+static void _heap_free(struct TN_Heap *heap, void *p_data)
+{
+   struct _TN_HeapBlock *block = _block_from_ptr(p_data);
+   struct _TN_HeapBlock *next;
+
+   heap->used_size -= _block_size(block) + _HEAP_BLOCK_OVERHEAD;
+   heap->used_blocks_cnt--;
+   heap->free_blocks_cnt++;
+
+   block->u.size |= _HEAP_BLOCK_FREE;
+
+   //-- merge with the previous block, if it's free
+   if (block->u.size & _HEAP_BLOCK_PREV_FREE){
+      struct _TN_HeapBlock *prev = block->prev_phys;
+
+      _free_block_remove(heap, prev);
+      prev->u.size += _block_size(block) + _HEAP_BLOCK_OVERHEAD;
+      block = prev;
+      heap->free_blocks_cnt--;
+   }
+
+   //-- merge with the next block, if it's free
+   next = _block_next(block);
+   if (_block_is_free(next)){
+      _free_block_remove(heap, next);
+      block->u.size += _block_size(next) + _HEAP_BLOCK_OVERHEAD;
+      heap->free_blocks_cnt--;
+
+      next = _block_next(block);
+   }
+
+   //-- let the next block know that its previous block is free
+   next->prev_phys = block;
+   next->u.size |= _HEAP_BLOCK_PREV_FREE;
+
+   _free_block_insert(heap, block);
+
+   //-- maybe some waiting tasks can get their memory now
+   _waiters_serve(heap);
+}
+
+
+//-- Additional param checking {{{
+#if TN_CHECK_PARAM
+_TN_STATIC_INLINE enum TN_RCode _check_param_create(
+      const struct TN_Heap *heap,
+      enum TN_WaitOrder     wait_order
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (heap == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (_tn_heap_is_valid(heap) || !_tn_wait_order_is_valid(wait_order)){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_generic(
+      const struct TN_Heap *heap
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (heap == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_heap_is_valid(heap)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_alloc(
+      const struct TN_Heap *heap,
+      void **p_data
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (heap == TN_NULL || p_data == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_heap_is_valid(heap)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_free(
+      const struct TN_Heap *heap,
+      void *p_data
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (heap == TN_NULL || p_data == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_heap_is_valid(heap)){
+      rc = TN_RC_INVALID_OBJ;
+   } else if (0
+         || (unsigned char *)p_data
+               < (unsigned char *)_block_to_ptr(heap->first_block)
+         || (unsigned char *)p_data
+               >= (unsigned char *)heap->sentinel
+         || (((TN_UIntPtr)p_data) & (sizeof(TN_UWord) - 1))
+         || _block_is_free(_block_from_ptr(p_data))
+         )
+   {
+      //-- the pointer is not in the heap, or the block is free already
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+#else
+#  define _check_param_create(heap, wait_order)    (TN_RC_OK)
+#  define _check_param_generic(heap)               (TN_RC_OK)
+#  define _check_param_alloc(heap, p_data)         (TN_RC_OK)
+#  define _check_param_free(heap, p_data)          (TN_RC_OK)
+#endif
+// }}}
+
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_create_worder(
+      struct TN_Heap   *heap,
+      void             *start_addr,
+      unsigned int      size,
+      enum TN_WaitOrder wait_order
+      )
+{
+   enum TN_RCode rc;
+   unsigned char *p_cur;
+   unsigned char *p_end;
+   unsigned int block_size;
+   int fl, sl;
+
+   rc = _check_param_create(heap, wait_order);
+   if (rc != TN_RC_OK){
+      goto out;
+   }
+
+   //-- check that start_addr is not TN_NULL, and it is aligned properly
+   if (     start_addr == TN_NULL
+         || TN_MAKE_ALIG_SIZE((TN_UIntPtr)start_addr) != (TN_UIntPtr)start_addr
+         || size < _HEAP_SMALL_SIZE
+      )
+   {
+      rc = TN_RC_WPARAM;
+      goto out;
+   }
+
+   //-- Determine the number of first-level classes: the first block can't
+   //   be larger than the whole buffer, so, use the size of the buffer.
+   _mapping_insert(size, &fl, &sl);
+   heap->fl_cnt = fl + 1;
+
+   //-- Control data are placed at the beginning of the buffer:
+   //   lists heads first, then second-level bitmaps
+   p_cur = (unsigned char *)start_addr;
+   p_end = p_cur + (size & ~(sizeof(TN_UWord) - 1));
+
+   heap->free_lists = (struct _TN_HeapBlock **)p_cur;
+   p_cur += sizeof(struct _TN_HeapBlock *) * heap->fl_cnt * _HEAP_SL_CNT;
+
+   heap->sl_bitmap = (unsigned int *)p_cur;
+   p_cur += TN_MAKE_ALIG_SIZE(sizeof(unsigned int) * heap->fl_cnt);
+
+   //-- The rest is for the blocks: the first block, which takes all the
+   //   memory, and then the zero-size sentinel block (which takes its
+   //   header only)
+   if (p_end - p_cur < (int)(  _HEAP_BLOCK_DATA_OFFSET + _HEAP_BLOCK_SIZE_MIN
+                             + _HEAP_BLOCK_OVERHEAD))
+   {
+      rc = TN_RC_WPARAM;
+      goto out;
+   }
+
+   block_size = (unsigned int)(p_end - p_cur)
+      - _HEAP_BLOCK_DATA_OFFSET - _HEAP_BLOCK_OVERHEAD;
+   block_size &= ~(_HEAP_ALIGN - 1);
+
+   //-- checks are done; proceed to actual creation
+
+   heap->wait_order = wait_order;
+   _tn_list_reset(&(heap->wait_queue));
+
+   heap->fl_bitmap = 0;
+   for (fl = 0; fl < heap->fl_cnt; fl++){
+      heap->sl_bitmap[fl] = 0;
+      for (sl = 0; sl < _HEAP_SL_CNT; sl++){
+         *_free_list_head(heap, fl, sl) = TN_NULL;
+      }
+   }
+
+   heap->first_block = (struct _TN_HeapBlock *)p_cur;
+   heap->first_block->u.size = block_size | _HEAP_BLOCK_FREE;
+
+   heap->sentinel = _block_next(heap->first_block);
+   heap->sentinel->u.size = 0 | _HEAP_BLOCK_PREV_FREE;
+   heap->sentinel->prev_phys = heap->first_block;
+
+   _free_block_insert(heap, heap->first_block);
+
+   heap->total_size        = block_size + _HEAP_BLOCK_OVERHEAD;
+   heap->used_size         = 0;
+   heap->used_size_max     = 0;
+   heap->used_blocks_cnt   = 0;
+   heap->free_blocks_cnt   = 1;
+   heap->fail_cnt          = 0;
+
+   //-- set id
+   heap->id_heap = TN_ID_HEAP;
+
+out:
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_delete(struct TN_Heap *heap)
+{
+   enum TN_RCode rc = _check_param_generic(heap);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      //-- remove all tasks (if any) from heap's wait queue
+      _tn_wait_queue_notify_deleted(&(heap->wait_queue));
+
+      heap->id_heap = TN_ID_NONE;   //-- heap does not exist now
+
+      TN_INT_RESTORE();
+
+      //-- we might need to switch context if _tn_wait_queue_notify_deleted()
+      //   has woken up some high-priority task
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_alloc(
+      struct TN_Heap *heap,
+      unsigned int size,
+      void **p_data,
+      TN_TickCnt timeout
+      )
+{
+   TN_BOOL waited_for_data = TN_FALSE;
+   enum TN_RCode rc = _check_param_alloc(heap, p_data);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else if ((size = _size_adjust(heap, size)) == 0){
+      //-- the heap can never provide the block of such size
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      rc = _heap_alloc(heap, size, p_data);
+
+      if (rc == TN_RC_TIMEOUT){
+         heap->fail_cnt++;
+
+         if (timeout > 0){
+            _tn_curr_run_task->subsys_wait.heap.size = size;
+            _tn_task_curr_to_wait_action_ordered(
+                  &(heap->wait_queue),
+                  heap->wait_order,
+                  TN_WAIT_REASON_WHEAP,
+                  timeout
+                  );
+            waited_for_data = TN_TRUE;
+         }
+      }
+
+      TN_INT_RESTORE();
+      _tn_context_switch_pend_if_needed();
+      if (waited_for_data){
+
+         //-- get wait result
+         rc = _tn_curr_run_task->task_wait_rc;
+
+         //-- if wait result is TN_RC_OK, copy block pointer to the
+         //   user's location
+         if (rc == TN_RC_OK){
+            *p_data = _tn_curr_run_task->subsys_wait.heap.data_elem;
+         }
+
+      }
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_alloc_polling(
+      struct TN_Heap *heap,
+      unsigned int size,
+      void **p_data
+      )
+{
+   return tn_heap_alloc(heap, size, p_data, 0);
+}
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_ialloc_polling(
+      struct TN_Heap *heap,
+      unsigned int size,
+      void **p_data
+      )
+{
+   enum TN_RCode rc = _check_param_alloc(heap, p_data);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else if ((size = _size_adjust(heap, size)) == 0){
+      //-- the heap can never provide the block of such size
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      rc = _heap_alloc(heap, size, p_data);
+      if (rc == TN_RC_TIMEOUT){
+         heap->fail_cnt++;
+      }
+
+      TN_INT_IRESTORE();
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_free(struct TN_Heap *heap, void *p_data)
+{
+   enum TN_RCode rc = _check_param_free(heap, p_data);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      _heap_free(heap, p_data);
+
+      TN_INT_RESTORE();
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_ifree(struct TN_Heap *heap, void *p_data)
+{
+   enum TN_RCode rc = _check_param_free(heap, p_data);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      _heap_free(heap, p_data);
+
+      TN_INT_IRESTORE();
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_heap.h)
+ */
+enum TN_RCode tn_heap_stat_get(
+      struct TN_Heap *heap,
+      struct TN_HeapStat *p_stat
+      )
+{
+   enum TN_RCode rc = _check_param_generic(heap);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (p_stat == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      p_stat->total_size         = heap->total_size;
+      p_stat->used_size          = heap->used_size;
+      p_stat->used_size_max      = heap->used_size_max;
+      p_stat->used_blocks_cnt    = heap->used_blocks_cnt;
+      p_stat->free_blocks_cnt    = heap->free_blocks_cnt;
+      p_stat->fail_cnt           = heap->fail_cnt;
+
+      //-- each free block has header too
+      p_stat->free_size = heap->total_size - heap->used_size
+         - heap->free_blocks_cnt * _HEAP_BLOCK_OVERHEAD;
+
+      //-- the largest free block is in the highest non-empty class,
+      //   but blocks in the class might be of different sizes, so,
+      //   walk the list (it is O(n) with interrupts disabled, see tn_heap.h)
+      p_stat->largest_free_size = 0;
+      if (heap->fl_bitmap != 0){
+         int fl = _heap_fls(heap->fl_bitmap);
+         int sl = _heap_fls(heap->sl_bitmap[fl]);
+         struct _TN_HeapBlock *block;
+
+         for (
+               block = *_free_list_head(heap, fl, sl);
+               block != TN_NULL;
+               block = block->next_free
+             )
+         {
+            if (_block_size(block) > p_stat->largest_free_size){
+               p_stat->largest_free_size = _block_size(block);
+            }
+         }
+      }
+
+      TN_INT_IRESTORE();
+   }
+
+   return rc;
+}
+
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
@@ -0,0 +1,492 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+
+/**
+ * \file
+ *
+ * Heap: memory pool for blocks of arbitrary size.
+ *
+ * \ref tn_fmem.h "Fixed memory pool" is perfect when all the blocks are of
+ * the same size, but when sizes vary, one either has to waste memory on
+ * the pool of the largest-size blocks, or keep several pools. Generic
+ * `malloc()` is not an option either: its execution time is unbounded, and
+ * it can't make the task wait until memory is available.
+ *
+ * Heap manages the memory area provided by the application as a set of
+ * blocks of arbitrary size, using the TLSF (Two-Level Segregated Fit)
+ * algorithm, so that both allocation and freeing of the block take constant
+ * time, independently of the number of blocks or size of the heap:
+ *
+ * - Free blocks are kept in segregated lists by their size: the first level
+ *   is a power of two, and each power of two is split into 8 second-level
+ *   ranges. Non-empty lists are marked in the two-level bitmap, so the
+ *   suitable list is found by a couple of find-first-set operations.
+ * - Each block has a header of one word (`#TN_UWord`; two words on 16-bit
+ *   platforms), which contains size of the block and a couple of flags;
+ *   the free neighbours of the block are merged with it immediately when
+ *   the block is freed.
+ *
+ * To find a block in constant time, the heap looks for it in the classes
+ * where any block is large enough, i.e. it starts from the class next to the
+ * one of the requested size. Only if the former fails, the first block of
+ * the requested size class itself is checked (so, allocation of the block of
+ * exactly the same size as the just freed one still succeeds). The found
+ * block is split, if it's large enough, so that the rest is returned to the
+ * heap.
+ *
+ * If there is no suitable free block, task may wait until some other task
+ * frees enough memory, just like with the fixed memory pool. When the block
+ * is freed, the kernel gives memory to the waiting tasks in order (see `enum
+ * #TN_WaitOrder`), until the first task whose request can't be satisfied:
+ * this one and the tasks after it keep waiting. So, the tasks which wait
+ * for small blocks don't overtake the one which waits for a large block,
+ * and the time of `tn_heap_free()` / `tn_heap_ifree()` is constant plus
+ * constant per task woken up.
+ *
+ * The heap keeps a few statistics: used size and its high-water mark,
+ * number of blocks, size of the largest free block (so that fragmentation
+ * can be estimated), and the number of failed allocations; see `struct
+ * #TN_HeapStat`.
+ */
+
+#ifndef _TN_HEAP_H
+#define _TN_HEAP_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_list.h"
+#include "tn_common.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {  /*}*/
+#endif
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+struct _TN_HeapBlock;
+
+/**
+ * Heap: memory pool for blocks of arbitrary size
+ */
+struct TN_Heap {
+   ///
+   /// id for object validity verification.
+   /// This field is in the beginning of the structure to make it easier
+   /// to detect memory corruption.
+   enum TN_ObjId           id_heap;
+   ///
+   /// list of tasks waiting for memory
+   struct TN_ListItem      wait_queue;
+   ///
+   /// Order of tasks in the `wait_queue`
+   enum TN_WaitOrder       wait_order;
+
+   ///
+   /// First-level bitmap: bit N is set if there are free blocks
+   /// in any of the lists of the N-th first-level class
+   unsigned int            fl_bitmap;
+   ///
+   /// Second-level bitmaps, one for each first-level class: bit M is set if
+   /// the list of free blocks `[N][M]` is not empty. The array is located
+   /// at the beginning of the memory area given to `tn_heap_create()`.
+   unsigned int           *sl_bitmap;
+   ///
+   /// Heads of the lists of free blocks, `fl_cnt` x 8 items. The array is
+   /// located at the beginning of the memory area given to
+   /// `tn_heap_create()`.
+   struct _TN_HeapBlock  **free_lists;
+   ///
+   /// Number of first-level classes
+   int                     fl_cnt;
+
+   ///
+   /// The first block in the heap
+   struct _TN_HeapBlock   *first_block;
+   ///
+   /// Zero-size sentinel block which follows the last block in the heap
+   struct _TN_HeapBlock   *sentinel;
+   ///
+   /// Total size of the heap, including headers of blocks; it is the
+   /// maximum size of block that can be allocated, plus the header size.
+   unsigned int            total_size;
+
+   ///
+   /// Size of allocated blocks, including their headers
+   unsigned int            used_size;
+   ///
+   /// High-water mark of `used_size`
+   unsigned int            used_size_max;
+   ///
+   /// Number of allocated blocks
+   int                     used_blocks_cnt;
+   ///
+   /// Number of free blocks
+   int                     free_blocks_cnt;
+   ///
+   /// Number of allocation requests that couldn't be satisfied right away
+   /// (no matter whether task waited for memory then or not)
+   unsigned int            fail_cnt;
+};
+
+/**
+ * Heap-specific fields related to waiting task,
+ * to be included in struct TN_Task.
+ */
+struct TN_HeapTaskWait {
+   ///
+   /// Size of the block requested by the task (already adjusted to
+   /// alignment and minimum block size)
+   unsigned int size;
+   ///
+   /// When the block is allocated for the waiting task, its address is
+   /// stored here
+   void *data_elem;
+};
+
+/**
+ * Heap statistics, see `tn_heap_stat_get()`.
+ *
+ * Fragmentation of the heap can be estimated as follows: if
+ * `largest_free_size` is much less than `free_size`, the free memory is
+ * scattered across many small blocks, and large blocks can't be allocated
+ * even though there's enough free memory in total.
+ */
+struct TN_HeapStat {
+   ///
+   /// Total size of the heap, including headers of blocks
+   unsigned int   total_size;
+   ///
+   /// Size of allocated blocks, including their headers
+   unsigned int   used_size;
+   ///
+   /// High-water mark of `used_size`
+   unsigned int   used_size_max;
+   ///
+   /// Size available for allocation in all free blocks (i.e. sum of sizes
+   /// of all free blocks, excluding headers)
+   unsigned int   free_size;
+   ///
+   /// Size of the largest free block (excluding header), i.e. the largest
+   /// block that can be allocated right now
+   unsigned int   largest_free_size;
+   ///
+   /// Number of allocated blocks
+   int            used_blocks_cnt;
+   ///
+   /// Number of free blocks
+   int            free_blocks_cnt;
+   ///
+   /// Number of allocation requests that couldn't be satisfied right away
+   unsigned int   fail_cnt;
+};
+
+
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/**
+ * Convenience macro for the definition of buffer for heap. See
+ * `tn_heap_create()` for usage example.
+ *
+ * Note that the heap places its control data (a few words per each power of
+ * two of the heap size) at the beginning of the buffer, and each block takes
+ * a header, so the buffer should be somewhat larger than the
+ * total size of blocks to be allocated.
+ *
+ * @param name
+ *    C variable name of the buffer array (this name should be given
+ *    to the `tn_heap_create()` function as the `start_addr` argument)
+ * @param size
+ *    Size of the buffer in bytes
+ */
+#define TN_HEAP_BUF_DEF(name, size)                               \
+   TN_UWord name[ TN_MAKE_ALIG_SIZE(size) / sizeof(TN_UWord) ]
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * The same as `tn_heap_create()`, but takes additional argument:
+ * `wait_order`, so that tasks waiting for memory may be queued in order of
+ * their priorities.
+ *
+ * @param heap       pointer to already allocated `struct TN_Heap`.
+ * @param start_addr pointer to start of the buffer; should be aligned
+ *                   properly
+ * @param size       size of the buffer in bytes
+ * @param wait_order order of waiting tasks, see `enum #TN_WaitOrder`
+ */
+enum TN_RCode tn_heap_create_worder(
+      struct TN_Heap   *heap,
+      void             *start_addr,
+      unsigned int      size,
+      enum TN_WaitOrder wait_order
+      );
+
+/**
+ * Construct heap in the given buffer. `id_heap` field should not contain
+ * `#TN_ID_HEAP`, otherwise, `#TN_RC_WPARAM` is returned.
+ *
+ * Waiting tasks are queued in FIFO order; if you need them to be queued
+ * by priority, use `tn_heap_create_worder()`.
+ *
+ * Note that `start_addr` should be a multiple of `sizeof(#TN_UWord)`.
+ *
+ * Typical definition looks as follows:
+ *
+ * \code{.c}
+ *     //-- define buffer for heap
+ *     TN_HEAP_BUF_DEF(my_heap_buf, 4096);
+ *
+ *     //-- define heap structure
+ *     struct TN_Heap my_heap;
+ * \endcode
+ *
+ * And then, construct your `my_heap` as follows:
+ *
+ * \code{.c}
+ *     enum TN_RCode rc;
+ *     rc = tn_heap_create(&my_heap, my_heap_buf, sizeof(my_heap_buf));
+ *     if (rc != TN_RC_OK){
+ *        //-- handle error
+ *     }
+ * \endcode
+ *
+ * If given `start_addr` isn't aligned properly, or the buffer is too small
+ * even for the control data and one block, `#TN_RC_WPARAM` is returned.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param heap       pointer to already allocated `struct TN_Heap`.
+ * @param start_addr pointer to start of the buffer; should be aligned
+ *                   properly, see example above
+ * @param size       size of the buffer in bytes
+ *
+ * @return
+ *    * `#TN_RC_OK` if heap was successfully created;
+ *    * `#TN_RC_WPARAM` if wrong params were given (say, the buffer is too
+ *      small or not aligned properly).
+ */
+_TN_STATIC_INLINE enum TN_RCode tn_heap_create(
+      struct TN_Heap   *heap,
+      void             *start_addr,
+      unsigned int      size
+      )
+{
+   return tn_heap_create_worder(
+         heap, start_addr, size, TN_WAIT_ORDER_FIFO
+         );
+}
+
+/**
+ * Destruct heap.
+ *
+ * All tasks that wait for memory become runnable with `#TN_RC_DELETED` code
+ * returned.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param heap       pointer to heap to be deleted
+ *
+ * @return
+ *    * `#TN_RC_OK` if heap is successfully deleted;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_heap_delete(struct TN_Heap *heap);
+
+/**
+ * Allocate block of the given size from the heap. Start address of the
+ * block is returned through the `p_data` argument; it is aligned to
+ * `sizeof(#TN_UWord)`. The content of the block is undefined. If there is
+ * no suitable free block in the heap, behavior depends on `timeout` value:
+ * refer to `#TN_TickCnt`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param heap
+ *    Pointer to heap
+ * @param size
+ *    Size of the block in bytes
+ * @param p_data
+ *    Address of the `(void *)` to which allocated block address will be
+ *    saved
+ * @param timeout
+ *    Refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK` if block was successfully returned through `p_data`;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * `#TN_RC_WPARAM` if `size` is 0, or it is larger than the heap can
+ *      ever provide;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_heap_alloc(
+      struct TN_Heap *heap,
+      unsigned int size,
+      void **p_data,
+      TN_TickCnt timeout
+      );
+
+/**
+ * The same as `tn_heap_alloc()` with zero timeout
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_heap_alloc_polling(
+      struct TN_Heap *heap,
+      unsigned int size,
+      void **p_data
+      );
+
+/**
+ * The same as `tn_heap_alloc()` with zero timeout, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_heap_ialloc_polling(
+      struct TN_Heap *heap,
+      unsigned int size,
+      void **p_data
+      );
+
+/**
+ * Return the block back to the heap. The block is merged with its free
+ * neighbours (if any), and then the kernel checks whether some waiting
+ * tasks can get their memory now, see the top of this file for details.
+ *
+ * If `#TN_CHECK_PARAM` is non-zero, the kernel checks that `p_data` points
+ * into the heap and the block isn't free already, but it can't check that
+ * `p_data` is really the address returned by `tn_heap_alloc()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param heap
+ *    Pointer to heap.
+ * @param p_data
+ *    Address of the block to free.
+ *
+ * @return
+ *    * `#TN_RC_OK` on success
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_heap_free(struct TN_Heap *heap, void *p_data);
+
+/**
+ * The same as `tn_heap_free()`, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_heap_ifree(struct TN_Heap *heap, void *p_data);
+
+/**
+ * Get heap statistics, see `struct #TN_HeapStat`.
+ *
+ * Most of the values are just copied, but to find the largest free block,
+ * the kernel has to walk the list of free blocks of the highest size class
+ * (all the other lists are skipped thanks to the bitmaps). So, unlike the
+ * other heap services, it is not constant-time: it takes O(n) time, where
+ * n is the number of free blocks in that class, and interrupts are
+ * disabled all the while. Don't call it from time-critical code.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param heap
+ *    Pointer to heap.
+ * @param p_stat
+ *    Pointer to the structure to fill.
+ *
+ * @return
+ *    * `#TN_RC_OK` on success
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_heap_stat_get(
+      struct TN_Heap *heap,
+      struct TN_HeapStat *p_stat
+      );
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_HEAP_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
@@ -0,0 +1,251 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+
+/**
+ * \file
+ *
+ * Interrupts-disabled duration statistics.
+ *
+ * If `#TN_INT_DIS_STAT` is non-zero, critical section macros
+ * `TN_INT_DIS_SAVE()`, `TN_INT_RESTORE()`, `TN_INT_IDIS_SAVE()` and
+ * `TN_INT_IRESTORE()` are overridden so that each critical section gets
+ * timestamped: on entering the outermost critical section, the timestamp is
+ * taken, and on leaving it, the duration of the section is added to the
+ * statistics of the call site at which interrupts were disabled. Each call
+ * site is identified by the file name and line number, and has its own
+ * `struct #TN_IntDisSite` with the counter of executions, maximum duration
+ * and histogram of durations.
+ *
+ * This way, you can find out which kernel service (or which critical section
+ * of your application, since the same macros are used there) is responsible
+ * for the worst interrupt latency.
+ *
+ * Timestamps are taken by the user-provided callback (see
+ * `tn_callback_profiler_timestamp_set()`), so `#TN_PROFILER_TIMESTAMP` must
+ * be set as well. Durations are given in the units of that timestamp.
+ *
+ * Only the critical sections which are entered with interrupts enabled are
+ * measured; nested critical sections are accounted to the outermost one.
+ *
+ * All kernel services disable interrupts by these macros, but the following
+ * critical sections are not measured, so the actual worst case might be
+ * somewhat longer than the reported one:
+ *
+ * - context switch itself, which is performed by the port (say, in the
+ *   PendSV handler on Cortex-M) with interrupts disabled;
+ * - the final part of `tn_task_exit()`: it disables interrupts and switches
+ *   context to the next task without restoring them;
+ * - critical sections inside the port, and the ones entered by the direct
+ *   calls to `tn_arch_sr_save_int_dis()` or `tn_arch_int_dis()` from the
+ *   application.
+ *
+ * \attention This is a debug tool: each call site takes about 80 bytes of
+ * RAM (which is allocated statically, right at the call site), and each
+ * critical section gets some overhead, so you don't want to enable it in the
+ * production firmware.
+ */
+
+#ifndef _TN_INT_DIS_STAT_H
+#define _TN_INT_DIS_STAT_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_common.h"
+#include "../arch/tn_arch.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {     /*}*/
+#endif
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Number of buckets in the histogram of critical section durations, see
+ * `struct #TN_IntDisSite`
+ */
+#define  TN_INT_DIS_STAT_HIST_CNT   16
+
+/**
+ * Statistics of critical sections which are entered at the particular call
+ * site of `TN_INT_DIS_SAVE()` or `TN_INT_IDIS_SAVE()`. The structure is
+ * allocated statically at the call site, and is linked to the list of sites
+ * (see `tn_int_dis_stat_sites_get()`) when the critical section is measured
+ * for the first time.
+ */
+struct TN_IntDisSite {
+   ///
+   /// Source file of the call site
+   const char             *file;
+   ///
+   /// Line number of the call site
+   unsigned int            line;
+   ///
+   /// Whether the site is already linked to the list of sites
+   TN_BOOL                 linked;
+   ///
+   /// Number of measured critical sections
+   unsigned long           cnt;
+   ///
+   /// Maximum duration of critical section
+   unsigned long           max;
+   ///
+   /// Histogram of durations with power-of-two buckets: `hist[0]` is the
+   /// number of sections with duration 0, `hist[N]` is the number of
+   /// sections with duration from `(1 << (N - 1))` to `((1 << N) - 1)`, and
+   /// the last bucket accounts for all longer sections as well.
+   unsigned long           hist[ TN_INT_DIS_STAT_HIST_CNT ];
+   ///
+   /// Next site in the list, or `TN_NULL`
+   struct TN_IntDisSite   *next;
+};
+
+
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+//-- Override critical section macros provided by the port
+#if TN_INT_DIS_STAT && !defined(DOXYGEN_ACTIVE)
+
+#undef   TN_INT_DIS_SAVE
+#undef   TN_INT_RESTORE
+#undef   TN_INT_IDIS_SAVE
+#undef   TN_INT_IRESTORE
+
+#define  TN_INT_DIS_SAVE()                                              \
+   do {                                                                 \
+      static struct TN_IntDisSite _tn_int_dis_site = {                  \
+         __FILE__, __LINE__                                             \
+      };                                                                \
+      TN_INTSAVE_VAR = _tn_int_dis_stat_sr_save_int_dis(                \
+            &_tn_int_dis_site                                           \
+            );                                                          \
+   } while (0)
+
+#define  TN_INT_RESTORE()     _tn_int_dis_stat_sr_restore(TN_INTSAVE_VAR)
+
+#define  TN_INT_IDIS_SAVE()   TN_INT_DIS_SAVE()
+#define  TN_INT_IRESTORE()    TN_INT_RESTORE()
+
+#endif
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+#if TN_INT_DIS_STAT || defined(DOXYGEN_ACTIVE)
+
+/**
+ * $(TN_IF_ONLY_INT_DIS_STAT_SET)
+ *
+ * Returns the list of call sites of critical sections which were measured at
+ * least once. The list is linked by the `next` field of `struct
+ * #TN_IntDisSite`; new sites are added to the head of the list, so the list
+ * should be walked with interrupts disabled.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CALL_FROM_MAIN)
+ * $(TN_LEGEND_LINK)
+ */
+const struct TN_IntDisSite *tn_int_dis_stat_sites_get(void);
+
+/**
+ * $(TN_IF_ONLY_INT_DIS_STAT_SET)
+ *
+ * Reset statistics of all the call sites (sites themselves are not removed
+ * from the list).
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CALL_FROM_MAIN)
+ * $(TN_LEGEND_LINK)
+ */
+void tn_int_dis_stat_reset(void);
+
+/**
+ * For internal kernel usage: disable interrupts, and if they were enabled,
+ * start measuring critical section. Used by `TN_INT_DIS_SAVE()` when
+ * `#TN_INT_DIS_STAT` is set.
+ *
+ * @param site
+ *    Statistics of the call site
+ *
+ * @return
+ *    Previous value of status register, as `tn_arch_sr_save_int_dis()`.
+ */
+TN_UWord _tn_int_dis_stat_sr_save_int_dis(struct TN_IntDisSite *site);
+
+/**
+ * For internal kernel usage: if the outermost critical section is being
+ * left, update its statistics; then restore status register. Used by
+ * `TN_INT_RESTORE()` when `#TN_INT_DIS_STAT` is set.
+ *
+ * @param sr
+ *    Status register value returned by `_tn_int_dis_stat_sr_save_int_dis()`
+ */
+void _tn_int_dis_stat_sr_restore(TN_UWord sr);
+
+#endif
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_INT_DIS_STAT_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
+
+
@@ -141,6 +141,27 @@ _TN_MAX_INLINED_FUNC void _tn_list_remove_entry(struct TN_ListItem *entry)
    //         to get the next item.
 }
 
+/*
+ * See comments in the header file tn_list.h
+ */
+_TN_MAX_INLINED_FUNC void _tn_list_move_all(
+      struct TN_ListItem *dst,
+      struct TN_ListItem *src
+      )
+{
+   //-- Move all entries from the `src` list to the `dst` list.
+   if (src->next == src){
+      _tn_list_reset(dst);
+   } else {
+      dst->next = src->next;
+      dst->prev = src->prev;
+      dst->next->prev = dst;
+      dst->prev->next = dst;
+
+      _tn_list_reset(src);
+   }
+}
+
 /*
  * See comments in the header file tn_list.h
  */
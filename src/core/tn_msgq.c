@@ -0,0 +1,839 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "tn_common.h"
+#include "tn_sys.h"
+
+//-- internal tnkernel headers
+#include "_tn_eventgrp.h"
+#include "_tn_tasks.h"
+#include "_tn_timer.h"
+#include "_tn_list.h"
+#include "_tn_trace.h"
+
+
+#include "tn_msgq.h"
+#include "_tn_msgq.h"
+
+#include "tn_tasks.h"
+
+
+
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/**
+ * Type of job: send message or receive message. Given to
+ * `_msgq_job_perform()` and `_msgq_job_iperform()`.
+ */
+enum _JobType {
+   _JOB_TYPE__SEND,
+   _JOB_TYPE__RECEIVE,
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+//-- Additional param checking {{{
+#if TN_CHECK_PARAM
+_TN_STATIC_INLINE enum TN_RCode _check_param_generic(
+      const struct TN_MsgQ *msgq
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (msgq == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_msgq_is_valid(msgq)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_create(
+      const struct TN_MsgQ *msgq,
+      void *buf,
+      unsigned int item_size,
+      int items_cnt
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (msgq == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (   item_size == 0
+              || items_cnt < 0
+              || (buf == TN_NULL && items_cnt > 0)
+              || _tn_msgq_is_valid(msgq)
+             )
+   {
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_job_perform(
+      const struct TN_MsgQ *msgq,
+      const void *p_msg
+      )
+{
+   enum TN_RCode rc = _check_param_generic(msgq);
+
+   if (rc == TN_RC_OK && p_msg == TN_NULL){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+#else
+#  define _check_param_generic(msgq)                              (TN_RC_OK)
+#  define _check_param_create(msgq, buf, item_size, items_cnt)    (TN_RC_OK)
+#  define _check_param_job_perform(msgq, p_msg)                   (TN_RC_OK)
+#endif
+// }}}
+
+//-- Message queue storage FIFO processing {{{
+
+/**
+ * Try to copy message to the FIFO.
+ *
+ * If there is a room in the FIFO, message is copied, and `#TN_RC_OK` is
+ * returned; otherwise, `#TN_RC_TIMEOUT` is returned, and this case can
+ * be handled by the caller.
+ *
+ * @param msgq
+ *    Message queue in which message should be written
+ * @param p_msg
+ *    Message to write: `item_size` bytes are copied from it
+ */
+static enum TN_RCode _fifo_write(struct TN_MsgQ *msgq, const void *p_msg)
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (msgq->filled_items_cnt >= msgq->items_cnt){
+      //-- no space for new message
+      rc = TN_RC_TIMEOUT;
+   } else {
+
+      //-- write message
+      memcpy(
+            msgq->buf + (msgq->head_idx * msgq->item_size),
+            p_msg, msgq->item_size
+            );
+      msgq->filled_items_cnt++;
+      msgq->head_idx++;
+      if (msgq->head_idx >= msgq->items_cnt){
+         msgq->head_idx = 0;
+      }
+
+      //-- set flag in the connected event group (if any),
+      //   indicating that there are messages in the queue
+      _tn_eventgrp_link_manage(&msgq->eventgrp_link, TN_TRUE);
+   }
+
+   return rc;
+}
+
+
+/**
+ * Try to copy message from the FIFO.
+ *
+ * If there are some messages in the FIFO, the oldest one is copied, and
+ * `#TN_RC_OK` is returned; otherwise, `#TN_RC_TIMEOUT` is returned, and this
+ * case can be handled by the caller.
+ *
+ * @param msgq
+ *    Message queue from which message should be read
+ * @param p_msg
+ *    Buffer to which message should be copied
+ */
+static enum TN_RCode _fifo_read(struct TN_MsgQ *msgq, void *p_msg)
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (msgq->filled_items_cnt == 0){
+      //-- nothing to read
+      rc = TN_RC_TIMEOUT;
+   } else {
+
+      //-- read message
+      memcpy(
+            p_msg, msgq->buf + (msgq->tail_idx * msgq->item_size),
+            msgq->item_size
+            );
+      msgq->filled_items_cnt--;
+      msgq->tail_idx++;
+      if (msgq->tail_idx >= msgq->items_cnt){
+         msgq->tail_idx = 0;
+      }
+
+      if (msgq->filled_items_cnt == 0){
+         //-- clear flag in the connected event group (if any),
+         //   indicating that there are no messages in the queue
+         _tn_eventgrp_link_manage(&msgq->eventgrp_link, TN_FALSE);
+      }
+   }
+
+   return rc;
+}
+// }}}
+
+/**
+ * Callback function that is given to `_tn_task_first_wait_complete()`
+ * when task finishes waiting for new messages in the queue.
+ *
+ * See `#_TN_CBBeforeTaskWaitComplete` for details on function signature.
+ */
+static void _cb_before_task_wait_complete__send(
+      struct TN_Task   *task,
+      void             *user_data_1,
+      void             *user_data_2
+      )
+{
+   struct TN_MsgQ *msgq = (struct TN_MsgQ *)user_data_2;
+
+   //-- before task is woken up, copy the message right to its buffer,
+   //   bypassing the FIFO
+   memcpy(task->subsys_wait.msgq.p_msg, user_data_1, msgq->item_size);
+
+   _tn_trace(TN_TRACE_EV_MSGQ_SEND, msgq, (TN_UWord)user_data_1);
+   _tn_trace(
+         TN_TRACE_EV_MSGQ_RECEIVE, msgq,
+         (TN_UWord)task->subsys_wait.msgq.p_msg
+         );
+}
+
+/**
+ * Callback function that is given to `_tn_task_first_wait_complete()`
+ * when task finishes waiting for free item in the queue.
+ *
+ * See `#_TN_CBBeforeTaskWaitComplete` for details on function signature.
+ */
+static void _cb_before_task_wait_complete__receive_ok(
+      struct TN_Task   *task,
+      void             *user_data_1,
+      void             *user_data_2
+      )
+{
+   struct TN_MsgQ *msgq = (struct TN_MsgQ *)user_data_1;
+
+   //-- copy the message of the waiting task to the FIFO
+   enum TN_RCode rc = _fifo_write(msgq, task->subsys_wait.msgq.p_msg);
+   if (rc != TN_RC_OK){
+      _TN_FATAL_ERROR("rc should always be TN_RC_OK here");
+   }
+   _tn_trace(
+         TN_TRACE_EV_MSGQ_SEND, msgq,
+         (TN_UWord)task->subsys_wait.msgq.p_msg
+         );
+   _TN_UNUSED(user_data_2);
+}
+
+/**
+ * Callback function that is given to `_tn_task_first_wait_complete()`
+ * when `items_cnt` is 0.
+ *
+ * See `#_TN_CBBeforeTaskWaitComplete` for details on function signature.
+ */
+static void _cb_before_task_wait_complete__receive_timeout(
+      struct TN_Task   *task,
+      void             *user_data_1,
+      void             *user_data_2
+      )
+{
+   // (that might happen if only msgq->items_cnt is 0)
+
+   struct TN_MsgQ *msgq = (struct TN_MsgQ *)user_data_2;
+
+   //-- copy the message of the waiting task right to the receiver's buffer
+   memcpy(user_data_1, task->subsys_wait.msgq.p_msg, msgq->item_size);
+
+   _tn_trace(
+         TN_TRACE_EV_MSGQ_SEND, msgq,
+         (TN_UWord)task->subsys_wait.msgq.p_msg
+         );
+}
+
+
+/**
+ * Actual worker function that sends new message through the queue.
+ * Eventually called when user calls one of these functions:
+ *
+ * - `tn_msgq_send()`
+ * - `tn_msgq_send_polling()`
+ * - `tn_msgq_isend_polling()`
+ *
+ *
+ * First of all, it checks whether there are tasks that wait for new message.
+ * If so, the message is copied to the buffer of that task, and task is woken
+ * up. FIFO stays untouched.
+ *
+ * Otherwise, it calls `_fifo_write()` which tries to copy message to the
+ * FIFO. If there is a room in the FIFO, message is written, and `#TN_RC_OK`
+ * is returned; otherwise, `#TN_RC_TIMEOUT` is returned, and this case is
+ * probably handled by the caller (`_msgq_job_perform()` or
+ * `_msgq_job_iperform()`) depending on requested `timeout` value.
+ */
+static enum TN_RCode _msgq_send(
+      struct TN_MsgQ *msgq,
+      const void *p_msg
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (  !_tn_task_first_wait_complete(
+            &msgq->wait_receive_list, TN_RC_OK,
+            _cb_before_task_wait_complete__send, (void *)p_msg, msgq
+            )
+      )
+   {
+      //-- the message queue's wait_receive list is empty
+      rc = _fifo_write(msgq, p_msg);
+
+      if (rc == TN_RC_OK){
+         _tn_trace(TN_TRACE_EV_MSGQ_SEND, msgq, (TN_UWord)p_msg);
+      }
+   }
+
+   return rc;
+}
+
+/**
+ * Actual worker function that receives message from the queue.
+ * Eventually called when user calls one of these functions:
+ *
+ * - `tn_msgq_receive()`
+ * - `tn_msgq_receive_polling()`
+ * - `tn_msgq_ireceive_polling()`
+ *
+ * First of all, it tries to read message from the queue by calling
+ * `_fifo_read()`. In case of success, it checks whether there are tasks that
+ * wait for the free space in the queue, and wakes up the first task, if any.
+ *
+ * Otherwise (queue is empty, so, read is failed), it checks for the rare case
+ * if there are tasks that wait to write to the queue. It may happen if only
+ * `items_cnt` is 0. If there are such tasks, message is received from the
+ * first task from the queue. Otherwise, `#TN_RC_TIMEOUT` is returned, and
+ * this can be handled by the caller (`_msgq_job_perform()` or
+ * `_msgq_job_iperform()`) depending on requested `timeout` value.
+ */
+static enum TN_RCode _msgq_receive(
+      struct TN_MsgQ *msgq,
+      void *p_msg
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   //-- try to read message from the queue
+   rc = _fifo_read(msgq, p_msg);
+
+   switch (rc){
+      case TN_RC_OK:
+         //-- successfully read message from the queue.
+         //   if there are tasks that wait to send message to the queue,
+         //   wake the first one up, since there is room now.
+         _tn_task_first_wait_complete(
+               &msgq->wait_send_list, TN_RC_OK,
+               _cb_before_task_wait_complete__receive_ok, msgq, TN_NULL
+               );
+         break;
+
+      case TN_RC_TIMEOUT:
+         //-- nothing to read from the queue.
+         //   Let's check whether some task wants to send message
+         //   (that might happen if only msgq->items_cnt is 0)
+         if (  _tn_task_first_wait_complete(
+                  &msgq->wait_send_list, TN_RC_OK,
+                  _cb_before_task_wait_complete__receive_timeout, p_msg, msgq
+                  )
+            )
+         {
+            //-- that might happen if only msgq->items_cnt is 0:
+            //   message was copied to `p_msg` in the
+            //   `_cb_before_task_wait_complete__receive_timeout()`
+            rc = TN_RC_OK;
+         }
+         break;
+
+      default:
+         _TN_FATAL_ERROR("rc should be TN_RC_OK or TN_RC_TIMEOUT here");
+         break;
+   }
+
+   if (rc == TN_RC_OK){
+      _tn_trace(TN_TRACE_EV_MSGQ_RECEIVE, msgq, (TN_UWord)p_msg);
+   }
+
+   return rc;
+}
+
+
+/**
+ * Intermediary function that is called by queue-related services
+ * (`tn_msgq_send()`, `tn_msgq_receive()`, etc), which performs all necessary
+ * housekeeping and eventually calls actual worker function depending on given
+ * `job_type`.
+ *
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param msgq
+ *    Message queue on which job should be performed.
+ * @param job_type
+ *    Type of job to perform, depending on it, appropriate worker function
+ *    will be called (`_msgq_send()` or `_msgq_receive()`).
+ * @param p_msg
+ *    Depends on given job_type:
+ *
+ *    - `_JOB_TYPE__SEND`: message to send;
+ *    - `_JOB_TYPE__RECEIVE`: buffer to which message should be received.
+ * @param timeout
+ *    Refer to `#TN_TickCnt`; if `is_deadline` is `TN_TRUE`, it is the
+ *    absolute deadline instead.
+ * @param is_deadline
+ *    Whether `timeout` is the deadline, see `_tn_timeout_resolve()`.
+ */
+static enum TN_RCode _msgq_job_perform(
+      struct TN_MsgQ *msgq,
+      enum _JobType job_type,
+      void *p_msg,
+      TN_TickCnt timeout,
+      TN_BOOL is_deadline
+      )
+{
+   TN_BOOL waited = TN_FALSE;
+   enum TN_RCode rc = _check_param_job_perform(msgq, p_msg);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      switch (job_type){
+
+         case _JOB_TYPE__SEND:
+            //-- try to put new message to the queue
+            rc = _msgq_send(msgq, p_msg);
+
+            //-- if deadline is given, it is converted to timeout right here,
+            //   with interrupts disabled
+            if (rc == TN_RC_TIMEOUT){
+               timeout = _tn_timeout_resolve(timeout, is_deadline);
+            }
+
+            if (rc == TN_RC_TIMEOUT && timeout != 0){
+               //-- We can't put new message to the queue right now (queue
+               //   is full), and user asked to wait if that happens.
+               //
+               //   Save pointer to the message in the `msgq.p_msg` task
+               //   field, and put current task to wait until there's room in
+               //   the queue: then, the message will be copied from there.
+               _tn_curr_run_task->subsys_wait.msgq.p_msg = p_msg;
+               _tn_task_curr_to_wait_action(
+                     &(msgq->wait_send_list),
+                     TN_WAIT_REASON_MSGQ_WSEND,
+                     timeout
+                     );
+
+               waited = TN_TRUE;
+            }
+            break;
+
+         case _JOB_TYPE__RECEIVE:
+            //-- try to get the message from the queue
+            rc = _msgq_receive(msgq, p_msg);
+
+            if (rc == TN_RC_TIMEOUT){
+               timeout = _tn_timeout_resolve(timeout, is_deadline);
+            }
+
+            if (rc == TN_RC_TIMEOUT && timeout != 0){
+               //-- Queue is empty right now, and user asked to wait if that
+               //   happens.
+               //
+               //   Save pointer to the buffer in the `msgq.p_msg` task
+               //   field, so that the sender copies message right there, and
+               //   put current task to wait until new message comes.
+               _tn_curr_run_task->subsys_wait.msgq.p_msg = p_msg;
+               _tn_task_curr_to_wait_action(
+                     &(msgq->wait_receive_list),
+                     TN_WAIT_REASON_MSGQ_WRECEIVE,
+                     timeout
+                     );
+
+               waited = TN_TRUE;
+            }
+            break;
+      }
+
+#if TN_DEBUG
+      if (!_tn_need_context_switch() && waited){
+         _TN_FATAL_ERROR("");
+      }
+#endif
+
+      TN_INT_RESTORE();
+      _tn_context_switch_pend_if_needed();
+      if (waited){
+         //-- get wait result. If it is `TN_RC_OK`, the message is already
+         //   copied: either to the receiver's buffer or from the sender's
+         //   memory
+         rc = _tn_curr_run_task->task_wait_rc;
+      }
+
+   }
+   return rc;
+}
+
+/**
+ * The same as `_msgq_job_perform()` with zero timeout, but for using in the
+ * ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+static enum TN_RCode _msgq_job_iperform(
+      struct TN_MsgQ *msgq,
+      enum _JobType job_type,
+      void *p_msg
+      )
+{
+   enum TN_RCode rc = _check_param_job_perform(msgq, p_msg);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      //-- wrong context
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      //-- depending on the job type, call appropriate function
+      switch (job_type){
+
+         case _JOB_TYPE__SEND:
+            //-- Try to put new message to the queue. We don't handle returned
+            //   value here, since we can't wait in interrupt, so, just return
+            //   the value to the caller.
+            rc = _msgq_send(msgq, p_msg);
+            break;
+
+         case _JOB_TYPE__RECEIVE:
+            //-- try to get the message from the queue. We don't handle
+            //   returned value here, since we can't wait in interrupt, so,
+            //   just return the value to the caller.
+            rc = _msgq_receive(msgq, p_msg);
+            break;
+      }
+
+      TN_INT_IRESTORE();
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+   }
+
+   return rc;
+}
+
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_create(
+      struct TN_MsgQ   *msgq,
+      void             *buf,
+      unsigned int      item_size,
+      int               items_cnt
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   rc = _check_param_create(msgq, buf, item_size, items_cnt);
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else {
+      _tn_list_reset(&(msgq->wait_send_list));
+      _tn_list_reset(&(msgq->wait_receive_list));
+
+      msgq->buf               = (unsigned char *)buf;
+      msgq->item_size         = item_size;
+      msgq->items_cnt         = items_cnt;
+
+      _tn_eventgrp_link_reset(&msgq->eventgrp_link);
+
+      if (msgq->buf == TN_NULL){
+         msgq->items_cnt = 0;
+      }
+
+      msgq->filled_items_cnt  = 0;
+      msgq->tail_idx          = 0;
+      msgq->head_idx          = 0;
+
+      msgq->id_msgq = TN_ID_MSGQUEUE;
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_delete(struct TN_MsgQ *msgq)
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   rc = _check_param_generic(msgq);
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      //-- notify waiting tasks that the object is deleted
+      //   (TN_RC_DELETED is returned)
+      _tn_wait_queue_notify_deleted(&(msgq->wait_send_list));
+      _tn_wait_queue_notify_deleted(&(msgq->wait_receive_list));
+
+      msgq->id_msgq = TN_ID_NONE; //-- message queue does not exist now
+
+      TN_INT_RESTORE();
+
+      //-- we might need to switch context if _tn_wait_queue_notify_deleted()
+      //   has woken up some high-priority task
+      _tn_context_switch_pend_if_needed();
+
+   }
+
+   return rc;
+
+}
+
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_send(
+      struct TN_MsgQ   *msgq,
+      const void       *p_msg,
+      TN_TickCnt        timeout
+      )
+{
+   return _msgq_job_perform(
+         msgq, _JOB_TYPE__SEND, (void *)p_msg, timeout, TN_FALSE
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_send_polling(struct TN_MsgQ *msgq, const void *p_msg)
+{
+   return _msgq_job_perform(
+         msgq, _JOB_TYPE__SEND, (void *)p_msg, 0, TN_FALSE
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_isend_polling(struct TN_MsgQ *msgq, const void *p_msg)
+{
+   return _msgq_job_iperform(msgq, _JOB_TYPE__SEND, (void *)p_msg);
+}
+
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_receive(
+      struct TN_MsgQ   *msgq,
+      void             *p_msg,
+      TN_TickCnt        timeout
+      )
+{
+   return _msgq_job_perform(
+         msgq, _JOB_TYPE__RECEIVE, p_msg, timeout, TN_FALSE
+         );
+}
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_receive_until(
+      struct TN_MsgQ   *msgq,
+      void             *p_msg,
+      TN_TickCnt        deadline
+      )
+{
+   return _msgq_job_perform(
+         msgq, _JOB_TYPE__RECEIVE, p_msg, deadline, TN_TRUE
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_receive_polling(struct TN_MsgQ *msgq, void *p_msg)
+{
+   return _msgq_job_perform(
+         msgq, _JOB_TYPE__RECEIVE, p_msg, 0, TN_FALSE
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_ireceive_polling(struct TN_MsgQ *msgq, void *p_msg)
+{
+   return _msgq_job_iperform(msgq, _JOB_TYPE__RECEIVE, p_msg);
+}
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+int tn_msgq_free_items_cnt_get(
+      struct TN_MsgQ   *msgq
+      )
+{
+   int ret = -1;
+   enum TN_RCode rc = _check_param_generic(msgq);
+
+   if (rc == TN_RC_OK){
+      //-- It's not needed to disable interrupts here, since `filled_items_cnt`
+      //   is read by just one assembler instruction, and `items_cnt` never
+      //   changes.
+      ret = msgq->items_cnt - msgq->filled_items_cnt;
+   }
+
+   return ret;
+}
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+int tn_msgq_used_items_cnt_get(
+      struct TN_MsgQ   *msgq
+      )
+{
+   int ret = -1;
+   enum TN_RCode rc = _check_param_generic(msgq);
+
+   if (rc == TN_RC_OK){
+      //-- It's not needed to disable interrupts here, since `filled_items_cnt`
+      //   is read by just one assembler instruction.
+      ret = msgq->filled_items_cnt;
+   }
+
+   return ret;
+}
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_eventgrp_connect(
+      struct TN_MsgQ      *msgq,
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             pattern
+      )
+{
+   TN_INTSAVE_DATA;
+   enum TN_RCode rc = _check_param_generic(msgq);
+
+   if (rc == TN_RC_OK){
+      TN_INT_DIS_SAVE();
+      rc = _tn_eventgrp_link_set(&msgq->eventgrp_link, eventgrp, pattern);
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_msgq.h)
+ */
+enum TN_RCode tn_msgq_eventgrp_disconnect(
+      struct TN_MsgQ      *msgq
+      )
+{
+   TN_INTSAVE_DATA;
+   enum TN_RCode rc = _check_param_generic(msgq);
+
+   if (rc == TN_RC_OK){
+      TN_INT_DIS_SAVE();
+      rc = _tn_eventgrp_link_reset(&msgq->eventgrp_link);
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
+
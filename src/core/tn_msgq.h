@@ -0,0 +1,482 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/**
+ * \file
+ *
+ * A message queue is a FIFO of fixed-size messages which are copied by value.
+ * Unlike \ref tn_dqueue.h "data queue", which passes just pointers (so that
+ * real messages usually live in the \ref tn_fmem.h "fixed memory pool", and
+ * each message costs additional `tn_fmem_get()` / `tn_fmem_release()`
+ * calls), message queue stores messages right in its own buffer, provided
+ * by the application.
+ *
+ * A task that sends a message gives a pointer to it, and the message is
+ * copied: either to the buffer of the task which is waiting for a message
+ * (if any), or to the FIFO. If there is no space left in the FIFO, the task
+ * is switched to the waiting state until space appears, and the message is
+ * copied from the task's memory to the FIFO as soon as it does.
+ *
+ * A task that receives a message gives a pointer to its buffer, and the
+ * message is copied there from the FIFO; if the FIFO is empty, the task is
+ * switched to the waiting state, and the next message sent is copied right
+ * into its buffer, bypassing the FIFO. So, each message is copied at most
+ * twice, and it takes one kernel call to send it and one call to receive it.
+ *
+ * Messages are copied with interrupts disabled, so message queue is intended
+ * for relatively small messages (a few words, say, samples from a sensor).
+ * For large messages, use data queue and fixed memory pool instead.
+ *
+ * To use a message queue just for the synchronous message passing, set
+ * capacity of the FIFO to 0: then, message is copied from the sender's memory
+ * to the receiver's buffer directly.
+ *
+ * Just like data queue, message queue can be connected to the event group,
+ * refer to the section \ref eventgrp_connect for details. Related services:
+ *
+ * - `tn_msgq_eventgrp_connect()`
+ * - `tn_msgq_eventgrp_disconnect()`
+ *
+ */
+
+#ifndef _TN_MSGQ_H
+#define _TN_MSGQ_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_list.h"
+#include "tn_common.h"
+#include "tn_eventgrp.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {  /*}*/
+#endif
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Structure representing message queue object
+ */
+struct TN_MsgQ {
+   ///
+   /// id for object validity verification.
+   /// This field is in the beginning of the structure to make it easier
+   /// to detect memory corruption.
+   enum TN_ObjId id_msgq;
+   ///
+   /// list of tasks waiting to send message
+   struct TN_ListItem  wait_send_list;
+   ///
+   /// list of tasks waiting to receive message
+   struct TN_ListItem  wait_receive_list;
+
+   ///
+   /// buffer to store messages: `items_cnt` messages of `item_size` bytes
+   /// each. Can be `TN_NULL`.
+   unsigned char *buf;
+   ///
+   /// size of each message, in bytes
+   unsigned int   item_size;
+   ///
+   /// capacity (total messages count). Can be 0.
+   int            items_cnt;
+   ///
+   /// count of messages in `buf`
+   int            filled_items_cnt;
+   ///
+   /// index of the message which will be written next time
+   int            head_idx;
+   ///
+   /// index of the message which will be read next time
+   int            tail_idx;
+   ///
+   /// connected event group
+   struct TN_EGrpLink eventgrp_link;
+};
+
+/**
+ * MsgQ-specific fields related to waiting task,
+ * to be included in struct TN_Task.
+ */
+struct TN_MsgQTaskWait {
+   /// if task tries to send the message to the message queue, and there's no
+   /// space in the queue, pointer to the message to send is stored in this
+   /// field; if task tries to receive the message, and the queue is empty,
+   /// pointer to the buffer for the message is stored here.
+   void *p_msg;
+};
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Construct message queue. `id_msgq` member should not contain
+ * `#TN_ID_MSGQUEUE`, otherwise, `#TN_RC_WPARAM` is returned.
+ *
+ * Typical definition looks as follows:
+ *
+ * \code{.c}
+ *     //-- message type
+ *     struct MySample {
+ *        int   channel;
+ *        int   value;
+ *     };
+ *
+ *     //-- number of messages in the queue
+ *     #define MY_MSGQ_ITEMS_CNT     8
+ *
+ *     //-- define buffer for messages
+ *     struct MySample my_msgq_buf[ MY_MSGQ_ITEMS_CNT ];
+ *
+ *     //-- define message queue structure
+ *     struct TN_MsgQ my_msgq;
+ * \endcode
+ *
+ * And then, construct your `my_msgq` as follows:
+ *
+ * \code{.c}
+ *     enum TN_RCode rc;
+ *     rc = tn_msgq_create(
+ *           &my_msgq, my_msgq_buf, sizeof(struct MySample), MY_MSGQ_ITEMS_CNT
+ *           );
+ *     if (rc != TN_RC_OK){
+ *        //-- handle error
+ *     }
+ * \endcode
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param msgq       pointer to already allocated `struct #TN_MsgQ`.
+ * @param buf        pointer to already allocated buffer for `items_cnt`
+ *                   messages of `item_size` bytes each. There are no
+ *                   alignment requirements, since messages are copied
+ *                   byte-by-byte. Can be `#TN_NULL`.
+ * @param item_size  size of each message, in bytes. Should be more than 0.
+ * @param items_cnt  capacity of queue (count of messages in the `buf`).
+ *                   Can be 0.
+ *
+ * @return
+ *    * `#TN_RC_OK` if queue was successfully created;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
+ *      is available: `#TN_RC_WPARAM`.
+ */
+enum TN_RCode tn_msgq_create(
+      struct TN_MsgQ   *msgq,
+      void             *buf,
+      unsigned int      item_size,
+      int               items_cnt
+      );
+
+
+/**
+ * Destruct message queue.
+ *
+ * All tasks that wait for writing to or reading from the queue become
+ * runnable with `#TN_RC_DELETED` code returned.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param msgq       pointer to message queue to be deleted
+ *
+ * @return
+ *    * `#TN_RC_OK` if queue was successfully deleted;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_msgq_delete(struct TN_MsgQ *msgq);
+
+
+/**
+ * Send the message pointed to by `p_msg` to the message queue specified by
+ * the `msgq`: `item_size` bytes are copied from `p_msg`.
+ *
+ * If there are tasks in the queue's `wait_receive` list already, the
+ * function releases the task from the head of the `wait_receive` list, copies
+ * the message right to the buffer given by that task to `tn_msgq_receive()`,
+ * and makes the task runnable.
+ *
+ * If there are no tasks in the queue's `wait_receive` list, the message is
+ * copied to the tail of the FIFO. If the FIFO is full, behavior depends on
+ * the `timeout` value: refer to `#TN_TickCnt`. While the task waits, the
+ * message is not copied yet, so the memory pointed to by `p_msg` must not be
+ * changed by anyone.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param msgq       pointer to message queue to send message to
+ * @param p_msg      pointer to the message to send
+ * @param timeout    refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK`   if message was successfully sent;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_msgq_send(
+      struct TN_MsgQ   *msgq,
+      const void       *p_msg,
+      TN_TickCnt        timeout
+      );
+
+/**
+ * The same as `tn_msgq_send()` with zero timeout
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_msgq_send_polling(
+      struct TN_MsgQ   *msgq,
+      const void       *p_msg
+      );
+
+/**
+ * The same as `tn_msgq_send()` with zero timeout, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_msgq_isend_polling(
+      struct TN_MsgQ   *msgq,
+      const void       *p_msg
+      );
+
+/**
+ * Receive the message from the message queue specified by the `msgq`:
+ * `item_size` bytes are copied to the buffer pointed to by `p_msg`. If the
+ * FIFO already has messages, the oldest one is copied and removed from the
+ * FIFO.
+ *
+ * If there are task(s) in the queue's `wait_send` list, first one gets
+ * removed from the head of `wait_send` list, becomes runnable and its
+ * message is copied to the tail of the FIFO. If there are no messages in the
+ * FIFO and there are no tasks in the `wait_send` list, behavior depends on
+ * the `timeout` value: refer to `#TN_TickCnt`. While the task waits, the
+ * next message sent is copied right to `p_msg`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param msgq       pointer to message queue to receive message from
+ * @param p_msg      pointer to the buffer of `item_size` bytes to store
+ *                   the message
+ * @param timeout    refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK`   if message was successfully received;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_msgq_receive(
+      struct TN_MsgQ   *msgq,
+      void             *p_msg,
+      TN_TickCnt        timeout
+      );
+
+/**
+ * The same as `tn_msgq_receive()`, but instead of relative timeout, the
+ * absolute `deadline` (in terms of `tn_sys_time_get()`) is given. It is
+ * converted to timeout (as `tn_sys_timeout_until()` does) with interrupts
+ * disabled, right before the task is put to wait, so the task never wakes up
+ * later than the deadline. If the `deadline` is already reached, it behaves
+ * like `tn_msgq_receive_polling()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_msgq_receive_until(
+      struct TN_MsgQ   *msgq,
+      void             *p_msg,
+      TN_TickCnt        deadline
+      );
+
+/**
+ * The same as `tn_msgq_receive()` with zero timeout
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_msgq_receive_polling(
+      struct TN_MsgQ   *msgq,
+      void             *p_msg
+      );
+
+/**
+ * The same as `tn_msgq_receive()` with zero timeout, but for using in the
+ * ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_msgq_ireceive_polling(
+      struct TN_MsgQ   *msgq,
+      void             *p_msg
+      );
+
+
+/**
+ * Returns number of free items in the queue
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param msgq
+ *    Pointer to queue.
+ *
+ * @return
+ *    Number of free items in the queue, or -1 if wrong params were given (the
+ *    check is performed if only `#TN_CHECK_PARAM` is non-zero)
+ */
+int tn_msgq_free_items_cnt_get(
+      struct TN_MsgQ   *msgq
+      );
+
+
+/**
+ * Returns number of used (non-free) items in the queue
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param msgq
+ *    Pointer to queue.
+ *
+ * @return
+ *    Number of used (non-free) items in the queue, or -1 if wrong params were
+ *    given (the check is performed if only `#TN_CHECK_PARAM` is non-zero)
+ */
+int tn_msgq_used_items_cnt_get(
+      struct TN_MsgQ   *msgq
+      );
+
+
+/**
+ * Connect an event group to the queue.
+ * Refer to the section \ref eventgrp_connect for details.
+ *
+ * Only one event group can be connected to the queue at a time. If you
+ * connect event group while another event group is already connected,
+ * the old link is discarded.
+ *
+ * @param msgq
+ *    queue to which event group should be connected
+ * @param eventgrp
+ *    event groupt to connect
+ * @param pattern
+ *    flags pattern that should be managed by the queue automatically
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_msgq_eventgrp_connect(
+      struct TN_MsgQ      *msgq,
+      struct TN_EventGrp  *eventgrp,
+      TN_UWord             pattern
+      );
+
+
+/**
+ * Disconnect a connected event group from the queue.
+ * Refer to the section \ref eventgrp_connect for details.
+ *
+ * If there is no event group connected, nothing is changed.
+ *
+ * @param msgq    queue from which event group should be disconnected
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_msgq_eventgrp_disconnect(
+      struct TN_MsgQ      *msgq
+      );
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_MSGQ_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
+
+
@@ -46,6 +46,7 @@
 #include "_tn_mutex.h"
 #include "_tn_tasks.h"
 #include "_tn_list.h"
+#include "_tn_trace.h"
 
 //-- header of current module
 #include "tn_mutex.h"
@@ -84,6 +85,35 @@
 #  define __MUTEX_REC_LOCK_RETVAL   TN_RC_ILLEGAL_USE
 #endif
 
+#if TN_MUTEX_FAST_LOCK
+#  if !defined(_TN_CAS)
+/**
+ * Generic compare-and-swap for the architectures which don't provide
+ * anything better: just disable interrupts for a few instructions.
+ */
+_TN_STATIC_INLINE TN_BOOL _tn_cas_generic(
+      volatile TN_UWord *p, TN_UWord old_val, TN_UWord new_val
+      )
+{
+   TN_BOOL ret = TN_FALSE;
+   TN_INTSAVE_DATA;
+
+   TN_INT_DIS_SAVE();
+
+   if (*p == old_val){
+      *p = new_val;
+      ret = TN_TRUE;
+   }
+
+   TN_INT_RESTORE();
+
+   return ret;
+}
+#     define _TN_CAS(p, old_val, new_val)                               \
+         _tn_cas_generic((p), (old_val), (new_val))
+#  endif
+#endif
+
 // L. Sha, R. Rajkumar, J. Lehoczky, Priority Inheritance Protocols: An Approach
 // to Real-Time Synchronization, IEEE Transactions on Computers, Vol.39, No.9, 1990
 
@@ -114,7 +144,8 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_generic(
 _TN_STATIC_INLINE enum TN_RCode _check_param_create(
       const struct TN_Mutex        *mutex,
       enum TN_MutexProtocol   protocol,
-      int                     ceil_priority
+      int                     ceil_priority,
+      enum TN_WaitOrder       wait_order
       )
 {
    enum TN_RCode rc = TN_RC_OK;
@@ -123,6 +154,8 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_create(
       rc = TN_RC_WPARAM;
    } else if (_tn_mutex_is_valid(mutex)){
       rc = TN_RC_WPARAM;
+   } else if (!_tn_wait_order_is_valid(wait_order)){
+      rc = TN_RC_WPARAM;
    } else if (    protocol != TN_MUTEX_PROT_CEILING 
                && protocol != TN_MUTEX_PROT_INHERIT)
    {
@@ -143,30 +176,52 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_create(
 
 #else
 #  define _check_param_generic(mutex)                             (TN_RC_OK)
-#  define _check_param_create(mutex, protocol, ceil_priority)     (TN_RC_OK)
+#  define _check_param_create(mutex, protocol, ceil_priority, wait_order) \
+                                                                  (TN_RC_OK)
 #endif
 // }}}
 
 
 /**
- * Iterate through all the tasks that wait for locked mutex,
- * checking if task's priority is higher than ref_priority.
+ * Add task to the mutex's `prio_wait_queue`: before the first task with lower
+ * priority, or to the tail if there is no such task. So, the first task in
+ * this queue always has the highest priority among the tasks that wait for
+ * the mutex.
+ */
+static void _prio_wait_queue_add(struct TN_Mutex *mutex, struct TN_Task *task)
+{
+   struct TN_ListItem *item;
+
+   _tn_list_for_each(item, &(mutex->prio_wait_queue)){
+      if (_tn_list_entry(item, struct TN_Task, mutex_prio_queue)->priority
+            > task->priority)
+      {
+         break;
+      }
+   }
+
+   //-- adding to the tail of the list `item` means inserting just before
+   //   `item` (or to the tail of the queue, if `item` is the queue itself)
+   _tn_list_add_tail(item, &(task->mutex_prio_queue));
+}
+
+/**
+ * Check if the task which waits for locked mutex with highest priority
+ * has priority higher than ref_priority.
  *
  * Max priority (i.e. lowest value) is returned.
  */
 _TN_STATIC_INLINE int _find_max_blocked_priority(struct TN_Mutex *mutex, int ref_priority)
 {
-   int               priority;
-   struct TN_Task   *task;
+   int priority = ref_priority;
 
-   priority = ref_priority;
+   //-- Waiters are ordered by priority, so we don't need to iterate through
+   //   all of them: the first one has the highest priority.
+   if (!_tn_list_is_empty(&(mutex->prio_wait_queue))){
+      struct TN_Task *task = _tn_list_first_entry(
+            &(mutex->prio_wait_queue), struct TN_Task, mutex_prio_queue
+            );
 
-   //-- Iterate through all the tasks that wait for lock mutex.
-   //   Highest priority (i.e. lowest number) will be returned eventually.
-   _tn_list_for_each_entry(
-         task, struct TN_Task, &(mutex->wait_queue), task_queue
-         )
-   {
       if (task->priority < priority){
          //--  task priority is higher, remember it
          priority = task->priority;
@@ -197,8 +252,8 @@ _TN_STATIC_INLINE int _find_max_priority_by_mutex(
 
       case TN_MUTEX_PROT_INHERIT:
          //-- Mutex protocol is 'priority inheritance':
-         //   we need to iterate through all the tasks that wait for 
-         //   the mutex, checking if task's priority is higher than
+         //   we need to check the highest-priority task that waits for
+         //   the mutex, checking if its priority is higher than
          //   `ref_priority`.
          priority = _find_max_blocked_priority(mutex, priority);
          break;
@@ -213,21 +268,61 @@ _TN_STATIC_INLINE int _find_max_priority_by_mutex(
 }
 
 /**
- * Iterate through all the mutexes that are held by task,
- * for each mutex:
+ * Add mutex to the list of mutexes held by task: before the first mutex
+ * which imposes lower priority on the task (see
+ * `_find_max_priority_by_mutex()`), or to the tail if there is no such mutex.
+ * So, the first mutex in this list always imposes the highest priority.
+ */
+static void _mutex_queue_add(struct TN_Task *task, struct TN_Mutex *mutex)
+{
+   struct TN_ListItem *item;
+   int priority = _find_max_priority_by_mutex(mutex, TN_PRIORITIES_CNT - 1);
+
+   _tn_list_for_each(item, &(task->mutex_queue)){
+      if (_find_max_priority_by_mutex(
+               _tn_list_entry(item, struct TN_Mutex, mutex_queue),
+               TN_PRIORITIES_CNT - 1
+               ) > priority)
+      {
+         break;
+      }
+   }
+
+   _tn_list_add_tail(item, &(mutex->mutex_queue));
+}
+
+/**
+ * Should be called when the highest-priority task that waits for the locked
+ * mutex might have changed: moves the mutex to the appropriate place in its
+ * holder's list of locked mutexes.
+ */
+static void _mutex_queue_update(struct TN_Mutex *mutex)
+{
+   _tn_list_remove_entry(&(mutex->mutex_queue));
+   _mutex_queue_add(mutex->holder, mutex);
+}
+
+/**
+ * Determine new priority of the task: take its base priority, and check the
+ * first mutex held by the task (if any):
  *
  *    - if protocol is TN_MUTEX_PROT_CEILING:
  *      check if ceil priority higher than task's base priority
  *    - if protocol is TN_MUTEX_PROT_INHERIT:
- *      iterate through all the tasks that wait for this mutex,
- *      and check if priority of each task is higher than
- *      our task's base priority
+ *      check if priority of the highest-priority task that waits for
+ *      this mutex is higher than our task's base priority
+ *
+ * Mutexes held by the task are ordered by the priority they impose
+ * (see `_mutex_queue_add()`), so we don't need to check other ones.
+ *
+ * Eventually, set the priority found.
  *
- * Eventually, find out highest priority and set it.
+ * @returns TN_TRUE if task's priority has changed, TN_FALSE otherwise.
  */
-static void _update_task_priority(struct TN_Task *task)
+static TN_BOOL _update_task_priority(struct TN_Task *task)
 {
    int priority;
+   TN_BOOL changed = TN_FALSE;
 
    //-- Now, we need to determine new priority of current task.
    //   We start from its base priority, but if there are other
@@ -235,22 +330,22 @@ static void _update_task_priority(struct TN_Task *task)
    //   what priority we should set.
    priority = task->base_priority;
 
-   {
-      struct TN_Mutex *mutex;
-
-      //-- Iterate through all the mutexes locked by given task
-      _tn_list_for_each_entry(
-            mutex, struct TN_Mutex, &(task->mutex_queue), mutex_queue
-            )
-      {
-         priority = _find_max_priority_by_mutex(mutex, priority);
-      }
+   if (!_tn_list_is_empty(&(task->mutex_queue))){
+      priority = _find_max_priority_by_mutex(
+            _tn_list_first_entry(
+               &(task->mutex_queue), struct TN_Mutex, mutex_queue
+               ),
+            priority
+            );
    }
 
    //-- New priority determined, set it
    if (priority != task->priority){
       _tn_change_task_priority(task, priority);
+      changed = TN_TRUE;
    }
+
+   return changed;
 }
 
 
@@ -282,7 +377,9 @@ in:
       _tn_change_running_task_priority(task, priority);
    } else {
       //-- Task is not runnable, so, just set new priority to it
-      task->priority = priority;
+      //   (if the task waits in the queue ordered by priority, it is
+      //   moved in that queue as well)
+      _tn_change_task_priority(task, priority);
 
       //-- and check if the task is waiting for mutex
       if (     (_tn_task_is_waiting(task))
@@ -312,10 +409,15 @@ in:
 _TN_STATIC_INLINE void _mutex_do_lock(struct TN_Mutex *mutex, struct TN_Task *task)
 {
    mutex->holder = task;
+#if TN_MUTEX_FAST_LOCK
+   mutex->owner  = (TN_UWord)task | _TN_MUTEX_OWNER_KERNEL;
+#endif
    __mutex_lock_cnt_change(mutex, 1);
 
+   _tn_trace(TN_TRACE_EV_MUTEX_LOCK, mutex, (TN_UWord)task);
+
    //-- Add mutex to task's locked mutexes queue
-   _tn_list_add_tail(&(task->mutex_queue), &(mutex->mutex_queue));
+   _mutex_queue_add(task, mutex);
 
    //-- Determine new priority for the task
    {
@@ -481,9 +583,15 @@ static void _cry_deadlock_inactive(struct TN_Mutex *mutex, struct TN_Task *task)
 }
 #else
 static void _check_deadlock_active(struct TN_Mutex *mutex, struct TN_Task *task)
-{}
+{
+   _TN_UNUSED(mutex);
+   _TN_UNUSED(task);
+}
 static void _cry_deadlock_inactive(struct TN_Mutex *mutex, struct TN_Task *task)
-{}
+{
+   _TN_UNUSED(mutex);
+   _TN_UNUSED(task);
+}
 #endif
 
 _TN_STATIC_INLINE void _add_curr_task_to_mutex_wait_queue(
@@ -496,6 +604,22 @@ _TN_STATIC_INLINE void _add_curr_task_to_mutex_wait_queue(
    if (mutex->protocol == TN_MUTEX_PROT_INHERIT){
       //-- Priority inheritance protocol
 
+      //-- add current task to the mutex's waiters ordered by priority;
+      //   if it has become the first one there, the mutex might impose
+      //   higher priority on its holder now, so, move the mutex in the
+      //   holder's locked mutexes queue.
+      //
+      //   NOTE: it should be done before elevating holder's priority,
+      //   so that the holder's locked mutexes queue is consistent
+      //   if the holder waits for some other mutex.
+      _prio_wait_queue_add(mutex, _tn_curr_run_task);
+      if (     mutex->prio_wait_queue.next
+            == &(_tn_curr_run_task->mutex_prio_queue)
+         )
+      {
+         _mutex_queue_update(mutex);
+      }
+
       //-- if run_task curr priority higher holder's curr priority
       if (_tn_curr_run_task->priority < mutex->holder->priority){
          _task_priority_elevate(mutex->holder, _tn_curr_run_task->priority);
@@ -507,7 +631,9 @@ _TN_STATIC_INLINE void _add_curr_task_to_mutex_wait_queue(
       wait_reason = TN_WAIT_REASON_MUTEX_C;
    }
 
-   _tn_task_curr_to_wait_action(&(mutex->wait_queue), wait_reason, timeout);
+   _tn_task_curr_to_wait_action_ordered(
+         &(mutex->wait_queue), mutex->wait_order, wait_reason, timeout
+         );
 
    //-- check if there is deadlock
    _check_deadlock_active(mutex, _tn_curr_run_task);
@@ -529,6 +655,11 @@ _TN_STATIC_INLINE void _add_curr_task_to_mutex_wait_queue(
  */
 static void _mutex_do_unlock(struct TN_Mutex * mutex)
 {
+   //-- NOTE: if the mutex is locked through the fast path, it should be
+   //   taken over by the kernel first, see `_mutex_fast_to_kernel()`.
+
+   _tn_trace(TN_TRACE_EV_MUTEX_UNLOCK, mutex, (TN_UWord)mutex->holder);
+
    //-- explicitly reset lock count to 0, because it might be not zero
    //   if mutex is unlocked because task is being deleted.
    mutex->cnt = 0;
@@ -537,13 +668,16 @@ static void _mutex_do_unlock(struct TN_Mutex * mutex)
    _tn_list_remove_entry(&(mutex->mutex_queue));
 
    //-- update priority for current holder
-   _update_task_priority(mutex->holder);
+   (void)_update_task_priority(mutex->holder);
 
    //-- Check for the task(s) that want to lock the mutex
    if (_tn_list_is_empty(&(mutex->wait_queue))){
       //-- no more tasks want to lock the mutex,
       //   so, set holder to TN_NULL and return.
       mutex->holder = TN_NULL;
+#if TN_MUTEX_FAST_LOCK
+      mutex->owner  = 0;
+#endif
    } else {
       //-- there are tasks that want to lock the mutex,
       //   so, lock it by the first task in the queue
@@ -557,7 +691,7 @@ static void _mutex_do_unlock(struct TN_Mutex * mutex)
 
       //-- wake it up.
       //   Note: _update_task_priority() for current holder
-      //   of mutex will be eventually called from:
+      //   of mutex would be eventually called from:
       //    _tn_task_wait_complete ->
       //       _tn_task_clear_waiting ->
       //          _on_task_wait_complete ->
@@ -622,13 +756,20 @@ in:
    holder = _get_mutex_by_wait_queque(task->pwait_queue)->holder;
 
    //-- now, `holder` points to the (ex-)holder, i.e. to the task which is/was
-   //   holding the mutex. Now, we iterate through all the mutexes that are
-   //   still held by (ex-)holder, determining new priority for (ex-)holder.
-   _update_task_priority(holder);
-
-   //-- and check if the (ex-)holder is also waiting for some other mutex
-   if (     (_tn_task_is_waiting(holder))
+   //   holding the mutex. Now, we check the mutexes that are still held by
+   //   (ex-)holder, determining new priority for (ex-)holder.
+   //
+   //   If the priority hasn't changed, the holders further in the chain
+   //   aren't affected, so we're done.
+   //
+   //   NOTE: if mutexes are locked in a cycle (i.e. there is a deadlock),
+   //   the chain leads back to the task which is finishing waiting now:
+   //   it is still in the WAIT state, but it is already removed from the
+   //   wait queue, so, we should stop there as well.
+   if (     _update_task_priority(holder)
+         && (_tn_task_is_waiting(holder))
          && (holder->task_wait_reason == TN_WAIT_REASON_MUTEX_I)
+         && !_tn_list_is_empty(&(holder->task_queue))
       )
    {
       //-- holder is waiting for another mutex. In this case, call this
@@ -647,6 +788,239 @@ in:
 
 
 
+#if TN_MUTEX_FAST_LOCK
+
+/**
+ * If the mutex is locked through the fast path, make the kernel aware of
+ * that: set `holder`, add the mutex to the holder's locked mutexes queue,
+ * and set `#_TN_MUTEX_OWNER_KERNEL` bit, so that the holder will unlock it
+ * through the kernel.
+ *
+ * Should be called with interrupts disabled, before any kernel code which
+ * deals with `holder`.
+ *
+ * NOTE: lock count isn't touched here: it is modified by the holder only
+ * (and the holder can't run while we're here).
+ */
+static void _mutex_fast_to_kernel(struct TN_Mutex *mutex)
+{
+   TN_UWord owner = mutex->owner;
+
+   if (owner != 0 && !(owner & _TN_MUTEX_OWNER_KERNEL)){
+      struct TN_Task *task = (struct TN_Task *)owner;
+
+      mutex->holder = task;
+      mutex->owner  = owner | _TN_MUTEX_OWNER_KERNEL;
+
+      //-- Mutex can't impose any priority on the task yet: if the protocol
+      //   is TN_MUTEX_PROT_CEILING, base priority of the task is equal to
+      //   the ceiling (see `_mutex_fast_lock()`), and if it is
+      //   TN_MUTEX_PROT_INHERIT, there are no waiters.
+      //   So, we just add the mutex to the task's locked mutexes queue.
+      _mutex_queue_add(task, mutex);
+   }
+}
+
+/**
+ * Remove the mutex from the list of mutexes locked by the task through the
+ * fast path (if it's there). The list is modified by a single store, so that
+ * it's always consistent, even if the task is terminated in the middle.
+ *
+ * Should be called by the task itself (or with interrupts disabled).
+ */
+static void _mutex_fast_list_remove(
+      struct TN_Task *task,
+      struct TN_Mutex *mutex
+      )
+{
+   struct TN_Mutex *volatile *pp = &(task->mutex_fast_list);
+
+   while (*pp != TN_NULL){
+      if (*pp == mutex){
+         *pp = mutex->fast_next;
+         break;
+      }
+      pp = &((*pp)->fast_next);
+   }
+}
+
+/**
+ * Try to lock the mutex without entering the kernel.
+ *
+ * @returns TN_TRUE if the mutex is locked (or recursive lock was attempted),
+ *    `*p_rc` contains the result then; TN_FALSE if the kernel should
+ *    handle the mutex.
+ */
+static TN_BOOL _mutex_fast_lock(struct TN_Mutex *mutex, enum TN_RCode *p_rc)
+{
+   TN_BOOL ret = TN_FALSE;
+   struct TN_Task *task = _tn_curr_run_task;
+   TN_UWord owner = mutex->owner;
+
+   if ((owner & ~_TN_MUTEX_OWNER_KERNEL) == (TN_UWord)task){
+      //-- mutex is already locked by current task: only current task
+      //   touches lock count, so we don't need the kernel here.
+      __mutex_lock_cnt_change(mutex, 1);
+      *p_rc = __MUTEX_REC_LOCK_RETVAL;
+      ret = TN_TRUE;
+
+   } else if (owner == 0
+         && (0
+            || mutex->protocol == TN_MUTEX_PROT_INHERIT
+            || task->base_priority == mutex->ceil_priority
+            )
+         )
+   {
+      //-- if the task gets terminated somewhere below, the kernel should
+      //   know which mutex might be locked, but not yet in the list
+      task->mutex_fast_pending = mutex;
+
+      if (_TN_CAS(&(mutex->owner), 0, (TN_UWord)task)){
+         //-- Locked. Now, the kernel might take the mutex over at any
+         //   moment (if some other task tries to lock it), but the lock
+         //   count and the fast list are still ours.
+         mutex->fast_next = task->mutex_fast_list;
+         task->mutex_fast_list = mutex;
+         __mutex_lock_cnt_change(mutex, 1);
+
+#if TN_TRACE
+         {
+            TN_INTSAVE_DATA;
+            TN_INT_DIS_SAVE();
+            _tn_trace(TN_TRACE_EV_MUTEX_LOCK, mutex, (TN_UWord)task);
+            TN_INT_RESTORE();
+         }
+#endif
+
+         *p_rc = TN_RC_OK;
+         ret = TN_TRUE;
+      }
+
+      task->mutex_fast_pending = TN_NULL;
+   }
+
+   return ret;
+}
+
+/**
+ * Try to unlock the mutex without entering the kernel.
+ *
+ * @returns TN_TRUE if the mutex is unlocked (or lock count is just
+ *    decremented, or the task isn't an owner), `*p_rc` contains the result
+ *    then; TN_FALSE if the kernel should unlock the mutex.
+ */
+static TN_BOOL _mutex_fast_unlock(struct TN_Mutex *mutex, enum TN_RCode *p_rc)
+{
+   TN_BOOL ret = TN_TRUE;
+   struct TN_Task *task = _tn_curr_run_task;
+   TN_UWord owner = mutex->owner;
+
+   *p_rc = TN_RC_OK;
+
+   if ((owner & ~_TN_MUTEX_OWNER_KERNEL) != (TN_UWord)task){
+      //-- unlocking is enabled only for the owner and already locked mutex
+      *p_rc = TN_RC_ILLEGAL_USE;
+
+   } else if (mutex->cnt > 1){
+      //-- there was recursive lock, so here we just decrement counter,
+      //   but don't unlock the mutex.
+      __mutex_lock_cnt_change(mutex, -1);
+
+   } else {
+      //-- mutex should be unlocked now: remove it from the fast list
+      //   first (we'll need to do that anyway, no matter whether the mutex
+      //   is managed by the kernel or not)
+      task->mutex_fast_pending = mutex;
+      _mutex_fast_list_remove(task, mutex);
+
+      //-- lock count should be modified before the mutex is free, since
+      //   then, it belongs to the next owner.
+      __mutex_lock_cnt_change(mutex, -1);
+
+      if (     !(owner & _TN_MUTEX_OWNER_KERNEL)
+            && _TN_CAS(&(mutex->owner), (TN_UWord)task, 0)
+         )
+      {
+         //-- Unlocked.
+#if TN_TRACE
+         {
+            TN_INTSAVE_DATA;
+            TN_INT_DIS_SAVE();
+            _tn_trace(TN_TRACE_EV_MUTEX_UNLOCK, mutex, (TN_UWord)task);
+            TN_INT_RESTORE();
+         }
+#endif
+      } else {
+         //-- the mutex is managed by the kernel (probably it has been
+         //   taken over just now), so, the kernel should unlock it.
+         //   Restore lock count, it will be decremented by the kernel.
+         __mutex_lock_cnt_change(mutex, 1);
+         ret = TN_FALSE;
+      }
+
+      //-- NOTE: if the task is terminated after that, the mutex is either
+      //   free or managed by the kernel, so we don't need `pending` anymore.
+      task->mutex_fast_pending = TN_NULL;
+   }
+
+   return ret;
+}
+
+/**
+ * If the mutex is locked by the task through the fast path (and isn't taken
+ * over by the kernel), just mark it as free.
+ */
+_TN_STATIC_INLINE void _mutex_fast_release(
+      struct TN_Mutex *mutex,
+      struct TN_Task *task
+      )
+{
+   if (mutex->owner == (TN_UWord)task){
+      _tn_trace(TN_TRACE_EV_MUTEX_UNLOCK, mutex, (TN_UWord)task);
+
+      mutex->cnt   = 0;
+      mutex->owner = 0;
+   }
+}
+
+/**
+ * Unlock mutexes which are locked by the task through the fast path and not
+ * taken over by the kernel. Called with interrupts disabled when the task is
+ * terminated. Mutexes which are managed by the kernel are left intact.
+ */
+static void _mutex_fast_unlock_all_by_task(struct TN_Task *task)
+{
+   struct TN_Mutex *mutex;
+
+   //-- the mutex which is being locked or unlocked right now (if any):
+   //   it might be not in the list
+   if (task->mutex_fast_pending != TN_NULL){
+      _mutex_fast_release(task->mutex_fast_pending, task);
+      task->mutex_fast_pending = TN_NULL;
+   }
+
+   for (
+         mutex = task->mutex_fast_list;
+         mutex != TN_NULL;
+         mutex = mutex->fast_next
+       )
+   {
+      _mutex_fast_release(mutex, task);
+   }
+
+   task->mutex_fast_list = TN_NULL;
+}
+
+#else
+#  define _mutex_fast_to_kernel(mutex)
+#  define _mutex_fast_list_remove(task, mutex)
+#  define _mutex_fast_lock(mutex, p_rc)            (TN_FALSE)
+#  define _mutex_fast_unlock(mutex, p_rc)          (TN_FALSE)
+#  define _mutex_fast_unlock_all_by_task(task)
+#endif
+
+
+
 /*******************************************************************************
  *    PUBLIC FUNCTIONS
  ******************************************************************************/
@@ -654,19 +1028,23 @@ in:
 /*
  * See comments in the header file (tn_mutex.h)
  */
-enum TN_RCode tn_mutex_create(
+enum TN_RCode tn_mutex_create_worder(
       struct TN_Mutex        *mutex,
       enum TN_MutexProtocol   protocol,
-      int                     ceil_priority
+      int                     ceil_priority,
+      enum TN_WaitOrder       wait_order
       )
 {
-   enum TN_RCode rc = _check_param_create(mutex, protocol, ceil_priority);
+   enum TN_RCode rc = _check_param_create(
+         mutex, protocol, ceil_priority, wait_order
+         );
 
    if (rc != TN_RC_OK){
       //-- just return rc as it is
    } else {
 
       _tn_list_reset(&(mutex->wait_queue));
+      _tn_list_reset(&(mutex->prio_wait_queue));
       _tn_list_reset(&(mutex->mutex_queue));
 #if TN_MUTEX_DEADLOCK_DETECT
       _tn_list_reset(&(mutex->deadlock_list));
@@ -676,6 +1054,11 @@ enum TN_RCode tn_mutex_create(
       mutex->holder        = TN_NULL;
       mutex->ceil_priority = ceil_priority;
       mutex->cnt           = 0;
+      mutex->wait_order    = wait_order;
+#if TN_MUTEX_FAST_LOCK
+      mutex->owner         = 0;
+      mutex->fast_next     = TN_NULL;
+#endif
       mutex->id_mutex      = TN_ID_MUTEX;
    }
 
@@ -698,6 +1081,10 @@ enum TN_RCode tn_mutex_delete(struct TN_Mutex *mutex)
 
       TN_INT_DIS_SAVE();
 
+      //-- if the mutex is locked through the fast path, let the kernel
+      //   know about that
+      _mutex_fast_to_kernel(mutex);
+
       //-- mutex can be deleted if only it isn't held 
       if (mutex->holder != TN_NULL && mutex->holder != _tn_curr_run_task){
          rc = TN_RC_ILLEGAL_USE;
@@ -708,6 +1095,7 @@ enum TN_RCode tn_mutex_delete(struct TN_Mutex *mutex)
 
          if (mutex->holder != TN_NULL){
             //-- If the mutex is locked
+            _mutex_fast_list_remove(mutex->holder, mutex);
             _mutex_do_unlock(mutex);
 
             //-- NOTE: redundant reset, because it will anyway
@@ -743,11 +1131,17 @@ enum TN_RCode tn_mutex_lock(struct TN_Mutex *mutex, TN_TickCnt timeout)
       //-- just return rc as it is
    } else if (!tn_is_task_context()){
       rc = TN_RC_WCONTEXT;
+   } else if (_mutex_fast_lock(mutex, &rc)){
+      //-- mutex is locked without entering the kernel, rc is already set
    } else {
       TN_INTSAVE_DATA;
 
       TN_INT_DIS_SAVE();
 
+      //-- if the mutex is locked through the fast path by some other task,
+      //   let the kernel know about that
+      _mutex_fast_to_kernel(mutex);
+
       if (_tn_curr_run_task == mutex->holder){
          //-- mutex is already locked by current task
          //   if recursive locking enabled (TN_MUTEX_REC), increment lock count,
@@ -765,15 +1159,6 @@ enum TN_RCode tn_mutex_lock(struct TN_Mutex *mutex, TN_TickCnt timeout)
 
       } else if (mutex->holder == TN_NULL){
          //-- mutex is not locked, let's lock it
-
-         //-- TODO: probably, we should add special flag to _mutex_do_lock,
-         //   something like "other_tasks_can_wait", and set it to false here.
-         //   When _mutex_do_lock() is called from _mutex_do_unlock(), this flag
-         //   should be set to true there.
-         //   _mutex_do_lock() should forward this flag to _find_max_priority_by_mutex(),
-         //   and if that flag is false, _find_max_priority_by_mutex() should not
-         //   call _find_max_blocked_priority().
-         //   We could save about 30 cycles then. =)
          _mutex_do_lock(mutex, _tn_curr_run_task);
 
       } else {
@@ -829,11 +1214,15 @@ enum TN_RCode tn_mutex_unlock(struct TN_Mutex *mutex)
       //-- just return rc as it is
    } else if (!tn_is_task_context()){
       rc = TN_RC_WCONTEXT;
+   } else if (_mutex_fast_unlock(mutex, &rc)){
+      //-- mutex is unlocked without entering the kernel, rc is already set
    } else {
       TN_INTSAVE_DATA;
 
       TN_INT_DIS_SAVE();
 
+      _mutex_fast_to_kernel(mutex);
+
       //-- unlocking is enabled only for the owner and already locked mutex
       if (_tn_curr_run_task != mutex->holder){
          rc = TN_RC_ILLEGAL_USE;
@@ -883,6 +1272,10 @@ void _tn_mutex_unlock_all_by_task(struct TN_Task *task)
                                  //   item is removed from the list
                                  //   in _mutex_do_unlock().
 
+   //-- Mutexes locked through the fast path, which the kernel isn't
+   //   aware of, are just marked as free
+   _mutex_fast_unlock_all_by_task(task);
+
    _tn_list_for_each_entry_safe(
          mutex, struct TN_Mutex, tmp_mutex, &(task->mutex_queue), mutex_queue
          )
@@ -906,12 +1299,30 @@ void _tn_mutex_i_on_task_wait_complete(struct TN_Task *task)
    }
 #endif
 
-   if (task->priority_already_updated){
+   struct TN_Mutex *mutex = _get_mutex_by_wait_queque(task->pwait_queue);
+   TN_BOOL was_first
+      = (mutex->prio_wait_queue.next == &(task->mutex_prio_queue));
+
+   //-- remove the task from the mutex's waiters ordered by priority
+   _tn_list_remove_entry(&(task->mutex_prio_queue));
+   _tn_list_reset(&(task->mutex_prio_queue));
+
+   if (mutex->holder->priority_already_updated){
       //-- priority is already updated (in _mutex_do_unlock)
       //   so, just do nothing here
       //   (flag will be cleared in _mutex_do_unlock 
       //   when we exit from `_tn_task_wait_complete()`)
+      //
+      //   NOTE: the mutex is already removed from the holder's locked
+      //   mutexes queue, so we must not touch that queue here.
+   } else if (!was_first){
+      //-- the task wasn't the highest-priority waiter, so the priority
+      //   which the mutex imposes on its holder isn't changed.
    } else {
+      //-- the mutex might impose lower priority on its holder now,
+      //   so, move it in the holder's locked mutexes queue.
+      _mutex_queue_update(mutex);
+
       //-- Update priority of the holder of mutex which `task` was waiting
       //   for. If the holder itself waits for some mutex2, update priority
       //   of mutex2's holder, and so on, recursively.
@@ -922,6 +1333,32 @@ void _tn_mutex_i_on_task_wait_complete(struct TN_Task *task)
 
 }
 
+/**
+ * See comments in _tn_mutex.h file
+ */
+void _tn_mutex_i_on_task_priority_change(struct TN_Task *task)
+{
+   struct TN_Mutex *mutex = _get_mutex_by_wait_queque(task->pwait_queue);
+   TN_BOOL was_first
+      = (mutex->prio_wait_queue.next == &(task->mutex_prio_queue));
+
+   //-- move the task to the new place in the mutex's waiters ordered
+   //   by priority
+   _tn_list_remove_entry(&(task->mutex_prio_queue));
+   _prio_wait_queue_add(mutex, task);
+
+   if (     was_first
+         || mutex->prio_wait_queue.next == &(task->mutex_prio_queue)
+      )
+   {
+      //-- the highest-priority waiter has changed its priority (or the
+      //   task has become the highest-priority one), so the mutex might
+      //   impose another priority on its holder now: move it in the
+      //   holder's locked mutexes queue.
+      _mutex_queue_update(mutex);
+   }
+}
+
 /**
  * See comments in _tn_mutex.h file
  */
@@ -129,6 +129,12 @@ struct TN_Mutex {
    /// List of tasks that wait a mutex
    struct TN_ListItem wait_queue;
    ///
+   /// Used if only protocol is `#TN_MUTEX_PROT_INHERIT`: the same tasks as in
+   /// `wait_queue`, but always ordered by priority, so that the
+   /// highest-priority waiter is the first one (no matter what `wait_order`
+   /// is)
+   struct TN_ListItem prio_wait_queue;
+   ///
    /// To include in task's locked mutexes list (if any)
    struct TN_ListItem mutex_queue;
 #if TN_MUTEX_DEADLOCK_DETECT
@@ -141,7 +147,11 @@ struct TN_Mutex {
    /// Mutex protocol: priority ceiling or priority inheritance
    enum TN_MutexProtocol protocol;
    ///
-   /// Current mutex owner (task that locked mutex)
+   /// Current mutex owner (task that locked mutex).
+   ///
+   /// NOTE: if `#TN_MUTEX_FAST_LOCK` is set and the mutex is locked through
+   /// the fast path, this field stays `TN_NULL` until the mutex gets
+   /// contended: the actual owner is in the `owner` field.
    struct TN_Task *holder;
    ///
    /// Used if only protocol is `#TN_MUTEX_PROT_CEILING`:
@@ -150,6 +160,22 @@ struct TN_Mutex {
    ///
    /// Lock count (for recursive locking)
    int cnt;
+   ///
+   /// Order of tasks in the `wait_queue`
+   enum TN_WaitOrder wait_order;
+#if TN_MUTEX_FAST_LOCK
+   ///
+   /// Lock word, modified by atomic compare-and-swap: `0` if the mutex is
+   /// free, otherwise, pointer to the task that holds the mutex. If the
+   /// lowest bit is set, the mutex is managed by the kernel (`holder` is
+   /// valid, and the mutex is in the holder's locked mutexes list), so it
+   /// can't be unlocked through the fast path.
+   volatile TN_UWord owner;
+   ///
+   /// Next mutex in the holder's list of mutexes locked through the fast
+   /// path (see `mutex_fast_list` in `struct #TN_Task`)
+   struct TN_Mutex *volatile fast_next;
+#endif
 };
 
 /*******************************************************************************
@@ -164,10 +190,37 @@ struct TN_Mutex {
  *    PUBLIC FUNCTION PROTOTYPES
  ******************************************************************************/
 
+/**
+ * The same as `tn_mutex_create()`, but takes additional argument:
+ * `wait_order`, so that tasks waiting to lock the mutex may be queued in
+ * order of their priorities: then, when the mutex is unlocked, it is
+ * locked by the waiting task with highest priority.
+ *
+ * @param mutex
+ *    Pointer to already allocated `struct TN_Mutex`
+ * @param protocol
+ *    Mutex protocol: priority ceiling or priority inheritance.
+ *    See `enum #TN_MutexProtocol`.
+ * @param ceil_priority
+ *    Used if only `protocol` is `#TN_MUTEX_PROT_CEILING`: maximum priority
+ *    of the task that may lock the mutex.
+ * @param wait_order
+ *    Order of waiting tasks, see `enum #TN_WaitOrder`
+ */
+enum TN_RCode tn_mutex_create_worder(
+      struct TN_Mutex        *mutex,
+      enum TN_MutexProtocol   protocol,
+      int                     ceil_priority,
+      enum TN_WaitOrder       wait_order
+      );
+
 /**
  * Construct the mutex. The field `id_mutex` should not contain `#TN_ID_MUTEX`, 
  * otherwise, `#TN_RC_WPARAM` is returned.
  *
+ * Waiting tasks are queued in FIFO order; if you need them to be queued
+ * by priority, use `tn_mutex_create_worder()`.
+ *
  * $(TN_CALL_FROM_TASK)
  * $(TN_CALL_FROM_ISR)
  * $(TN_LEGEND_LINK)
@@ -186,11 +239,16 @@ struct TN_Mutex {
  *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
  *      is available: `#TN_RC_WPARAM`.
  */
-enum TN_RCode tn_mutex_create(
+_TN_STATIC_INLINE enum TN_RCode tn_mutex_create(
       struct TN_Mutex        *mutex,
       enum TN_MutexProtocol   protocol,
       int                     ceil_priority
-      );
+      )
+{
+   return tn_mutex_create_worder(
+         mutex, protocol, ceil_priority, TN_WAIT_ORDER_FIFO
+         );
+}
 
 /**
  * Destruct mutex.
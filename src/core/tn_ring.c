@@ -0,0 +1,600 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_common.h"
+#include "tn_sys.h"
+
+//-- internal tnkernel headers
+#include "_tn_tasks.h"
+#include "_tn_list.h"
+
+
+#include "tn_ring.h"
+#include "_tn_ring.h"
+
+#include "tn_tasks.h"
+
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+//-- Additional param checking {{{
+#if TN_CHECK_PARAM
+_TN_STATIC_INLINE enum TN_RCode _check_param_generic(
+      const struct TN_Ring *ring
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (ring == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_ring_is_valid(ring)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_create(
+      const struct TN_Ring *ring,
+      void *buf,
+      unsigned int item_size,
+      int items_cnt
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (ring == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (   buf == TN_NULL
+              || item_size == 0
+              || items_cnt <= 0
+              //-- capacity should be a power of two
+              || (items_cnt & (items_cnt - 1)) != 0
+              || _tn_ring_is_valid(ring)
+             )
+   {
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_job_perform(
+      const struct TN_Ring *ring,
+      const void *p_data,
+      int items_cnt
+      )
+{
+   enum TN_RCode rc = _check_param_generic(ring);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (p_data == TN_NULL || items_cnt <= 0){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+#else
+#  define _check_param_generic(ring)                              (TN_RC_OK)
+#  define _check_param_create(ring, buf, item_size, items_cnt)    (TN_RC_OK)
+#  define _check_param_job_perform(ring, p_data, items_cnt)       (TN_RC_OK)
+#endif
+// }}}
+
+//-- Lock-free data path {{{
+
+/**
+ * Copy `size` bytes from `p_src` to `p_dst`.
+ *
+ * Both the buffer and the user's memory are accessed through volatile
+ * pointers: this way, the compiler isn't allowed to move the copying after
+ * the subsequent store to `head_cnt` / `tail_cnt` (which are volatile as
+ * well), so that the other side never sees an item which isn't completely
+ * copied yet. If both pointers and size are word-aligned (which is the
+ * case for the buffer defined by `TN_RING_BUF_DEF()` and the items whose
+ * size is a multiple of `sizeof(#TN_UWord)`), data is copied word-by-word.
+ */
+static void _copy(void *p_dst, const void *p_src, TN_UWord size)
+{
+   if (
+         (((TN_UWord)p_dst | (TN_UWord)p_src | size)
+          & (sizeof(TN_UWord) - 1)) == 0
+      )
+   {
+      volatile TN_UWord *p_dst_w = (volatile TN_UWord *)p_dst;
+      const volatile TN_UWord *p_src_w = (const volatile TN_UWord *)p_src;
+
+      for (size /= sizeof(TN_UWord); size > 0; size--){
+         *p_dst_w++ = *p_src_w++;
+      }
+   } else {
+      volatile unsigned char *p_dst_b = (volatile unsigned char *)p_dst;
+      const volatile unsigned char *p_src_b
+         = (const volatile unsigned char *)p_src;
+
+      for (; size > 0; size--){
+         *p_dst_b++ = *p_src_b++;
+      }
+   }
+}
+
+/**
+ * Write as many items as there is room for (but not more than `items_cnt`)
+ * to the buffer, and then publish them by updating `head_cnt`. Called by
+ * the producer only; interrupts may be enabled.
+ *
+ * @return number of items written
+ */
+static int _ring_write(
+      struct TN_Ring *ring,
+      const unsigned char *p_data,
+      int items_cnt
+      )
+{
+   TN_UWord head_cnt = ring->head_cnt;
+   TN_UWord free_cnt = (ring->items_mask + 1) - (head_cnt - ring->tail_cnt);
+   TN_UWord idx = head_cnt & ring->items_mask;
+   TN_UWord first_cnt;
+
+   if ((TN_UWord)items_cnt > free_cnt){
+      items_cnt = (int)free_cnt;
+   }
+
+   //-- copy data in up to two chunks: up to the end of the buffer, and
+   //   then from the beginning of it
+   first_cnt = (ring->items_mask + 1) - idx;
+   if (first_cnt > (TN_UWord)items_cnt){
+      first_cnt = (TN_UWord)items_cnt;
+   }
+
+   _copy(
+         ring->buf + idx * ring->item_size,
+         p_data,
+         first_cnt * ring->item_size
+        );
+   _copy(
+         ring->buf,
+         p_data + first_cnt * ring->item_size,
+         ((TN_UWord)items_cnt - first_cnt) * ring->item_size
+        );
+
+   //-- publish new items: single store of TN_UWord
+   ring->head_cnt = head_cnt + (TN_UWord)items_cnt;
+
+   return items_cnt;
+}
+
+/**
+ * Read as many items as there are in the buffer (but not more than
+ * `items_cnt`), and then release the room by updating `tail_cnt`. Called by
+ * the consumer only; interrupts may be enabled.
+ *
+ * @return number of items read
+ */
+static int _ring_read(
+      struct TN_Ring *ring,
+      unsigned char *p_data,
+      int items_cnt
+      )
+{
+   TN_UWord tail_cnt = ring->tail_cnt;
+   TN_UWord used_cnt = ring->head_cnt - tail_cnt;
+   TN_UWord idx = tail_cnt & ring->items_mask;
+   TN_UWord first_cnt;
+
+   if ((TN_UWord)items_cnt > used_cnt){
+      items_cnt = (int)used_cnt;
+   }
+
+   first_cnt = (ring->items_mask + 1) - idx;
+   if (first_cnt > (TN_UWord)items_cnt){
+      first_cnt = (TN_UWord)items_cnt;
+   }
+
+   _copy(
+         p_data,
+         ring->buf + idx * ring->item_size,
+         first_cnt * ring->item_size
+        );
+   _copy(
+         p_data + first_cnt * ring->item_size,
+         ring->buf,
+         ((TN_UWord)items_cnt - first_cnt) * ring->item_size
+        );
+
+   //-- release the room: single store of TN_UWord
+   ring->tail_cnt = tail_cnt + (TN_UWord)items_cnt;
+
+   return items_cnt;
+}
+// }}}
+
+/**
+ * Wake up the consumer task waiting for the data, if any. Should be called
+ * with interrupts disabled, after new items are published.
+ */
+static void _reader_wake(struct TN_Ring *ring)
+{
+   ring->reader_waiting = TN_FALSE;
+
+   _tn_task_first_wait_complete(
+         &ring->wait_receive_list, TN_RC_OK, TN_NULL, TN_NULL, TN_NULL
+         );
+}
+
+/**
+ * Store `cnt` to the location pointed to by `p_cnt`, if it is not
+ * `#TN_NULL`, and return appropriate return code for the write or read.
+ */
+_TN_STATIC_INLINE enum TN_RCode _done_cnt_store(
+      int *p_cnt,
+      int cnt,
+      TN_BOOL ok
+      )
+{
+   if (p_cnt != TN_NULL){
+      *p_cnt = cnt;
+   }
+
+   return ok ? TN_RC_OK : TN_RC_TIMEOUT;
+}
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+enum TN_RCode tn_ring_create(
+      struct TN_Ring   *ring,
+      void             *buf,
+      unsigned int      item_size,
+      int               items_cnt
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   rc = _check_param_create(ring, buf, item_size, items_cnt);
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else {
+      _tn_list_reset(&(ring->wait_receive_list));
+
+      ring->buf            = (unsigned char *)buf;
+      ring->item_size      = item_size;
+      ring->items_mask     = (TN_UWord)items_cnt - 1;
+
+      ring->head_cnt       = 0;
+      ring->tail_cnt       = 0;
+      ring->reader_waiting = TN_FALSE;
+
+      ring->id_ring = TN_ID_RING;
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+enum TN_RCode tn_ring_delete(struct TN_Ring *ring)
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   rc = _check_param_generic(ring);
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      //-- notify waiting task that the object is deleted
+      //   (TN_RC_DELETED is returned)
+      _tn_wait_queue_notify_deleted(&(ring->wait_receive_list));
+
+      ring->id_ring = TN_ID_NONE; //-- ring buffer does not exist now
+
+      TN_INT_RESTORE();
+
+      //-- we might need to switch context if _tn_wait_queue_notify_deleted()
+      //   has woken up some high-priority task
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+enum TN_RCode tn_ring_write(
+      struct TN_Ring   *ring,
+      const void       *p_data,
+      int               items_cnt,
+      int              *p_written_cnt
+      )
+{
+   int written_cnt = 0;
+   enum TN_RCode rc = _check_param_job_perform(ring, p_data, items_cnt);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      written_cnt = _ring_write(ring, p_data, items_cnt);
+
+      //-- The consumer sets `reader_waiting` with interrupts disabled, and
+      //   then checks whether the buffer is still empty. Since new items are
+      //   already published, either it sees them, or we see the flag.
+      if (written_cnt > 0 && ring->reader_waiting){
+         TN_INTSAVE_DATA;
+
+         TN_INT_DIS_SAVE();
+         _reader_wake(ring);
+         TN_INT_RESTORE();
+
+         _tn_context_switch_pend_if_needed();
+      }
+
+      rc = _done_cnt_store(
+            p_written_cnt, written_cnt, (written_cnt == items_cnt)
+            );
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+enum TN_RCode tn_ring_iwrite(
+      struct TN_Ring   *ring,
+      const void       *p_data,
+      int               items_cnt,
+      int              *p_written_cnt
+      )
+{
+   int written_cnt = 0;
+   enum TN_RCode rc = _check_param_job_perform(ring, p_data, items_cnt);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      written_cnt = _ring_write(ring, p_data, items_cnt);
+
+      //-- see comment in tn_ring_write()
+      if (written_cnt > 0 && ring->reader_waiting){
+         TN_INTSAVE_DATA_INT;
+
+         TN_INT_IDIS_SAVE();
+         _reader_wake(ring);
+         TN_INT_IRESTORE();
+
+         _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+      }
+
+      rc = _done_cnt_store(
+            p_written_cnt, written_cnt, (written_cnt == items_cnt)
+            );
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+enum TN_RCode tn_ring_read(
+      struct TN_Ring   *ring,
+      void             *p_data,
+      int               items_cnt,
+      int              *p_read_cnt,
+      TN_TickCnt        timeout
+      )
+{
+   int read_cnt = 0;
+   enum TN_RCode rc = _check_param_job_perform(ring, p_data, items_cnt);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      read_cnt = _ring_read(ring, p_data, items_cnt);
+
+      if (read_cnt == 0 && timeout != 0){
+         //-- The buffer is empty, and user asked to wait if that happens.
+         //   This is the only case when the consumer disables interrupts.
+         TN_BOOL waited = TN_FALSE;
+         TN_INTSAVE_DATA;
+
+         TN_INT_DIS_SAVE();
+
+         //-- Set the flag first, and then check if the buffer is still
+         //   empty: the producer publishes items first, and then checks the
+         //   flag, so that the items can't be missed.
+         ring->reader_waiting = TN_TRUE;
+         if (ring->head_cnt == ring->tail_cnt){
+            _tn_task_curr_to_wait_action(
+                  &(ring->wait_receive_list),
+                  TN_WAIT_REASON_RING_WRECEIVE,
+                  timeout
+                  );
+            waited = TN_TRUE;
+         } else {
+            ring->reader_waiting = TN_FALSE;
+         }
+
+#if TN_DEBUG
+         if (!_tn_need_context_switch() && waited){
+            _TN_FATAL_ERROR("");
+         }
+#endif
+
+         TN_INT_RESTORE();
+         _tn_context_switch_pend_if_needed();
+
+         rc = TN_RC_OK;
+         if (waited){
+            rc = _tn_curr_run_task->task_wait_rc;
+
+            if (rc != TN_RC_OK && rc != TN_RC_DELETED){
+               //-- the producer didn't wake us up (timeout or forced
+               //   release), so the flag is still set: clear it to save
+               //   the producer needless critical section
+               ring->reader_waiting = TN_FALSE;
+            }
+         }
+
+         if (rc == TN_RC_OK){
+            read_cnt = _ring_read(ring, p_data, items_cnt);
+         }
+      }
+
+      if (rc == TN_RC_OK){
+         rc = _done_cnt_store(p_read_cnt, read_cnt, (read_cnt > 0));
+      } else {
+         _done_cnt_store(p_read_cnt, 0, TN_FALSE);
+      }
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+enum TN_RCode tn_ring_read_polling(
+      struct TN_Ring   *ring,
+      void             *p_data,
+      int               items_cnt,
+      int              *p_read_cnt
+      )
+{
+   return tn_ring_read(ring, p_data, items_cnt, p_read_cnt, 0);
+}
+
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+enum TN_RCode tn_ring_iread_polling(
+      struct TN_Ring   *ring,
+      void             *p_data,
+      int               items_cnt,
+      int              *p_read_cnt
+      )
+{
+   int read_cnt = 0;
+   enum TN_RCode rc = _check_param_job_perform(ring, p_data, items_cnt);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      read_cnt = _ring_read(ring, p_data, items_cnt);
+      rc = _done_cnt_store(p_read_cnt, read_cnt, (read_cnt > 0));
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+int tn_ring_free_items_cnt_get(
+      struct TN_Ring   *ring
+      )
+{
+   int ret = -1;
+   enum TN_RCode rc = _check_param_generic(ring);
+
+   if (rc == TN_RC_OK){
+      //-- It's not needed to disable interrupts here, since both counters
+      //   are read by just one assembler instruction each, and the result
+      //   is a snapshot anyway.
+      ret = (int)((ring->items_mask + 1) - (ring->head_cnt - ring->tail_cnt));
+   }
+
+   return ret;
+}
+
+/*
+ * See comments in the header file (tn_ring.h)
+ */
+int tn_ring_used_items_cnt_get(
+      struct TN_Ring   *ring
+      )
+{
+   int ret = -1;
+   enum TN_RCode rc = _check_param_generic(ring);
+
+   if (rc == TN_RC_OK){
+      //-- see comment in tn_ring_free_items_cnt_get()
+      ret = (int)(ring->head_cnt - ring->tail_cnt);
+   }
+
+   return ret;
+}
+
+
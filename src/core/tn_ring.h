@@ -0,0 +1,432 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/**
+ * \file
+ *
+ * A ring buffer is a single-producer / single-consumer FIFO of fixed-size
+ * items, intended for high-rate streams from an ISR to a task (say, samples
+ * from an ADC or data received by DMA).
+ *
+ * Unlike \ref tn_dqueue.h "data queue" and \ref tn_msgq.h "message queue",
+ * the data path of the ring buffer doesn't disable interrupts at all: the
+ * producer (`tn_ring_iwrite()` or `tn_ring_write()`) modifies only the
+ * head counter, and the consumer (`tn_ring_read()` and friends) modifies
+ * only the tail counter. Each counter is updated by a single store of
+ * `#TN_UWord`, which is atomic on every supported architecture, after the
+ * items are copied, so that the other side never sees an item which isn't
+ * completely written or read.
+ *
+ * The only thing which involves the scheduler is the case when the consumer
+ * task has to wait for the data: then it sets the "reader is waiting" flag
+ * and goes to sleep, and the producer, after writing new items, checks this
+ * flag and, if only it is set, enters the (short) critical section to wake
+ * the consumer up. So, as long as the consumer keeps up with the producer,
+ * neither side ever disables interrupts.
+ *
+ * The price of that is the following restrictions:
+ *
+ * - There should be at most one producer and at most one consumer at a
+ *   time. E.g. it's not allowed to write to the same ring buffer from two
+ *   different ISRs, or from ISR and from task, unless these writes are
+ *   somehow serialized by the application; the same is true for reading.
+ * - The producer never waits: if there's no room in the buffer, just as many
+ *   items are written as there is room for, and the caller is told how many.
+ *   This is what is usually needed for streams: ISR can't wait anyway.
+ * - Capacity of the buffer (in items) should be a power of two.
+ *
+ * Items can be written and read one by one as well as in bulk: the data is
+ * copied to / from the buffer in at most two contiguous chunks (before and
+ * after the wraparound point).
+ *
+ */
+
+#ifndef _TN_RING_H
+#define _TN_RING_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_list.h"
+#include "tn_common.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {  /*}*/
+#endif
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Structure representing ring buffer object
+ */
+struct TN_Ring {
+   ///
+   /// id for object validity verification.
+   /// This field is in the beginning of the structure to make it easier
+   /// to detect memory corruption.
+   enum TN_ObjId id_ring;
+   ///
+   /// list of tasks waiting for data (since there's only one consumer, there
+   /// is at most one task in it)
+   struct TN_ListItem wait_receive_list;
+
+   ///
+   /// buffer to store items: `items_mask + 1` items of `item_size` bytes
+   /// each.
+   unsigned char *buf;
+   ///
+   /// size of each item, in bytes
+   unsigned int item_size;
+   ///
+   /// capacity of the buffer minus 1; since capacity is a power of two,
+   /// it is used as a mask to get item index from the counter.
+   TN_UWord items_mask;
+   ///
+   /// total count of items written to the buffer (wraps around).
+   /// Modified by producer only.
+   volatile TN_UWord head_cnt;
+   ///
+   /// total count of items read from the buffer (wraps around).
+   /// Modified by consumer only.
+   volatile TN_UWord tail_cnt;
+   ///
+   /// set by the consumer (with interrupts disabled) right before it goes to
+   /// wait for the data; if the producer finds it set, it wakes the
+   /// consumer up.
+   volatile TN_BOOL reader_waiting;
+};
+
+
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/**
+ * Convenience macro for the definition of buffer for ring buffer. See
+ * `tn_ring_create()` for usage example.
+ *
+ * The buffer is defined as an array of `#TN_UWord`, so that it is properly
+ * aligned, and items can be copied word-by-word if only their size allows.
+ *
+ * @param name
+ *    C variable name of the buffer array (this name should be given
+ *    to the `tn_ring_create()` function as the `buf` argument)
+ * @param item_type
+ *    Type of item in the ring buffer
+ * @param size
+ *    Number of items in the ring buffer; should be a power of two
+ */
+#define TN_RING_BUF_DEF(name, item_type, size)                    \
+   TN_UWord name[                                                 \
+      (                                                           \
+           (size) * sizeof(item_type)                             \
+         + sizeof(TN_UWord) - 1                                   \
+      ) / sizeof(TN_UWord)                                        \
+      ]
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Construct ring buffer. `id_ring` member should not contain `#TN_ID_RING`,
+ * otherwise, `#TN_RC_WPARAM` is returned.
+ *
+ * For the definition of buffer, convenience macro `TN_RING_BUF_DEF()` was
+ * invented.
+ *
+ * Typical definition looks as follows:
+ *
+ * \code{.c}
+ *     //-- number of samples in the ring buffer (should be a power of two)
+ *     #define MY_RING_ITEMS_CNT     64
+ *
+ *     //-- define buffer for samples
+ *     TN_RING_BUF_DEF(my_ring_buf, unsigned short, MY_RING_ITEMS_CNT);
+ *
+ *     //-- define ring buffer structure
+ *     struct TN_Ring my_ring;
+ * \endcode
+ *
+ * And then, construct your `my_ring` as follows:
+ *
+ * \code{.c}
+ *     enum TN_RCode rc;
+ *     rc = tn_ring_create(
+ *           &my_ring, my_ring_buf, sizeof(unsigned short), MY_RING_ITEMS_CNT
+ *           );
+ *     if (rc != TN_RC_OK){
+ *        //-- handle error
+ *     }
+ * \endcode
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param ring       pointer to already allocated `struct #TN_Ring`.
+ * @param buf        pointer to already allocated buffer for `items_cnt`
+ *                   items of `item_size` bytes each. Use `TN_RING_BUF_DEF()`
+ *                   for the definition: if the buffer is word-aligned, and
+ *                   `item_size` is a multiple of `sizeof(#TN_UWord)`, items
+ *                   are copied word-by-word.
+ * @param item_size  size of each item, in bytes. Should be more than 0.
+ * @param items_cnt  capacity of ring buffer (count of items in the `buf`).
+ *                   Should be a power of two.
+ *
+ * @return
+ *    * `#TN_RC_OK` if ring buffer was successfully created;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
+ *      is available: `#TN_RC_WPARAM`.
+ */
+enum TN_RCode tn_ring_create(
+      struct TN_Ring   *ring,
+      void             *buf,
+      unsigned int      item_size,
+      int               items_cnt
+      );
+
+
+/**
+ * Destruct ring buffer.
+ *
+ * If the consumer task waits for the data, it becomes runnable with
+ * `#TN_RC_DELETED` code returned.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param ring       pointer to ring buffer to be deleted
+ *
+ * @return
+ *    * `#TN_RC_OK` if ring buffer was successfully deleted;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_ring_delete(struct TN_Ring *ring);
+
+
+/**
+ * Write up to `items_cnt` items from the array `p_data` to the ring buffer,
+ * without disabling interrupts. If there isn't enough room in the buffer,
+ * as many items are written as there is room for; the producer never waits.
+ *
+ * If the consumer task waits for the data, it is woken up (that's the only
+ * case when interrupts are disabled, for a short time).
+ *
+ * The ring buffer should have just one producer: see restrictions in the
+ * description of the \ref tn_ring.h "ring buffer".
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param ring          pointer to ring buffer to write data to
+ * @param p_data        array of `items_cnt` items of `item_size` bytes each
+ * @param items_cnt     number of items to write, should be more than 0
+ * @param p_written_cnt location to store number of items actually written:
+ *                      all of them if `#TN_RC_OK` is returned, and less
+ *                      otherwise. Can be `#TN_NULL`.
+ *
+ * @return
+ *    * `#TN_RC_OK`   if all the items were written;
+ *    * `#TN_RC_TIMEOUT` if there was no room for some of the items;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_ring_write(
+      struct TN_Ring   *ring,
+      const void       *p_data,
+      int               items_cnt,
+      int              *p_written_cnt
+      );
+
+/**
+ * The same as `tn_ring_write()`, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_ring_iwrite(
+      struct TN_Ring   *ring,
+      const void       *p_data,
+      int               items_cnt,
+      int              *p_written_cnt
+      );
+
+/**
+ * Read up to `items_cnt` items from the ring buffer to the array `p_data`,
+ * without disabling interrupts: as many items are read as there are in the
+ * buffer.
+ *
+ * If the buffer is empty, behavior depends on the `timeout` value: refer to
+ * `#TN_TickCnt`. The task waits until at least one item is written, and
+ * then reads whatever is available (up to `items_cnt` items).
+ *
+ * The ring buffer should have just one consumer: see restrictions in the
+ * description of the \ref tn_ring.h "ring buffer".
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param ring          pointer to ring buffer to read data from
+ * @param p_data        array of `items_cnt` items of `item_size` bytes each
+ *                      to store the data
+ * @param items_cnt     max number of items to read, should be more than 0
+ * @param p_read_cnt    location to store number of items actually read: at
+ *                      least one if `#TN_RC_OK` is returned, and 0
+ *                      otherwise. Can be `#TN_NULL`.
+ * @param timeout       refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK`   if at least one item was read;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_ring_read(
+      struct TN_Ring   *ring,
+      void             *p_data,
+      int               items_cnt,
+      int              *p_read_cnt,
+      TN_TickCnt        timeout
+      );
+
+/**
+ * The same as `tn_ring_read()` with zero timeout
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_ring_read_polling(
+      struct TN_Ring   *ring,
+      void             *p_data,
+      int               items_cnt,
+      int              *p_read_cnt
+      );
+
+/**
+ * The same as `tn_ring_read()` with zero timeout, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_ring_iread_polling(
+      struct TN_Ring   *ring,
+      void             *p_data,
+      int               items_cnt,
+      int              *p_read_cnt
+      );
+
+
+/**
+ * Returns number of free items in the ring buffer. If called by the
+ * producer, the actual number can only be larger; if called by anyone else,
+ * it's just a snapshot.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param ring
+ *    Pointer to ring buffer.
+ *
+ * @return
+ *    Number of free items in the ring buffer, or -1 if wrong params were
+ *    given (the check is performed if only `#TN_CHECK_PARAM` is non-zero)
+ */
+int tn_ring_free_items_cnt_get(
+      struct TN_Ring   *ring
+      );
+
+
+/**
+ * Returns number of used (non-free) items in the ring buffer. If called by
+ * the consumer, the actual number can only be larger; if called by anyone
+ * else, it's just a snapshot.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param ring
+ *    Pointer to ring buffer.
+ *
+ * @return
+ *    Number of used (non-free) items in the ring buffer, or -1 if wrong
+ *    params were given (the check is performed if only `#TN_CHECK_PARAM` is
+ *    non-zero)
+ */
+int tn_ring_used_items_cnt_get(
+      struct TN_Ring   *ring
+      );
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_RING_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
+
+
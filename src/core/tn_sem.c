@@ -45,6 +45,7 @@
 
 //-- internal tnkernel headers
 #include "_tn_tasks.h"
+#include "_tn_timer.h"
 #include "_tn_list.h"
 
 
@@ -84,7 +85,8 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_generic(
 _TN_STATIC_INLINE enum TN_RCode _check_param_create(
       const struct TN_Sem *sem,
       int start_count,
-      int max_count
+      int max_count,
+      enum TN_WaitOrder wait_order
       )
 {
    enum TN_RCode rc = TN_RC_OK;
@@ -96,6 +98,7 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_create(
          || max_count <= 0
          || start_count < 0
          || start_count > max_count
+         || !_tn_wait_order_is_valid(wait_order)
          )
    {
       rc = TN_RC_WPARAM;
@@ -106,7 +109,8 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_create(
 
 #else
 #  define _check_param_generic(sem)                            (TN_RC_OK)
-#  define _check_param_create(sem, start_count, max_count)     (TN_RC_OK)
+#  define _check_param_create(sem, start_count, max_count, wait_order)   \
+                                                               (TN_RC_OK)
 #endif
 // }}}
 
@@ -116,12 +120,16 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_create(
  *
  * @param sem        semaphore to perform job on
  * @param p_worker   pointer to actual worker function
- * @param timeout    see `#TN_TickCnt`
+ * @param timeout    see `#TN_TickCnt`; if `is_deadline` is `TN_TRUE`, it is
+ *                   the absolute deadline instead
+ * @param is_deadline   whether `timeout` is the deadline, see
+ *                   `_tn_timeout_resolve()`
  */
 _TN_STATIC_INLINE enum TN_RCode _sem_job_perform(
       struct TN_Sem *sem,
       enum TN_RCode (p_worker)(struct TN_Sem *sem),
-      TN_TickCnt timeout
+      TN_TickCnt timeout,
+      TN_BOOL is_deadline
       )
 {
    enum TN_RCode rc = _check_param_generic(sem);
@@ -137,10 +145,16 @@ _TN_STATIC_INLINE enum TN_RCode _sem_job_perform(
       TN_INT_DIS_SAVE();      //-- disable interrupts
       rc = p_worker(sem);     //-- call actual worker function
 
-      //-- if we should wait, put current task to wait
+      //-- if we should wait, put current task to wait (if deadline is given,
+      //   it is converted to timeout right here, with interrupts disabled)
+      if (rc == TN_RC_TIMEOUT){
+         timeout = _tn_timeout_resolve(timeout, is_deadline);
+      }
+
       if (rc == TN_RC_TIMEOUT && timeout != 0){
-         _tn_task_curr_to_wait_action(
-               &(sem->wait_queue), TN_WAIT_REASON_SEM, timeout
+         _tn_task_curr_to_wait_action_ordered(
+               &(sem->wait_queue), sem->wait_order,
+               TN_WAIT_REASON_SEM, timeout
                );
 
          //-- rc will be set later thanks to waited_for_sem
@@ -244,14 +258,17 @@ _TN_STATIC_INLINE enum TN_RCode _sem_wait(struct TN_Sem *sem)
 /*
  * See comments in the header file (tn_sem.h)
  */
-enum TN_RCode tn_sem_create(
+enum TN_RCode tn_sem_create_worder(
       struct TN_Sem *sem,
       int start_count,
-      int max_count
+      int max_count,
+      enum TN_WaitOrder wait_order
       )
 {
    //-- perform additional params checking (if enabled by TN_CHECK_PARAM)
-   enum TN_RCode rc = _check_param_create(sem, start_count, max_count);
+   enum TN_RCode rc = _check_param_create(
+         sem, start_count, max_count, wait_order
+         );
 
    if (rc != TN_RC_OK){
       //-- just return rc as it is
@@ -261,6 +278,7 @@ enum TN_RCode tn_sem_create(
 
       sem->count     = start_count;
       sem->max_count = max_count;
+      sem->wait_order = wait_order;
       sem->id_sem    = TN_ID_SEMAPHORE;
 
    }
@@ -302,7 +320,7 @@ enum TN_RCode tn_sem_delete(struct TN_Sem * sem)
  */
 enum TN_RCode tn_sem_signal(struct TN_Sem *sem)
 {
-   return _sem_job_perform(sem, _sem_signal, 0);
+   return _sem_job_perform(sem, _sem_signal, 0, TN_FALSE);
 }
 
 /*
@@ -318,7 +336,15 @@ enum TN_RCode tn_sem_isignal(struct TN_Sem *sem)
  */
 enum TN_RCode tn_sem_wait(struct TN_Sem *sem, TN_TickCnt timeout)
 {
-   return _sem_job_perform(sem, _sem_wait, timeout);
+   return _sem_job_perform(sem, _sem_wait, timeout, TN_FALSE);
+}
+
+/*
+ * See comments in the header file (tn_sem.h)
+ */
+enum TN_RCode tn_sem_wait_until(struct TN_Sem *sem, TN_TickCnt deadline)
+{
+   return _sem_job_perform(sem, _sem_wait, deadline, TN_TRUE);
 }
 
 /*
@@ -326,7 +352,7 @@ enum TN_RCode tn_sem_wait(struct TN_Sem *sem, TN_TickCnt timeout)
  */
 enum TN_RCode tn_sem_wait_polling(struct TN_Sem *sem)
 {
-   return _sem_job_perform(sem, _sem_wait, 0);
+   return _sem_job_perform(sem, _sem_wait, 0, TN_FALSE);
 }
 
 /*
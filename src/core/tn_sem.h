@@ -100,6 +100,9 @@ struct TN_Sem {
    ///
    /// Max value of `count`
    int max_count;
+   ///
+   /// Order of tasks in the `wait_queue`
+   enum TN_WaitOrder wait_order;
 };
 
 
@@ -115,10 +118,34 @@ struct TN_Sem {
  *    PUBLIC FUNCTION PROTOTYPES
  ******************************************************************************/
 
+/**
+ * The same as `tn_sem_create()`, but takes additional argument:
+ * `wait_order`, so that tasks waiting for the semaphore may be queued in
+ * order of their priorities.
+ *
+ * @param sem
+ *    Pointer to already allocated `struct TN_Sem`
+ * @param start_count
+ *    Initial counter value, typically it is equal to `max_count`
+ * @param max_count
+ *    Maximum counter value.
+ * @param wait_order
+ *    Order of waiting tasks, see `enum #TN_WaitOrder`
+ */
+enum TN_RCode tn_sem_create_worder(
+      struct TN_Sem *sem,
+      int start_count,
+      int max_count,
+      enum TN_WaitOrder wait_order
+      );
+
 /**
  * Construct the semaphore. `id_sem` field should not contain
  * `#TN_ID_SEMAPHORE`, otherwise, `#TN_RC_WPARAM` is returned.
  *
+ * Waiting tasks are queued in FIFO order; if you need them to be queued
+ * by priority, use `tn_sem_create_worder()`.
+ *
  * $(TN_CALL_FROM_TASK)
  * $(TN_CALL_FROM_ISR)
  * $(TN_LEGEND_LINK)
@@ -135,11 +162,16 @@ struct TN_Sem {
  *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
  *      is available: `#TN_RC_WPARAM`.
  */
-enum TN_RCode tn_sem_create(
+_TN_STATIC_INLINE enum TN_RCode tn_sem_create(
       struct TN_Sem *sem,
       int start_count,
       int max_count
-      );
+      )
+{
+   return tn_sem_create_worder(
+         sem, start_count, max_count, TN_WAIT_ORDER_FIFO
+         );
+}
 
 /**
  * Destruct the semaphore.
@@ -223,6 +255,21 @@ enum TN_RCode tn_sem_isignal(struct TN_Sem *sem);
  */
 enum TN_RCode tn_sem_wait(struct TN_Sem *sem, TN_TickCnt timeout);
 
+/**
+ * The same as `tn_sem_wait()`, but instead of relative timeout, the absolute
+ * `deadline` (in terms of `tn_sys_time_get()`) is given. It is converted to
+ * timeout (as `tn_sys_timeout_until()` does) with interrupts disabled, right
+ * before the task is put to wait, so the task never wakes up later than the
+ * deadline. If the `deadline` is already reached, it behaves like
+ * `tn_sem_wait_polling()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_sem_wait_until(struct TN_Sem *sem, TN_TickCnt deadline);
+
 /**
  * The same as `tn_sem_wait()` with zero timeout.
  *
@@ -0,0 +1,617 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+
+//-- common tnkernel headers
+#include "tn_common.h"
+#include "tn_sys.h"
+
+//-- internal tnkernel headers
+#include "_tn_sys.h"
+
+
+//-- header of current module
+#include "tn_slab.h"
+#include "_tn_slab.h"
+
+//-- header of other needed modules
+#include "tn_fmem.h"
+#include "_tn_fmem.h"
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Returns the address right after the last block of the pool
+ */
+_TN_STATIC_INLINE unsigned char *_fmem_end_addr(const struct TN_FMem *fmem)
+{
+   return (unsigned char *)fmem->start_addr
+      + fmem->block_size * (unsigned int)fmem->blocks_cnt;
+}
+
+/**
+ * Update bit of the given class in the bitmap of non-empty classes,
+ * according to the current state of the pool.
+ *
+ * Should be called with interrupts disabled.
+ */
+_TN_STATIC_INLINE void _free_bmp_update(struct TN_Slab *slab, int class_idx)
+{
+   if (slab->pools[class_idx]->free_blocks_cnt > 0){
+      slab->free_bmp |= (1u << class_idx);
+   } else {
+      slab->free_bmp &= ~(1u << class_idx);
+   }
+}
+
+/**
+ * Returns index of the smallest class whose blocks are large enough for
+ * the given size, or `classes_cnt` if there's no such class.
+ *
+ * Since classes are sorted by block size, it's a binary search.
+ */
+static int _class_by_size(const struct TN_Slab *slab, unsigned int size)
+{
+   int lo = 0;
+   int hi = slab->classes_cnt;
+
+   while (lo < hi){
+      int mid = (lo + hi) / 2;
+      if (slab->pools[mid]->block_size < size){
+         lo = mid + 1;
+      } else {
+         hi = mid;
+      }
+   }
+
+   return lo;
+}
+
+/**
+ * Returns index of the class to which the given block belongs, or -1 if
+ * the block doesn't belong to any pool.
+ *
+ * Binary search among the address ranges of the pools, see `addr_order`
+ * field of `struct #TN_Slab`.
+ */
+static int _class_by_addr(const struct TN_Slab *slab, const void *p_data)
+{
+   int ret = -1;
+   int lo = 0;
+   int hi = slab->classes_cnt;
+
+   //-- find the last pool whose start address is not above `p_data`
+   while (lo < hi){
+      int mid = (lo + hi) / 2;
+      if ((const unsigned char *)slab->pools[slab->addr_order[mid]]->start_addr
+            <= (const unsigned char *)p_data)
+      {
+         lo = mid + 1;
+      } else {
+         hi = mid;
+      }
+   }
+
+   if (lo > 0){
+      int class_idx = slab->addr_order[lo - 1];
+
+      if ((const unsigned char *)p_data
+            < _fmem_end_addr(slab->pools[class_idx]))
+      {
+         ret = class_idx;
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * Try to take the block from the given class or, if it is empty and
+ * `#TN_SLAB_ATTR_FALLBACK` is set, from the next larger non-empty class.
+ *
+ * Should be called with interrupts disabled.
+ *
+ * @return
+ *    * `#TN_RC_OK` if the block is allocated;
+ *    * `#TN_RC_TIMEOUT` if there are no suitable free blocks.
+ */
+static enum TN_RCode _slab_alloc(
+      struct TN_Slab *slab,
+      int class_idx,
+      void **p_data
+      )
+{
+   enum TN_RCode rc = TN_RC_TIMEOUT;
+   unsigned int bmp;
+
+   if (slab->attr & TN_SLAB_ATTR_FALLBACK){
+      bmp = slab->free_bmp & (~0u << class_idx);
+   } else {
+      bmp = slab->free_bmp & (1u << class_idx);
+   }
+
+   //-- the bit may be stale: `tn_slab_alloc()` takes the block by
+   //   `tn_fmem_get()` in its own critical section and updates the bitmap
+   //   afterwards. So if the pool turns out to be empty, clear its bit
+   //   and try the next candidate; each iteration clears one bit, so
+   //   there are at most `classes_cnt` iterations.
+   while (rc != TN_RC_OK && bmp != 0){
+      int found_idx = _tn_bmp_ffs(bmp) - 1;
+
+      rc = _tn_fmem_get(slab->pools[found_idx], p_data);
+      _free_bmp_update(slab, found_idx);
+      bmp &= ~(1u << found_idx);
+
+      if (rc == TN_RC_OK && found_idx != class_idx){
+         slab->fallback_cnt++;
+      }
+   }
+
+   if (rc != TN_RC_OK){
+      slab->fail_cnt++;
+   }
+
+   return rc;
+}
+
+/**
+ * Return the block to its pool and update the bitmap.
+ *
+ * Should be called with interrupts disabled.
+ */
+static enum TN_RCode _slab_free(
+      struct TN_Slab *slab,
+      int class_idx,
+      void *p_data
+      )
+{
+   enum TN_RCode rc = _tn_fmem_release(slab->pools[class_idx], p_data);
+   _free_bmp_update(slab, class_idx);
+   return rc;
+}
+
+/**
+ * Find the class for the block to free. If the block doesn't belong to any
+ * pool, -1 is returned.
+ *
+ * If `#TN_CHECK_PARAM` is non-zero, also check that the `p_data` is the
+ * start of a block.
+ */
+static int _class_for_free(const struct TN_Slab *slab, const void *p_data)
+{
+   int class_idx = _class_by_addr(slab, p_data);
+
+#if TN_CHECK_PARAM
+   if (class_idx >= 0){
+      const struct TN_FMem *fmem = slab->pools[class_idx];
+      unsigned int offset = (unsigned int)(
+               (const unsigned char *)p_data
+            - (const unsigned char *)fmem->start_addr
+            );
+
+      if ((offset % fmem->block_size) != 0){
+         class_idx = -1;
+      }
+   }
+#endif
+
+   return class_idx;
+}
+
+
+//-- Additional param checking {{{
+#if TN_CHECK_PARAM
+_TN_STATIC_INLINE enum TN_RCode _check_param_create(
+      const struct TN_Slab   *slab,
+      struct TN_FMem *const  *pools
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (slab == TN_NULL || pools == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (_tn_slab_is_valid(slab)){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_generic(
+      const struct TN_Slab *slab
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (slab == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_slab_is_valid(slab)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_job_perform(
+      const struct TN_Slab *slab,
+      const void *p
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (slab == TN_NULL || p == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_slab_is_valid(slab)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+#else
+#  define _check_param_create(slab, pools)               (TN_RC_OK)
+#  define _check_param_generic(slab)                     (TN_RC_OK)
+#  define _check_param_job_perform(slab, p)              (TN_RC_OK)
+#endif
+// }}}
+
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_create(
+      struct TN_Slab         *slab,
+      struct TN_FMem *const  *pools,
+      int                     classes_cnt,
+      enum TN_SlabAttr        attr
+      )
+{
+   enum TN_RCode rc;
+   int i, j;
+
+   rc = _check_param_create(slab, pools);
+   if (rc != TN_RC_OK){
+      goto out;
+   }
+
+   //-- basic check: classes_cnt should fit in the bitmap
+   if (classes_cnt < 1 || classes_cnt > TN_SLAB_CLASSES_MAX){
+      rc = TN_RC_WPARAM;
+      goto out;
+   }
+
+   //-- check that all the pools exist, and they are sorted by block size
+   for (i = 0; i < classes_cnt; i++){
+      if (     pools[i] == TN_NULL
+            || !_tn_fmem_is_valid(pools[i])
+            || (i > 0 && pools[i]->block_size <= pools[i - 1]->block_size)
+         )
+      {
+         rc = TN_RC_WPARAM;
+         goto out;
+      }
+   }
+
+   //-- sort pools by start address (insertion sort: there are just a few
+   //   of them)
+   for (i = 0; i < classes_cnt; i++){
+      unsigned char *start = (unsigned char *)pools[i]->start_addr;
+
+      for (
+            j = i;
+            j > 0 && (unsigned char *)pools[
+                  slab->addr_order[j - 1]
+               ]->start_addr > start;
+            j--
+          )
+      {
+         slab->addr_order[j] = slab->addr_order[j - 1];
+      }
+      slab->addr_order[j] = (unsigned char)i;
+   }
+
+   //-- check that memory areas of the pools don't overlap
+   for (i = 1; i < classes_cnt; i++){
+      if (     _fmem_end_addr(pools[slab->addr_order[i - 1]])
+            >  (unsigned char *)pools[slab->addr_order[i]]->start_addr
+         )
+      {
+         rc = TN_RC_WPARAM;
+         goto out;
+      }
+   }
+
+   //-- checks are done; proceed to actual creation
+
+   slab->pools          = pools;
+   slab->classes_cnt    = classes_cnt;
+   slab->attr           = attr;
+   slab->fallback_cnt   = 0;
+   slab->fail_cnt       = 0;
+
+   slab->free_bmp = 0;
+   for (i = 0; i < classes_cnt; i++){
+      _free_bmp_update(slab, i);
+   }
+
+   //-- set id
+   slab->id_slab = TN_ID_SLAB;
+
+out:
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_delete(struct TN_Slab *slab)
+{
+   enum TN_RCode rc = _check_param_generic(slab);
+
+   if (rc == TN_RC_OK){
+      //-- nobody waits for the slab itself (tasks wait for pools), so,
+      //   just invalidate it
+      slab->id_slab = TN_ID_NONE;
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_alloc(
+      struct TN_Slab *slab,
+      unsigned int size,
+      void **p_data,
+      TN_TickCnt timeout
+      )
+{
+   enum TN_RCode rc = _check_param_job_perform(slab, p_data);
+   int class_idx = 0;
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else if (
+            size == 0
+         || (class_idx = _class_by_size(slab, size)) >= slab->classes_cnt
+         )
+   {
+      //-- there's no class with blocks large enough
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+      rc = _slab_alloc(slab, class_idx, p_data);
+      TN_INT_RESTORE();
+
+      if (rc == TN_RC_TIMEOUT && timeout != 0){
+         //-- no free blocks: wait for the block of the suitable class.
+         //   Note that the block may have been freed since interrupts are
+         //   enabled, but `tn_fmem_get()` checks it again, so it's fine.
+         //   Until the bitmap is updated below, its bit may be stale;
+         //   `_slab_alloc()` copes with it.
+         rc = tn_fmem_get(slab->pools[class_idx], p_data, timeout);
+
+         if (rc == TN_RC_OK){
+            TN_INT_DIS_SAVE();
+            _free_bmp_update(slab, class_idx);
+            TN_INT_RESTORE();
+         }
+      }
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_alloc_polling(
+      struct TN_Slab *slab,
+      unsigned int size,
+      void **p_data
+      )
+{
+   return tn_slab_alloc(slab, size, p_data, 0);
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_ialloc_polling(
+      struct TN_Slab *slab,
+      unsigned int size,
+      void **p_data
+      )
+{
+   enum TN_RCode rc = _check_param_job_perform(slab, p_data);
+   int class_idx = 0;
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else if (
+            size == 0
+         || (class_idx = _class_by_size(slab, size)) >= slab->classes_cnt
+         )
+   {
+      //-- there's no class with blocks large enough
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+      rc = _slab_alloc(slab, class_idx, p_data);
+      TN_INT_IRESTORE();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_free(struct TN_Slab *slab, void *p_data)
+{
+   enum TN_RCode rc = _check_param_job_perform(slab, p_data);
+   int class_idx;
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else if ((class_idx = _class_for_free(slab, p_data)) < 0){
+      //-- the block doesn't belong to any pool
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+      rc = _slab_free(slab, class_idx, p_data);
+      TN_INT_RESTORE();
+
+      //-- the block might be given to the waiting task
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_ifree(struct TN_Slab *slab, void *p_data)
+{
+   enum TN_RCode rc = _check_param_job_perform(slab, p_data);
+   int class_idx;
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else if ((class_idx = _class_for_free(slab, p_data)) < 0){
+      //-- the block doesn't belong to any pool
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+      rc = _slab_free(slab, class_idx, p_data);
+      TN_INT_IRESTORE();
+
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_stat_get(
+      struct TN_Slab *slab,
+      struct TN_SlabStat *p_stat
+      )
+{
+   enum TN_RCode rc = _check_param_job_perform(slab, p_stat);
+
+   if (rc == TN_RC_OK){
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      p_stat->classes_cnt  = slab->classes_cnt;
+      p_stat->fallback_cnt = slab->fallback_cnt;
+      p_stat->fail_cnt     = slab->fail_cnt;
+
+      TN_INT_IRESTORE();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_slab.h)
+ */
+enum TN_RCode tn_slab_class_stat_get(
+      struct TN_Slab *slab,
+      int class_idx,
+      struct TN_SlabClassStat *p_stat
+      )
+{
+   enum TN_RCode rc = _check_param_job_perform(slab, p_stat);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (class_idx < 0 || class_idx >= slab->classes_cnt){
+      rc = TN_RC_WPARAM;
+   } else {
+      struct TN_FMem *fmem = slab->pools[class_idx];
+
+      //-- `block_size` and `blocks_cnt` never change
+      p_stat->block_size      = fmem->block_size;
+      p_stat->blocks_cnt      = fmem->blocks_cnt;
+      p_stat->free_blocks_cnt = tn_fmem_free_blocks_cnt_get(fmem);
+   }
+
+   return rc;
+}
+
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
@@ -0,0 +1,450 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+
+/**
+ * \file
+ *
+ * Slab allocator: a front-end which groups several \ref tn_fmem.h "fixed
+ * memory pools" of different block sizes into size classes, so that the
+ * application can just ask for the block of the size it needs, instead of
+ * picking the pool by hand.
+ *
+ * The slab doesn't own any memory: the application creates the pools as
+ * usual, and then gives the array of them (sorted by block size) to
+ * `tn_slab_create()`. After that, the pools should be used through the slab
+ * only.
+ *
+ * The slab keeps a bitmap of the classes which have free blocks, so that
+ * `tn_slab_alloc()` finds the smallest class with a free block by a single
+ * find-first-set operation, no matter how many classes there are:
+ *
+ * - first, the smallest class whose block size is enough for the request is
+ *   determined (by the binary search among the classes);
+ * - then, if that class is empty and the slab is created with
+ *   `#TN_SLAB_ATTR_FALLBACK`, the block is taken from the next larger class
+ *   which has free blocks. Without that attribute, only the suitable class
+ *   is used, so that small requests never eat blocks intended for large
+ *   ones.
+ *
+ * If there is no free block, the task may wait for it, but it always waits
+ * for the block of the suitable class (not the larger one): it's just a
+ * `tn_fmem_get()` on the pool of that class.
+ *
+ * `tn_slab_free()` takes just the address of the block: the slab finds the
+ * pool which the block belongs to by the binary search among the address
+ * ranges of the pools.
+ *
+ * Statistics of each class (see `tn_slab_class_stat_get()`) come from the
+ * underlying pool, and the slab itself counts allocations which fell back
+ * to larger classes and which failed (see `tn_slab_stat_get()`): both help
+ * to tune the sizes and counts of blocks in the pools.
+ */
+
+#ifndef _TN_SLAB_H
+#define _TN_SLAB_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_common.h"
+#include "tn_fmem.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {  /*}*/
+#endif
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/**
+ * Max number of size classes (i.e. pools) in the slab: it is limited by the
+ * width of the bitmap of non-empty classes, which is `unsigned int`, so it's
+ * 16 to fit any platform.
+ */
+#define TN_SLAB_CLASSES_MAX      16
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Attributes that could be given to the slab object, see `tn_slab_create()`
+ */
+enum TN_SlabAttr {
+   ///
+   /// No attributes: the block is always taken from the smallest class
+   /// which is large enough for the request.
+   TN_SLAB_ATTR_NONE       = (0),
+   ///
+   /// If the smallest suitable class has no free blocks, take the block from
+   /// the next larger class which has any.
+   TN_SLAB_ATTR_FALLBACK   = (1 << 0),
+};
+
+/**
+ * Slab allocator
+ */
+struct TN_Slab {
+   ///
+   /// id for object validity verification.
+   /// This field is in the beginning of the structure to make it easier
+   /// to detect memory corruption.
+   enum TN_ObjId           id_slab;
+   ///
+   /// Array of pools given to `tn_slab_create()`, sorted by block size;
+   /// index in this array is the index of size class.
+   struct TN_FMem *const  *pools;
+   ///
+   /// Number of items in the `pools` array
+   int                     classes_cnt;
+   ///
+   /// Attributes given to `tn_slab_create()`
+   enum TN_SlabAttr        attr;
+   ///
+   /// Bit N is set if the pool `pools[N]` has free blocks
+   unsigned int            free_bmp;
+   ///
+   /// Indexes of pools sorted by their start addresses, for the lookup of
+   /// the pool by block address in `tn_slab_free()`
+   unsigned char           addr_order[ TN_SLAB_CLASSES_MAX ];
+   ///
+   /// Number of allocations served by a larger class than requested (see
+   /// `#TN_SLAB_ATTR_FALLBACK`)
+   unsigned int            fallback_cnt;
+   ///
+   /// Number of allocation requests that couldn't be satisfied right away
+   /// (no matter whether task waited for memory then or not)
+   unsigned int            fail_cnt;
+};
+
+/**
+ * Statistics of the slab, see `tn_slab_stat_get()`
+ */
+struct TN_SlabStat {
+   ///
+   /// Number of size classes
+   int            classes_cnt;
+   ///
+   /// Number of allocations served by a larger class than requested
+   unsigned int   fallback_cnt;
+   ///
+   /// Number of allocation requests that couldn't be satisfied right away
+   unsigned int   fail_cnt;
+};
+
+/**
+ * Statistics of the size class, see `tn_slab_class_stat_get()`
+ */
+struct TN_SlabClassStat {
+   ///
+   /// Size of blocks in the class
+   unsigned int   block_size;
+   ///
+   /// Total number of blocks in the class
+   int            blocks_cnt;
+   ///
+   /// Number of free blocks in the class
+   int            free_blocks_cnt;
+};
+
+
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Construct slab from the given pools. `id_slab` field should not contain
+ * `#TN_ID_SLAB`, otherwise, `#TN_RC_WPARAM` is returned.
+ *
+ * All the pools should be created already, their block sizes should
+ * strictly increase, and their memory areas shouldn't overlap. The array
+ * `pools` isn't copied, so it should stay valid for the lifetime of the
+ * slab.
+ *
+ * Typical usage looks as follows:
+ *
+ * \code{.c}
+ *     #define MY_SMALL_CNT    16
+ *     #define MY_MEDIUM_CNT    8
+ *     #define MY_LARGE_CNT     2
+ *
+ *     TN_FMEM_BUF_DEF(buf_small,  struct MySmall,  MY_SMALL_CNT);
+ *     TN_FMEM_BUF_DEF(buf_medium, struct MyMedium, MY_MEDIUM_CNT);
+ *     TN_FMEM_BUF_DEF(buf_large,  struct MyLarge,  MY_LARGE_CNT);
+ *
+ *     struct TN_FMem pool_small, pool_medium, pool_large;
+ *
+ *     //-- pools, sorted by block size
+ *     static struct TN_FMem *const my_pools[] = {
+ *        &pool_small, &pool_medium, &pool_large,
+ *     };
+ *
+ *     struct TN_Slab my_slab;
+ * \endcode
+ *
+ * And then:
+ *
+ * \code{.c}
+ *     tn_fmem_create(
+ *           &pool_small, buf_small,
+ *           TN_MAKE_ALIG_SIZE(sizeof(struct MySmall)),
+ *           MY_SMALL_CNT
+ *           );
+ *     //-- ... create other pools in the same way
+ *
+ *     tn_slab_create(
+ *           &my_slab, my_pools,
+ *           sizeof(my_pools) / sizeof(my_pools[0]),
+ *           TN_SLAB_ATTR_FALLBACK
+ *           );
+ * \endcode
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param slab          pointer to already allocated `struct TN_Slab`.
+ * @param pools         array of pointers to already created pools, sorted
+ *                      by block size
+ * @param classes_cnt   number of items in the `pools` array, from 1 to
+ *                      `#TN_SLAB_CLASSES_MAX`
+ * @param attr          attributes of the slab, see `enum #TN_SlabAttr`
+ *
+ * @return
+ *    * `#TN_RC_OK` if slab was successfully created;
+ *    * `#TN_RC_WPARAM` if wrong params were given (say, the pools aren't
+ *      sorted, or some pool isn't created).
+ */
+enum TN_RCode tn_slab_create(
+      struct TN_Slab         *slab,
+      struct TN_FMem *const  *pools,
+      int                     classes_cnt,
+      enum TN_SlabAttr        attr
+      );
+
+/**
+ * Destruct slab. The pools aren't affected: the application may go on
+ * using them directly, or delete them.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param slab       pointer to slab to be deleted
+ *
+ * @return
+ *    * `#TN_RC_OK` if slab is successfully deleted;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_slab_delete(struct TN_Slab *slab);
+
+/**
+ * Allocate the block of at least `size` bytes: it is taken from the
+ * smallest class which is large enough and has free blocks (see the top of
+ * this file for details).
+ *
+ * If there are no free blocks, behavior depends on `timeout` value: the
+ * task waits for the block of the smallest class which is large enough,
+ * like `tn_fmem_get()` does.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param slab
+ *    Pointer to slab
+ * @param size
+ *    Size of the block in bytes
+ * @param p_data
+ *    Address of the `(void *)` to which allocated block address will be
+ *    saved
+ * @param timeout
+ *    Refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK` if block was successfully returned through `p_data`;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * `#TN_RC_WPARAM` if `size` is 0, or it is larger than the block size
+ *      of the largest class;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_slab_alloc(
+      struct TN_Slab *slab,
+      unsigned int size,
+      void **p_data,
+      TN_TickCnt timeout
+      );
+
+/**
+ * The same as `tn_slab_alloc()` with zero timeout
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_slab_alloc_polling(
+      struct TN_Slab *slab,
+      unsigned int size,
+      void **p_data
+      );
+
+/**
+ * The same as `tn_slab_alloc()` with zero timeout, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_slab_ialloc_polling(
+      struct TN_Slab *slab,
+      unsigned int size,
+      void **p_data
+      );
+
+/**
+ * Return the block back to the pool which it belongs to. The pool is found
+ * by the block address. If there are tasks waiting for the block of that
+ * pool, the block is given to the first of them, just like with
+ * `tn_fmem_release()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param slab
+ *    Pointer to slab.
+ * @param p_data
+ *    Address of the block to free.
+ *
+ * @return
+ *    * `#TN_RC_OK` on success
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * `#TN_RC_WPARAM` if `p_data` doesn't belong to any of the pools (and,
+ *      if `#TN_CHECK_PARAM` is non-zero, if it isn't the address of the
+ *      block);
+ *    * `#TN_RC_OVERFLOW` if the pool already has all its blocks free (which
+ *      means that the block is freed twice);
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_slab_free(struct TN_Slab *slab, void *p_data);
+
+/**
+ * The same as `tn_slab_free()`, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_slab_ifree(struct TN_Slab *slab, void *p_data);
+
+/**
+ * Get statistics of the slab, see `struct #TN_SlabStat`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param slab
+ *    Pointer to slab.
+ * @param p_stat
+ *    Pointer to the structure to fill.
+ *
+ * @return
+ *    * `#TN_RC_OK` on success
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_slab_stat_get(
+      struct TN_Slab *slab,
+      struct TN_SlabStat *p_stat
+      );
+
+/**
+ * Get statistics of the size class, see `struct #TN_SlabClassStat`. Number
+ * of free blocks is got by `tn_fmem_free_blocks_cnt_get()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param slab
+ *    Pointer to slab.
+ * @param class_idx
+ *    Index of the class, i.e. index in the `pools` array given to
+ *    `tn_slab_create()`
+ * @param p_stat
+ *    Pointer to the structure to fill.
+ *
+ * @return
+ *    * `#TN_RC_OK` on success
+ *    * `#TN_RC_WPARAM` if `class_idx` is out of range;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_slab_class_stat_get(
+      struct TN_Slab *slab,
+      int class_idx,
+      struct TN_SlabClassStat *p_stat
+      );
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_SLAB_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
@@ -0,0 +1,1146 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "tn_common.h"
+#include "tn_sys.h"
+
+//-- internal tnkernel headers
+#include "_tn_tasks.h"
+#include "_tn_list.h"
+
+
+#include "tn_stream.h"
+#include "_tn_stream.h"
+
+#include "tn_tasks.h"
+
+
+
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/**
+ * Type of job: write bytes or read bytes. Given to `_stream_job_perform()`,
+ * `_stream_job_iperform()`, `_stream_commit_perform()` and
+ * `_stream_commit_iperform()`.
+ */
+enum _JobType {
+   _JOB_TYPE__WRITE,
+   _JOB_TYPE__READ,
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+//-- Additional param checking {{{
+#if TN_CHECK_PARAM
+_TN_STATIC_INLINE enum TN_RCode _check_param_generic(
+      const struct TN_StreamBuf *stream
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (stream == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (!_tn_stream_is_valid(stream)){
+      rc = TN_RC_INVALID_OBJ;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_create(
+      const struct TN_StreamBuf *stream,
+      void *buf,
+      unsigned int size,
+      unsigned int trigger_level
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (stream == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else if (   buf == TN_NULL
+              || size == 0
+              || trigger_level == 0
+              || trigger_level > size
+              || _tn_stream_is_valid(stream)
+             )
+   {
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_trigger_level(
+      const struct TN_StreamBuf *stream,
+      unsigned int trigger_level
+      )
+{
+   enum TN_RCode rc = _check_param_generic(stream);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (trigger_level == 0 || trigger_level > stream->size){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_job_perform(
+      const struct TN_StreamBuf *stream,
+      const void *p_data,
+      unsigned int size
+      )
+{
+   enum TN_RCode rc = _check_param_generic(stream);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (p_data == TN_NULL || size == 0){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+_TN_STATIC_INLINE enum TN_RCode _check_param_region_get(
+      const struct TN_StreamBuf *stream,
+      const void *pp_region,
+      const unsigned int *p_size
+      )
+{
+   enum TN_RCode rc = _check_param_generic(stream);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (pp_region == TN_NULL || p_size == TN_NULL){
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+
+#else
+#  define _check_param_generic(stream)                                  \
+                                                            (TN_RC_OK)
+#  define _check_param_create(stream, buf, size, trigger_level)         \
+                                                            (TN_RC_OK)
+#  define _check_param_trigger_level(stream, trigger_level)             \
+                                                            (TN_RC_OK)
+#  define _check_param_job_perform(stream, p_data, size)                \
+                                                            (TN_RC_OK)
+#  define _check_param_region_get(stream, pp_region, p_size)            \
+                                                            (TN_RC_OK)
+#endif
+// }}}
+
+//-- Stream buffer storage FIFO processing {{{
+
+/**
+ * Returns size of the contiguous region of free bytes, starting from
+ * `head_idx`.
+ */
+static unsigned int _free_region_size(const struct TN_StreamBuf *stream)
+{
+   unsigned int ret = stream->size - stream->filled_size;
+
+   if (ret > stream->size - stream->head_idx){
+      ret = stream->size - stream->head_idx;
+   }
+
+   return ret;
+}
+
+/**
+ * Returns size of the contiguous region of filled bytes, starting from
+ * `tail_idx`.
+ */
+static unsigned int _filled_region_size(const struct TN_StreamBuf *stream)
+{
+   unsigned int ret = stream->filled_size;
+
+   if (ret > stream->size - stream->tail_idx){
+      ret = stream->size - stream->tail_idx;
+   }
+
+   return ret;
+}
+
+/**
+ * Mark `size` bytes at `head_idx` as filled. Caller is responsible for
+ * checking that there is enough room.
+ */
+static void _head_advance(struct TN_StreamBuf *stream, unsigned int size)
+{
+   stream->head_idx += size;
+   if (stream->head_idx >= stream->size){
+      stream->head_idx -= stream->size;
+   }
+   stream->filled_size += size;
+}
+
+/**
+ * Mark `size` bytes at `tail_idx` as free. Caller is responsible for
+ * checking that there are enough filled bytes.
+ */
+static void _tail_advance(struct TN_StreamBuf *stream, unsigned int size)
+{
+   stream->tail_idx += size;
+   if (stream->tail_idx >= stream->size){
+      stream->tail_idx -= stream->size;
+   }
+   stream->filled_size -= size;
+}
+
+/**
+ * Copy as many bytes as there is room for (but not more than `size`) from
+ * `p_data` to the FIFO, in up to two chunks.
+ *
+ * @return number of bytes copied
+ */
+static unsigned int _fifo_write(
+      struct TN_StreamBuf *stream,
+      const unsigned char *p_data,
+      unsigned int size
+      )
+{
+   unsigned int first_size;
+
+   if (size > stream->size - stream->filled_size){
+      size = stream->size - stream->filled_size;
+   }
+
+   first_size = _free_region_size(stream);
+   if (first_size > size){
+      first_size = size;
+   }
+
+   memcpy(stream->buf + stream->head_idx, p_data, first_size);
+   _head_advance(stream, first_size);
+
+   //-- if there's something left, head_idx is 0 now
+   memcpy(stream->buf + stream->head_idx, p_data + first_size,
+          size - first_size);
+   _head_advance(stream, size - first_size);
+
+   return size;
+}
+
+/**
+ * Copy as many bytes as there are in the FIFO (but not more than `size`)
+ * from the FIFO to `p_data`, in up to two chunks.
+ *
+ * @return number of bytes copied
+ */
+static unsigned int _fifo_read(
+      struct TN_StreamBuf *stream,
+      unsigned char *p_data,
+      unsigned int size
+      )
+{
+   unsigned int first_size;
+
+   if (size > stream->filled_size){
+      size = stream->filled_size;
+   }
+
+   first_size = _filled_region_size(stream);
+   if (first_size > size){
+      first_size = size;
+   }
+
+   memcpy(p_data, stream->buf + stream->tail_idx, first_size);
+   _tail_advance(stream, first_size);
+
+   //-- if there's something left, tail_idx is 0 now
+   memcpy(p_data + first_size, stream->buf + stream->tail_idx,
+          size - first_size);
+   _tail_advance(stream, size - first_size);
+
+   return size;
+}
+// }}}
+
+/**
+ * Returns number of bytes that should be available for the reader which
+ * wants to read `size` bytes
+ */
+_TN_STATIC_INLINE unsigned int _reader_level(
+      const struct TN_StreamBuf *stream,
+      unsigned int size
+      )
+{
+   return (size < stream->trigger_level) ? size : stream->trigger_level;
+}
+
+/**
+ * Callback function that is given to `_tn_task_first_wait_complete()`
+ * when enough bytes are available for the waiting reader.
+ *
+ * See `#_TN_CBBeforeTaskWaitComplete` for details on function signature.
+ */
+static void _cb_before_task_wait_complete__receive(
+      struct TN_Task   *task,
+      void             *user_data_1,
+      void             *user_data_2
+      )
+{
+   struct TN_StreamBuf *stream = (struct TN_StreamBuf *)user_data_1;
+   struct TN_StreamTaskWait *p_wait = &task->subsys_wait.stream;
+
+   //-- before task is woken up, copy the bytes right to its buffer
+   p_wait->done_size = _fifo_read(
+         stream, (unsigned char *)p_wait->p_data, p_wait->size
+         );
+
+   _TN_UNUSED(user_data_2);
+}
+
+/**
+ * Wake up waiting readers, one by one, while there are enough bytes for the
+ * first of them.
+ *
+ * @return `#TN_TRUE` if at least one reader was woken up (so that some room
+ *         appeared in the FIFO)
+ */
+static TN_BOOL _readers_feed(struct TN_StreamBuf *stream)
+{
+   TN_BOOL ret = TN_FALSE;
+   struct TN_Task *task;
+
+   while (!_tn_list_is_empty(&stream->wait_receive_list)){
+      task = _tn_list_first_entry(
+            &stream->wait_receive_list, struct TN_Task, task_queue
+            );
+
+      if (stream->filled_size < _reader_level(
+               stream, task->subsys_wait.stream.size
+               )
+         )
+      {
+         //-- not enough bytes for the first reader yet
+         break;
+      }
+
+      _tn_task_first_wait_complete(
+            &stream->wait_receive_list, TN_RC_OK,
+            _cb_before_task_wait_complete__receive, stream, TN_NULL
+            );
+      ret = TN_TRUE;
+   }
+
+   return ret;
+}
+
+/**
+ * Copy the remaining bytes of waiting writers to the FIFO, while there is
+ * room for them. Writer is woken up when all its bytes are written.
+ *
+ * @return `#TN_TRUE` if some bytes were written
+ */
+static TN_BOOL _writers_feed(struct TN_StreamBuf *stream)
+{
+   TN_BOOL ret = TN_FALSE;
+   struct TN_Task *task;
+   struct TN_StreamTaskWait *p_wait;
+
+   while (
+            stream->filled_size < stream->size
+         && !_tn_list_is_empty(&stream->wait_send_list)
+         )
+   {
+      task = _tn_list_first_entry(
+            &stream->wait_send_list, struct TN_Task, task_queue
+            );
+      p_wait = &task->subsys_wait.stream;
+
+      p_wait->done_size += _fifo_write(
+            stream,
+            (const unsigned char *)p_wait->p_data + p_wait->done_size,
+            p_wait->size - p_wait->done_size
+            );
+      ret = TN_TRUE;
+
+      if (p_wait->done_size == p_wait->size){
+         //-- all the bytes of this writer are written
+         _tn_task_wait_complete(task, TN_RC_OK);
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * Serve waiting tasks after the FIFO has changed: wake up readers for which
+ * there are enough bytes, and write bytes of waiting writers for which there
+ * is room. Since each of these makes possible the other one, repeat until
+ * nothing happens.
+ */
+static void _waiters_serve(struct TN_StreamBuf *stream)
+{
+   TN_BOOL progress;
+
+   do {
+      progress = _readers_feed(stream);
+      if (_writers_feed(stream)){
+         progress = TN_TRUE;
+      }
+   } while (progress);
+}
+
+/**
+ * Write as many bytes as there is room for (but not more than `size`),
+ * serving waiting readers as bytes become available. If there are
+ * writers waiting already, nothing is written: new writer shouldn't
+ * overtake them.
+ *
+ * @return number of bytes written
+ */
+static unsigned int _stream_write(
+      struct TN_StreamBuf *stream,
+      const unsigned char *p_data,
+      unsigned int size
+      )
+{
+   unsigned int done_size = 0;
+   unsigned int chunk_size;
+
+   if (_tn_list_is_empty(&stream->wait_send_list)){
+      while (done_size < size){
+         chunk_size = _fifo_write(
+               stream, p_data + done_size, size - done_size
+               );
+         if (chunk_size == 0){
+            //-- FIFO is full, and nobody is going to read from it
+            break;
+         }
+         done_size += chunk_size;
+
+         //-- readers might take some bytes, so there might be room for
+         //   the rest of our bytes
+         _waiters_serve(stream);
+      }
+   }
+
+   return done_size;
+}
+
+/**
+ * Read as many bytes as there are in the FIFO (but not more than `size`),
+ * and feed waiting writers.
+ *
+ * @return number of bytes read
+ */
+static unsigned int _stream_read(
+      struct TN_StreamBuf *stream,
+      unsigned char *p_data,
+      unsigned int size
+      )
+{
+   unsigned int done_size = _fifo_read(stream, p_data, size);
+
+   if (done_size > 0){
+      _waiters_serve(stream);
+   }
+
+   return done_size;
+}
+
+/**
+ * Store `done_size` to the location pointed to by `p_done_size`, if it is
+ * not `#TN_NULL`.
+ */
+_TN_STATIC_INLINE void _done_size_store(
+      unsigned int *p_done_size,
+      unsigned int done_size
+      )
+{
+   if (p_done_size != TN_NULL){
+      *p_done_size = done_size;
+   }
+}
+
+
+/**
+ * Intermediary function that is called by stream buffer services
+ * (`tn_stream_write()`, `tn_stream_read()`, etc), which performs all
+ * necessary housekeeping and eventually calls actual worker function
+ * depending on given `job_type`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream
+ *    Stream buffer on which job should be performed.
+ * @param job_type
+ *    Type of job to perform, depending on it, appropriate worker function
+ *    will be called (`_stream_write()` or `_stream_read()`).
+ * @param p_data
+ *    Bytes to write, or buffer to read bytes to.
+ * @param size
+ *    Number of bytes to write, or size of buffer to read bytes to.
+ * @param p_done_size
+ *    Location to store number of bytes written or read, may be `#TN_NULL`.
+ * @param timeout
+ *    Refer to `#TN_TickCnt`.
+ */
+static enum TN_RCode _stream_job_perform(
+      struct TN_StreamBuf *stream,
+      enum _JobType job_type,
+      void *p_data,
+      unsigned int size,
+      unsigned int *p_done_size,
+      TN_TickCnt timeout
+      )
+{
+   TN_BOOL waited = TN_FALSE;
+   unsigned int done_size = 0;
+   enum TN_RCode rc = _check_param_job_perform(stream, p_data, size);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      switch (job_type){
+
+         case _JOB_TYPE__WRITE:
+            done_size = _stream_write(stream, p_data, size);
+            rc = (done_size == size) ? TN_RC_OK : TN_RC_TIMEOUT;
+
+            if (rc == TN_RC_TIMEOUT && timeout != 0){
+               //-- There's no room for the rest of bytes right now, and
+               //   user asked to wait if that happens.
+               //
+               //   Save the bytes in the `stream` task field, so that they
+               //   are copied to the FIFO as soon as there is room, and put
+               //   current task to wait until all of them are written.
+               _tn_curr_run_task->subsys_wait.stream.p_data = p_data;
+               _tn_curr_run_task->subsys_wait.stream.size = size;
+               _tn_curr_run_task->subsys_wait.stream.done_size = done_size;
+               _tn_task_curr_to_wait_action(
+                     &(stream->wait_send_list),
+                     TN_WAIT_REASON_STREAM_WSEND,
+                     timeout
+                     );
+
+               waited = TN_TRUE;
+            }
+            break;
+
+         case _JOB_TYPE__READ:
+            if (
+                     timeout == 0
+                  || stream->filled_size >= _reader_level(stream, size)
+               )
+            {
+               done_size = _stream_read(stream, p_data, size);
+               rc = (done_size > 0) ? TN_RC_OK : TN_RC_TIMEOUT;
+            } else {
+               //-- There are not enough bytes in the FIFO, and user asked
+               //   to wait if that happens.
+               //
+               //   Save pointer to the buffer in the `stream` task field, so
+               //   that the writer copies bytes right there, and put
+               //   current task to wait until enough bytes come.
+               _tn_curr_run_task->subsys_wait.stream.p_data = p_data;
+               _tn_curr_run_task->subsys_wait.stream.size = size;
+               _tn_curr_run_task->subsys_wait.stream.done_size = 0;
+               _tn_task_curr_to_wait_action(
+                     &(stream->wait_receive_list),
+                     TN_WAIT_REASON_STREAM_WRECEIVE,
+                     timeout
+                     );
+
+               waited = TN_TRUE;
+            }
+            break;
+      }
+
+#if TN_DEBUG
+      if (!_tn_need_context_switch() && waited){
+         _TN_FATAL_ERROR("");
+      }
+#endif
+
+      TN_INT_RESTORE();
+      _tn_context_switch_pend_if_needed();
+      if (waited){
+         //-- get wait result and number of bytes which were written or read
+         //   while we were waiting
+         rc = _tn_curr_run_task->task_wait_rc;
+         done_size = _tn_curr_run_task->subsys_wait.stream.done_size;
+
+         if (job_type == _JOB_TYPE__READ && rc == TN_RC_TIMEOUT){
+            //-- there weren't enough bytes for the trigger level: read
+            //   whatever is available
+            TN_INT_DIS_SAVE();
+            if (_tn_stream_is_valid(stream)){
+               done_size = _stream_read(stream, p_data, size);
+            }
+            TN_INT_RESTORE();
+            _tn_context_switch_pend_if_needed();
+
+            rc = (done_size > 0) ? TN_RC_OK : TN_RC_TIMEOUT;
+         }
+      }
+
+      _done_size_store(p_done_size, done_size);
+   }
+
+   return rc;
+}
+
+/**
+ * The same as `_stream_job_perform()` with zero timeout, but for using in
+ * the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+static enum TN_RCode _stream_job_iperform(
+      struct TN_StreamBuf *stream,
+      enum _JobType job_type,
+      void *p_data,
+      unsigned int size,
+      unsigned int *p_done_size
+      )
+{
+   unsigned int done_size = 0;
+   enum TN_RCode rc = _check_param_job_perform(stream, p_data, size);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      //-- wrong context
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      //-- depending on the job type, call appropriate function. We can't
+      //   wait in interrupt, so, just return the result to the caller.
+      switch (job_type){
+
+         case _JOB_TYPE__WRITE:
+            done_size = _stream_write(stream, p_data, size);
+            rc = (done_size == size) ? TN_RC_OK : TN_RC_TIMEOUT;
+            break;
+
+         case _JOB_TYPE__READ:
+            done_size = _stream_read(stream, p_data, size);
+            rc = (done_size > 0) ? TN_RC_OK : TN_RC_TIMEOUT;
+            break;
+      }
+
+      TN_INT_IRESTORE();
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+
+      _done_size_store(p_done_size, done_size);
+   }
+
+   return rc;
+}
+
+/**
+ * Actual worker function for `tn_stream_write_commit()`,
+ * `tn_stream_read_commit()` and their ISR forms: mark `size` bytes of the
+ * region as filled or free, respectively, and serve waiting tasks. Should
+ * be called with interrupts disabled.
+ */
+static enum TN_RCode _stream_commit(
+      struct TN_StreamBuf *stream,
+      enum _JobType job_type,
+      unsigned int size
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   switch (job_type){
+
+      case _JOB_TYPE__WRITE:
+         if (size > _free_region_size(stream)){
+            rc = TN_RC_OVERFLOW;
+         } else {
+            _head_advance(stream, size);
+         }
+         break;
+
+      case _JOB_TYPE__READ:
+         if (size > _filled_region_size(stream)){
+            rc = TN_RC_OVERFLOW;
+         } else {
+            _tail_advance(stream, size);
+         }
+         break;
+   }
+
+   if (rc == TN_RC_OK && size > 0){
+      _waiters_serve(stream);
+   }
+
+   return rc;
+}
+
+/**
+ * Intermediary function for `tn_stream_write_commit()` and
+ * `tn_stream_read_commit()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+static enum TN_RCode _stream_commit_perform(
+      struct TN_StreamBuf *stream,
+      enum _JobType job_type,
+      unsigned int size
+      )
+{
+   enum TN_RCode rc = _check_param_generic(stream);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+      rc = _stream_commit(stream, job_type, size);
+      TN_INT_RESTORE();
+
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+/**
+ * The same as `_stream_commit_perform()`, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+static enum TN_RCode _stream_commit_iperform(
+      struct TN_StreamBuf *stream,
+      enum _JobType job_type,
+      unsigned int size
+      )
+{
+   enum TN_RCode rc = _check_param_generic(stream);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+      rc = _stream_commit(stream, job_type, size);
+      TN_INT_IRESTORE();
+
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+   }
+
+   return rc;
+}
+
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_create(
+      struct TN_StreamBuf  *stream,
+      void                 *buf,
+      unsigned int          size,
+      unsigned int          trigger_level
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   rc = _check_param_create(stream, buf, size, trigger_level);
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else {
+      _tn_list_reset(&(stream->wait_send_list));
+      _tn_list_reset(&(stream->wait_receive_list));
+
+      stream->buf             = (unsigned char *)buf;
+      stream->size            = size;
+      stream->trigger_level   = trigger_level;
+
+      stream->filled_size     = 0;
+      stream->tail_idx        = 0;
+      stream->head_idx        = 0;
+
+      stream->id_stream = TN_ID_STREAMBUF;
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_delete(struct TN_StreamBuf *stream)
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   rc = _check_param_generic(stream);
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      //-- notify waiting tasks that the object is deleted
+      //   (TN_RC_DELETED is returned)
+      _tn_wait_queue_notify_deleted(&(stream->wait_send_list));
+      _tn_wait_queue_notify_deleted(&(stream->wait_receive_list));
+
+      stream->id_stream = TN_ID_NONE; //-- stream buffer does not exist now
+
+      TN_INT_RESTORE();
+
+      //-- we might need to switch context if _tn_wait_queue_notify_deleted()
+      //   has woken up some high-priority task
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_trigger_level_set(
+      struct TN_StreamBuf  *stream,
+      unsigned int          trigger_level
+      )
+{
+   enum TN_RCode rc = _check_param_trigger_level(stream, trigger_level);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      stream->trigger_level = trigger_level;
+
+      //-- if the level is lowered, there might be enough bytes for
+      //   waiting readers now
+      _waiters_serve(stream);
+
+      TN_INT_RESTORE();
+      _tn_context_switch_pend_if_needed();
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_write(
+      struct TN_StreamBuf  *stream,
+      const void           *p_data,
+      unsigned int          size,
+      unsigned int         *p_written_size,
+      TN_TickCnt            timeout
+      )
+{
+   return _stream_job_perform(
+         stream, _JOB_TYPE__WRITE, (void *)p_data, size, p_written_size,
+         timeout
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_write_polling(
+      struct TN_StreamBuf  *stream,
+      const void           *p_data,
+      unsigned int          size,
+      unsigned int         *p_written_size
+      )
+{
+   return _stream_job_perform(
+         stream, _JOB_TYPE__WRITE, (void *)p_data, size, p_written_size, 0
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_iwrite_polling(
+      struct TN_StreamBuf  *stream,
+      const void           *p_data,
+      unsigned int          size,
+      unsigned int         *p_written_size
+      )
+{
+   return _stream_job_iperform(
+         stream, _JOB_TYPE__WRITE, (void *)p_data, size, p_written_size
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_read(
+      struct TN_StreamBuf  *stream,
+      void                 *p_data,
+      unsigned int          size,
+      unsigned int         *p_read_size,
+      TN_TickCnt            timeout
+      )
+{
+   return _stream_job_perform(
+         stream, _JOB_TYPE__READ, p_data, size, p_read_size, timeout
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_read_polling(
+      struct TN_StreamBuf  *stream,
+      void                 *p_data,
+      unsigned int          size,
+      unsigned int         *p_read_size
+      )
+{
+   return _stream_job_perform(
+         stream, _JOB_TYPE__READ, p_data, size, p_read_size, 0
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_iread_polling(
+      struct TN_StreamBuf  *stream,
+      void                 *p_data,
+      unsigned int          size,
+      unsigned int         *p_read_size
+      )
+{
+   return _stream_job_iperform(
+         stream, _JOB_TYPE__READ, p_data, size, p_read_size
+         );
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_write_region_get(
+      struct TN_StreamBuf  *stream,
+      void                **pp_region,
+      unsigned int         *p_size
+      )
+{
+   TN_INTSAVE_DATA;
+   enum TN_RCode rc = _check_param_region_get(stream, pp_region, p_size);
+
+   if (rc == TN_RC_OK){
+      TN_INT_DIS_SAVE();
+      *pp_region = stream->buf + stream->head_idx;
+      *p_size = _free_region_size(stream);
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_write_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      )
+{
+   return _stream_commit_perform(stream, _JOB_TYPE__WRITE, size);
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_iwrite_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      )
+{
+   return _stream_commit_iperform(stream, _JOB_TYPE__WRITE, size);
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_read_region_get(
+      struct TN_StreamBuf  *stream,
+      const void          **pp_region,
+      unsigned int         *p_size
+      )
+{
+   TN_INTSAVE_DATA;
+   enum TN_RCode rc = _check_param_region_get(stream, pp_region, p_size);
+
+   if (rc == TN_RC_OK){
+      TN_INT_DIS_SAVE();
+      *pp_region = stream->buf + stream->tail_idx;
+      *p_size = _filled_region_size(stream);
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_read_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      )
+{
+   return _stream_commit_perform(stream, _JOB_TYPE__READ, size);
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+enum TN_RCode tn_stream_iread_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      )
+{
+   return _stream_commit_iperform(stream, _JOB_TYPE__READ, size);
+}
+
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+int tn_stream_free_size_get(
+      struct TN_StreamBuf  *stream
+      )
+{
+   int ret = -1;
+   enum TN_RCode rc = _check_param_generic(stream);
+
+   if (rc == TN_RC_OK){
+      //-- It's not needed to disable interrupts here, since `filled_size`
+      //   is read by just one assembler instruction, and `size` never
+      //   changes.
+      ret = (int)(stream->size - stream->filled_size);
+   }
+
+   return ret;
+}
+
+/*
+ * See comments in the header file (tn_stream.h)
+ */
+int tn_stream_used_size_get(
+      struct TN_StreamBuf  *stream
+      )
+{
+   int ret = -1;
+   enum TN_RCode rc = _check_param_generic(stream);
+
+   if (rc == TN_RC_OK){
+      //-- It's not needed to disable interrupts here, since `filled_size`
+      //   is read by just one assembler instruction.
+      ret = (int)stream->filled_size;
+   }
+
+   return ret;
+}
+
+
@@ -0,0 +1,594 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+/**
+ * \file
+ *
+ * A stream buffer is a FIFO of bytes: writers append byte spans of
+ * arbitrary length, and readers take as many bytes as they need. It is
+ * intended for byte-oriented data such as UART or USB CDC streams, where
+ * packing bytes into \ref tn_fmem.h "memory blocks" and sending pointers
+ * through the \ref tn_dqueue.h "data queue" is an overkill.
+ *
+ * Stream buffer has a <i>trigger level</i>: a reader waits until at least
+ * that many bytes are available (or until the timeout expires), so that
+ * the reader isn't woken up for every single byte. If the reader asks for
+ * less bytes than the trigger level, it waits for the requested number of
+ * bytes instead.
+ *
+ * Just like with \ref tn_msgq.h "message queue", if the reader waits and
+ * the writer makes enough bytes available, the bytes are copied right to
+ * the reader's buffer before the reader is woken up; if the writer waits
+ * for the room, its remaining bytes are copied to the stream buffer as
+ * soon as readers free some room, and the writer is woken up when all of
+ * its bytes are written. So, each byte is copied exactly twice, and it
+ * takes one kernel call to write the span and one call to read it.
+ *
+ * For zero-copy operation (say, when the peripheral is fed by DMA), there
+ * are services that give contiguous region of free or filled bytes of the
+ * buffer, and commit the number of bytes actually written or read:
+ *
+ * - `tn_stream_write_region_get()`, `tn_stream_write_commit()`,
+ *   `tn_stream_iwrite_commit()`;
+ * - `tn_stream_read_region_get()`, `tn_stream_read_commit()`,
+ *   `tn_stream_iread_commit()`.
+ *
+ * While the region is being written (or read) by the DMA, nobody else
+ * should write to (or, respectively, read from) the stream buffer; and
+ * the tasks waiting to write are fed only when readers free some room,
+ * so, it's not a good idea to mix regular writers with the DMA writer
+ * (the same is true for readers).
+ *
+ */
+
+#ifndef _TN_STREAM_H
+#define _TN_STREAM_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_list.h"
+#include "tn_common.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {  /*}*/
+#endif
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Structure representing stream buffer object
+ */
+struct TN_StreamBuf {
+   ///
+   /// id for object validity verification.
+   /// This field is in the beginning of the structure to make it easier
+   /// to detect memory corruption.
+   enum TN_ObjId id_stream;
+   ///
+   /// list of tasks waiting for room to write bytes
+   struct TN_ListItem  wait_send_list;
+   ///
+   /// list of tasks waiting for bytes to read
+   struct TN_ListItem  wait_receive_list;
+
+   ///
+   /// buffer to store bytes
+   unsigned char *buf;
+   ///
+   /// capacity of the buffer, in bytes
+   unsigned int   size;
+   ///
+   /// count of bytes in `buf`
+   unsigned int   filled_size;
+   ///
+   /// index of the byte which will be written next time
+   unsigned int   head_idx;
+   ///
+   /// index of the byte which will be read next time
+   unsigned int   tail_idx;
+   ///
+   /// number of bytes that should be available for the waiting reader to
+   /// be woken up
+   unsigned int   trigger_level;
+};
+
+/**
+ * Stream buffer-specific fields related to waiting task,
+ * to be included in struct TN_Task.
+ */
+struct TN_StreamTaskWait {
+   ///
+   /// if task waits for room to write bytes, pointer to the bytes to write;
+   /// if task waits for bytes to read, pointer to the buffer for them.
+   void          *p_data;
+   ///
+   /// number of bytes to write, or size of the buffer to read bytes to
+   unsigned int   size;
+   ///
+   /// number of bytes written from `p_data` (or read to `p_data`) while the
+   /// task was waiting
+   unsigned int   done_size;
+};
+
+
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Construct stream buffer. `id_stream` member should not contain
+ * `#TN_ID_STREAMBUF`, otherwise, `#TN_RC_WPARAM` is returned.
+ *
+ * Typical definition looks as follows:
+ *
+ * \code{.c}
+ *     //-- size of the stream buffer, in bytes
+ *     #define MY_STREAM_SIZE        128
+ *
+ *     //-- define buffer for bytes
+ *     unsigned char my_stream_buf[ MY_STREAM_SIZE ];
+ *
+ *     //-- define stream buffer structure
+ *     struct TN_StreamBuf my_stream;
+ * \endcode
+ *
+ * And then, construct your `my_stream` as follows (readers are woken up
+ * when there are at least 16 bytes):
+ *
+ * \code{.c}
+ *     enum TN_RCode rc;
+ *     rc = tn_stream_create(&my_stream, my_stream_buf, MY_STREAM_SIZE, 16);
+ *     if (rc != TN_RC_OK){
+ *        //-- handle error
+ *     }
+ * \endcode
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream        pointer to already allocated `struct #TN_StreamBuf`.
+ * @param buf           pointer to already allocated buffer of `size` bytes.
+ * @param size          capacity of the buffer, in bytes. Should be more
+ *                      than 0.
+ * @param trigger_level number of bytes that should be available for the
+ *                      waiting reader to be woken up; should be from 1 to
+ *                      `size`. Can be changed later by
+ *                      `tn_stream_trigger_level_set()`.
+ *
+ * @return
+ *    * `#TN_RC_OK` if stream buffer was successfully created;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
+ *      is available: `#TN_RC_WPARAM`.
+ */
+enum TN_RCode tn_stream_create(
+      struct TN_StreamBuf  *stream,
+      void                 *buf,
+      unsigned int          size,
+      unsigned int          trigger_level
+      );
+
+
+/**
+ * Destruct stream buffer.
+ *
+ * All tasks that wait for writing to or reading from the stream buffer
+ * become runnable with `#TN_RC_DELETED` code returned.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream     pointer to stream buffer to be deleted
+ *
+ * @return
+ *    * `#TN_RC_OK` if stream buffer was successfully deleted;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_stream_delete(struct TN_StreamBuf *stream);
+
+
+/**
+ * Set new trigger level: number of bytes that should be available for the
+ * waiting reader to be woken up. If the new level is lower than the
+ * previous one, waiting reader might be woken up immediately.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream        pointer to stream buffer
+ * @param trigger_level new trigger level, from 1 to the size of the buffer
+ *
+ * @return
+ *    * `#TN_RC_OK` if trigger level was successfully set;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_stream_trigger_level_set(
+      struct TN_StreamBuf  *stream,
+      unsigned int          trigger_level
+      );
+
+
+/**
+ * Write `size` bytes pointed to by `p_data` to the stream buffer.
+ *
+ * Bytes are appended to the stream buffer; if there are readers waiting,
+ * and enough bytes become available, they are copied to the buffer of the
+ * first waiting reader, and it is woken up.
+ *
+ * If there is no room for all the bytes, behavior depends on the `timeout`
+ * value: refer to `#TN_TickCnt`. While the task waits, the remaining bytes
+ * are copied to the stream buffer as soon as there is room for them, so
+ * the memory pointed to by `p_data` must not be changed by anyone. Note that
+ * `timeout` is for the whole span, not for each byte.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream           pointer to stream buffer to write bytes to
+ * @param p_data           bytes to write
+ * @param size             number of bytes to write, should be more than 0
+ * @param p_written_size   location to store number of bytes actually
+ *                         written: all of them if `#TN_RC_OK` is returned,
+ *                         and possibly less otherwise. Can be `#TN_NULL`.
+ * @param timeout          refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK`   if all the bytes were written;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_stream_write(
+      struct TN_StreamBuf  *stream,
+      const void           *p_data,
+      unsigned int          size,
+      unsigned int         *p_written_size,
+      TN_TickCnt            timeout
+      );
+
+/**
+ * The same as `tn_stream_write()` with zero timeout: as many bytes are
+ * written as there is room for.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_stream_write_polling(
+      struct TN_StreamBuf  *stream,
+      const void           *p_data,
+      unsigned int          size,
+      unsigned int         *p_written_size
+      );
+
+/**
+ * The same as `tn_stream_write()` with zero timeout, but for using in the
+ * ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_stream_iwrite_polling(
+      struct TN_StreamBuf  *stream,
+      const void           *p_data,
+      unsigned int          size,
+      unsigned int         *p_written_size
+      );
+
+/**
+ * Read up to `size` bytes from the stream buffer to the buffer pointed to
+ * by `p_data`.
+ *
+ * If there are at least as many bytes as the trigger level (or as `size`,
+ * if it is less than the trigger level), the bytes are read immediately.
+ * Otherwise, behavior depends on the `timeout` value: refer to
+ * `#TN_TickCnt`. While the task waits, the bytes are copied right to
+ * `p_data` as soon as enough of them are written. If the timeout expires,
+ * whatever is available is read.
+ *
+ * If the bytes are read, tasks waiting for room to write are fed.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream        pointer to stream buffer to read bytes from
+ * @param p_data        buffer of `size` bytes to store the bytes
+ * @param size          max number of bytes to read, should be more than 0
+ * @param p_read_size   location to store number of bytes actually read.
+ *                      Can be `#TN_NULL`.
+ * @param timeout       refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK`   if at least one byte was read;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_stream_read(
+      struct TN_StreamBuf  *stream,
+      void                 *p_data,
+      unsigned int          size,
+      unsigned int         *p_read_size,
+      TN_TickCnt            timeout
+      );
+
+/**
+ * The same as `tn_stream_read()` with zero timeout: whatever is available
+ * (up to `size` bytes) is read, regardless of the trigger level.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_stream_read_polling(
+      struct TN_StreamBuf  *stream,
+      void                 *p_data,
+      unsigned int          size,
+      unsigned int         *p_read_size
+      );
+
+/**
+ * The same as `tn_stream_read()` with zero timeout, but for using in the
+ * ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_stream_iread_polling(
+      struct TN_StreamBuf  *stream,
+      void                 *p_data,
+      unsigned int          size,
+      unsigned int         *p_read_size
+      );
+
+
+/**
+ * Get the contiguous region of free bytes of the stream buffer, for
+ * zero-copy writing (say, by DMA). When the bytes are written to the
+ * region, call `tn_stream_write_commit()` or `tn_stream_iwrite_commit()`.
+ *
+ * The region ends either where filled bytes begin, or at the end of the
+ * buffer (then, after commit, the next region starts at the beginning of
+ * the buffer). The region may be empty, if the buffer is full.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream        pointer to stream buffer
+ * @param pp_region     location to store pointer to the region
+ * @param p_size        location to store size of the region, in bytes
+ *
+ * @return
+ *    * `#TN_RC_OK` if region was successfully returned;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_stream_write_region_get(
+      struct TN_StreamBuf  *stream,
+      void                **pp_region,
+      unsigned int         *p_size
+      );
+
+/**
+ * Commit `size` bytes written to the region returned by
+ * `tn_stream_write_region_get()`: they become available to readers, and
+ * the waiting reader is woken up if there are enough bytes now.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream        pointer to stream buffer
+ * @param size          number of bytes written, can't be more than the size
+ *                      of the region
+ *
+ * @return
+ *    * `#TN_RC_OK` if bytes were successfully committed;
+ *    * `#TN_RC_OVERFLOW` if `size` is more than the size of the region;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_stream_write_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      );
+
+/**
+ * The same as `tn_stream_write_commit()`, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_stream_iwrite_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      );
+
+/**
+ * Get the contiguous region of filled bytes of the stream buffer, for
+ * zero-copy reading (say, by DMA). When the bytes are read from the
+ * region, call `tn_stream_read_commit()` or `tn_stream_iread_commit()`.
+ *
+ * The region ends either where free bytes begin, or at the end of the
+ * buffer (then, after commit, the next region starts at the beginning of
+ * the buffer). The region may be empty, if the buffer is empty.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream        pointer to stream buffer
+ * @param pp_region     location to store pointer to the region
+ * @param p_size        location to store size of the region, in bytes
+ *
+ * @return
+ *    * `#TN_RC_OK` if region was successfully returned;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_stream_read_region_get(
+      struct TN_StreamBuf  *stream,
+      const void          **pp_region,
+      unsigned int         *p_size
+      );
+
+/**
+ * Commit `size` bytes read from the region returned by
+ * `tn_stream_read_region_get()`: they are removed from the stream buffer,
+ * and tasks waiting for room to write are fed.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream        pointer to stream buffer
+ * @param size          number of bytes read, can't be more than the size
+ *                      of the region
+ *
+ * @return
+ *    * `#TN_RC_OK` if bytes were successfully committed;
+ *    * `#TN_RC_OVERFLOW` if `size` is more than the size of the region;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_stream_read_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      );
+
+/**
+ * The same as `tn_stream_read_commit()`, but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_stream_iread_commit(
+      struct TN_StreamBuf  *stream,
+      unsigned int          size
+      );
+
+
+/**
+ * Returns number of free bytes in the stream buffer
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream
+ *    Pointer to stream buffer.
+ *
+ * @return
+ *    Number of free bytes in the stream buffer, or -1 if wrong params were
+ *    given (the check is performed if only `#TN_CHECK_PARAM` is non-zero)
+ */
+int tn_stream_free_size_get(
+      struct TN_StreamBuf  *stream
+      );
+
+
+/**
+ * Returns number of used (non-free) bytes in the stream buffer
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param stream
+ *    Pointer to stream buffer.
+ *
+ * @return
+ *    Number of used (non-free) bytes in the stream buffer, or -1 if wrong
+ *    params were given (the check is performed if only `#TN_CHECK_PARAM` is
+ *    non-zero)
+ */
+int tn_stream_used_size_get(
+      struct TN_StreamBuf  *stream
+      );
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_STREAM_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
+
+
@@ -54,6 +54,7 @@
 #include "_tn_timer.h"
 #include "_tn_tasks.h"
 #include "_tn_list.h"
+#include "_tn_trace.h"
 
 
 #include "tn_tasks.h"
@@ -70,8 +71,14 @@
 #endif
 
 //-- check TN_PRIORITIES_CNT
-#if (TN_PRIORITIES_CNT > TN_PRIORITIES_MAX_CNT)
-#  error TN_PRIORITIES_CNT is too large (maximum is TN_PRIORITIES_MAX_CNT)
+#if TN_PRIORITIES_2LEVEL_BMP
+#  if (TN_PRIORITIES_CNT > (TN_PRIORITIES_MAX_CNT * TN_INT_WIDTH))
+#     error TN_PRIORITIES_CNT is too large (maximum is TN_PRIORITIES_MAX_CNT * TN_INT_WIDTH)
+#  endif
+#else
+#  if (TN_PRIORITIES_CNT > TN_PRIORITIES_MAX_CNT)
+#     error TN_PRIORITIES_CNT is too large (maximum is TN_PRIORITIES_MAX_CNT)
+#  endif
 #endif
 
 
@@ -105,9 +112,41 @@ struct TN_Task *_tn_curr_run_task;
 // See comments in the internal/_tn_sys.h file
 volatile unsigned int _tn_ready_to_run_bmp;
 
+#if TN_PRIORITIES_2LEVEL_BMP
+// See comments in the internal/_tn_sys.h file
+volatile unsigned int _tn_ready_to_run_bmp_lvl2[_TN_READY_BMP_GROUPS_CNT];
+#endif
+
 // See comments in the internal/_tn_sys.h file
 struct TN_Task _tn_idle_task;
 
+#if !defined(_TN_FFS)
+
+#if (TN_INT_WIDTH != 32) && (TN_INT_WIDTH != 16)
+#  error generic find-first-set supports TN_INT_WIDTH 16 or 32 only
+#endif
+
+#if (_TN_FFS_GENERIC == _TN_FFS_GENERIC__DEBRUIJN)
+// See comments in the internal/_tn_sys.h file
+const unsigned char _tn_ffs_debruijn_tbl[TN_INT_WIDTH] = {
+#if (TN_INT_WIDTH == 32)
+    1,  2, 29,  3, 30, 15, 25,  4, 31, 23, 21, 16, 26, 18,  5,  9,
+   32, 28, 14, 24, 22, 20, 17,  8, 27, 13, 19,  7, 12,  6, 11, 10,
+#else
+    1,  2,  3,  6,  4, 10,  7, 12, 16,  5,  9, 11, 15,  8, 14, 13,
+#endif
+};
+#elif (_TN_FFS_GENERIC == _TN_FFS_GENERIC__LUT)
+// See comments in the internal/_tn_sys.h file
+const unsigned char _tn_ffs_nibble_tbl[16] = {
+   0, 1, 2, 1, 3, 1, 2, 1, 4, 1, 2, 1, 3, 1, 2, 1,
+};
+#elif (_TN_FFS_GENERIC != _TN_FFS_GENERIC__LOOP)
+#  error wrong _TN_FFS_GENERIC
+#endif
+
+#endif   // !defined(_TN_FFS)
+
 
 
 
@@ -144,6 +183,46 @@ unsigned short _tn_tslice_ticks[TN_PRIORITIES_CNT];
 int _tn_deadlocks_cnt = 0;
 #endif
 
+#if TN_PROFILER_TIMESTAMP
+/// User-provided callback function that returns high-resolution timestamp
+/// for the profiler (see `#TN_PROFILER_TIMESTAMP`)
+TN_CBProfilerTimestampGet *_tn_cb_profiler_timestamp_get = TN_NULL;
+#endif
+
+#if TN_DYNAMIC_TICK
+/// Timer that expires when the time slice of `_tn_tslice_task` is over: in
+/// dynamic tick mode, round-robin is driven by timer, since there are no
+/// periodic ticks. The timer is active if only there is time slice set for
+/// the priority of `_tn_next_task_to_run`, and there are other runnable tasks
+/// with the same priority.
+struct TN_Timer _tn_tslice_timer;
+
+/// Task whose time slice is counted by `_tn_tslice_timer`, or `TN_NULL` if
+/// the timer is inactive.
+struct TN_Task *_tn_tslice_task = TN_NULL;
+#endif
+
+#if TN_TRACE
+// See comments in the internal/_tn_trace.h file
+struct TN_TraceBuf _tn_trace_buf;
+#endif
+
+#if TN_INT_DIS_STAT
+/// List of critical section call sites which were measured at least once
+/// (see `#TN_INT_DIS_STAT`)
+struct TN_IntDisSite *_tn_int_dis_sites = TN_NULL;
+
+/// Call site of the outermost critical section which is being measured
+struct TN_IntDisSite *_tn_int_dis_cur_site = TN_NULL;
+
+/// Timestamp at which the outermost critical section was entered
+unsigned long _tn_int_dis_start_time;
+
+/// Nesting depth of critical sections, or 0 if nothing is being measured
+/// at the moment
+unsigned int _tn_int_dis_depth = 0;
+#endif
+
 
 /*******************************************************************************
  *    PRIVATE DATA
@@ -183,9 +262,67 @@ static void _idle_task_body(void *par)
 #if TN_DYNAMIC_TICK
 
 _TN_STATIC_INLINE void _round_robin_manage(void) {
-   /*TODO: round-robin should be powered by timers mechanism.
-    * So, when round-robin is active, the system isn't so "tickless".
-    */
+   //-- In dynamic tick mode, round-robin is driven by `_tn_tslice_timer`,
+   //   see `_tn_tslice_manage()`
+}
+
+/**
+ * Stop counting time slice of `_tn_tslice_task` (if any): remember how much of
+ * the time slice it has already used (in `tslice_count`), and cancel
+ * `_tn_tslice_timer`.
+ */
+static void _tslice_stop(void)
+{
+   if (_tn_tslice_task != TN_NULL){
+      TN_TickCnt time_left = _tn_timer_time_left(&_tn_tslice_timer);
+      int ticks = _tn_tslice_ticks[_tn_tslice_task->priority];
+
+      if (time_left < (TN_TickCnt)ticks){
+         _tn_tslice_task->tslice_count = ticks - (int)time_left;
+      } else {
+         //-- time slice has been changed (or it has just expired)
+         _tn_tslice_task->tslice_count = 0;
+      }
+
+      _tn_timer_cancel(&_tn_tslice_timer);
+      _tn_tslice_task = TN_NULL;
+   }
+}
+
+/**
+ * Callback of `_tn_tslice_timer`: time slice of `_tn_tslice_task` is over, so,
+ * put it at the tail of the ready queue of its priority.
+ */
+static void _tslice_timer_callback(struct TN_Timer *timer, void *p_user_data)
+{
+   TN_INTSAVE_DATA_INT;
+
+   //-- timer callback is called with interrupts enabled
+   TN_INT_IDIS_SAVE();
+
+   //-- while interrupts were enabled, the task might be already preempted:
+   //   then, `_tn_tslice_task` is either `TN_NULL` or another task.
+   if (_tn_tslice_task != TN_NULL && _tn_tslice_task == _tn_next_task_to_run){
+      int priority = _tn_tslice_task->priority;
+      struct TN_ListItem *pri_queue = &(_tn_tasks_ready_list[priority]);
+
+      _tn_tslice_task->tslice_count = 0;
+      _tn_tslice_task = TN_NULL;
+
+      //-- Remove task from head and add it to the tail of
+      //-- ready queue for current priority
+      _tn_list_add_tail(pri_queue, _tn_list_remove_head(pri_queue));
+
+      _tn_next_task_to_run = _tn_get_task_by_tsk_queue(pri_queue->next);
+
+      //-- start counting time slice of the new task
+      _tn_tslice_manage();
+   }
+
+   TN_INT_IRESTORE();
+
+   _TN_UNUSED(timer);
+   _TN_UNUSED(p_user_data);
 }
 
 #else
@@ -251,7 +388,7 @@ _TN_STATIC_INLINE void _tn_sys_on_context_switch_profiler(
    //-- interrupts should be disabled here
    _TN_BUG_ON(!TN_IS_INT_DISABLED());
 
-   TN_TickCnt cur_tick_cnt = _tn_timer_sys_time_get();
+   unsigned long cur_time = _tn_profiler_time_get();
 
    //-- handle task_prev (the one that was running and going to wait) {{{
    {
@@ -264,8 +401,8 @@ _TN_STATIC_INLINE void _tn_sys_on_context_switch_profiler(
 
       //-- get difference between current time and last saved time:
       //   this is the time task was running.
-      TN_TickCnt cur_run_time
-         = (TN_TickCnt)(cur_tick_cnt - task_prev->profiler.last_tick_cnt);
+      unsigned long cur_run_time
+         = (unsigned long)(cur_time - task_prev->profiler.last_time);
 
       //-- add it to total run time
       task_prev->profiler.timing.total_run_time += cur_run_time;
@@ -276,7 +413,7 @@ _TN_STATIC_INLINE void _tn_sys_on_context_switch_profiler(
       }
 
       //-- update current task state
-      task_prev->profiler.last_tick_cnt      = cur_tick_cnt;
+      task_prev->profiler.last_time          = cur_time;
 #if TN_PROFILER_WAIT_TIME
       task_prev->profiler.last_wait_reason   = task_prev->task_wait_reason;
 #endif
@@ -295,8 +432,8 @@ _TN_STATIC_INLINE void _tn_sys_on_context_switch_profiler(
 #if TN_PROFILER_WAIT_TIME
       //-- get difference between current time and last saved time:
       //   this is the time task was waiting.
-      TN_TickCnt cur_wait_time
-         = (TN_TickCnt)(cur_tick_cnt - task_new->profiler.last_tick_cnt);
+      unsigned long cur_wait_time
+         = (unsigned long)(cur_time - task_new->profiler.last_time);
 
       //-- add it to total total_wait_time for particular wait reason
       task_new->profiler.timing.total_wait_time
@@ -318,7 +455,7 @@ _TN_STATIC_INLINE void _tn_sys_on_context_switch_profiler(
       task_new->profiler.timing.got_running_cnt++;
 
       //-- update current task state
-      task_new->profiler.last_tick_cnt      = cur_tick_cnt;
+      task_new->profiler.last_time          = cur_time;
    }
    // }}}
 }
@@ -388,6 +525,41 @@ _TN_STATIC_INLINE void _tn_sys_stack_overflow_check(
 }
 #endif
 
+#if TN_INT_DIS_STAT
+/**
+ * Account the duration of the critical section to the statistics of its
+ * call site, and link the site to the list if it isn't linked yet.
+ * Should be called with interrupts disabled.
+ */
+static void _int_dis_site_update(
+      struct TN_IntDisSite *site,
+      unsigned long duration
+      )
+{
+   int bucket = 0;
+   unsigned long tmp = duration;
+
+   if (!site->linked){
+      site->next = _tn_int_dis_sites;
+      _tn_int_dis_sites = site;
+      site->linked = TN_TRUE;
+   }
+
+   site->cnt++;
+
+   if (site->max < duration){
+      site->max = duration;
+   }
+
+   //-- find power-of-two bucket, the last one is open-ended
+   while (tmp != 0 && bucket < (TN_INT_DIS_STAT_HIST_CNT - 1)){
+      tmp >>= 1;
+      bucket++;
+   }
+   site->hist[bucket]++;
+}
+#endif
+
 /**
  * Create idle task, the task is NOT started after creation.
  */
@@ -434,6 +606,12 @@ static void _build_cfg_check(void)
       _TN_FATAL_ERROR("TN_PRIORITIES_CNT doesn't match");
    }
 
+   if (kernel_build_cfg.priorities_2level_bmp 
+         != app_build_cfg->priorities_2level_bmp)
+   {
+      _TN_FATAL_ERROR("TN_PRIORITIES_2LEVEL_BMP doesn't match");
+   }
+
    if (kernel_build_cfg.check_param != app_build_cfg->check_param){
       _TN_FATAL_ERROR("TN_CHECK_PARAM doesn't match");
    }
@@ -454,10 +632,20 @@ static void _build_cfg_check(void)
       _TN_FATAL_ERROR("TN_MUTEX_DEADLOCK_DETECT doesn't match");
    }
 
+   if (kernel_build_cfg.mutex_fast_lock != app_build_cfg->mutex_fast_lock){
+      _TN_FATAL_ERROR("TN_MUTEX_FAST_LOCK doesn't match");
+   }
+
    if (kernel_build_cfg.tick_lists_cnt_minus_one != app_build_cfg->tick_lists_cnt_minus_one){
       _TN_FATAL_ERROR("TN_TICK_LISTS_CNT doesn't match");
    }
 
+   if (kernel_build_cfg.tick_wheel_lvl_minus_one 
+         != app_build_cfg->tick_wheel_lvl_minus_one)
+   {
+      _TN_FATAL_ERROR("TN_TICK_WHEEL_LEVELS doesn't match");
+   }
+
    if (kernel_build_cfg.api_make_alig_arg != app_build_cfg->api_make_alig_arg){
       _TN_FATAL_ERROR("TN_API_MAKE_ALIG_ARG doesn't match");
    }
@@ -470,6 +658,26 @@ static void _build_cfg_check(void)
       _TN_FATAL_ERROR("TN_PROFILER_WAIT_TIME doesn't match");
    }
 
+   if (kernel_build_cfg.profiler_timestamp != app_build_cfg->profiler_timestamp){
+      _TN_FATAL_ERROR("TN_PROFILER_TIMESTAMP doesn't match");
+   }
+
+   if (kernel_build_cfg.trace != app_build_cfg->trace){
+      _TN_FATAL_ERROR("TN_TRACE doesn't match");
+   }
+
+   if (kernel_build_cfg.int_dis_stat != app_build_cfg->int_dis_stat){
+      _TN_FATAL_ERROR("TN_INT_DIS_STAT doesn't match");
+   }
+
+   if (kernel_build_cfg.task_notify != app_build_cfg->task_notify){
+      _TN_FATAL_ERROR("TN_TASK_NOTIFY doesn't match");
+   }
+
+   if (kernel_build_cfg.eventgrp_bit_index != app_build_cfg->eventgrp_bit_index){
+      _TN_FATAL_ERROR("TN_EVENTGRP_BIT_INDEX doesn't match");
+   }
+
    if (kernel_build_cfg.stack_overflow_check != app_build_cfg->stack_overflow_check){
       _TN_FATAL_ERROR("TN_STACK_OVERFLOW_CHECK doesn't match");
    }
@@ -478,6 +686,10 @@ static void _build_cfg_check(void)
       _TN_FATAL_ERROR("TN_DYNAMIC_TICK doesn't match");
    }
 
+   if (kernel_build_cfg.timer_task != app_build_cfg->timer_task){
+      _TN_FATAL_ERROR("TN_TIMER_TASK doesn't match");
+   }
+
    if (kernel_build_cfg.old_events_api != app_build_cfg->old_events_api){
       _TN_FATAL_ERROR("TN_OLD_EVENT_API doesn't match");
    }
@@ -488,6 +700,15 @@ static void _build_cfg_check(void)
    }
 #endif
 
+#if defined (__TN_ARCH_CORTEX_M__)
+   if (     kernel_build_cfg.arch.cortex_m.max_syscall_priority
+         != app_build_cfg->arch.cortex_m.max_syscall_priority
+      )
+   {
+      _TN_FATAL_ERROR("TN_MAX_SYSCALL_PRIORITY doesn't match");
+   }
+#endif
+
 
    //-- for the case I forgot to add some param above, perform generic check
    TN_BOOL cfg_match = 
@@ -528,10 +749,37 @@ void tn_sys_start(
    //-- init timers
    _tn_timers_init();
 
+#if TN_DYNAMIC_TICK
+   //-- create timer for round-robin
+   _tn_timer_create(&_tn_tslice_timer, _tslice_timer_callback, TN_NULL);
+#endif
+
    //-- check that build configuration for the kernel and application match
    //   (if only TN_CHECK_BUILD_CFG is non-zero)
    _build_cfg_check();
 
+#if TN_TRACE
+   //-- init trace buffer header: it contains everything the decoder needs
+   //   to parse the records
+   _tn_trace_buf.magic     = TN_TRACE_MAGIC;
+   _tn_trace_buf.long_size = sizeof(unsigned long);
+   _tn_trace_buf.ptr_size  = sizeof(void *);
+   _tn_trace_buf.word_size = sizeof(TN_UWord);
+   _tn_trace_buf.rec_size  = sizeof(struct TN_TraceRec);
+   _tn_trace_buf.recs_cnt  = TN_TRACE_RECS_CNT;
+   _tn_trace_buf.wr_cnt    = 0;
+   _tn_trace_buf.active    = TN_TRUE;
+#endif
+
+#if TN_PROFILER_TIMESTAMP
+   //-- check that we have profiler timestamp callback set
+   //   (it should be set by tn_callback_profiler_timestamp_set() before
+   //   calling tn_sys_start())
+   if (_tn_cb_profiler_timestamp_get == TN_NULL){
+      _TN_FATAL_ERROR("");
+   }
+#endif
+
    //-- for each priority: 
    //   - reset list of runnable tasks with this priority
    //   - reset time slice to `#TN_NO_TIME_SLICE`
@@ -549,6 +797,11 @@ void tn_sys_start(
 
    //-- reset bitmask of priorities with runnable tasks
    _tn_ready_to_run_bmp = 0;
+#if TN_PRIORITIES_2LEVEL_BMP
+   for (i = 0; i < _TN_READY_BMP_GROUPS_CNT; i++){
+      _tn_ready_to_run_bmp_lvl2[i] = 0;
+   }
+#endif
 
    //-- reset pointers to currently running task and next task to run
    _tn_next_task_to_run = TN_NULL;
@@ -655,7 +908,16 @@ enum TN_RCode tn_sys_tslice_set(int priority, int ticks)
       TN_INTSAVE_DATA;
 
       TN_INT_DIS_SAVE();
+
+#if TN_DYNAMIC_TICK
+      //-- current time slice (if any) is counted with the old value: stop it,
+      //   so that it's counted with the new value by `_tn_tslice_manage()`
+      _tslice_stop();
+#endif
+
       _tn_tslice_ticks[priority] = ticks;
+      _tn_tslice_manage();
+
       TN_INT_RESTORE();
    }
    return rc;
@@ -676,6 +938,14 @@ TN_TickCnt tn_sys_time_get(void)
    return ret;
 }
 
+/*
+ * See comments in the header file (tn_sys.h)
+ */
+TN_TickCnt tn_sys_timeout_until(TN_TickCnt deadline)
+{
+   return _tn_timeout_until(deadline, tn_sys_time_get());
+}
+
 /*
  * Returns current state flags (_tn_sys_state)
  */
@@ -700,6 +970,63 @@ void tn_callback_stack_overflow_set(TN_CBStackOverflow *cb)
    _tn_cb_stack_overflow = cb;
 }
 
+#if TN_PROFILER_TIMESTAMP
+/*
+ * See comment in tn_sys.h file
+ */
+void tn_callback_profiler_timestamp_set(TN_CBProfilerTimestampGet *cb)
+{
+   _tn_cb_profiler_timestamp_get = cb;
+}
+#endif
+
+#if TN_TRACE
+/*
+ * See comment in tn_trace.h file
+ */
+const struct TN_TraceBuf *tn_trace_buf_get(void)
+{
+   return &_tn_trace_buf;
+}
+
+/*
+ * See comment in tn_trace.h file
+ */
+void tn_trace_active_set(TN_BOOL active)
+{
+   _tn_trace_buf.active = active;
+}
+#endif
+
+#if TN_INT_DIS_STAT
+/*
+ * See comment in tn_int_dis_stat.h file
+ */
+const struct TN_IntDisSite *tn_int_dis_stat_sites_get(void)
+{
+   return _tn_int_dis_sites;
+}
+
+/*
+ * See comment in tn_int_dis_stat.h file
+ */
+void tn_int_dis_stat_reset(void)
+{
+   struct TN_IntDisSite *site;
+   TN_INTSAVE_DATA;
+
+   TN_INT_DIS_SAVE();
+
+   for (site = _tn_int_dis_sites; site != TN_NULL; site = site->next){
+      site->cnt = 0;
+      site->max = 0;
+      memset(site->hist, 0x00, sizeof(site->hist));
+   }
+
+   TN_INT_RESTORE();
+}
+#endif
+
 /*
  * See comment in tn_sys.h file
  */
@@ -754,6 +1081,42 @@ void tn_callback_dyn_tick_set(
  *    PROTECTED FUNCTIONS
  ******************************************************************************/
 
+#if TN_DYNAMIC_TICK
+/**
+ * See comment in the _tn_sys.h file
+ */
+void _tn_tslice_manage(void)
+{
+   struct TN_Task *task = _tn_next_task_to_run;
+   int ticks = _tn_tslice_ticks[task->priority];
+   struct TN_ListItem *pri_queue = &(_tn_tasks_ready_list[task->priority]);
+
+   //-- time slice should be counted if only round-robin is on for the
+   //   priority, and there are more than 1 task in the ready queue
+   TN_BOOL tslice_needed = (
+            ticks != TN_NO_TIME_SLICE
+         && pri_queue->next->next != pri_queue
+         );
+
+   if (_tn_tslice_task != task || !tslice_needed){
+      //-- task is preempted, or it has no competitors anymore
+      _tslice_stop();
+
+      if (tslice_needed){
+         //-- task might have already used part of its time slice before
+         //   it was preempted, so, only the rest of it is counted now
+         int timeout = ticks - task->tslice_count;
+
+         _tn_tslice_task = task;
+         _tn_timer_start(
+               &_tn_tslice_timer,
+               (TN_TickCnt)((timeout > 0) ? timeout : 1)
+               );
+      }
+   }
+}
+#endif
+
 /**
  * See comment in the _tn_sys.h file
  */
@@ -846,6 +1209,57 @@ void _tn_sys_on_context_switch(
 {
    _tn_sys_stack_overflow_check(task_prev);
    _tn_sys_on_context_switch_profiler(task_prev, task_new);
+   _tn_trace(
+         TN_TRACE_EV_CONTEXT_SWITCH, task_new, (TN_UWord)task_prev
+         );
+}
+#endif
+
+#if TN_INT_DIS_STAT
+/*
+ * See comments in the file tn_int_dis_stat.h
+ */
+TN_UWord _tn_int_dis_stat_sr_save_int_dis(struct TN_IntDisSite *site)
+{
+   TN_BOOL int_enabled = !TN_IS_INT_DISABLED();
+   TN_UWord sr = tn_arch_sr_save_int_dis();
+
+   if (int_enabled){
+      //-- outermost critical section: start measuring, if only the timestamp
+      //   callback is already set (it might be not, before `tn_sys_start()`)
+      if (_tn_cb_profiler_timestamp_get != TN_NULL){
+         _tn_int_dis_cur_site    = site;
+         _tn_int_dis_depth       = 1;
+         _tn_int_dis_start_time  = _tn_profiler_time_get();
+      } else {
+         _tn_int_dis_depth       = 0;
+      }
+   } else if (_tn_int_dis_depth > 0){
+      //-- nested critical section: it is accounted to the outermost one
+      _tn_int_dis_depth++;
+   }
+
+   return sr;
+}
+
+/*
+ * See comments in the file tn_int_dis_stat.h
+ */
+void _tn_int_dis_stat_sr_restore(TN_UWord sr)
+{
+   if (_tn_int_dis_depth > 0){
+      _tn_int_dis_depth--;
+
+      if (_tn_int_dis_depth == 0){
+         //-- leaving the outermost critical section
+         _int_dis_site_update(
+               _tn_int_dis_cur_site,
+               _tn_profiler_time_get() - _tn_int_dis_start_time
+               );
+      }
+   }
+
+   tn_arch_sr_restore(sr);
 }
 #endif
 
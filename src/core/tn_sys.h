@@ -103,6 +103,14 @@ struct TN_Mutex;
    (_p_struct)->arch.p24.p24_sys_ipl = TN_P24_SYS_IPL;            \
 }
 
+#elif defined (__TN_ARCH_CORTEX_M__)
+
+#  define _TN_BUILD_CFG_ARCH_STRUCT_FILL(_p_struct)               \
+{                                                                 \
+   (_p_struct)->arch.cortex_m.max_syscall_priority                \
+      = TN_MAX_SYSCALL_PRIORITY;                                  \
+}
+
 #else
 #  define _TN_BUILD_CFG_ARCH_STRUCT_FILL(_p_struct)
 #endif
@@ -121,17 +129,26 @@ struct TN_Mutex;
    memset((_p_struct), 0x00, sizeof(*(_p_struct)));                     \
                                                                         \
    (_p_struct)->priorities_cnt            = TN_PRIORITIES_CNT;          \
+   (_p_struct)->priorities_2level_bmp     = TN_PRIORITIES_2LEVEL_BMP;   \
    (_p_struct)->check_param               = TN_CHECK_PARAM;             \
    (_p_struct)->debug                     = TN_DEBUG;                   \
    (_p_struct)->use_mutexes               = TN_USE_MUTEXES;             \
    (_p_struct)->mutex_rec                 = TN_MUTEX_REC;               \
    (_p_struct)->mutex_deadlock_detect     = TN_MUTEX_DEADLOCK_DETECT;   \
+   (_p_struct)->mutex_fast_lock           = TN_MUTEX_FAST_LOCK;         \
    (_p_struct)->tick_lists_cnt_minus_one  = (TN_TICK_LISTS_CNT - 1);    \
+   (_p_struct)->tick_wheel_lvl_minus_one  = (TN_TICK_WHEEL_LEVELS - 1); \
    (_p_struct)->api_make_alig_arg         = TN_API_MAKE_ALIG_ARG;       \
    (_p_struct)->profiler                  = TN_PROFILER;                \
    (_p_struct)->profiler_wait_time        = TN_PROFILER_WAIT_TIME;      \
+   (_p_struct)->profiler_timestamp        = TN_PROFILER_TIMESTAMP;      \
+   (_p_struct)->trace                     = TN_TRACE;                   \
+   (_p_struct)->int_dis_stat              = TN_INT_DIS_STAT;            \
+   (_p_struct)->task_notify               = TN_TASK_NOTIFY;             \
+   (_p_struct)->eventgrp_bit_index        = TN_EVENTGRP_BIT_INDEX;      \
    (_p_struct)->stack_overflow_check      = TN_STACK_OVERFLOW_CHECK;    \
    (_p_struct)->dynamic_tick              = TN_DYNAMIC_TICK;            \
+   (_p_struct)->timer_task                = TN_TIMER_TASK;              \
    (_p_struct)->old_events_api            = TN_OLD_EVENT_API;           \
                                                                         \
    _TN_BUILD_CFG_ARCH_STRUCT_FILL(_p_struct);                           \
@@ -169,7 +186,10 @@ struct TN_Mutex;
 struct _TN_BuildCfg {
    ///
    /// Value of `#TN_PRIORITIES_CNT`
-   unsigned          priorities_cnt             : 7;
+   unsigned          priorities_cnt             : 11;
+   ///
+   /// Value of `#TN_PRIORITIES_2LEVEL_BMP`
+   unsigned          priorities_2level_bmp      : 1;
    ///
    /// Value of `#TN_CHECK_PARAM`
    unsigned          check_param                : 1;
@@ -188,9 +208,15 @@ struct _TN_BuildCfg {
    /// Value of `#TN_MUTEX_DEADLOCK_DETECT`
    unsigned          mutex_deadlock_detect      : 1;
    ///
+   /// Value of `#TN_MUTEX_FAST_LOCK`
+   unsigned          mutex_fast_lock            : 1;
+   ///
    /// Value of `#TN_TICK_LISTS_CNT` minus one
    unsigned          tick_lists_cnt_minus_one   : 8;
    ///
+   /// Value of `#TN_TICK_WHEEL_LEVELS` minus one
+   unsigned          tick_wheel_lvl_minus_one   : 3;
+   ///
    /// Value of `#TN_API_MAKE_ALIG_ARG`
    unsigned          api_make_alig_arg          : 2;
    ///
@@ -200,12 +226,30 @@ struct _TN_BuildCfg {
    /// Value of `#TN_PROFILER_WAIT_TIME`
    unsigned          profiler_wait_time         : 1;
    ///
+   /// Value of `#TN_PROFILER_TIMESTAMP`
+   unsigned          profiler_timestamp         : 1;
+   ///
+   /// Value of `#TN_TRACE`
+   unsigned          trace                      : 1;
+   ///
+   /// Value of `#TN_INT_DIS_STAT`
+   unsigned          int_dis_stat               : 1;
+   ///
+   /// Value of `#TN_TASK_NOTIFY`
+   unsigned          task_notify                : 1;
+   ///
+   /// Value of `#TN_EVENTGRP_BIT_INDEX`
+   unsigned          eventgrp_bit_index         : 1;
+   ///
    /// Value of `#TN_STACK_OVERFLOW_CHECK`
    unsigned          stack_overflow_check       : 1;
    ///
    /// Value of `#TN_DYNAMIC_TICK`
    unsigned          dynamic_tick               : 1;
    ///
+   /// Value of `#TN_TIMER_TASK`
+   unsigned          timer_task                 : 1;
+   ///
    /// Value of `#TN_OLD_EVENT_API`
    unsigned          old_events_api             : 1;
    ///
@@ -223,6 +267,13 @@ struct _TN_BuildCfg {
          /// Value of `#TN_P24_SYS_IPL`
          unsigned    p24_sys_ipl                : 3;
       } p24;
+      ///
+      /// Cortex-M-dependent values
+      struct {
+         ///
+         /// Value of `#TN_MAX_SYSCALL_PRIORITY`
+         unsigned    max_syscall_priority       : 8;
+      } cortex_m;
    } arch;
 };
 
@@ -353,6 +404,25 @@ typedef void (TN_CBDeadlock)(
       struct TN_Task *task
       );
 
+/**
+ * User-provided callback function that returns current high-resolution
+ * timestamp for profiler. Typically, it returns the value of some
+ * free-running hardware counter (CPU cycle counter, or a timer).
+ * Note: this callback is used if only `#TN_PROFILER_TIMESTAMP` is non-zero.
+ *
+ * The counter may wrap around at the full range of `unsigned long`: time
+ * intervals are calculated modulo this range. So, if the counter is narrower
+ * (say, 16-bit timer), intervals longer than its period can't be measured
+ * correctly.
+ *
+ * It is called with interrupts disabled, at every context switch, so it
+ * should be as fast as possible.
+ *
+ * @see `tn_callback_profiler_timestamp_set()`
+ * @see `tn_arch_timestamp_get()`
+ */
+typedef unsigned long (TN_CBProfilerTimestampGet)(void);
+
 
 
 
@@ -467,6 +537,31 @@ enum TN_RCode tn_sys_tslice_set(int priority, int ticks);
  */
 TN_TickCnt tn_sys_time_get(void);
 
+/**
+ * Get timeout which should be given to some blocking call (say,
+ * `tn_sem_wait()`) so that it doesn't wait beyond the absolute `deadline`.
+ * This way, a chain of blocking calls can share one deadline without
+ * recomputing timeouts by hand.
+ *
+ * `TN_TickCnt` wraps around, so the `deadline` is considered to be in the
+ * future if only it is less than half of the `#TN_TickCnt` range ahead of
+ * the current system ticks count; otherwise it is considered to be already
+ * reached.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param deadline
+ *    Absolute time, in terms of `tn_sys_time_get()`
+ *
+ * @return
+ *    Number of system ticks left until the `deadline`, or `0` if the
+ *    `deadline` is already reached (so that blocking call just polls).
+ *    Never returns `#TN_WAIT_INFINITE`.
+ */
+TN_TickCnt tn_sys_timeout_until(TN_TickCnt deadline);
+
 
 /**
  * Set callback function that should be called whenever deadlock occurs or
@@ -639,6 +734,27 @@ void tn_callback_dyn_tick_set(
       );
 #endif
 
+#if TN_PROFILER_TIMESTAMP || defined(DOXYGEN_ACTIVE)
+/**
+ * $(TN_IF_ONLY_PROFILER_TIMESTAMP_SET)
+ *
+ * Set callback function that returns high-resolution timestamp for the
+ * profiler and the event trace (see `#TN_PROFILER_TIMESTAMP`). On some architectures, you can
+ * just give `tn_arch_timestamp_get()` here.
+ *
+ * \attention This function should be called <b>before</b> `tn_sys_start()`,
+ * otherwise, you'll run into run-time error `_TN_FATAL_ERROR()`.
+ *
+ * $(TN_CALL_FROM_MAIN)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param cb
+ *    Pointer to user-provided callback function, see
+ *    `#TN_CBProfilerTimestampGet` for the prototype.
+ */
+void tn_callback_profiler_timestamp_set(TN_CBProfilerTimestampGet *cb);
+#endif
+
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -45,8 +45,10 @@
 //-- internal tnkernel headers
 #include "_tn_tasks.h"
 #include "_tn_mutex.h"
+#include "_tn_eventgrp.h"
 #include "_tn_timer.h"
 #include "_tn_list.h"
+#include "_tn_trace.h"
 
 
 //-- header of current module
@@ -87,8 +89,31 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_generic(
    return rc;
 }
 
+#if TN_TASK_NOTIFY
+_TN_STATIC_INLINE enum TN_RCode _check_param_notify(
+      const struct TN_Task      *task,
+      enum TN_TaskNotifyAction   action
+      )
+{
+   enum TN_RCode rc = _check_param_generic(task);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (0
+         || action < TN_TASK_NOTIFY_ACTION_SET_BITS
+         || action > TN_TASK_NOTIFY_ACTION_OVERWRITE
+         )
+   {
+      rc = TN_RC_WPARAM;
+   }
+
+   return rc;
+}
+#endif
+
 #else
 #  define _check_param_generic(task)            (TN_RC_OK)
+#  define _check_param_notify(task, action)     (TN_RC_OK)
 #endif
 // }}}
 
@@ -99,6 +124,11 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_generic(
 _TN_STATIC_INLINE void _init_mutex_queue(struct TN_Task *task)
 {
    _tn_list_reset(&(task->mutex_queue));
+   _tn_list_reset(&(task->mutex_prio_queue));
+#if TN_MUTEX_FAST_LOCK
+   task->mutex_fast_list    = TN_NULL;
+   task->mutex_fast_pending = TN_NULL;
+#endif
 }
 
 #if TN_MUTEX_DEADLOCK_DETECT
@@ -116,6 +146,21 @@ _TN_STATIC_INLINE void _init_deadlock_list(struct TN_Task *task)
 #endif
 
 
+#if TN_PRIORITIES_2LEVEL_BMP
+/**
+ * Index of the group of priorities in `_tn_ready_to_run_bmp_lvl2` and the bit
+ * in `_tn_ready_to_run_bmp`, see `#TN_PRIORITIES_2LEVEL_BMP`
+ */
+#  define _READY_BMP_GROUP(priority)                                    \
+   ((unsigned int)(priority) / TN_INT_WIDTH)
+
+/**
+ * Bit of the priority inside the group word
+ */
+#  define _READY_BMP_GROUP_BIT(priority)                                \
+   ((unsigned int)(priority) % TN_INT_WIDTH)
+#endif
+
 /**
  * Looks for first runnable task with highest priority,
  * set _tn_next_task_to_run to it.
@@ -126,28 +171,15 @@ static void _find_next_task_to_run(void)
 {
    int priority;
 
-#ifdef _TN_FFS
-   //-- architecture-dependent way to find-first-set-bit is available,
-   //   so use it.
-   priority = _TN_FFS(_tn_ready_to_run_bmp);
-   priority--;
-#else
-   //-- there is no architecture-dependent way to find-first-set-bit available,
-   //   so, use generic (somewhat naive) algorithm.
-   int i;
-   unsigned int mask;
+#if TN_PRIORITIES_2LEVEL_BMP
+   //-- first, find the group with highest priority runnable task(s),
+   //   and then, the priority inside this group.
+   int group = _tn_bmp_ffs(_tn_ready_to_run_bmp) - 1;
 
-   mask = 1;
-   priority = 0;
-
-   for (i = 0; i < TN_PRIORITIES_CNT; i++){
-      //-- for each bit in bmp
-      if (_tn_ready_to_run_bmp & mask){
-         priority = i;
-         break;
-      }
-      mask = (mask << 1);
-   }
+   priority = (group * TN_INT_WIDTH)
+      + _tn_bmp_ffs(_tn_ready_to_run_bmp_lvl2[group]) - 1;
+#else
+   priority = _tn_bmp_ffs(_tn_ready_to_run_bmp) - 1;
 #endif
 
    //-- set task to run: fetch next task from ready list of appropriate
@@ -157,6 +189,37 @@ static void _find_next_task_to_run(void)
          );
 }
 
+/**
+ * Add task to the wait queue ordered by priority (see
+ * `#TN_WAIT_ORDER_PRIORITY`): before the first task with lower priority, or
+ * to the tail if there is no such task. So, tasks with equal priorities are
+ * kept in FIFO order.
+ */
+static void _wait_queue_add_by_priority(
+      struct TN_ListItem *wait_que,
+      struct TN_Task *task
+      )
+{
+   struct TN_ListItem *item;
+
+   //-- walk the queue from the head until the task with lower priority
+   //   is found (or until the queue is over)
+   for (
+         item = wait_que->next;
+         item != wait_que;
+         item = item->next
+       )
+   {
+      if (_tn_get_task_by_tsk_queue(item)->priority > task->priority){
+         break;
+      }
+   }
+
+   //-- adding to the tail of the list `item` means inserting just before
+   //   `item` (or to the tail of the queue, if `item` is the queue itself)
+   _tn_list_add_tail(item, &(task->task_queue));
+}
+
 // }}}
 
 //-- Inline functions {{{
@@ -200,6 +263,54 @@ _TN_STATIC_INLINE enum TN_RCode _task_release_wait(struct TN_Task *task)
    return rc;
 }
 
+#if TN_TASK_NOTIFY
+/**
+ * See the comment for tn_task_notify, tn_task_inotify in the tn_tasks.h
+ */
+_TN_STATIC_INLINE enum TN_RCode _task_notify(
+      struct TN_Task            *task,
+      enum TN_TaskNotifyAction   action,
+      TN_UWord                   value
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (_tn_task_is_dormant(task)){
+      rc = TN_RC_WSTATE;
+   } else {
+      switch (action){
+         case TN_TASK_NOTIFY_ACTION_SET_BITS:
+            task->notify_value |= value;
+            break;
+         case TN_TASK_NOTIFY_ACTION_INCREMENT:
+            task->notify_value++;
+            break;
+         case TN_TASK_NOTIFY_ACTION_OVERWRITE:
+            task->notify_value = value;
+            break;
+      }
+
+      if (     (_tn_task_is_waiting(task))
+            && (task->task_wait_reason == TN_WAIT_REASON_TASK_NOTIFY))
+      {
+         //-- Task waits for notification: hand the value to it right now,
+         //   so that it doesn't need to disable interrupts again when it
+         //   wakes up.
+         task->subsys_wait.notify.value = task->notify_value;
+         task->notify_value &= ~task->subsys_wait.notify.clear_mask;
+
+         _tn_task_wait_complete(task, TN_RC_OK);
+      } else {
+         //-- Task doesn't wait for notification now; it will receive it
+         //   by the next call to tn_task_notify_wait()
+         task->notify_pending = TN_TRUE;
+      }
+   }
+
+   return rc;
+}
+#endif
+
 _TN_STATIC_INLINE enum TN_RCode _task_delete(struct TN_Task *task)
 {
    enum TN_RCode rc = TN_RC_OK;
@@ -286,7 +397,20 @@ _TN_STATIC_INLINE TN_BOOL _remove_entry_from_ready_queue(
 
    if (ret){
       //-- list is empty, so, modify bitmask _tn_ready_to_run_bmp
+#if TN_PRIORITIES_2LEVEL_BMP
+      unsigned int group = _READY_BMP_GROUP(priority);
+      unsigned int group_bmp;
+
+      group_bmp = (_tn_ready_to_run_bmp_lvl2[group] &=
+            ~(1u << _READY_BMP_GROUP_BIT(priority)));
+
+      //-- if there are no more runnable tasks in the group, clear the
+      //   group bit in the top-level bitmask as well (without branching:
+      //   `(group_bmp == 0)` is either 0 or 1).
+      _tn_ready_to_run_bmp &= ~((unsigned int)(group_bmp == 0) << group);
+#else
       _tn_ready_to_run_bmp &= ~(1 << priority);
+#endif
    }
 
    return ret;
@@ -297,7 +421,13 @@ _TN_STATIC_INLINE void _add_entry_to_ready_queue(
       )
 {
    _tn_list_add_tail(&(_tn_tasks_ready_list[priority]), list_node);
+#if TN_PRIORITIES_2LEVEL_BMP
+   _tn_ready_to_run_bmp_lvl2[_READY_BMP_GROUP(priority)] |=
+      (1u << _READY_BMP_GROUP_BIT(priority));
+   _tn_ready_to_run_bmp |= (1u << _READY_BMP_GROUP(priority));
+#else
    _tn_ready_to_run_bmp |= (1 << priority);
+#endif
 }
 
 // }}}
@@ -307,9 +437,8 @@ _TN_STATIC_INLINE void _add_entry_to_ready_queue(
  * handle priorities of other involved tasks.
  *
  * This function is called _after_ removing task from wait_queue,
- * because _find_max_blocked_priority()
- * in tn_mutex.c checks for all tasks in mutex's wait_queue to
- * get max blocked priority.
+ * because handlers in tn_mutex.c expect the task to be already removed
+ * from the mutex's wait_queue (see `_tn_mutex_i_on_task_wait_complete()`).
 
  * This function is called _before_ task is actually woken up,
  * so callback functions may check whatever waiting parameters
@@ -655,6 +784,44 @@ enum TN_RCode tn_task_sleep(TN_TickCnt timeout)
    return rc;
 }
 
+/*
+ * See comments in the header file (tn_tasks.h)
+ */
+enum TN_RCode tn_task_sleep_until(TN_TickCnt deadline)
+{
+   enum TN_RCode rc = TN_RC_TIMEOUT;
+
+   if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_TickCnt timeout;
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      //-- timeout is calculated with interrupts disabled, so that system
+      //   tick can't happen between getting current time and putting task
+      //   to wait
+      timeout = _tn_timeout_until(deadline, _tn_timer_sys_time_get());
+
+      if (timeout != 0){
+         //-- put task to wait with reason SLEEP and without wait queue.
+         _tn_task_curr_to_wait_action(
+               TN_NULL, TN_WAIT_REASON_SLEEP, timeout
+               );
+      }
+
+      TN_INT_RESTORE();
+
+      if (timeout != 0){
+         _tn_context_switch_pend_if_needed();
+         rc = _tn_curr_run_task->task_wait_rc;
+      }
+   }
+
+   return rc;
+}
+
 /*
  * See comments in the header file (tn_tasks.h)
  */
@@ -703,6 +870,120 @@ enum TN_RCode tn_task_irelease_wait(struct TN_Task *task)
    return _task_job_iperform(task, _task_release_wait);
 }
 
+#if TN_TASK_NOTIFY
+/*
+ * See comments in the header file (tn_tasks.h)
+ */
+enum TN_RCode tn_task_notify(
+      struct TN_Task            *task,
+      enum TN_TaskNotifyAction   action,
+      TN_UWord                   value
+      )
+{
+   enum TN_RCode rc = _check_param_notify(task, action);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      rc = _task_notify(task, action, value);
+
+      TN_INT_RESTORE();
+      _tn_context_switch_pend_if_needed();
+   }
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_tasks.h)
+ */
+enum TN_RCode tn_task_inotify(
+      struct TN_Task            *task,
+      enum TN_TaskNotifyAction   action,
+      TN_UWord                   value
+      )
+{
+   enum TN_RCode rc = _check_param_notify(task, action);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (!tn_is_isr_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      TN_INTSAVE_DATA_INT;
+
+      TN_INT_IDIS_SAVE();
+
+      rc = _task_notify(task, action, value);
+
+      TN_INT_IRESTORE();
+      _TN_CONTEXT_SWITCH_IPEND_IF_NEEDED();
+   }
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_tasks.h)
+ */
+enum TN_RCode tn_task_notify_wait(
+      TN_UWord       clear_mask,
+      TN_UWord      *p_value,
+      TN_TickCnt     timeout
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+   TN_BOOL waited_for_notify = TN_FALSE;
+
+   if (!tn_is_task_context()){
+      rc = TN_RC_WCONTEXT;
+   } else {
+      struct TN_Task *task = _tn_curr_run_task;
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      if (task->notify_pending){
+         //-- notification is pending already, so, receive it immediately
+         if (p_value != TN_NULL){
+            *p_value = task->notify_value;
+         }
+         task->notify_value &= ~clear_mask;
+         task->notify_pending = TN_FALSE;
+      } else if (timeout == 0){
+         rc = TN_RC_TIMEOUT;
+      } else {
+         //-- put task to wait with reason TASK_NOTIFY and without wait
+         //   queue: the notifier refers to the task directly.
+         task->subsys_wait.notify.clear_mask = clear_mask;
+         _tn_task_curr_to_wait_action(
+               TN_NULL, TN_WAIT_REASON_TASK_NOTIFY, timeout
+               );
+         waited_for_notify = TN_TRUE;
+      }
+
+      TN_INT_RESTORE();
+
+      if (waited_for_notify){
+         _tn_context_switch_pend_if_needed();
+
+         //-- the notifier has stored the value before waking us up, so
+         //   there's no need to disable interrupts again
+         rc = task->task_wait_rc;
+         if (rc == TN_RC_OK && p_value != TN_NULL){
+            *p_value = task->subsys_wait.notify.value;
+         }
+      }
+   }
+
+   return rc;
+}
+#endif
+
 /*
  * See comments in the header file (tn_tasks.h)
  */
@@ -890,14 +1171,15 @@ enum TN_RCode tn_task_profiler_timing_get(
    if (rc != TN_RC_OK){
       //-- just return rc as it is
    } else {
-      int sr_saved;
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
 
       //-- just copy timing data from task structure
       //   to the user-provided location
       memcpy(tgt, &task->profiler.timing, sizeof(*tgt));
 
-      tn_arch_sr_restore(sr_saved);
+      TN_INT_RESTORE();
    }
    return rc;
 }
@@ -934,6 +1216,9 @@ void _tn_task_set_runnable(struct TN_Task * task)
    if (priority < _tn_next_task_to_run->priority){
       _tn_next_task_to_run = task;
    }
+
+   //-- manage round-robin timer (if needed)
+   _tn_tslice_manage();
 }
 
 /**
@@ -987,11 +1272,14 @@ void _tn_task_clear_runnable(struct TN_Task *task)
    //-- and reset task's queue
    _tn_list_reset(&(task->task_queue));
 
+   //-- manage round-robin timer (if needed)
+   _tn_tslice_manage();
 }
 
 void _tn_task_set_waiting(
       struct TN_Task *task,
       struct TN_ListItem *wait_que,
+      enum TN_WaitOrder wait_order,
       enum TN_WaitReason wait_reason,
       TN_TickCnt timeout
       )
@@ -1013,10 +1301,15 @@ void _tn_task_set_waiting(
 
    task->waited           = TN_TRUE;
 
-   //--- Add to the wait queue  - FIFO
+   //--- Add to the wait queue: either FIFO or by priority
 
    if (wait_que != TN_NULL){
-      _tn_list_add_tail(wait_que, &(task->task_queue));
+      task->wait_order_prio = (wait_order == TN_WAIT_ORDER_PRIORITY);
+      if (task->wait_order_prio){
+         _wait_queue_add_by_priority(wait_que, task);
+      } else {
+         _tn_list_add_tail(wait_que, &(task->task_queue));
+      }
       task->pwait_queue = wait_que;
    } else {
       //-- NOTE: we don't need to reset task_queue because
@@ -1025,6 +1318,8 @@ void _tn_task_set_waiting(
 
    //-- Add to the timers queue, if timeout is neither 0 nor `TN_WAIT_INFINITE`.
    _tn_timer_start(&task->timer, timeout);
+
+   _tn_trace(TN_TRACE_EV_TASK_WAIT, task, (TN_UWord)wait_reason);
 }
 
 /**
@@ -1050,9 +1345,8 @@ void _tn_task_clear_waiting(struct TN_Task *task, enum TN_RCode wait_rc)
 #endif
 
    //-- NOTE: we should remove task from wait_queue before calling
-   //   _on_task_wait_complete(), because _find_max_blocked_priority()
-   //   in tn_mutex.c checks for all tasks in mutex's wait_queue to
-   //   get max blocked priority
+   //   _on_task_wait_complete(), because handlers in tn_mutex.c expect
+   //   the task to be already removed from the mutex's wait_queue
 
    //-- NOTE: we don't care here whether task is contained in any wait_queue,
    //   because even if it isn't, _tn_list_remove_entry() on empty list
@@ -1077,6 +1371,8 @@ void _tn_task_clear_waiting(struct TN_Task *task, enum TN_RCode wait_rc)
 
    //-- Clear wait reason
    task->task_wait_reason = TN_WAIT_REASON_NONE;
+
+   _tn_trace(TN_TRACE_EV_TASK_WAIT_END, task, (TN_UWord)wait_rc);
 }
 
 void _tn_task_set_suspended(struct TN_Task *task)
@@ -1116,8 +1412,16 @@ void _tn_task_set_dormant(struct TN_Task* task)
       _TN_FATAL_ERROR("");
    } else if (!_tn_list_is_empty(&task->mutex_queue)){
       _TN_FATAL_ERROR("");
+   } else if (!_tn_list_is_empty(&task->mutex_prio_queue)){
+      _TN_FATAL_ERROR("");
+#if TN_MUTEX_FAST_LOCK
+   } else if (task->mutex_fast_list != TN_NULL){
+      _TN_FATAL_ERROR("");
+#endif
+#if TN_MUTEX_DEADLOCK_DETECT
    } else if (!_tn_list_is_empty(&task->deadlock_list)){
       _TN_FATAL_ERROR("");
+#endif
    }
 #endif
 
@@ -1125,6 +1429,11 @@ void _tn_task_set_dormant(struct TN_Task* task)
    task->task_state  |= TN_TASK_STATE_DORMANT;   //-- Task state
 
    task->tslice_count  = 0;
+
+#if TN_TASK_NOTIFY
+   task->notify_value   = 0;
+   task->notify_pending = TN_FALSE;
+#endif
 }
 
 void _tn_task_clear_dormant(struct TN_Task *task)
@@ -1149,9 +1458,9 @@ void _tn_task_clear_dormant(struct TN_Task *task)
 
 
 #if TN_PROFILER
-   //-- If profiler is present, set last tick count
-   //   to current tick count value
-   task->profiler.last_tick_cnt = _tn_timer_sys_time_get();
+   //-- If profiler is present, set last time
+   //   to current time value
+   task->profiler.last_time = _tn_profiler_time_get();
 #endif
 }
 
@@ -1217,6 +1526,39 @@ void _tn_change_task_priority(struct TN_Task *task, int new_priority)
       _tn_change_running_task_priority(task, new_priority);
    } else {
       task->priority = new_priority;
+
+      //-- NOTE: the task might be still in the WAIT state, but already
+      //   removed from the wait queue: it happens when the task finishes
+      //   waiting for the mutex, and priorities of the involved tasks are
+      //   being updated. In this case, the task must not be put back
+      //   to the queue, so we check if it is still there.
+      if (     _tn_task_is_waiting(task)
+            && task->pwait_queue != TN_NULL
+            && !_tn_list_is_empty(&(task->task_queue))
+            && task->wait_order_prio
+         )
+      {
+         //-- task waits in the queue ordered by priority: move it to the
+         //   new place in that queue
+         _tn_list_remove_entry(&(task->task_queue));
+         _wait_queue_add_by_priority(task->pwait_queue, task);
+
+#if TN_EVENTGRP_BIT_INDEX
+         if (task->task_wait_reason == TN_WAIT_REASON_EVENT){
+            _tn_eventgrp_on_task_requeue(task);
+         }
+#endif
+      }
+
+      if (     _tn_task_is_waiting(task)
+            && task->task_wait_reason == TN_WAIT_REASON_MUTEX_I
+            && !_tn_list_is_empty(&(task->task_queue))
+         )
+      {
+         //-- task waits for the mutex with priority inheritance: the mutex
+         //   keeps its waiters ordered by priority, so, move the task there
+         _tn_mutex_i_on_task_priority_change(task);
+      }
    }
 }
 
@@ -1238,6 +1580,9 @@ void _tn_change_running_task_priority(struct TN_Task *task, int new_priority)
    _add_entry_to_ready_queue(&(task->task_queue), new_priority);
 
    _find_next_task_to_run();
+
+   //-- manage round-robin timer (if needed)
+   _tn_tslice_manage();
 }
 
 #if 0
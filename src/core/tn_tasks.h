@@ -107,6 +107,17 @@
  * #TN_CBIdle. It is useful to bring the processor to some kind of real idle
  * state, so that device draws less current.
  *
+ * \section tn_tasks__notify Task notifications
+ *
+ * If `#TN_TASK_NOTIFY` is set, each task has a notification value: a word
+ * which other tasks and ISRs may modify by `tn_task_notify()` /
+ * `tn_task_inotify()` (set some bits, increment or overwrite it), and the
+ * task itself may wait for it to be modified by `tn_task_notify_wait()`.
+ *
+ * It is a lightweight replacement of the semaphore or event group which
+ * only one task waits for: there's no separate object and wait queue, and
+ * notifying the task takes less time than signalling the semaphore.
+ *
  */
 
 #ifndef _TN_TASKS_H
@@ -123,6 +134,9 @@
 #include "tn_eventgrp.h"
 #include "tn_dqueue.h"
 #include "tn_fmem.h"
+#include "tn_heap.h"
+#include "tn_msgq.h"
+#include "tn_stream.h"
 #include "tn_timer.h"
 
 
@@ -208,6 +222,39 @@ enum TN_WaitReason {
    /// memory blocks
    /// @see tn_fmem.h
    TN_WAIT_REASON_WFIXMEM,
+   ///
+   /// Task wants to send a message to the message queue, and there's no
+   /// space in the queue.
+   /// @see tn_msgq.h
+   TN_WAIT_REASON_MSGQ_WSEND,
+   ///
+   /// Task wants to receive a message from the message queue, and there's
+   /// no messages in the queue
+   /// @see tn_msgq.h
+   TN_WAIT_REASON_MSGQ_WRECEIVE,
+   ///
+   /// Task wants to read data from the ring buffer, and the buffer is empty
+   /// @see tn_ring.h
+   TN_WAIT_REASON_RING_WRECEIVE,
+   ///
+   /// Task wants to write bytes to the stream buffer, and there's no room
+   /// for all of them
+   /// @see tn_stream.h
+   TN_WAIT_REASON_STREAM_WSEND,
+   ///
+   /// Task wants to read bytes from the stream buffer, and there are less
+   /// bytes than the trigger level
+   /// @see tn_stream.h
+   TN_WAIT_REASON_STREAM_WRECEIVE,
+   ///
+   /// Task waits for notification
+   /// @see `tn_task_notify_wait()`
+   TN_WAIT_REASON_TASK_NOTIFY,
+   ///
+   /// Task wants to allocate memory block from the heap, and there's no
+   /// suitable free block
+   /// @see tn_heap.h
+   TN_WAIT_REASON_WHEAP,
 
 
    ///
@@ -242,6 +289,44 @@ enum TN_TaskExitOpt {
    TN_TASK_EXIT_OPT_DELETE = (1 << 0),
 };
 
+#if TN_TASK_NOTIFY || DOXYGEN_ACTIVE
+/**
+ * $(TN_IF_ONLY_TASK_NOTIFY_SET)
+ *
+ * Action to perform on the notification value of the task, see
+ * `tn_task_notify()`
+ */
+enum TN_TaskNotifyAction {
+   ///
+   /// bits of the given value are set in the notification value (like
+   /// event group)
+   TN_TASK_NOTIFY_ACTION_SET_BITS,
+   ///
+   /// notification value is incremented, given value is ignored (like
+   /// counting semaphore)
+   TN_TASK_NOTIFY_ACTION_INCREMENT,
+   ///
+   /// notification value is overwritten with the given value (like mailbox
+   /// of one word)
+   TN_TASK_NOTIFY_ACTION_OVERWRITE,
+};
+
+/**
+ * $(TN_IF_ONLY_TASK_NOTIFY_SET)
+ *
+ * Notification-specific fields related to waiting task,
+ * to be included in struct TN_Task.
+ */
+struct TN_TaskNotifyWait {
+   ///
+   /// bits to clear in the notification value when it is received
+   TN_UWord clear_mask;
+   ///
+   /// notification value received (before bits are cleared)
+   TN_UWord value;
+};
+#endif
+
 #if TN_PROFILER || DOXYGEN_ACTIVE
 /**
  * Timing structure that is managed by profiler and can be read by
@@ -301,8 +386,9 @@ struct TN_TaskTiming {
  */
 struct _TN_TaskProfiler {
    ///
-   /// Tick count of when the task got running or non-running last time.
-   TN_TickCnt        last_tick_cnt;
+   /// Time (see `_tn_profiler_time_get()`) of when the task got running or
+   /// non-running last time.
+   unsigned long        last_time;
 #if TN_PROFILER_WAIT_TIME || DOXYGEN_ACTIVE
    ///
    /// Available if only `#TN_PROFILER_WAIT_TIME` option is non-zero.
@@ -356,8 +442,26 @@ struct TN_Task {
 
 #if TN_USE_MUTEXES
    ///
-   /// list of all mutexes that are locked by task
+   /// list of all mutexes that are locked by task, ordered by the priority
+   /// which they impose on the task: the first mutex imposes the highest one
    struct TN_ListItem mutex_queue;
+   ///
+   /// To include in the `prio_wait_queue` of the mutex with priority
+   /// inheritance which the task waits for (if any)
+   struct TN_ListItem mutex_prio_queue;
+#if TN_MUTEX_FAST_LOCK
+   ///
+   /// Singly-linked list of mutexes locked by the task through the fast path
+   /// (see `#TN_MUTEX_FAST_LOCK`), the latest one first. Modified by the
+   /// task itself only; the kernel uses it to unlock these mutexes when the
+   /// task is terminated.
+   struct TN_Mutex *volatile mutex_fast_list;
+   ///
+   /// Mutex which is being locked or unlocked through the fast path right
+   /// now (if any): if the task is terminated in the middle of that,
+   /// the mutex might be locked, but not in the `mutex_fast_list`.
+   struct TN_Mutex *volatile mutex_fast_pending;
+#endif
 #if TN_MUTEX_DEADLOCK_DETECT
    ///
    /// list of other tasks involved in deadlock. This list is non-empty
@@ -426,10 +530,30 @@ struct TN_Task {
       ///
       /// fields specific to tn_fmem.h
       struct TN_FMemTaskWait fmem;
+      ///
+      /// fields specific to tn_msgq.h
+      struct TN_MsgQTaskWait msgq;
+      ///
+      /// fields specific to tn_stream.h
+      struct TN_StreamTaskWait stream;
+      ///
+      /// fields specific to tn_heap.h
+      struct TN_HeapTaskWait heap;
+#if TN_TASK_NOTIFY
+      ///
+      /// fields specific to task notifications
+      struct TN_TaskNotifyWait notify;
+#endif
    } subsys_wait;
    ///
    /// Task name for debug purposes, user may want to set it by hand
    const char *name;          
+#if TN_TASK_NOTIFY
+   ///
+   /// Notification value, see `tn_task_notify()`. Available if only
+   /// `#TN_TASK_NOTIFY` is non-zero.
+   TN_UWord          notify_value;
+#endif
 #if TN_PROFILER || DOXYGEN_ACTIVE
    /// Profiler data, available if only `#TN_PROFILER` is non-zero.
    struct _TN_TaskProfiler    profiler;
@@ -446,6 +570,20 @@ struct TN_Task {
    /// if the caller is interested in the relevant value of this flag.
    unsigned          waited : 1;
 
+   /// Flag indicates that task waits in the wait queue which is ordered
+   /// by priority (see `#TN_WAIT_ORDER_PRIORITY`), so that the task should
+   /// be moved in the queue when its priority changes.
+   /// This flag is set in `_tn_task_set_waiting()`.
+   unsigned          wait_order_prio : 1;
+
+#if TN_TASK_NOTIFY
+   /// Flag indicates that notification value was modified by
+   /// `tn_task_notify()`, and the task hasn't received it by
+   /// `tn_task_notify_wait()` yet. Available if only `#TN_TASK_NOTIFY` is
+   /// non-zero.
+   unsigned          notify_pending : 1;
+#endif
+
 
 // Other implementation specific fields may be added below
 
@@ -647,6 +785,47 @@ enum TN_RCode tn_task_resume(struct TN_Task *task);
  */
 enum TN_RCode tn_task_sleep(TN_TickCnt timeout);
 
+/**
+ * Put current task to sleep until the absolute time `deadline` (in terms of
+ * `tn_sys_time_get()`). Otherwise, it behaves just like `tn_task_sleep()`.
+ *
+ * Since the wakeup time doesn't depend on the time the task spent before the
+ * call, periodic task doesn't accumulate jitter:
+ *
+ * \code{.c}
+ *    TN_TickCnt deadline = tn_sys_time_get();
+ *
+ *    for (;;){
+ *       deadline += MY_PERIOD;
+ *       tn_task_sleep_until(deadline);
+ *
+ *       //-- do the periodic job
+ *    }
+ * \endcode
+ *
+ * `TN_TickCnt` wraps around, so the `deadline` is considered to be in the
+ * future if only it is less than half of the `#TN_TickCnt` range ahead of
+ * the current system ticks count; otherwise it is considered to be already
+ * reached. See also `tn_sys_timeout_until()`.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param deadline
+ *    Absolute time at which the task should be woken up
+ *
+ * @returns
+ *    * `#TN_RC_TIMEOUT` if task has slept until the `deadline`, or if the
+ *      `deadline` is already reached (then, task doesn't sleep at all);
+ *    * `#TN_RC_OK` if task was woken up from other task by `tn_task_wakeup()`
+ *    * `#TN_RC_FORCED` if task was released from wait forcibly by 
+ *       `tn_task_release_wait()`
+ *    * `#TN_RC_WCONTEXT` if called from wrong context
+ */
+enum TN_RCode tn_task_sleep_until(TN_TickCnt deadline);
+
 /**
  * Wake up task from sleep.
  *
@@ -756,6 +935,102 @@ enum TN_RCode tn_task_release_wait(struct TN_Task *task);
  */
 enum TN_RCode tn_task_irelease_wait(struct TN_Task *task);
 
+#if TN_TASK_NOTIFY || DOXYGEN_ACTIVE
+/**
+ * $(TN_IF_ONLY_TASK_NOTIFY_SET)
+ *
+ * Notify the task: modify its notification value as specified by `action`
+ * and `value`, and mark the notification as pending. If the task waits for
+ * notification in `tn_task_notify_wait()`, it is woken up right away.
+ *
+ * Typical usage instead of binary semaphore which only one task waits for:
+ *
+ * \code{.c}
+ *     //-- ISR
+ *     tn_task_inotify(&my_task, TN_TASK_NOTIFY_ACTION_SET_BITS, MY_EV_RX);
+ *
+ *     //-- task
+ *     TN_UWord events;
+ *     rc = tn_task_notify_wait(MY_EV_RX, &events, TN_WAIT_INFINITE);
+ * \endcode
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param task    task to notify
+ * @param action  action to perform on the notification value, see
+ *                `enum #TN_TaskNotifyAction`
+ * @param value   value for the action
+ *
+ * @return
+ *    * `#TN_RC_OK` if successful
+ *    * `#TN_RC_WSTATE` if task is dormant
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return codes
+ *      are available: `#TN_RC_WPARAM` and `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_task_notify(
+      struct TN_Task            *task,
+      enum TN_TaskNotifyAction   action,
+      TN_UWord                   value
+      );
+
+/**
+ * $(TN_IF_ONLY_TASK_NOTIFY_SET)
+ *
+ * The same as `tn_task_notify()` but for using in the ISR.
+ *
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ */
+enum TN_RCode tn_task_inotify(
+      struct TN_Task            *task,
+      enum TN_TaskNotifyAction   action,
+      TN_UWord                   value
+      );
+
+/**
+ * $(TN_IF_ONLY_TASK_NOTIFY_SET)
+ *
+ * Wait for notification of the current task. If notification is pending
+ * already, it is received immediately; otherwise, behavior depends on the
+ * `timeout` value: refer to `#TN_TickCnt`.
+ *
+ * When notification is received, notification value is stored to
+ * `p_value` (if it isn't `#TN_NULL`), and then bits of `clear_mask` are
+ * cleared in the notification value; so, use `0` to keep the value (say,
+ * if it is overwritten each time), or `(TN_UWord)-1` to reset it to zero
+ * (say, if it is incremented as a counting semaphore, or if it is used as a
+ * set of event bits).
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_CAN_SLEEP)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param clear_mask bits to clear in the notification value when it is
+ *                   received
+ * @param p_value    location to store the notification value (before
+ *                   bits of `clear_mask` are cleared); may be `#TN_NULL`.
+ * @param timeout    refer to `#TN_TickCnt`
+ *
+ * @return
+ *    * `#TN_RC_OK` if notification was received;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * Other possible return codes depend on `timeout` value,
+ *      refer to `#TN_TickCnt`
+ *
+ * @see `#TN_TickCnt`
+ */
+enum TN_RCode tn_task_notify_wait(
+      TN_UWord       clear_mask,
+      TN_UWord      *p_value,
+      TN_TickCnt     timeout
+      );
+#endif
+
 /**
  * This function terminates the currently running task. The task is moved to
  * the $(TN_TASK_STATE_DORMANT) state.
@@ -47,6 +47,11 @@
 #include "_tn_timer.h"
 #include "_tn_list.h"
 
+#if TN_TIMER_TASK
+#  include "_tn_tasks.h"
+#  include "tn_tasks.h"
+#endif
+
 
 
 
@@ -56,6 +61,33 @@
 
 
 
+#if TN_TIMER_TASK
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+/*
+ * NOTE: as long as these variables are private, they could be declared as
+ * `static` actually, but for easier debug they are left global.
+ */
+
+/// The timer task, see `#TN_TIMER_TASK`
+struct TN_Task _tn_timer_task;
+
+/// Whether the timer task is created by `tn_timer_task_create()`
+TN_BOOL _tn_timer_task_created = TN_FALSE;
+
+/// List of timers whose callbacks should be called by the timer task
+struct TN_ListItem _tn_timer_list__pending = {
+   &_tn_timer_list__pending, &_tn_timer_list__pending
+};
+
+/// Statistics of the timer task
+struct TN_TimerTaskStat _tn_timer_task_stat;
+#endif
+
+
+
 /*******************************************************************************
  *    DEFINITIONS
  ******************************************************************************/
@@ -109,6 +141,78 @@ _TN_STATIC_INLINE enum TN_RCode _check_param_create(
 // }}}
 
 
+#if TN_TIMER_TASK
+
+/**
+ * Remove the timer from the list of pending callbacks (if it is there), so
+ * that its callback won't be called by the timer task.
+ * Interrupts should be disabled when calling it.
+ */
+static void _timer_pending_remove(struct TN_Timer *timer)
+{
+   if (!_tn_list_is_empty(&(timer->pending_queue))){
+      _tn_list_remove_entry(&(timer->pending_queue));
+      _tn_list_reset(&(timer->pending_queue));
+
+      _tn_timer_task_stat.backlog_cnt--;
+   }
+}
+
+/**
+ * Body of the timer task: take timers from the list of pending callbacks
+ * one by one and call callbacks; when the list is empty, sleep until
+ * `_tn_timer_pending_add()` wakes the task up.
+ */
+static void _timer_task_body(void *par)
+{
+   for (;;){
+      TN_INTSAVE_DATA;
+
+      TN_INT_DIS_SAVE();
+
+      if (_tn_list_is_empty(&_tn_timer_list__pending)){
+         //-- no pending callbacks: put current task to sleep
+         _tn_task_curr_to_wait_action(
+               TN_NULL, TN_WAIT_REASON_SLEEP, TN_WAIT_INFINITE
+               );
+
+         TN_INT_RESTORE();
+         _tn_context_switch_pend_if_needed();
+
+      } else {
+         struct TN_Timer *timer = _tn_list_first_entry(
+               &_tn_timer_list__pending, struct TN_Timer, pending_queue
+               );
+
+         TN_TickCnt delay 
+            = _tn_timer_sys_time_get() - timer->pending_tick_cnt;
+
+         //-- remember callback and user data while interrupts are disabled,
+         //   since the timer might be changed as soon as they are enabled
+         TN_TimerFunc *func = timer->func;
+         void *p_user_data = timer->p_user_data;
+
+         _timer_pending_remove(timer);
+
+         if (delay > _tn_timer_task_stat.delay_max){
+            _tn_timer_task_stat.delay_max = delay;
+         }
+
+         TN_INT_RESTORE();
+
+         //-- call user callback function
+         func(timer, p_user_data);
+      }
+   }
+
+   _TN_UNUSED(par);
+}
+
+#else
+#  define _timer_pending_remove(timer)    /* nothing */
+#endif
+
+
 
 /*******************************************************************************
  *    PUBLIC FUNCTIONS
@@ -129,6 +233,13 @@ enum TN_RCode tn_timer_create(
       //-- just return rc as it is
    } else {
       rc = _tn_timer_create(timer, func, p_user_data);
+
+#if TN_TIMER_TASK
+      if (rc == TN_RC_OK){
+         //-- callbacks of user timers are called by the timer task
+         timer->deferred = TN_TRUE;
+      }
+#endif
    }
 
    return rc;
@@ -139,17 +250,18 @@ enum TN_RCode tn_timer_create(
  */
 enum TN_RCode tn_timer_delete(struct TN_Timer *timer)
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(timer);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
       //-- if timer is active, cancel it first
       rc = _tn_timer_cancel(timer);
+      _timer_pending_remove(timer);
 
       //-- now, delete timer
       timer->id_timer = TN_ID_NONE;
-      tn_arch_sr_restore(sr_saved);
+      TN_INT_RESTORE();
    }
 
    return rc;
@@ -160,13 +272,50 @@ enum TN_RCode tn_timer_delete(struct TN_Timer *timer)
  */
 enum TN_RCode tn_timer_start(struct TN_Timer *timer, TN_TickCnt timeout)
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(timer);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
+      rc = _tn_timer_start(timer, timeout);
+      if (rc == TN_RC_OK){
+         //-- single-shot timer
+         timer->period = 0;
+         timer->overrun_cnt = 0;
+         _timer_pending_remove(timer);
+      }
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_timer.h)
+ */
+enum TN_RCode tn_timer_start_periodic(
+      struct TN_Timer  *timer,
+      TN_TickCnt        timeout,
+      TN_TickCnt        period
+      )
+{
+   TN_INTSAVE_DATA;
+   enum TN_RCode rc = _check_param_generic(timer);
+
+   if (rc != TN_RC_OK){
+      //-- just return rc as it is
+   } else if (period == TN_WAIT_INFINITE || period == 0){
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INT_DIS_SAVE();
       rc = _tn_timer_start(timer, timeout);
-      tn_arch_sr_restore(sr_saved);
+      if (rc == TN_RC_OK){
+         //-- periodic timer: it will be rearmed by the kernel
+         timer->period = period;
+         timer->overrun_cnt = 0;
+         _timer_pending_remove(timer);
+      }
+      TN_INT_RESTORE();
    }
 
    return rc;
@@ -177,13 +326,14 @@ enum TN_RCode tn_timer_start(struct TN_Timer *timer, TN_TickCnt timeout)
  */
 enum TN_RCode tn_timer_cancel(struct TN_Timer *timer)
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(timer);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
       rc = _tn_timer_cancel(timer);
-      tn_arch_sr_restore(sr_saved);
+      _timer_pending_remove(timer);
+      TN_INT_RESTORE();
    }
 
    return rc;
@@ -198,13 +348,13 @@ enum TN_RCode tn_timer_set_func(
       void             *p_user_data
       )
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(timer);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
       rc = _tn_timer_set_func(timer, func, p_user_data);
-      tn_arch_sr_restore(sr_saved);
+      TN_INT_RESTORE();
    }
 
    return rc;
@@ -215,13 +365,13 @@ enum TN_RCode tn_timer_set_func(
  */
 enum TN_RCode tn_timer_is_active(struct TN_Timer *timer, TN_BOOL *p_is_active)
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(timer);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
       *p_is_active = _tn_timer_is_active(timer);
-      tn_arch_sr_restore(sr_saved);
+      TN_INT_RESTORE();
    }
 
    return rc;
@@ -235,18 +385,104 @@ enum TN_RCode tn_timer_time_left(
       TN_TickCnt *p_time_left
       )
 {
-   int sr_saved;
+   TN_INTSAVE_DATA;
    enum TN_RCode rc = _check_param_generic(timer);
 
    if (rc == TN_RC_OK){
-      sr_saved = tn_arch_sr_save_int_dis();
+      TN_INT_DIS_SAVE();
       *p_time_left = _tn_timer_time_left(timer);
-      tn_arch_sr_restore(sr_saved);
+      TN_INT_RESTORE();
    }
 
    return rc;
 }
 
+/*
+ * See comments in the header file (tn_timer.h)
+ */
+enum TN_RCode tn_timer_overrun_cnt_get(
+      struct TN_Timer  *timer,
+      unsigned int     *p_overrun_cnt
+      )
+{
+   TN_INTSAVE_DATA;
+   enum TN_RCode rc = _check_param_generic(timer);
+
+   if (rc == TN_RC_OK){
+      TN_INT_DIS_SAVE();
+      *p_overrun_cnt = timer->overrun_cnt;
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
+#if TN_TIMER_TASK
+
+/*
+ * See comments in the header file (tn_timer.h)
+ */
+enum TN_RCode tn_timer_task_create(
+      TN_UWord   *task_stack_low_addr,
+      int         task_stack_size,
+      int         priority
+      )
+{
+   enum TN_RCode rc = TN_RC_OK;
+   enum TN_Context context = tn_sys_context_get();
+
+   //-- Note: just like `tn_task_create()`, it is allowed to have 
+   //   `#TN_CONTEXT_NONE` here, since it might be called from `tn_sys_start()`
+   if (context != TN_CONTEXT_TASK && context != TN_CONTEXT_NONE){
+      rc = TN_RC_WCONTEXT;
+   } else if (_tn_timer_task_created){
+      rc = TN_RC_WSTATE;
+   } else {
+      rc = tn_task_create_wname(
+            &_tn_timer_task,              //-- task TCB
+            _timer_task_body,             //-- task function
+            priority,                     //-- task priority
+            task_stack_low_addr,          //-- task stack
+            task_stack_size,              //-- task stack size
+                                          //   (in int, not bytes)
+            TN_NULL,                      //-- task function parameter
+            TN_TASK_CREATE_OPT_START,     //-- Creation option
+            "Timer"                       //-- Task name
+            );
+
+      if (rc == TN_RC_OK){
+         TN_INTSAVE_DATA;
+
+         TN_INT_DIS_SAVE();
+         _tn_timer_task_created = TN_TRUE;
+         TN_INT_RESTORE();
+      }
+   }
+
+   return rc;
+}
+
+/*
+ * See comments in the header file (tn_timer.h)
+ */
+enum TN_RCode tn_timer_task_stat_get(struct TN_TimerTaskStat *p_stat)
+{
+   TN_INTSAVE_DATA;
+   enum TN_RCode rc = TN_RC_OK;
+
+   if (p_stat == TN_NULL){
+      rc = TN_RC_WPARAM;
+   } else {
+      TN_INT_DIS_SAVE();
+      *p_stat = _tn_timer_task_stat;
+      TN_INT_RESTORE();
+   }
+
+   return rc;
+}
+
+#endif // TN_TIMER_TASK
+
 
 
 
@@ -273,11 +509,23 @@ enum TN_RCode _tn_timer_create(
 
       _tn_list_reset(&(timer->timer_queue));
 
+      timer->period        = 0;
+      timer->overrun_cnt   = 0;
+
 #if TN_DYNAMIC_TICK
       timer->timeout = 0;
       timer->start_tick_cnt = 0;
+      timer->heap_child = TN_NULL;
+      timer->heap_next = TN_NULL;
+      timer->heap_prev = TN_NULL;
 #else
-      timer->timeout_cur   = 0;
+      timer->expire_tick_cnt = 0;
+#endif
+
+#if TN_TIMER_TASK
+      _tn_list_reset(&(timer->pending_queue));
+      timer->pending_tick_cnt = 0;
+      timer->deferred = TN_FALSE;
 #endif
       timer->id_timer      = TN_ID_TIMER;
 
@@ -317,4 +565,50 @@ TN_BOOL _tn_timer_is_active(struct TN_Timer *timer)
    return (!_tn_list_is_empty(&(timer->timer_queue)));
 }
 
+#if TN_TIMER_TASK
+/**
+ * See comments in the _tn_timer.h file.
+ */
+TN_BOOL _tn_timer_pending_add(struct TN_Timer *timer)
+{
+   TN_BOOL ret = TN_FALSE;
+
+   //-- interrupts should be disabled here
+   _TN_BUG_ON( !TN_IS_INT_DISABLED() );
+
+   if (!timer->deferred || !_tn_timer_task_created){
+      //-- callback should be called right away
+   } else if (!_tn_list_is_empty(&(timer->pending_queue))){
+      //-- periodic timer has expired again, but the callback for the
+      //   previous period is still pending: the period is missed.
+      //   (single-shot timer can't be pending here, since pending callback
+      //   is discarded when timer is started)
+      _TN_BUG_ON(timer->period == 0);
+
+      timer->overrun_cnt++;
+      ret = TN_TRUE;
+   } else {
+      timer->pending_tick_cnt = _tn_timer_sys_time_get();
+      _tn_list_add_tail(&_tn_timer_list__pending, &(timer->pending_queue));
+
+      _tn_timer_task_stat.backlog_cnt++;
+      if (_tn_timer_task_stat.backlog_cnt > _tn_timer_task_stat.backlog_max){
+         _tn_timer_task_stat.backlog_max = _tn_timer_task_stat.backlog_cnt;
+      }
+
+      //-- wake the timer task up, if it sleeps
+      if (     _tn_task_is_waiting(&_tn_timer_task)
+            && _tn_timer_task.task_wait_reason == TN_WAIT_REASON_SLEEP
+         )
+      {
+         _tn_task_wait_complete(&_tn_timer_task, TN_RC_OK);
+      }
+
+      ret = TN_TRUE;
+   }
+
+   return ret;
+}
+#endif
+
 
@@ -52,10 +52,16 @@
  *
  * The timer callback approach provides ultimate flexibility.
  *
- * In the spirit of TNeo, timers are as lightweight as possible. That's
- * why there is only one type of timer: the single-shot timer. If you need your
- * timer to fire repeatedly, you can easily restart it from the timer function
- * by the `tn_timer_start()`, so it's not a problem.
+ * In the spirit of TNeo, timers are as lightweight as possible. A timer
+ * started by `tn_timer_start()` is a single-shot one; if you need your timer
+ * to fire repeatedly, start it by `tn_timer_start_periodic()`. The kernel
+ * rearms the periodic timer right when it expires, relative to the previous
+ * expiration time (not to the time when the callback is called), so the
+ * timer doesn't drift. If the kernel misses some periods (this might happen
+ * if `#TN_DYNAMIC_TICK` is set and `tn_tick_int_processing()` is called too
+ * late, or if `#TN_TIMER_TASK` is set and the callback from the previous
+ * period is still pending), they are counted as overruns, see
+ * `tn_timer_overrun_cnt_get()`.
  *
  * When timer fires, the user-provided function is called. Be aware of the
  * following:
@@ -73,6 +79,11 @@
  *
  * See `#TN_TimerFunc` for the prototype of the function that could be
  * scheduled.
+
+ * If `#TN_TIMER_TASK` is non-zero, and the timer task is created by
+ * `tn_timer_task_create()`, the function is called from that task instead
+ * (see `#TN_TimerFunc` for details).
+ *
  *
  * TNeo offers two implementations of timers: static and dynamic. Refer
  * to the page \ref time_ticks for details.
@@ -124,15 +135,13 @@
  *
  * If the timer expires in the next `1` to `(N - 1)` system ticks, it is added
  * to one of the `N` lists (the so-called "tick" lists) devoted to short-range
- * timers using the least significant bits of the `timeout` value. If it
- * expires farther in the future, it is added to the "generic" list.
+ * timers using the least significant bits of the tick count value at which
+ * the timer expires. If it expires farther in the future, it is added to the
+ * "generic" list.
  *
  * Each `N`-th system tick, all the timers from "generic" list are walked
- * through, and the following is performed with each timer:
- *
- * - `timeout` value decremented by `N`
- * - if resulting `timeout` is less than `N`, timer is moved to the appropriate
- *   "tick" list.
+ * through, and each timer which now expires in less than `N` ticks is moved
+ * to the appropriate "tick" list.
  *
  * At *every* system tick, all the timers from current "tick" list are fired
  * unconditionally. This is an efficient and nice solution.
@@ -148,8 +157,34 @@
  * to the current "tick" list while we are iterating through it. 
  * (although timer can be deleted from that list, but it's ok)
  *
+ * If the application has a lot of timers with long timeouts, walking through
+ * the whole "generic" list each `N`-th tick becomes expensive. For this case,
+ * "tick" lists can be extended to the hierarchical timing wheel with `L`
+ * levels (again, like in Linux): the "tick" lists are the level 0, and each
+ * upper level `K` also has `N` lists, each of them holding timers which
+ * expire in `N^K` to `(N^(K + 1) - 1)` ticks. Now, the tick count value at
+ * which the timer expires is treated as a number in base `N`: the digit `K`
+ * of it is the index of the list in the level `K`. And only the timers which
+ * expire in `N^L` ticks or later are added to the "generic" list.
+ *
+ * When the level `K` is turned around (that is, each `N^(K + 1)`-th system
+ * tick), the timers from the current list of the level `(K + 1)` are moved to
+ * the lower levels (it is called "cascading"); and the "generic" list is
+ * walked through only when the whole wheel is turned around. So, starting,
+ * cancelling and moving of a timer are all done in constant time, and each
+ * timer is cascaded at most `L` times during its life, so the work done per
+ * tick is amortized O(1). Note that it's not O(1) in the worst case: the
+ * tick at which a list is cascaded takes time proportional to the number of
+ * timers in that list (and the tick at which the wheel is turned around also
+ * walks through the "generic" list). Interrupts are enabled for a short while
+ * after each timer is moved, so they are never disabled for too long.
+ *
+ * Since each timer remembers the tick count value at which it expires,
+ * `tn_timer_time_left()` is always precise.
+ *
  * The `N` in the TNeo is configured by the compile-time option
- * `#TN_TICK_LISTS_CNT`.
+ * `#TN_TICK_LISTS_CNT`, and the `L` is configured by
+ * `#TN_TICK_WHEEL_LEVELS`.
  */
 
 
@@ -190,6 +225,14 @@ struct TN_Timer;
  *   - It's legal to call interrupt services from this function;
  *   - The function should be as fast as possible.
  *
+ * If `#TN_TIMER_TASK` is non-zero and the timer task is created, then,
+ * instead, the function is called from the timer task, after all the
+ * callbacks of timers which expired earlier. It's legal to call task services
+ * from the function then, but it must never wait: otherwise, all the other
+ * pending callbacks would wait as well. If the timer is restarted, cancelled
+ * or deleted before its pending callback is called, the callback is
+ * discarded.
+ *
  * @param timer
  *    Timer that caused function to be called
  * @param p_user_data
@@ -215,6 +258,13 @@ struct TN_Timer {
    ///
    /// User data pointer that is given to user-provided `func`.
    void *p_user_data;
+   ///
+   /// Period of the periodic timer, or `0` for single-shot timer
+   TN_TickCnt period;
+   ///
+   /// Number of periods missed since the periodic timer was started, see
+   /// `tn_timer_overrun_cnt_get()`
+   unsigned int overrun_cnt;
 
 #if TN_DYNAMIC_TICK || defined(DOXYGEN_ACTIVE)
    ///
@@ -228,14 +278,50 @@ struct TN_Timer {
    /// Timeout value (it is set just once, and stays unchanged until timer is
    /// expired, cancelled or restarted)
    TN_TickCnt timeout;
+   ///
+   /// $(TN_IF_ONLY_DYNAMIC_TICK_SET)
+   ///
+   /// Links of the heap of active timers: the first child
+   struct TN_Timer *heap_child;
+   ///
+   /// $(TN_IF_ONLY_DYNAMIC_TICK_SET)
+   ///
+   /// Links of the heap of active timers: the next sibling
+   struct TN_Timer *heap_next;
+   ///
+   /// $(TN_IF_ONLY_DYNAMIC_TICK_SET)
+   ///
+   /// Links of the heap of active timers: the previous sibling, or the parent
+   /// if the timer is the first child.
+   struct TN_Timer *heap_prev;
 #endif
 
 #if !TN_DYNAMIC_TICK || defined(DOXYGEN_ACTIVE)
    ///
    /// $(TN_IF_ONLY_DYNAMIC_TICK_NOT_SET)
    ///
-   /// Current (left) timeout value
-   TN_TickCnt timeout_cur;
+   /// Value of system tick counter at which timer expires
+   TN_TickCnt expire_tick_cnt;
+#endif
+
+#if TN_TIMER_TASK || defined(DOXYGEN_ACTIVE)
+   ///
+   /// $(TN_IF_ONLY_TIMER_TASK_SET)
+   ///
+   /// A list item to be included in the list of timers whose callbacks
+   /// should be called by the timer task
+   struct TN_ListItem pending_queue;
+   ///
+   /// $(TN_IF_ONLY_TIMER_TASK_SET)
+   ///
+   /// System tick count value when the callback became pending
+   TN_TickCnt pending_tick_cnt;
+   ///
+   /// $(TN_IF_ONLY_TIMER_TASK_SET)
+   ///
+   /// Whether the callback should be called by the timer task (it is
+   /// `TN_FALSE` for timers used by the kernel itself, i.e. task timeouts)
+   TN_BOOL deferred;
 #endif
 };
 
@@ -282,6 +368,29 @@ typedef TN_TickCnt (TN_CBTickCntGet)(void);
 #endif
 
 
+#if TN_TIMER_TASK || defined(DOXYGEN_ACTIVE)
+
+/**
+ * $(TN_IF_ONLY_TIMER_TASK_SET)
+ *
+ * Statistics of the timer task, see `tn_timer_task_stat_get()`
+ */
+struct TN_TimerTaskStat {
+   ///
+   /// Number of callbacks which are pending at the moment
+   unsigned int      backlog_cnt;
+   ///
+   /// Maximum number of pending callbacks since the system start
+   unsigned int      backlog_max;
+   ///
+   /// Maximum time (in system ticks) that callback was pending before it was
+   /// called, since the system start
+   TN_TickCnt        delay_max;
+};
+
+#endif
+
+
 
 
 /*******************************************************************************
@@ -366,6 +475,45 @@ enum TN_RCode tn_timer_delete(struct TN_Timer *timer);
  */
 enum TN_RCode tn_timer_start(struct TN_Timer *timer, TN_TickCnt timeout);
 
+/**
+ * Start or restart the periodic timer: the timer's function is called
+ * after `timeout` system ticks, and then every `period` system ticks, until
+ * the timer is cancelled or restarted.
+ *
+ * The timer is rearmed by the kernel relative to the previous expiration
+ * time, so, the timer doesn't drift even if the callback is called late.
+ * Number of missed periods is reset to 0, see `tn_timer_overrun_cnt_get()`.
+ *
+ * It is legal to restart already active timer. In this case, the timer will be
+ * cancelled first.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param timer
+ *    Timer to start
+ * @param timeout
+ *    Number of system ticks after which timer should fire for the first time.
+ *    **Note** that `timeout` can't be `#TN_WAIT_INFINITE` or `0`.
+ * @param period
+ *    Number of system ticks between subsequent timer expirations. The same
+ *    restrictions apply as for `timeout`.
+ *
+ * @return 
+ *    * `#TN_RC_OK` if timer was successfully started;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * `#TN_RC_WPARAM` if wrong params were given: say, `timeout` or `period`
+ *      is either `#TN_WAIT_INFINITE` or `0`.
+ *    * If `#TN_CHECK_PARAM` is non-zero, additional return code
+ *      is available: `#TN_RC_INVALID_OBJ`.
+ */
+enum TN_RCode tn_timer_start_periodic(
+      struct TN_Timer  *timer,
+      TN_TickCnt        timeout,
+      TN_TickCnt        period
+      );
+
 /**
  * If timer is active, cancel it. If timer is already inactive, nothing is
  * changed.
@@ -451,6 +599,89 @@ enum TN_RCode tn_timer_time_left(
       TN_TickCnt *p_time_left
       );
 
+/**
+ * Returns how many periods the periodic timer has missed since it was
+ * started by `tn_timer_start_periodic()`. The period is missed if the timer
+ * expires again before the kernel had a chance to call the callback for the
+ * previous expiration: this might happen if `#TN_DYNAMIC_TICK` is set and
+ * `tn_tick_int_processing()` is called too late, or if `#TN_TIMER_TASK` is
+ * set and the callback for the previous period is still pending.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param timer
+ *    Timer to get number of missed periods of
+ * @param p_overrun_cnt
+ *    Pointer to `unsigned int` variable in which number of missed periods is
+ *    stored.
+ *
+ * @return
+ *    * `#TN_RC_OK` if operation was successfull;
+ *    * `#TN_RC_WPARAM` if wrong params were given.
+ */
+enum TN_RCode tn_timer_overrun_cnt_get(
+      struct TN_Timer  *timer,
+      unsigned int     *p_overrun_cnt
+      );
+
+
+#if TN_TIMER_TASK || defined(DOXYGEN_ACTIVE)
+
+/**
+ * $(TN_IF_ONLY_TIMER_TASK_SET)
+ *
+ * Create and start the timer task, which calls callbacks of expired timers
+ * (see `#TN_TIMER_TASK`). Should be called once, typically from the callback
+ * `#TN_CBUserTaskCreate` given to `tn_sys_start()`. Until this function is
+ * called, callbacks are called from the $(TN_SYS_TIMER_LINK) ISR.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CAN_SWITCH_CONTEXT)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param task_stack_low_addr
+ *    Pointer to the stack for the timer task, see `tn_task_create()`.
+ * @param task_stack_size
+ *    Size of task stack array, in words (`#TN_UWord`), not in bytes.
+ * @param priority
+ *    Priority of the timer task, see `tn_task_create()`. Typically, it
+ *    should be higher than that of the tasks which use timers.
+ *
+ * @return
+ *    * `#TN_RC_OK` on success;
+ *    * `#TN_RC_WCONTEXT` if called from wrong context;
+ *    * `#TN_RC_WSTATE` if the timer task is already created;
+ *    * `#TN_RC_WPARAM` if wrong params were given.
+ */
+enum TN_RCode tn_timer_task_create(
+      TN_UWord   *task_stack_low_addr,
+      int         task_stack_size,
+      int         priority
+      );
+
+/**
+ * $(TN_IF_ONLY_TIMER_TASK_SET)
+ *
+ * Get statistics of the timer task: number of pending callbacks and maximum
+ * time the callbacks wait for the timer task.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param p_stat
+ *    Pointer to the structure to which the statistics should be stored.
+ *
+ * @return
+ *    * `#TN_RC_OK` on success;
+ *    * `#TN_RC_WPARAM` if `p_stat` is `TN_NULL`.
+ */
+enum TN_RCode tn_timer_task_stat_get(struct TN_TimerTaskStat *p_stat);
+
+#endif
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
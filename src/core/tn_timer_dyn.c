@@ -45,6 +45,7 @@
 //-- internal tnkernel headers
 #include "_tn_timer.h"
 #include "_tn_list.h"
+#include "_tn_trace.h"
 
 
 //-- header of current module
@@ -77,10 +78,15 @@ TN_CBTickCntGet        *_tn_cb_tick_cnt_get  = TN_NULL;
  ******************************************************************************/
 
 ///
-/// List of active non-expired timers. Timers are sorted in ascending order
-/// by the timeout value.
+/// List of active non-expired timers (unsorted). Each of these timers is
+/// also contained in the heap `_timer_heap_root`.
 static struct TN_ListItem     _timer_list__gen;
 
+///
+/// Root of the pairing heap of active non-expired timers, ordered by the
+/// time left: the root is the timer which expires first.
+static struct TN_Timer       *_timer_heap_root;
+
 
 /// List of expired timers; after it is initialized, it is used only inside
 /// `_tn_timers_tick_proceed()`
@@ -93,12 +99,6 @@ static struct TN_ListItem     _timer_list__fire;
  *    DEFINITIONS
  ******************************************************************************/
 
-/**
- * Get pointer to `struct #TN_Task` by pointer to the `task_queue` member
- * of the `struct #TN_Task`.
- */
-#define _tn_get_timer_by_timer_queue(que)                               \
-   (que ? container_of(que, struct TN_Timer, timer_queue) : 0)
 
 
 
@@ -132,6 +132,163 @@ static TN_TickCnt _time_left_get(
    return time_left;
 }
 
+/**
+ * Meld two heaps: the root with larger time left becomes the first child
+ * of another one. Given roots should have their `heap_next` and `heap_prev`
+ * set to `TN_NULL`.
+ *
+ * @return the root of resulting heap
+ */
+static struct TN_Timer *_heap_meld(
+      struct TN_Timer *timer_a,
+      struct TN_Timer *timer_b,
+      TN_TickCnt cur_sys_tick_cnt
+      )
+{
+   struct TN_Timer *ret = timer_a;
+
+   if (timer_a == TN_NULL){
+      ret = timer_b;
+   } else if (timer_b == TN_NULL){
+      //-- just return timer_a
+   } else {
+      struct TN_Timer *child;
+
+      if (     _time_left_get(timer_b, cur_sys_tick_cnt) 
+            <  _time_left_get(timer_a, cur_sys_tick_cnt)
+         )
+      {
+         ret = timer_b;
+         child = timer_a;
+      } else {
+         child = timer_b;
+      }
+
+      child->heap_prev = ret;
+      child->heap_next = ret->heap_child;
+      if (ret->heap_child != TN_NULL){
+         ret->heap_child->heap_prev = child;
+      }
+      ret->heap_child = child;
+   }
+
+   return ret;
+}
+
+/**
+ * Merge the list of sibling heaps into a single heap, in two passes: first,
+ * meld siblings by pairs from left to right, and then meld resulting heaps
+ * from right to left. This is what keeps the pairing heap balanced.
+ *
+ * @return the root of resulting heap
+ */
+static struct TN_Timer *_heap_merge_pairs(
+      struct TN_Timer *first,
+      TN_TickCnt cur_sys_tick_cnt
+      )
+{
+   struct TN_Timer *ret = TN_NULL;
+
+   //-- melded pairs, linked by `heap_next` in reverse order
+   struct TN_Timer *pairs = TN_NULL;
+
+   while (first != TN_NULL){
+      struct TN_Timer *timer_a = first;
+      struct TN_Timer *timer_b = first->heap_next;
+
+      if (timer_b != TN_NULL){
+         first = timer_b->heap_next;
+         timer_b->heap_next = timer_b->heap_prev = TN_NULL;
+      } else {
+         first = TN_NULL;
+      }
+      timer_a->heap_next = timer_a->heap_prev = TN_NULL;
+
+      timer_a = _heap_meld(timer_a, timer_b, cur_sys_tick_cnt);
+      timer_a->heap_next = pairs;
+      pairs = timer_a;
+   }
+
+   while (pairs != TN_NULL){
+      struct TN_Timer *timer = pairs;
+
+      pairs = timer->heap_next;
+      timer->heap_next = TN_NULL;
+
+      ret = _heap_meld(ret, timer, cur_sys_tick_cnt);
+   }
+
+   return ret;
+}
+
+/**
+ * Remove the timer from the heap, if it is contained there.
+ */
+static void _heap_remove(struct TN_Timer *timer, TN_TickCnt cur_sys_tick_cnt)
+{
+   if (timer == _timer_heap_root){
+      _timer_heap_root = _heap_merge_pairs(
+            timer->heap_child, cur_sys_tick_cnt
+            );
+   } else if (timer->heap_prev != TN_NULL){
+      //-- detach the timer (together with its children) from the heap
+      if (timer->heap_prev->heap_child == timer){
+         //-- timer is the first child, so, heap_prev is the parent
+         timer->heap_prev->heap_child = timer->heap_next;
+      } else {
+         timer->heap_prev->heap_next = timer->heap_next;
+      }
+
+      if (timer->heap_next != TN_NULL){
+         timer->heap_next->heap_prev = timer->heap_prev;
+      }
+
+      //-- and put its children back
+      _timer_heap_root = _heap_meld(
+            _timer_heap_root,
+            _heap_merge_pairs(timer->heap_child, cur_sys_tick_cnt),
+            cur_sys_tick_cnt
+            );
+   } else {
+      //-- timer isn't contained in the heap: it is either inactive or
+      //   already expired (that is, it is in the "fire" list)
+   }
+
+   timer->heap_child = TN_NULL;
+   timer->heap_next  = TN_NULL;
+   timer->heap_prev  = TN_NULL;
+}
+
+/**
+ * Rearm the periodic timer which has just expired: new expiration time is
+ * calculated relative to the previous one, not to the current time, so that
+ * the timer doesn't drift. If `tn_tick_int_processing()` was called so late
+ * that some periods were missed, they are skipped and counted as overruns.
+ *
+ * Timer should be already removed from the heap and from the "fire" list.
+ */
+static void _timer_periodic_rearm(
+      struct TN_Timer *timer,
+      TN_TickCnt expire_tick_cnt,
+      TN_TickCnt cur_sys_tick_cnt
+      )
+{
+   TN_TickCnt late = cur_sys_tick_cnt - expire_tick_cnt;
+
+   if (late >= timer->period){
+      TN_TickCnt missed = late / timer->period;
+
+      timer->overrun_cnt += missed;
+      expire_tick_cnt += missed * timer->period;
+   }
+
+   timer->start_tick_cnt = expire_tick_cnt;
+   timer->timeout = timer->period;
+
+   _timer_heap_root = _heap_meld(_timer_heap_root, timer, cur_sys_tick_cnt);
+   _tn_list_add_tail(&_timer_list__gen, &(timer->timer_queue));
+}
+
 /**
  * Find out when the kernel needs `tn_tick_int_processing()` to be called next
  * time, and eventually call application callback `_tn_cb_tick_schedule()` with
@@ -141,15 +298,9 @@ static void _next_tick_schedule(TN_TickCnt cur_sys_tick_cnt)
 {
    TN_TickCnt next_timeout;
 
-   if (!_tn_list_is_empty(&_timer_list__gen)){
-      //-- need to get first timer from the list and get its timeout
-      //   (this list is sorted, so, the first timer is the one with 
-      //   minimum timeout value)
-      struct TN_Timer *timer_next = _tn_get_timer_by_timer_queue(
-            _timer_list__gen.next
-            );
-
-      next_timeout = _time_left_get(timer_next, cur_sys_tick_cnt);
+   if (_timer_heap_root != TN_NULL){
+      //-- the root of the heap is the timer with minimum time left
+      next_timeout = _time_left_get(_timer_heap_root, cur_sys_tick_cnt);
    } else {
       //-- no timers are active, so, no ticks needed at all
       next_timeout = TN_WAIT_INFINITE;
@@ -161,11 +312,14 @@ static void _next_tick_schedule(TN_TickCnt cur_sys_tick_cnt)
 
 
 /**
- * Cancel the timer: the main thing is that timer is removed from the linked
- * list.
+ * Cancel the timer: the main thing is that timer is removed from the heap
+ * and from the linked list.
  */
-static void _timer_cancel(struct TN_Timer *timer)
+static void _timer_cancel(struct TN_Timer *timer, TN_TickCnt cur_sys_tick_cnt)
 {
+   //-- remove timer from the heap (if it's there)
+   _heap_remove(timer, cur_sys_tick_cnt);
+
    //-- reset timeout and start_tick_cnt to zero (but this is actually not
    //   necessary)
    timer->timeout = 0;
@@ -220,6 +374,9 @@ void _tn_timers_init(void)
 
    //-- reset "current" timers list
    _tn_list_reset(&_timer_list__fire);
+
+   //-- reset the heap
+   _timer_heap_root = TN_NULL;
 }
 
 
@@ -239,30 +396,25 @@ void _tn_timers_tick_proceed(TN_UWord TN_INTSAVE_VAR)
    //-- First of all, get current time
    TN_TickCnt cur_sys_tick_cnt = _tn_timer_sys_time_get();
 
-   //-- Now, walk through timers list from start until we get non-expired timer
-   //   (timers list is sorted)
-   {
-      struct TN_Timer *timer;
-      struct TN_Timer *tmp_timer;
-
-      _tn_list_for_each_entry_safe(
-            timer, struct TN_Timer, tmp_timer,
-            &_timer_list__gen, timer_queue
-            )
-      {
-         //-- timeout value should never be TN_WAIT_INFINITE.
-         _TN_BUG_ON(timer->timeout == TN_WAIT_INFINITE);
-
-         if (_time_left_get(timer, cur_sys_tick_cnt) == 0){
-            //-- it's time to fire the timer, so, move it to the "fire" list
-            //   `_timer_list__fire`
-            _tn_list_remove_entry(&(timer->timer_queue));
-            _tn_list_add_tail(&_timer_list__fire, &(timer->timer_queue));
-         } else {
-            //-- We've got non-expired timer, therefore there are no more
-            //   expired timers.
-            break;
-         }
+   //-- Now, take timers from the root of the heap until we get non-expired
+   //   timer (the root is always the one with minimum time left)
+   while (_timer_heap_root != TN_NULL){
+      struct TN_Timer *timer = _timer_heap_root;
+
+      //-- timeout value should never be TN_WAIT_INFINITE.
+      _TN_BUG_ON(timer->timeout == TN_WAIT_INFINITE);
+
+      if (_time_left_get(timer, cur_sys_tick_cnt) == 0){
+         //-- it's time to fire the timer, so, remove it from the heap and
+         //   move it to the "fire" list `_timer_list__fire`
+         _heap_remove(timer, cur_sys_tick_cnt);
+
+         _tn_list_remove_entry(&(timer->timer_queue));
+         _tn_list_add_tail(&_timer_list__fire, &(timer->timer_queue));
+      } else {
+         //-- We've got non-expired timer, therefore there are no more
+         //   expired timers.
+         break;
       }
    }
 
@@ -270,15 +422,26 @@ void _tn_timers_tick_proceed(TN_UWord TN_INTSAVE_VAR)
    //   through them, firing each one.
    {
       struct TN_Timer *timer;
+      TN_TickCnt expire_tick_cnt;
 
       while (!_tn_list_is_empty(&_timer_list__fire)){
          timer = _tn_list_first_entry(
                &_timer_list__fire, struct TN_Timer, timer_queue
                );
 
+         //-- remember expiration time: it's needed to rearm periodic timer
+         expire_tick_cnt = timer->start_tick_cnt + timer->timeout;
+
          //-- first of all, cancel timer *before* calling callback function, so
          //   that function could start it again if it wants to.
-         _timer_cancel(timer);
+         _timer_cancel(timer, cur_sys_tick_cnt);
+
+         if (timer->period != 0){
+            //-- periodic timer should be rearmed right away
+            _timer_periodic_rearm(timer, expire_tick_cnt, cur_sys_tick_cnt);
+         }
+
+         _tn_trace(TN_TRACE_EV_TIMER_FIRE, timer, (TN_UWord)timer->func);
 
          //-- call user callback function
          _tn_timer_callback_call(timer, TN_INTSAVE_VAR);
@@ -303,51 +466,20 @@ enum TN_RCode _tn_timer_start(struct TN_Timer *timer, TN_TickCnt timeout)
    if (timeout == TN_WAIT_INFINITE || timeout == 0){
       rc = TN_RC_WPARAM;
    } else {
-      //-- cancel the timer
-      _timer_cancel(timer);
-
-      //-- walk through active timers list and get the position at which
-      //   new timer should be placed.
-
       //-- First of all, get current time
       TN_TickCnt cur_sys_tick_cnt = _tn_timer_sys_time_get();
 
-      //-- Since timers list is sorted, we need to find the correct place
-      //   to put new timer at.
-      //
-      //   Initially, we set it to the head of the list, and then walk
-      //   through timers until we found needed place (or until list is over)
-      struct TN_ListItem *list_item = &_timer_list__gen;
-      {
-         struct TN_Timer *timer;
-         struct TN_Timer *tmp_timer;
-
-         _tn_list_for_each_entry_safe(
-               timer, struct TN_Timer, tmp_timer,
-               &_timer_list__gen, timer_queue
-               )
-         {
-            //-- timeout value should never be TN_WAIT_INFINITE.
-            _TN_BUG_ON(timer->timeout == TN_WAIT_INFINITE);
-
-            if (_time_left_get(timer, cur_sys_tick_cnt) < timeout){
-               //-- Probably this is the place for new timer..
-               list_item = &timer->timer_queue;
-            } else {
-               //-- Found timer with larger timeout than that of new timer.
-               //   So, list_item now contains the correct place for new timer.
-               break;
-            }
-         }
-      }
-
-      //-- put timer object at the right position.
-      _tn_list_add_head(list_item, &(timer->timer_queue));
+      //-- cancel the timer
+      _timer_cancel(timer, cur_sys_tick_cnt);
 
       //-- initialize timer with given timeout
       timer->timeout = timeout;
       timer->start_tick_cnt = cur_sys_tick_cnt;
 
+      //-- put timer object to the heap, and to the list of active timers
+      _timer_heap_root = _heap_meld(_timer_heap_root, timer, cur_sys_tick_cnt);
+      _tn_list_add_tail(&_timer_list__gen, &(timer->timer_queue));
+
       //-- find out when `tn_tick_int_processing()` should be called next time,
       //   and tell that to application
       _next_tick_schedule(cur_sys_tick_cnt);
@@ -367,13 +499,14 @@ enum TN_RCode _tn_timer_cancel(struct TN_Timer *timer)
    _TN_BUG_ON( !TN_IS_INT_DISABLED() );
 
    if (_tn_timer_is_active(timer)){
+      TN_TickCnt cur_sys_tick_cnt = _tn_timer_sys_time_get();
 
       //-- cancel the timer
-      _timer_cancel(timer);
+      _timer_cancel(timer, cur_sys_tick_cnt);
 
       //-- find out when `tn_tick_int_processing()` should be called next time,
       //   and tell that to application
-      _next_tick_schedule( _tn_timer_sys_time_get() );
+      _next_tick_schedule(cur_sys_tick_cnt);
    }
 
    return rc;
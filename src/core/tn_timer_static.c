@@ -45,6 +45,7 @@
 //-- internal tnkernel headers
 #include "_tn_timer.h"
 #include "_tn_list.h"
+#include "_tn_trace.h"
 
 
 //-- header of current module
@@ -69,6 +70,12 @@ struct TN_ListItem _tn_timer_list__gen;
 //-- see comments in the file _tn_timer_static.h
 struct TN_ListItem _tn_timer_list__tick[ TN_TICK_LISTS_CNT ];
 
+#if (TN_TICK_WHEEL_LEVELS > 1)
+//-- see comments in the file _tn_timer_static.h
+struct TN_ListItem _tn_timer_list__wheel
+   [ TN_TICK_WHEEL_LEVELS - 1 ][ TN_TICK_LISTS_CNT ];
+#endif
+
 //-- see comments in the file _tn_timer_static.h
 volatile TN_TickCnt _tn_sys_time_count;
 
@@ -99,22 +106,103 @@ volatile TN_TickCnt _tn_sys_time_count;
 #  error TN_TICK_LISTS_CNT must be <= 256
 #endif
 
+#if (TN_TICK_WHEEL_LEVELS < 1)
+#  error TN_TICK_WHEEL_LEVELS must be >= 1
+#endif
+
+//-- Similarly, struct _TN_BuildCfg has just 3-bit field 
+//   `tick_wheel_lvl_minus_one`. Even with the minimal TN_TICK_LISTS_CNT,
+//   8 levels cover 256 ticks; with 16 lists, they cover all 32-bit values.
+#if (TN_TICK_WHEEL_LEVELS > 8)
+#  error TN_TICK_WHEEL_LEVELS must be <= 8
+#endif
+
+
 
 
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
 /**
- * Return index in the array `#_tn_timer_list__tick`, based on given timeout.
+ * Returns the list to which the timer with given expiration tick count
+ * should be added: one of the "tick" lists, one of the lists of upper wheel
+ * levels, or the "generic" list, if the timer expires too far in the future.
  *
- * @param timeout    should be < TN_TICK_LISTS_CNT
+ * Timer is added to the level `N` (0 is the level of "tick" lists) if it
+ * expires in `TN_TICK_LISTS_CNT^N` to `(TN_TICK_LISTS_CNT^(N + 1) - 1)`
+ * ticks; the index in the level is taken from the corresponding digit of
+ * `expire_tick_cnt` (in base `TN_TICK_LISTS_CNT`).
  */
-#define _TICK_LIST_INDEX(timeout)    \
-   (((TN_TickCnt)_tn_sys_time_count + timeout) & TN_TICK_LISTS_MASK)
+static struct TN_ListItem *_timer_list_get(TN_TickCnt expire_tick_cnt)
+{
+   struct TN_ListItem *ret = &_tn_timer_list__gen;
+   TN_TickCnt left = expire_tick_cnt - _tn_sys_time_count;
+
+   if (left < TN_TICK_LISTS_CNT){
+      ret = &_tn_timer_list__tick[ expire_tick_cnt & TN_TICK_LISTS_MASK ];
+   } else {
+#if (TN_TICK_WHEEL_LEVELS > 1)
+      int level;
+
+      for (level = 0; level < (TN_TICK_WHEEL_LEVELS - 1); level++){
+         left            /= TN_TICK_LISTS_CNT;
+         expire_tick_cnt /= TN_TICK_LISTS_CNT;
 
+         if (left < TN_TICK_LISTS_CNT){
+            ret = &_tn_timer_list__wheel
+               [ level ][ expire_tick_cnt & TN_TICK_LISTS_MASK ];
+            break;
+         }
+      }
+#endif
+   }
+
+   return ret;
+}
+
+/**
+ * Take all the timers from the given list, and add each of them to the list
+ * appropriate for the time left (see `_timer_list_get()`). Interrupts are
+ * enabled for a short while after each timer is moved, so that they are
+ * never disabled for too long, no matter how many timers are there.
+ *
+ * @param list
+ *    List to move timers from
+ * @param TN_INTSAVE_VAR
+ *    Status of interrupts, used by `TN_INT_IDIS_SAVE()` and friends.
+ */
+static void _timer_list_cascade(
+      struct TN_ListItem  *list,
+      TN_UWord             TN_INTSAVE_VAR
+      )
+{
+   struct TN_ListItem tmp_list;
 
+   //-- first of all, move all the timers to the temporary list: while
+   //   interrupts are enabled, timers might be cancelled or started, and new
+   //   timers should never get to the list we're walking through.
+   _tn_list_move_all(&tmp_list, list);
 
+   //-- NOTE that we shouldn't use iterators like 
+   //   `_tn_list_for_each_entry_safe()` here, because timers can be removed
+   //   from the list while interrupts are enabled.
+   while (!_tn_list_is_empty(&tmp_list)){
+      struct TN_Timer *timer = _tn_list_first_entry(
+            &tmp_list, struct TN_Timer, timer_queue
+            );
 
-/*******************************************************************************
- *    PRIVATE FUNCTIONS
- ******************************************************************************/
+      _tn_list_remove_entry(&(timer->timer_queue));
+      _tn_list_add_tail(
+            _timer_list_get(timer->expire_tick_cnt),
+            &(timer->timer_queue)
+            );
+
+      //-- let pending interrupts be handled
+      TN_INT_IRESTORE();
+      TN_INT_IDIS_SAVE();
+   }
+}
 
 
 /*******************************************************************************
@@ -144,6 +232,18 @@ void _tn_timers_init(void)
    for (i = 0; i < TN_TICK_LISTS_CNT; i++){
       _tn_list_reset(&_tn_timer_list__tick[i]);
    }
+
+#if (TN_TICK_WHEEL_LEVELS > 1)
+   //-- reset lists of all upper levels of the wheel
+   {
+      int level;
+      for (level = 0; level < (TN_TICK_WHEEL_LEVELS - 1); level++){
+         for (i = 0; i < TN_TICK_LISTS_CNT; i++){
+            _tn_list_reset(&_tn_timer_list__wheel[level][i]);
+         }
+      }
+   }
+#endif
 }
 
 /**
@@ -154,49 +254,50 @@ void _tn_timers_tick_proceed(TN_UWord TN_INTSAVE_VAR)
    //-- first of all, increment system timer
    _tn_sys_time_count++;
 
-   int tick_list_index = _TICK_LIST_INDEX(0);
+   TN_TickCnt time_digits = _tn_sys_time_count;
 
    //-- interrupts should be disabled here
    _TN_BUG_ON( !TN_IS_INT_DISABLED() );
 
-   if (tick_list_index == 0){
-      //-- it happens each TN_TICK_LISTS_CNT-th system tick:
-      //   now we should walk through all the timers in the "generic" timer
-      //   list, decrement the timeout of each one by TN_TICK_LISTS_CNT,
-      //   and if resulting timeout is less than TN_TICK_LISTS_CNT,
-      //   then move that timer to the appropriate "tick" timer list.
-
-      //-- handle "generic" timer list {{{
-      {
-         struct TN_Timer *timer;
-         struct TN_Timer *tmp_timer;
-
-         _tn_list_for_each_entry_safe(
-               timer, struct TN_Timer, tmp_timer,
-               &_tn_timer_list__gen, timer_queue
-               )
-         {
-
-            //-- timeout value should always be >= TN_TICK_LISTS_CNT here.
-            //   And it should never be TN_WAIT_INFINITE.
-            _TN_BUG_ON(0
-                  || timer->timeout_cur == TN_WAIT_INFINITE 
-                  || timer->timeout_cur < TN_TICK_LISTS_CNT
-                  );
+   if ((time_digits & TN_TICK_LISTS_MASK) == 0){
+      //-- it happens each TN_TICK_LISTS_CNT-th system tick: the "tick" lists
+      //   are turned around, so, the next level of the wheel should
+      //   be cascaded: all the timers from its current list are moved to
+      //   the lower levels. If the next level is turned around as well,
+      //   the level above it is cascaded too, and so on.
+      //
+      //   When the whole wheel is turned around, all the timers from the
+      //   "generic" list are re-added: some of them now fit in the wheel.
+      //
+      //   See implementation details in the tn_timer.h file
+
+#if (TN_TICK_WHEEL_LEVELS > 1)
+      int level;
+      struct TN_ListItem *p_list = TN_NULL;
+
+      for (level = 0; level < (TN_TICK_WHEEL_LEVELS - 1); level++){
+         time_digits /= TN_TICK_LISTS_CNT;
 
-            timer->timeout_cur -= TN_TICK_LISTS_CNT;
+         p_list = &_tn_timer_list__wheel
+            [ level ][ time_digits & TN_TICK_LISTS_MASK ];
 
-            if (timer->timeout_cur < TN_TICK_LISTS_CNT){
-               //-- it's time to move this timer to the "tick" list
-               _tn_list_remove_entry(&(timer->timer_queue));
-               _tn_list_add_tail(
-                     &_tn_timer_list__tick[_TICK_LIST_INDEX(timer->timeout_cur)],
-                     &(timer->timer_queue)
-                     );
-            }
+         _timer_list_cascade(p_list, TN_INTSAVE_VAR);
+
+         if ((time_digits & TN_TICK_LISTS_MASK) != 0){
+            //-- this level isn't turned around yet, so the upper ones
+            //   should stay untouched
+            p_list = TN_NULL;
+            break;
          }
       }
-      //}}}
+
+      if (p_list != TN_NULL){
+         //-- the whole wheel is turned around
+         _timer_list_cascade(&_tn_timer_list__gen, TN_INTSAVE_VAR);
+      }
+#else
+      _timer_list_cascade(&_tn_timer_list__gen, TN_INTSAVE_VAR);
+#endif
    }
 
    //-- it happens every system tick:
@@ -208,7 +309,7 @@ void _tn_timers_tick_proceed(TN_UWord TN_INTSAVE_VAR)
       struct TN_Timer *timer;
 
       struct TN_ListItem *p_cur_timer_list = 
-         &_tn_timer_list__tick[ tick_list_index ];
+         &_tn_timer_list__tick[ _tn_sys_time_count & TN_TICK_LISTS_MASK ];
 
       //-- now, p_cur_timer_list is a list of timers that we should
       //   fire NOW, unconditionally.
@@ -222,17 +323,38 @@ void _tn_timers_tick_proceed(TN_UWord TN_INTSAVE_VAR)
       //   Although timers could be removed from the list, note that
       //   new timer can't be added to it
       //   (because timeout 0 is disallowed, and timer with timeout
-      //   TN_TICK_LISTS_CNT is added to the "generic" list),
+      //   TN_TICK_LISTS_CNT is added to the upper level of the wheel),
       //   see implementation details in the tn_timer.h file
       while (!_tn_list_is_empty(p_cur_timer_list)){
          timer = _tn_list_first_entry(
                p_cur_timer_list, struct TN_Timer, timer_queue
                );
 
+         //-- timer from the current "tick" list should always expire now
+         _TN_BUG_ON(timer->expire_tick_cnt != _tn_sys_time_count);
+
          //-- first of all, cancel timer, so that 
          //   callback function could start it again if it wants to.
          _tn_timer_cancel(timer);
 
+         if (timer->period != 0){
+            //-- periodic timer should be rearmed right away, relative to the
+            //   current expiration time (which is `_tn_sys_time_count`),
+            //   so that it doesn't drift. Callback function is still able to
+            //   restart or cancel it.
+            //
+            //   Since period is never 0, timer can't get to the current
+            //   "tick" list.
+            timer->expire_tick_cnt = _tn_sys_time_count + timer->period;
+
+            _tn_list_add_tail(
+                  _timer_list_get(timer->expire_tick_cnt),
+                  &(timer->timer_queue)
+                  );
+         }
+
+         _tn_trace(TN_TRACE_EV_TIMER_FIRE, timer, (TN_UWord)timer->func);
+
          //-- call user callback function
          _tn_timer_callback_call(timer, TN_INTSAVE_VAR);
       }
@@ -259,22 +381,15 @@ enum TN_RCode _tn_timer_start(struct TN_Timer *timer, TN_TickCnt timeout)
       //-- if timer is active, cancel it first
       if ((rc = _tn_timer_cancel(timer)) == TN_RC_OK){
 
-         if (timeout < TN_TICK_LISTS_CNT){
-            //-- timer should be added to the one of "tick" lists.
-            int tick_list_index = _TICK_LIST_INDEX(timeout);
-            timer->timeout_cur = tick_list_index;
+         //-- remember when the timer expires, and add it to the appropriate
+         //   list: one of "tick" lists, one of the lists of upper wheel
+         //   levels, or the "generic" list.
+         timer->expire_tick_cnt = _tn_sys_time_count + timeout;
 
-            _tn_list_add_tail(
-                  &_tn_timer_list__tick[ tick_list_index ],
-                  &(timer->timer_queue)
-                  );
-         } else {
-            //-- timer should be added to the "generic" list.
-            //   We should set timeout_cur adding current "tick" index to it.
-            timer->timeout_cur = timeout + _TICK_LIST_INDEX(0);
-
-            _tn_list_add_tail(&_tn_timer_list__gen, &(timer->timer_queue));
-         }
+         _tn_list_add_tail(
+               _timer_list_get(timer->expire_tick_cnt),
+               &(timer->timer_queue)
+               );
       }
    }
 
@@ -292,8 +407,8 @@ enum TN_RCode _tn_timer_cancel(struct TN_Timer *timer)
    _TN_BUG_ON( !TN_IS_INT_DISABLED() );
 
    if (_tn_timer_is_active(timer)){
-      //-- reset timeout to zero (but this is actually not necessary)
-      timer->timeout_cur = 0;
+      //-- reset expiration time to zero (but this is actually not necessary)
+      timer->expire_tick_cnt = 0;
 
       //-- remove entry from timer queue
       _tn_list_remove_entry(&(timer->timer_queue));
@@ -316,19 +431,10 @@ TN_TickCnt _tn_timer_time_left(struct TN_Timer *timer)
    _TN_BUG_ON( !TN_IS_INT_DISABLED() );
 
    if (_tn_timer_is_active(timer)){
-      TN_TickCnt tick_list_index = _TICK_LIST_INDEX(0);
-
-      if (timer->timeout_cur > tick_list_index){
-         time_left = timer->timeout_cur - tick_list_index;
-      } else if (timer->timeout_cur < tick_list_index){
-         time_left = timer->timeout_cur + TN_TICK_LISTS_CNT - tick_list_index;
-      } else {
-#if TN_DEBUG
-         //-- timer->timeout_cur should never be equal to tick_list_index here
-         //   (if it is, timer is inactive, so, we don't get here)
-         _TN_FATAL_ERROR();
-#endif
-      }
+      //-- NOTE: it might be 0 if the timer is about to be fired during the
+      //   current system tick (i.e. if it's called from the callback of
+      //   another timer)
+      time_left = timer->expire_tick_cnt - _tn_sys_time_count;
    }
 
    return time_left;
@@ -0,0 +1,267 @@
+/*******************************************************************************
+ *
+ * TNeo: real-time kernel initially based on TNKernel
+ *
+ *    TNKernel:                  copyright 2004, 2013 Yuri Tiomkin.
+ *    PIC32-specific routines:   copyright 2013, 2014 Anders Montonen.
+ *    TNeo:                      copyright 2014       Dmitry Frank.
+ *
+ *    TNeo was born as a thorough review and re-implementation of
+ *    TNKernel. The new kernel has well-formed code, inherited bugs are fixed
+ *    as well as new features being added, and it is tested carefully with
+ *    unit-tests.
+ *
+ *    API is changed somewhat, so it's not 100% compatible with TNKernel,
+ *    hence the new name: TNeo.
+ *
+ *    Permission to use, copy, modify, and distribute this software in source
+ *    and binary forms and its documentation for any purpose and without fee
+ *    is hereby granted, provided that the above copyright notice appear
+ *    in all copies and that both that copyright notice and this permission
+ *    notice appear in supporting documentation.
+ *
+ *    THIS SOFTWARE IS PROVIDED BY THE DMITRY FRANK AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *    PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL DMITRY FRANK OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *    THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ******************************************************************************/
+
+
+/**
+ * \file
+ *
+ * Kernel event trace.
+ *
+ * If `#TN_TRACE` is non-zero, the kernel writes compact timestamped binary
+ * records about key events (context switches, tasks starting and finishing
+ * waiting, mutexes being locked and unlocked, data going through queues,
+ * timers firing) to the ring buffer `struct #TN_TraceBuf`. It is the
+ * alternative to logic analyzer for diagnosing scheduling latency in the
+ * field.
+ *
+ * Writing a record takes a few dozen cycles: the kernel writes records with
+ * interrupts already disabled, so no additional locking is needed. When the
+ * buffer is full, the oldest records are overwritten.
+ *
+ * Timestamps are taken from the same source as profiler's ones: if
+ * `#TN_PROFILER_TIMESTAMP` is non-zero, it is the user-provided
+ * high-resolution timestamp (see `tn_callback_profiler_timestamp_set()`);
+ * otherwise, it is the system tick count, which is generally too coarse
+ * for latency measurements.
+ *
+ * To analyze the trace, take a snapshot of `sizeof(struct TN_TraceBuf)`
+ * bytes at the address returned by `tn_trace_buf_get()` (say, by the
+ * debugger, or send it through UART), and feed it to the host-side decoder
+ * `stuff/tntrace/tntrace_decode.py`: it prints the timeline of events and
+ * per-task latency histograms. The header of the buffer contains all the
+ * information the decoder needs (sizes of the types and so on), so the
+ * decoder doesn't need to know the target architecture. Since the snapshot
+ * contains raw addresses of the kernel objects, you may give the decoder a
+ * file which maps addresses to names (say, produced from the `.map` file).
+ *
+ * To keep the buffer intact for post-mortem analysis, stop tracing by
+ * `tn_trace_active_set()` as soon as the problem is detected.
+ */
+
+#ifndef _TN_TRACE_H
+#define _TN_TRACE_H
+
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+#include "tn_common.h"
+
+
+
+#ifdef __cplusplus
+extern "C"  {     /*}*/
+#endif
+
+/*******************************************************************************
+ *    PUBLIC TYPES
+ ******************************************************************************/
+
+/**
+ * Kernel events which are written to the trace buffer. For each event,
+ * meaning of the fields `p_obj` and `param` of `struct #TN_TraceRec` is
+ * given.
+ *
+ * \attention Values are part of the binary trace format understood by the
+ * decoder `stuff/tntrace/tntrace_decode.py`, so, they must not be changed;
+ * new events may only be added to the end.
+ */
+enum TN_TraceEvent {
+   ///
+   /// Context switch: `p_obj` is the task which is going to run,
+   /// `param` is the task which was running.
+   TN_TRACE_EV_CONTEXT_SWITCH    = 1,
+   ///
+   /// Task starts waiting: `p_obj` is the task,
+   /// `param` is the wait reason (`enum #TN_WaitReason`).
+   TN_TRACE_EV_TASK_WAIT         = 2,
+   ///
+   /// Task finishes waiting: `p_obj` is the task,
+   /// `param` is the wait result (`enum #TN_RCode`).
+   TN_TRACE_EV_TASK_WAIT_END     = 3,
+   ///
+   /// Mutex is locked: `p_obj` is the mutex,
+   /// `param` is the task which has locked it.
+   TN_TRACE_EV_MUTEX_LOCK        = 4,
+   ///
+   /// Mutex is unlocked: `p_obj` is the mutex,
+   /// `param` is the task which has unlocked it.
+   TN_TRACE_EV_MUTEX_UNLOCK      = 5,
+   ///
+   /// Data is sent to the queue: `p_obj` is the queue,
+   /// `param` is the data pointer.
+   TN_TRACE_EV_QUEUE_SEND        = 6,
+   ///
+   /// Data is received from the queue: `p_obj` is the queue,
+   /// `param` is the data pointer.
+   TN_TRACE_EV_QUEUE_RECEIVE     = 7,
+   ///
+   /// Timer fires: `p_obj` is the timer,
+   /// `param` is the timer's callback function.
+   TN_TRACE_EV_TIMER_FIRE        = 8,
+   ///
+   /// Message is put to the message queue (see `tn_msgq.h`): `p_obj` is the
+   /// message queue, `param` is the sender's buffer the message is copied
+   /// from.
+   TN_TRACE_EV_MSGQ_SEND         = 9,
+   ///
+   /// Message is taken from the message queue: `p_obj` is the message
+   /// queue, `param` is the receiver's buffer the message is copied to.
+   TN_TRACE_EV_MSGQ_RECEIVE      = 10,
+};
+
+/**
+ * Trace record, see `enum #TN_TraceEvent`.
+ */
+struct TN_TraceRec {
+   ///
+   /// Time of the event: either high-resolution timestamp (if
+   /// `#TN_PROFILER_TIMESTAMP` is non-zero) or system tick count
+   unsigned long        timestamp;
+   ///
+   /// Kernel object the event is related to
+   const void          *p_obj;
+   ///
+   /// Event-specific parameter
+   TN_UWord             param;
+   ///
+   /// Event, see `enum #TN_TraceEvent`
+   TN_UWord             event;
+};
+
+/**
+ * Trace ring buffer. The header contains everything the decoder needs to
+ * parse the records on the host.
+ */
+struct TN_TraceBuf {
+   ///
+   /// Magic number `#TN_TRACE_MAGIC`, by which the decoder validates the
+   /// snapshot (and finds out the byte order)
+   unsigned long        magic;
+   ///
+   /// `sizeof(unsigned long)`
+   unsigned char        long_size;
+   ///
+   /// `sizeof(void *)`
+   unsigned char        ptr_size;
+   ///
+   /// `sizeof(#TN_UWord)`
+   unsigned char        word_size;
+   ///
+   /// `sizeof(struct #TN_TraceRec)`
+   unsigned char        rec_size;
+   ///
+   /// Capacity of the buffer (`#TN_TRACE_RECS_CNT`)
+   TN_UWord             recs_cnt;
+   ///
+   /// Free-running counter of written records; index of the next record to
+   /// write is `(wr_cnt % recs_cnt)`.
+   volatile TN_UWord    wr_cnt;
+   ///
+   /// Whether the kernel writes records, see `tn_trace_active_set()`
+   volatile TN_UWord    active;
+   ///
+   /// Records
+   struct TN_TraceRec   recs[ TN_TRACE_RECS_CNT ];
+};
+
+
+
+
+/*******************************************************************************
+ *    PROTECTED GLOBAL DATA
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/// Magic number in the header of trace buffer: "TNTR" in ASCII
+#define  TN_TRACE_MAGIC       0x544E5452UL
+
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+#if TN_TRACE || defined(DOXYGEN_ACTIVE)
+
+/**
+ * $(TN_IF_ONLY_TRACE_SET)
+ *
+ * Returns pointer to the trace buffer; it is needed to take a snapshot
+ * for the decoder.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CALL_FROM_MAIN)
+ * $(TN_LEGEND_LINK)
+ */
+const struct TN_TraceBuf *tn_trace_buf_get(void);
+
+/**
+ * $(TN_IF_ONLY_TRACE_SET)
+ *
+ * Start or stop writing trace records. Tracing is active by default; it's
+ * useful to stop it when some problem is detected, so that the records
+ * which led to the problem aren't overwritten until the snapshot is taken.
+ *
+ * $(TN_CALL_FROM_TASK)
+ * $(TN_CALL_FROM_ISR)
+ * $(TN_CALL_FROM_MAIN)
+ * $(TN_LEGEND_LINK)
+ *
+ * @param active
+ *    Whether the kernel should write trace records
+ */
+void tn_trace_active_set(TN_BOOL active);
+
+#endif
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif // _TN_TRACE_H
+
+/*******************************************************************************
+ *    end of file
+ ******************************************************************************/
+
+
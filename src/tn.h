@@ -50,13 +50,21 @@
 
 #include "core/tn_sys.h"
 #include "core/tn_common.h"
+#include "core/tn_dpc.h"
 #include "core/tn_dqueue.h"
 #include "core/tn_eventgrp.h"
 #include "core/tn_fmem.h"
+#include "core/tn_heap.h"
+#include "core/tn_int_dis_stat.h"
+#include "core/tn_msgq.h"
 #include "core/tn_mutex.h"
+#include "core/tn_ring.h"
 #include "core/tn_sem.h"
+#include "core/tn_slab.h"
+#include "core/tn_stream.h"
 #include "core/tn_tasks.h"
 #include "core/tn_timer.h"
+#include "core/tn_trace.h"
 
 
 //-- include old symbols for compatibility with old projects
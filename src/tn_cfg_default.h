@@ -113,7 +113,7 @@
  * (which has the lowest priority). This value can't be higher than
  * architecture-dependent value `#TN_PRIORITIES_MAX_CNT`, which typically
  * equals to width of `int` type. So, for 32-bit systems, max number of
- * priorities is 32.
+ * priorities is 32. If you need more, refer to `#TN_PRIORITIES_2LEVEL_BMP`.
  *
  * But usually, application needs much less: I can imagine **at most** 4-5
  * different priorities, plus one for the idle task.
@@ -130,6 +130,25 @@
 #  define TN_PRIORITIES_CNT      TN_PRIORITIES_MAX_CNT
 #endif
 
+/**
+ * Whether the kernel should use two-level bitmap of priorities with runnable
+ * tasks. It allows to have more priorities than `#TN_PRIORITIES_MAX_CNT`: up
+ * to `(#TN_PRIORITIES_MAX_CNT * #TN_INT_WIDTH)`, i.e. 1024 priorities on
+ * 32-bit systems and 256 on 16-bit ones.
+ *
+ * Priorities are split into groups of `#TN_INT_WIDTH` priorities each; there
+ * is a bitmap word for each group, plus the top-level word whose bits
+ * indicate groups that have at least one runnable task. So, the next task to
+ * run is still found in constant time: just two find-first-set operations,
+ * independently of `#TN_PRIORITIES_CNT`.
+ *
+ * If you don't need more than `#TN_PRIORITIES_MAX_CNT` priorities, leave this
+ * option off: single-level bitmap is a bit faster and smaller.
+ */
+#ifndef TN_PRIORITIES_2LEVEL_BMP
+#  define TN_PRIORITIES_2LEVEL_BMP  0
+#endif
+
 /**
  * Enables additional param checking for most of the system functions.
  * It's surely useful for debug, but probably better to remove in release.
@@ -192,6 +211,64 @@
 #  define TN_MUTEX_DEADLOCK_DETECT  1
 #endif
 
+/**
+ * Whether uncontended mutexes should be locked and unlocked without
+ * disabling interrupts: `tn_mutex_lock()` and `tn_mutex_unlock()` just
+ * perform atomic compare-and-swap of the mutex lock word (LDREX/STREX on
+ * Cortex-M3/M4/M7, LL/SC on PIC32), and enter the kernel only if the mutex
+ * is already locked by another task, or if someone waits for it.
+ *
+ * The fast path is taken for mutexes with `#TN_MUTEX_PROT_INHERIT` protocol,
+ * and for mutexes with `#TN_MUTEX_PROT_CEILING` protocol if only the base
+ * priority of the task is equal to the ceiling priority (since otherwise
+ * the priority of the task should be elevated, which is done by the kernel).
+ *
+ * While the mutex locked through the fast path is not contended, the kernel
+ * doesn't know about it, so `holder` field of `struct #TN_Mutex` is
+ * `TN_NULL`; the kernel takes over the mutex as soon as another task tries
+ * to lock it.
+ *
+ * On architectures without exclusive access instructions (Cortex-M0/M0+,
+ * PIC24/dsPIC), compare-and-swap is implemented by disabling interrupts
+ * for a few instructions.
+ */
+#ifndef TN_MUTEX_FAST_LOCK
+#  define TN_MUTEX_FAST_LOCK     0
+#endif
+
+/**
+ * Whether direct-to-task notifications should be available: each task gets
+ * a notification value which other tasks and ISRs may modify, waking the
+ * task up, so that separate semaphore or event group isn't needed just for
+ * signalling the particular task. Costs one word plus one bit per task.
+ *
+ * Disabled by default, so that applications which don't use notifications
+ * don't pay for it.
+ *
+ * @see `tn_task_notify()`
+ * @see `tn_task_notify_wait()`
+ */
+#ifndef TN_TASK_NOTIFY
+#  define TN_TASK_NOTIFY         0
+#endif
+
+/**
+ * Whether tasks waiting for event group should be indexed by the event bits
+ * they wait for. If set, tasks waiting for exactly one bit are kept in the
+ * separate list for each bit, so that `tn_eventgrp_modify()` and friends
+ * only visit tasks waiting for the bits that have just been set, instead of
+ * checking all waiting tasks with interrupts disabled. Tasks waiting for
+ * several bits at once are still checked one by one. Wake order and
+ * `#TN_EVENTGRP_WMODE_AUTOCLR` semantics are the same as without the index.
+ *
+ * It makes sense when many tasks wait for the same event group, each for its
+ * own bit. It costs two pointers per bit of `#TN_UWord` (i.e. 256 bytes on
+ * 32-bit systems) for each event group, plus one word per task.
+ */
+#ifndef TN_EVENTGRP_BIT_INDEX
+#  define TN_EVENTGRP_BIT_INDEX  0
+#endif
+
 /**
  *
  * <i>Takes effect if only `#TN_DYNAMIC_TICK` is <B>not set</B></i>.
@@ -213,6 +290,33 @@
 #  define TN_TICK_LISTS_CNT    8
 #endif
 
+/**
+ *
+ * <i>Takes effect if only `#TN_DYNAMIC_TICK` is <B>not set</B></i>.
+ *
+ * Number of levels of the timing wheel; minimum value: `1`, maximum value:
+ * `8`. Each level except the first one takes `#TN_TICK_LISTS_CNT` additional
+ * elements of `struct TN_ListItem`.
+ *
+ * Refer to the \ref timers_static_implementation for details.
+ *
+ * Shortly: timers which expire farther than `#TN_TICK_LISTS_CNT` to the power
+ * of `TN_TICK_WHEEL_LEVELS` ticks in the future are kept in the single
+ * "generic" list, which is walked through each time the whole wheel turns
+ * around. All other timers are moved between levels of the wheel in constant
+ * time each, so, the work done by $(TN_SYS_TIMER_LINK) ISR is amortized
+ * constant per tick; the worst case is the tick at which some list is
+ * cascaded, its cost is proportional to the number of timers in that list.
+ *
+ * The default value `1` means there is just a single level of "tick" lists,
+ * as it was in earlier versions of the kernel. If your application has a lot
+ * of timers with long timeouts, consider incrementing this value so that
+ * `(TN_TICK_LISTS_CNT ^ TN_TICK_WHEEL_LEVELS)` covers your longest timeout.
+ */
+#ifndef TN_TICK_WHEEL_LEVELS
+#  define TN_TICK_WHEEL_LEVELS    1
+#endif
+
 
 /**
  * API option for `MAKE_ALIG()` macro.
@@ -270,6 +374,70 @@
 #  define TN_PROFILER_WAIT_TIME  0
 #endif
 
+/**
+ * Whether profiler should measure time by the high-resolution timestamp
+ * instead of system ticks. By default, profiler measures time in system
+ * ticks, so, the task which runs for less than one tick shows up as zero.
+ *
+ * If this option is non-zero, you should provide the callback which returns
+ * current timestamp (say, the value of some free-running hardware counter)
+ * by calling `tn_callback_profiler_timestamp_set()` before
+ * `tn_sys_start()`. Some architectures have ready-made timestamp source:
+ * see `tn_arch_timestamp_get()`.
+ *
+ * Relevant if only `#TN_PROFILER` or `#TN_TRACE` is non-zero, or if
+ * \ref tn_dpc.h "DPC objects" are used (for drain latency statistics).
+ */
+#ifndef TN_PROFILER_TIMESTAMP
+#  define TN_PROFILER_TIMESTAMP  0
+#endif
+
+/**
+ * Whether kernel event trace should be enabled: the kernel writes
+ * timestamped binary records about context switches, task waits, mutex and
+ * queue operations and timer fires to the ring buffer, which can be decoded
+ * offline on the host. Enabling this option adds a few dozen cycles of
+ * overhead to each traced event. See `tn_trace.h` for details.
+ *
+ * Records are timestamped in the same way as profiler's ones: see
+ * `#TN_PROFILER_TIMESTAMP` (which is relevant for the trace regardless of
+ * `#TN_PROFILER`).
+ *
+ * @see `#TN_TRACE_RECS_CNT`
+ * @see `tn_trace_buf_get()`
+ */
+#ifndef TN_TRACE
+#  define TN_TRACE               0
+#endif
+
+/**
+ * Capacity of the trace ring buffer, in records; should be a power of two.
+ * Each record takes 4 words on 32-bit targets, so the default buffer
+ * takes 4 KB.
+ *
+ * Relevant if only `#TN_TRACE` is non-zero.
+ */
+#ifndef TN_TRACE_RECS_CNT
+#  define TN_TRACE_RECS_CNT      256
+#endif
+
+/**
+ * Whether the duration of each critical section should be measured: if
+ * this option is non-zero, macros `TN_INT_DIS_SAVE()` / `TN_INT_RESTORE()`
+ * and friends timestamp each critical section, and the kernel keeps maximum
+ * duration and histogram of durations for each call site. It allows to find
+ * out which kernel service is responsible for the worst interrupt latency.
+ * See `tn_int_dis_stat.h` for details.
+ *
+ * It's a debug tool: it adds overhead to each critical section and takes
+ * RAM for each call site. `#TN_PROFILER_TIMESTAMP` must be set as well.
+ *
+ * @see `tn_int_dis_stat_sites_get()`
+ */
+#ifndef TN_INT_DIS_STAT
+#  define TN_INT_DIS_STAT        0
+#endif
+
 /**
  * Whether interrupt stack space should be initialized with
  * `#TN_FILL_STACK_VAL` on system start. It is useful to disable this option if
@@ -335,6 +503,28 @@
 #endif
 
 
+/**
+ * Whether callbacks of the timers created by `tn_timer_create()` should be
+ * called from the dedicated kernel task (the "timer task") instead of the
+ * $(TN_SYS_TIMER_LINK) ISR.
+ *
+ * When this option is non-zero, the $(TN_SYS_TIMER_LINK) ISR merely moves
+ * expired timers to the list of pending callbacks and wakes up the timer
+ * task, which calls callbacks one by one, with interrupts enabled. So, slow
+ * callback no longer affects interrupt latency of the whole system. Timeouts
+ * of waiting tasks are still handled right in the ISR.
+ *
+ * The timer task should be created by `tn_timer_task_create()`, which allows
+ * to specify its stack and priority. Until it is created, callbacks are
+ * called from the ISR as usual.
+ *
+ * @see `tn_timer_task_stat_get()`
+ */
+#ifndef TN_TIMER_TASK
+#  define TN_TIMER_TASK          0
+#endif
+
+
 /**
  * Whether the old TNKernel events API compatibility mode is active.
  *
@@ -391,6 +581,37 @@
 
 
 
+/*******************************************************************************
+ *    Cortex-M-specific configuration
+ ******************************************************************************/
+
+
+/**
+ * Maximum system interrupt priority on Cortex-M3/M4/M4F (ARMv7-M), as a raw
+ * value of the priority register (that is, already shifted to the
+ * implemented most significant bits; say, for the priority 2 on the MCU with
+ * 4 priority bits, it is `0x20`). Subpriority bits, if any, should be zero.
+ *
+ * If it is 0 (default), kernel critical sections disable all interrupts by
+ * PRIMASK.
+ *
+ * Otherwise, kernel critical sections (including context switch) mask only
+ * interrupts with priority `TN_MAX_SYSCALL_PRIORITY` and lower (i.e. with
+ * numerically greater or equal priority values), by the BASEPRI register.
+ * These are the <i>system interrupts</i>: only they are allowed to call
+ * kernel services. Interrupts with higher priority are <i>user
+ * interrupts</i>: they are never delayed by the kernel, but they must not
+ * call kernel services. If `#TN_DEBUG` is set, the kernel checks that, see
+ * \ref cortex_m_interrupts "Cortex-M interrupts" for details.
+ *
+ * Cortex-M0/M0+/M1 don't have BASEPRI, so this option should be 0 there.
+ */
+#ifndef TN_MAX_SYSCALL_PRIORITY
+#  define TN_MAX_SYSCALL_PRIORITY   0
+#endif
+
+
+
 /*******************************************************************************
  *    PIC24/dsPIC-specific configuration
  ******************************************************************************/
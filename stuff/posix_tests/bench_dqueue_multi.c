@@ -0,0 +1,131 @@
+/*
+ * Benchmark of data queue throughput: items sent and received one by one
+ * (`tn_queue_send_polling()` / `tn_queue_receive_polling()`) against the
+ * batch services (`tn_queue_send_multi_polling()` /
+ * `tn_queue_receive_multi_polling()`), for several burst sizes, with and
+ * without the event group connected to the queue.
+ *
+ * On the host, disabling/enabling interrupts is a syscall, so the ratio is
+ * larger than it will be on the real hardware, where the savings come from
+ * fewer parameter checks, critical sections and event group updates.
+ */
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  BURST_MAX            64
+
+//-- number of items to send and receive for each measurement
+#define  ITEMS_TOTAL          (1 << 18)
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_DQueue    _dque;
+static struct TN_EventGrp  _eventgrp;
+
+static void *_dque_fifo[BURST_MAX];
+
+static void *_items[BURST_MAX];
+static void *_received[BURST_MAX];
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Send and receive `ITEMS_TOTAL` items one by one, by bursts of `burst`
+ * items; returns nanoseconds per item.
+ */
+static unsigned long _per_item_ns(int burst)
+{
+   unsigned long start = test_ns();
+   int round;
+   int i;
+
+   for (round = 0; round < ITEMS_TOTAL / burst; round++){
+      for (i = 0; i < burst; i++){
+         tn_queue_send_polling(&_dque, _items[i]);
+      }
+      for (i = 0; i < burst; i++){
+         tn_queue_receive_polling(&_dque, &_received[i]);
+      }
+   }
+
+   return (test_ns() - start) / ITEMS_TOTAL;
+}
+
+/**
+ * The same as `_per_item_ns()`, but by the batch services.
+ */
+static unsigned long _multi_ns(int burst)
+{
+   unsigned long start = test_ns();
+   int round;
+   int cnt;
+
+   for (round = 0; round < ITEMS_TOTAL / burst; round++){
+      tn_queue_send_multi_polling(&_dque, _items, burst, &cnt);
+      TEST_CHECK(cnt == burst);
+      tn_queue_receive_multi_polling(&_dque, _received, burst, &cnt);
+      TEST_CHECK(cnt == burst);
+   }
+
+   return (test_ns() - start) / ITEMS_TOTAL;
+}
+
+static void _bench(TN_BOOL eventgrp_connect)
+{
+   int burst;
+
+   printf("send + receive, event group %s:\n",
+         eventgrp_connect ? "connected" : "not connected"
+         );
+
+   for (burst = 8; burst <= BURST_MAX; burst *= 2){
+      TEST_CHECK(tn_queue_create(&_dque, _dque_fifo, burst) == TN_RC_OK);
+
+      if (eventgrp_connect){
+         TEST_CHECK(
+               tn_queue_eventgrp_connect(&_dque, &_eventgrp, 0x01)
+               == TN_RC_OK
+               );
+      }
+
+      printf("  burst %2d: per-item %5lu, multi %5lu ns/item\n",
+            burst, _per_item_ns(burst), _multi_ns(burst)
+            );
+
+      TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+   }
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int i;
+
+   for (i = 0; i < BURST_MAX; i++){
+      _items[i] = &_items[i];
+   }
+
+   TEST_CHECK(tn_eventgrp_create(&_eventgrp, 0) == TN_RC_OK);
+
+   _bench(TN_FALSE);
+   _bench(TN_TRUE);
+}
@@ -0,0 +1,156 @@
+/*
+ * Benchmark of find-first-set used by the scheduler (`_tn_bmp_ffs()`).
+ *
+ * The same source is built with port-provided `_TN_FFS()` and with each of
+ * generic algorithms (see `TN_POSIX_FFS_GENERIC` in Makefile). For each bit
+ * position, the program checks the result against `__builtin_ffs()` and
+ * measures the average time of a call, so one can see whether the time
+ * depends on the position of the lowest set bit.
+ */
+
+#include "test_common.h"
+#include "_tn_sys.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+//-- number of calls per bit position
+#define  ITERATIONS_CNT       (1 << 22)
+
+//-- number of different inputs per bit position, should be a power of two
+#define  INPUTS_CNT           256
+
+#if defined(_TN_FFS)
+#  define  VARIANT_NAME    "_TN_FFS() (__builtin_ffs)"
+#elif (_TN_FFS_GENERIC == _TN_FFS_GENERIC__DEBRUIJN)
+#  define  VARIANT_NAME    "_TN_FFS_GENERIC__DEBRUIJN"
+#elif (_TN_FFS_GENERIC == _TN_FFS_GENERIC__LUT)
+#  define  VARIANT_NAME    "_TN_FFS_GENERIC__LUT"
+#else
+#  define  VARIANT_NAME    "_TN_FFS_GENERIC__LOOP"
+#endif
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+//-- inputs are taken from the volatile array, so that the compiler can't
+//   compute results in advance
+static volatile unsigned int _inputs[INPUTS_CNT];
+
+static volatile int _sink;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Fill inputs with values whose lowest set bit is `bit`, and higher bits
+ * are random.
+ */
+static void _inputs_fill(int bit, unsigned long *p_rand_state)
+{
+   int i;
+   for (i = 0; i < INPUTS_CNT; i++){
+      unsigned int val = (unsigned int)test_rand(p_rand_state);
+      _inputs[i] = (val << bit) | (1u << bit);
+   }
+}
+
+static unsigned long _measure_ns(void)
+{
+   int i;
+   int sum = 0;
+   unsigned long start = test_ns();
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      sum += _tn_bmp_ffs(_inputs[i & (INPUTS_CNT - 1)]);
+   }
+
+   _sink = sum;
+
+   return test_ns() - start;
+}
+
+/**
+ * The same loop with trivial operation, in order to subtract the cost of the
+ * loop itself.
+ */
+static unsigned long _measure_empty_ns(void)
+{
+   int i;
+   int sum = 0;
+   unsigned long start = test_ns();
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      sum += (int)_inputs[i & (INPUTS_CNT - 1)];
+   }
+
+   _sink = sum;
+
+   return test_ns() - start;
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   unsigned long rand_state = 0x12345678;
+   unsigned long min_ps = (unsigned long)-1;
+   unsigned long max_ps = 0;
+   unsigned long sum_ps = 0;
+   int bit;
+   int i;
+
+   TN_INTSAVE_DATA;
+
+   printf("variant: %s\n", VARIANT_NAME);
+
+   //-- check the result for each bit position
+   for (bit = 0; bit < TN_INT_WIDTH; bit++){
+      _inputs_fill(bit, &rand_state);
+      for (i = 0; i < INPUTS_CNT; i++){
+         TEST_CHECK(_tn_bmp_ffs(_inputs[i]) == __builtin_ffs(_inputs[i]));
+      }
+   }
+
+   //-- measure, with system tick disabled
+   TN_INT_DIS_SAVE();
+
+   for (bit = 0; bit < TN_INT_WIDTH; bit++){
+      unsigned long ns;
+      unsigned long empty_ns;
+      unsigned long ps_per_call;
+
+      _inputs_fill(bit, &rand_state);
+
+      ns = _measure_ns();
+      empty_ns = _measure_empty_ns();
+      ns -= TEST_MIN(ns, empty_ns);
+
+      ps_per_call = ns * 1000 / ITERATIONS_CNT;
+
+      min_ps = TEST_MIN(min_ps, ps_per_call);
+      max_ps = TEST_MAX(max_ps, ps_per_call);
+      sum_ps += ps_per_call;
+
+      printf("  bit %2d: %5lu ps/call\n", bit, ps_per_call);
+   }
+
+   TN_INT_RESTORE();
+
+   printf("min %lu, avg %lu, max %lu ps/call\n",
+         min_ps, sum_ps / TN_INT_WIDTH, max_ps
+         );
+}
@@ -0,0 +1,144 @@
+/*
+ * Benchmark of the path from ISR to the task: the ISR (`SIGUSR1` handler)
+ * wakes up the higher-priority task either by `tn_task_inotify()` or by
+ * `tn_sem_isignal()`, and we measure the time spent by the service in the
+ * ISR, and the time from raising the interrupt until the woken-up task
+ * runs.
+ *
+ * On the host, both numbers are dominated by syscalls: each critical
+ * section blocks and unblocks signals, and the latency also includes signal
+ * delivery and context switch. So the difference between the two services
+ * (which is the work done with interrupts disabled) is mostly lost in the
+ * noise here; it is visible on the real hardware only.
+ */
+
+#include <signal.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  ROUNDS_CNT           (1 << 16)
+
+enum _Mode {
+   _MODE_NOTIFY,
+   _MODE_SEM,
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_Task   _waiter;
+static TN_UWord         _waiter_stack[TEST_TASK_STACK_SIZE];
+
+static struct TN_Sem    _sem;
+
+static volatile enum _Mode _mode;
+
+//-- time spent by the service in the ISR, accumulated
+static volatile unsigned long _isr_ns_total;
+
+//-- timestamp of the last wakeup of the waiter, and wakeups count
+static volatile unsigned long _wake_ns;
+static volatile unsigned long _wake_cnt;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _isr(void)
+{
+   unsigned long start = test_ns();
+
+   if (_mode == _MODE_NOTIFY){
+      tn_task_inotify(&_waiter, TN_TASK_NOTIFY_ACTION_INCREMENT, 0);
+   } else {
+      tn_sem_isignal(&_sem);
+   }
+
+   _isr_ns_total += test_ns() - start;
+}
+
+static void _waiter_body(void *param)
+{
+   (void)param;
+
+   for (;;){
+      if (_mode == _MODE_NOTIFY){
+         tn_task_notify_wait((TN_UWord)-1, TN_NULL, TN_WAIT_INFINITE);
+      } else {
+         tn_sem_wait(&_sem, TN_WAIT_INFINITE);
+      }
+
+      _wake_ns = test_ns();
+      _wake_cnt++;
+   }
+}
+
+static void _bench(enum _Mode mode, const char *name)
+{
+   unsigned long latency_total = 0;
+   unsigned long latency_min = (unsigned long)-1;
+   int round;
+
+   _mode = mode;
+   _isr_ns_total = 0;
+   _wake_cnt = 0;
+
+   TEST_CHECK(tn_sem_create(&_sem, 0, 1) == TN_RC_OK);
+   TEST_CHECK(
+         tn_task_create_wname(
+            &_waiter, _waiter_body, TEST_MAIN_TASK_PRIORITY - 1,
+            _waiter_stack, TEST_TASK_STACK_SIZE, TN_NULL,
+            TN_TASK_CREATE_OPT_START, "waiter"
+            ) == TN_RC_OK
+         );
+
+   for (round = 0; round < ROUNDS_CNT; round++){
+      unsigned long start = test_ns();
+      unsigned long latency;
+
+      //-- the handler is called before `raise()` returns, and the waiter
+      //   runs before us since it has higher priority
+      raise(SIGUSR1);
+
+      latency = _wake_ns - start;
+      latency_total += latency;
+      latency_min = TEST_MIN(latency_min, latency);
+   }
+
+   TEST_CHECK(_wake_cnt == ROUNDS_CNT);
+
+   printf("  %-16s in ISR %5lu, ISR to task avg %6lu, min %6lu ns\n",
+         name, _isr_ns_total / ROUNDS_CNT,
+         latency_total / ROUNDS_CNT, latency_min
+         );
+
+   TEST_CHECK(tn_task_terminate(&_waiter) == TN_RC_OK);
+   TEST_CHECK(tn_task_delete(&_waiter) == TN_RC_OK);
+   TEST_CHECK(tn_sem_delete(&_sem) == TN_RC_OK);
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   TEST_CHECK(tn_posix_isr_set(SIGUSR1, _isr) == 0);
+
+   printf("wake up the task from ISR:\n");
+   _bench(_MODE_NOTIFY, "tn_task_inotify");
+   _bench(_MODE_SEM, "tn_sem_isignal");
+}
@@ -0,0 +1,170 @@
+/*
+ * Benchmark of starting and cancelling timers while there are 10, 100 and
+ * 1000 other active timers.
+ *
+ * The same source is built for dynamic tick (where active timers are kept in
+ * the pairing heap) and for static tick (timing wheel), see Makefile.
+ *
+ * On the host, disabling/enabling interrupts is a syscall which costs much
+ * more than the timer bookkeeping itself, so the benchmark calls internal
+ * `_tn_timer_start()` / `_tn_timer_cancel()` from the single critical
+ * section. Each call is timed separately, so the numbers include the
+ * overhead of taking a timestamp. The 99th percentile is printed instead of
+ * the maximum, since the maximum is spoiled by the host's own preemption.
+ */
+
+#include <stdlib.h>
+
+#include "test_common.h"
+#include "_tn_timer.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  TIMERS_MAX_CNT       1000
+
+//-- number of cancel/start pairs per amount of timers
+#define  ITERATIONS_CNT       20000
+
+//-- timeouts are long enough for timers not to fire during the benchmark
+#define  TIMEOUT_MIN          100000
+#define  TIMEOUT_RANGE        1000000
+
+#if TN_DYNAMIC_TICK
+#  define  VARIANT_NAME    "dynamic tick (pairing heap)"
+#else
+#  define  VARIANT_NAME    "static tick (timing wheel)"
+#endif
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_Timer _timers[TIMERS_MAX_CNT];
+
+static unsigned long _rand_state = 0xdeadbeef;
+
+static unsigned long _start_ns[ITERATIONS_CNT];
+static unsigned long _cancel_ns[ITERATIONS_CNT];
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _timer_func(struct TN_Timer *timer, void *p_user_data)
+{
+   (void)timer;
+   (void)p_user_data;
+
+   TEST_CHECK(0 /* timer should never fire */);
+}
+
+static TN_TickCnt _timeout_get(void)
+{
+   return TIMEOUT_MIN + (TN_TickCnt)(test_rand(&_rand_state) % TIMEOUT_RANGE);
+}
+
+static int _ulong_cmp(const void *a, const void *b)
+{
+   unsigned long va = *(const unsigned long *)a;
+   unsigned long vb = *(const unsigned long *)b;
+
+   return (va > vb) - (va < vb);
+}
+
+/**
+ * Sort the samples, and return their sum; the 99th percentile is returned
+ * via `p_p99`.
+ */
+static unsigned long _samples_proceed(
+      unsigned long *samples,
+      unsigned long *p_p99
+      )
+{
+   unsigned long sum = 0;
+   int i;
+
+   qsort(samples, ITERATIONS_CNT, sizeof(samples[0]), _ulong_cmp);
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      sum += samples[i];
+   }
+
+   *p_p99 = samples[ITERATIONS_CNT * 99 / 100];
+
+   return sum;
+}
+
+static void _bench(int timers_cnt)
+{
+   unsigned long start_sum, start_p99;
+   unsigned long cancel_sum, cancel_p99;
+   int i;
+
+   TN_INTSAVE_DATA;
+
+   for (i = 0; i < timers_cnt; i++){
+      TEST_CHECK(tn_timer_start(&_timers[i], _timeout_get()) == TN_RC_OK);
+   }
+
+   TN_INT_DIS_SAVE();
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      struct TN_Timer *timer = &_timers[test_rand(&_rand_state) % timers_cnt];
+      TN_TickCnt timeout = _timeout_get();
+      unsigned long t0, t1, t2;
+
+      t0 = test_ns();
+      _tn_timer_cancel(timer);
+      t1 = test_ns();
+      _tn_timer_start(timer, timeout);
+      t2 = test_ns();
+
+      _cancel_ns[i] = t1 - t0;
+      _start_ns[i] = t2 - t1;
+   }
+
+   TN_INT_RESTORE();
+
+   for (i = 0; i < timers_cnt; i++){
+      TEST_CHECK(tn_timer_cancel(&_timers[i]) == TN_RC_OK);
+   }
+
+   start_sum = _samples_proceed(_start_ns, &start_p99);
+   cancel_sum = _samples_proceed(_cancel_ns, &cancel_p99);
+
+   printf("%5d timers: start avg %4lu p99 %4lu ns, "
+         "cancel avg %4lu p99 %4lu ns\n",
+         timers_cnt,
+         start_sum / ITERATIONS_CNT, start_p99,
+         cancel_sum / ITERATIONS_CNT, cancel_p99
+         );
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int i;
+
+   printf("variant: %s\n", VARIANT_NAME);
+
+   for (i = 0; i < TIMERS_MAX_CNT; i++){
+      tn_timer_create(&_timers[i], _timer_func, TN_NULL);
+   }
+
+   _bench(10);
+   _bench(100);
+   _bench(1000);
+}
@@ -0,0 +1,257 @@
+/*
+ * Benchmark of the wake-up latency of the highest-priority task among
+ * waiters with mixed priorities: the ISR (`SIGUSR1` handler) releases the
+ * semaphore (`tn_sem_isignal()`) or sends the item to the data queue
+ * (`tn_queue_isend_polling()`), and each release wakes up one waiter. The
+ * objects are created with `#TN_WAIT_ORDER_FIFO` and with
+ * `#TN_WAIT_ORDER_PRIORITY`.
+ *
+ * There are 1, 4 and 16 waiters: the urgent one has the highest priority,
+ * the others have random lower priorities. All of them have higher priority
+ * than the main task, so each woken-up task runs before `raise()` returns,
+ * and then waits again. The urgent task initially starts waiting last, which
+ * is the worst case for the FIFO order; after that, the order is kept by the
+ * waiters themselves, since each woken-up task gets back to the queue.
+ *
+ * For each round, the main task raises interrupts until the urgent task
+ * runs, and we measure the time from the first interrupt until then, and the
+ * number of interrupts it took. With FIFO order, the urgent task is woken
+ * only after all the other waiters; with priority order, it is woken by the
+ * very first interrupt.
+ *
+ * Just like other benchmarks here, absolute numbers are dominated by the
+ * host: each interrupt is a signal, and each critical section is a syscall.
+ * Besides, the process may be preempted by the host at any time, so the
+ * maximum is noisy, and a few such samples may pull the average above the
+ * 99th percentile; the number of interrupts per round is exact.
+ */
+
+#include <signal.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  WAITERS_MAX_CNT      16
+
+#define  ROUNDS_CNT           4096
+
+//-- priority of the urgent waiter; other waiters have priorities from
+//   `URGENT_PRIORITY + 1` to `TEST_MAIN_TASK_PRIORITY - 1`
+#define  URGENT_PRIORITY      1
+
+enum _ObjKind {
+   _OBJ_SEM,
+   _OBJ_DQUEUE,
+};
+
+struct _Stat {
+   unsigned long avg;
+   unsigned long p99;
+   unsigned long max;
+   unsigned long isr_max;
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+//-- the first waiter is the urgent one
+static struct TN_Task   _waiters[WAITERS_MAX_CNT];
+static TN_UWord         _stacks[WAITERS_MAX_CNT][TEST_TASK_STACK_SIZE];
+
+static volatile enum _ObjKind _obj_kind;
+
+static struct TN_Sem    _sem;
+static struct TN_DQueue _dque;
+static void            *_dque_buf[1];
+
+//-- timestamp of the last wakeup of the urgent waiter, and wakeups count
+static volatile unsigned long _urgent_wake_ns;
+static volatile unsigned long _urgent_wake_cnt;
+
+static unsigned long    _latency_ns[ROUNDS_CNT];
+
+static unsigned long    _rand_state = 1;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _isr(void)
+{
+   if (_obj_kind == _OBJ_SEM){
+      tn_sem_isignal(&_sem);
+   } else {
+      tn_queue_isend_polling(&_dque, TN_NULL);
+   }
+}
+
+static void _waiter_body(void *param)
+{
+   TN_BOOL urgent = (param != TN_NULL);
+   void *data;
+
+   for (;;){
+      if (_obj_kind == _OBJ_SEM){
+         tn_sem_wait(&_sem, TN_WAIT_INFINITE);
+      } else {
+         tn_queue_receive(&_dque, &data, TN_WAIT_INFINITE);
+      }
+
+      if (urgent){
+         _urgent_wake_ns = test_ns();
+         _urgent_wake_cnt++;
+      }
+   }
+}
+
+static int _ulong_cmp(const void *a, const void *b)
+{
+   unsigned long va = *(const unsigned long *)a;
+   unsigned long vb = *(const unsigned long *)b;
+
+   return (va > vb) - (va < vb);
+}
+
+static void _obj_create(enum TN_WaitOrder wait_order)
+{
+   if (_obj_kind == _OBJ_SEM){
+      TEST_CHECK(tn_sem_create_worder(&_sem, 0, 1, wait_order) == TN_RC_OK);
+   } else {
+      TEST_CHECK(
+            tn_queue_create_worder(&_dque, _dque_buf, 1, wait_order)
+            == TN_RC_OK
+            );
+   }
+}
+
+static void _obj_delete(void)
+{
+   if (_obj_kind == _OBJ_SEM){
+      TEST_CHECK(tn_sem_delete(&_sem) == TN_RC_OK);
+   } else {
+      TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+   }
+}
+
+static void _bench(
+      enum _ObjKind obj_kind,
+      int waiters_cnt,
+      enum TN_WaitOrder wait_order,
+      struct _Stat *stat
+      )
+{
+   unsigned long sum = 0;
+   int round;
+   int i;
+
+   _obj_kind = obj_kind;
+   _obj_create(wait_order);
+
+   stat->isr_max = 0;
+
+   //-- waiters start waiting as soon as they're activated, since they
+   //   have higher priority than ours; the urgent one goes last
+   for (i = waiters_cnt - 1; i >= 0; i--){
+      int priority = (i == 0)
+         ? URGENT_PRIORITY
+         : URGENT_PRIORITY + 1
+            + (int)(test_rand(&_rand_state)
+               % (TEST_MAIN_TASK_PRIORITY - URGENT_PRIORITY - 1));
+
+      TEST_CHECK(
+            tn_task_create_wname(
+               &_waiters[i], _waiter_body, priority,
+               _stacks[i], TEST_TASK_STACK_SIZE,
+               (i == 0) ? &_waiters[i] : TN_NULL,
+               0, "waiter"
+               ) == TN_RC_OK
+            );
+      TEST_CHECK(tn_task_activate(&_waiters[i]) == TN_RC_OK);
+   }
+
+   for (round = 0; round < ROUNDS_CNT; round++){
+      unsigned long wake_cnt = _urgent_wake_cnt;
+      unsigned long isr_cnt = 0;
+      unsigned long start = test_ns();
+
+      //-- the handler is called before `raise()` returns, and the woken-up
+      //   waiter runs before us
+      do {
+         raise(SIGUSR1);
+         isr_cnt++;
+      } while (_urgent_wake_cnt == wake_cnt);
+
+      _latency_ns[round] = _urgent_wake_ns - start;
+      stat->isr_max = TEST_MAX(stat->isr_max, isr_cnt);
+   }
+
+   for (i = 0; i < waiters_cnt; i++){
+      TEST_CHECK(tn_task_terminate(&_waiters[i]) == TN_RC_OK);
+      TEST_CHECK(tn_task_delete(&_waiters[i]) == TN_RC_OK);
+   }
+   _obj_delete();
+
+   qsort(_latency_ns, ROUNDS_CNT, sizeof(_latency_ns[0]), _ulong_cmp);
+
+   for (round = 0; round < ROUNDS_CNT; round++){
+      sum += _latency_ns[round];
+   }
+
+   stat->avg = sum / ROUNDS_CNT;
+   stat->p99 = _latency_ns[ROUNDS_CNT * 99 / 100];
+   stat->max = _latency_ns[ROUNDS_CNT - 1];
+}
+
+static void _stat_print(const char *name, const struct _Stat *stat)
+{
+   printf("    %-8s avg %6lu p99 %6lu max %7lu ns, up to %2lu ISRs\n",
+         name, stat->avg, stat->p99, stat->max, stat->isr_max
+         );
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   static const char *const obj_names[] = { "tn_sem", "tn_dqueue" };
+   int obj_kind;
+   int waiters_cnt;
+
+   TEST_CHECK(tn_posix_isr_set(SIGUSR1, _isr) == 0);
+
+   printf("wake up the highest-priority waiter from ISR:\n");
+
+   for (obj_kind = _OBJ_SEM; obj_kind <= _OBJ_DQUEUE; obj_kind++){
+      for (waiters_cnt = 1; waiters_cnt <= WAITERS_MAX_CNT; waiters_cnt *= 4){
+         struct _Stat fifo, prio;
+
+         _bench((enum _ObjKind)obj_kind, waiters_cnt,
+               TN_WAIT_ORDER_FIFO, &fifo);
+         _bench((enum _ObjKind)obj_kind, waiters_cnt,
+               TN_WAIT_ORDER_PRIORITY, &prio);
+
+         printf("  %s, %2d waiters:\n", obj_names[obj_kind], waiters_cnt);
+         _stat_print("fifo", &fifo);
+         _stat_print("priority", &prio);
+
+         //-- with priority order, the urgent task always goes first
+         TEST_CHECK(prio.isr_max == 1);
+         TEST_CHECK(fifo.isr_max == (unsigned long)waiters_cnt);
+      }
+   }
+}
@@ -0,0 +1,185 @@
+/*
+ * Benchmark of adding the task to the wait queue which already holds 1, 4,
+ * 16 and 64 other tasks: FIFO order (`#TN_WAIT_ORDER_FIFO`) against
+ * priority order (`#TN_WAIT_ORDER_PRIORITY`).
+ *
+ * All tasks have the same priority: it's the worst case for the priority
+ * order, since the new task goes after all tasks with equal priority, so the
+ * whole queue is walked.
+ *
+ * Just like the timers benchmark, it calls internal `_tn_task_set_waiting()`
+ * from the single critical section, since on the host disabling interrupts
+ * is a syscall which costs much more than the insertion itself. The tasks
+ * are never started: they're put to the queue and removed from it by hand,
+ * nobody is ever woken up.
+ */
+
+#include <stdlib.h>
+
+#include "test_common.h"
+#include "_tn_tasks.h"
+#include "_tn_list.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  WAITERS_MAX_CNT      64
+
+//-- number of insertions per queue length
+#define  ITERATIONS_CNT       20000
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+//-- the last task is the one being added to the queue
+static struct TN_Task   _tasks[WAITERS_MAX_CNT + 1];
+static TN_UWord         _stacks[WAITERS_MAX_CNT + 1][TEST_TASK_STACK_SIZE];
+
+static struct TN_ListItem _wait_queue;
+
+static unsigned long _add_ns[ITERATIONS_CNT];
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _task_body(void *param)
+{
+   (void)param;
+
+   TEST_CHECK(0 /* task should never run */);
+}
+
+static int _ulong_cmp(const void *a, const void *b)
+{
+   unsigned long va = *(const unsigned long *)a;
+   unsigned long vb = *(const unsigned long *)b;
+
+   return (va > vb) - (va < vb);
+}
+
+/**
+ * Put the task to the wait queue; must be called with interrupts disabled.
+ */
+static void _wait(struct TN_Task *task, enum TN_WaitOrder wait_order)
+{
+   _tn_task_set_waiting(
+         task, &_wait_queue, wait_order, TN_WAIT_REASON_SEM,
+         TN_WAIT_INFINITE
+         );
+}
+
+/**
+ * Remove the task from the wait queue and bring it back to the dormant
+ * state; must be called with interrupts disabled.
+ */
+static void _unwait(struct TN_Task *task)
+{
+   _tn_list_remove_entry(&task->task_queue);
+   task->pwait_queue = TN_NULL;
+   task->task_state = TN_TASK_STATE_DORMANT;
+}
+
+/**
+ * Add the task to the queue of `waiters_cnt` tasks, `ITERATIONS_CNT`
+ * times; returns average time, 99th percentile is returned via `p_p99`.
+ */
+static unsigned long _bench(
+      int waiters_cnt,
+      enum TN_WaitOrder wait_order,
+      unsigned long *p_p99
+      )
+{
+   struct TN_Task *task = &_tasks[WAITERS_MAX_CNT];
+   unsigned long sum = 0;
+   int i;
+
+   TN_INTSAVE_DATA;
+
+   TN_INT_DIS_SAVE();
+
+   for (i = 0; i < waiters_cnt; i++){
+      _wait(&_tasks[i], wait_order);
+   }
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      unsigned long t0, t1;
+
+      t0 = test_ns();
+      _wait(task, wait_order);
+      t1 = test_ns();
+
+      //-- the task should have been added to the tail
+      TEST_CHECK(_wait_queue.prev == &task->task_queue);
+      _unwait(task);
+
+      _add_ns[i] = t1 - t0;
+   }
+
+   for (i = 0; i < waiters_cnt; i++){
+      _unwait(&_tasks[i]);
+   }
+
+   TN_INT_RESTORE();
+
+   qsort(_add_ns, ITERATIONS_CNT, sizeof(_add_ns[0]), _ulong_cmp);
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      sum += _add_ns[i];
+   }
+
+   *p_p99 = _add_ns[ITERATIONS_CNT * 99 / 100];
+
+   return sum / ITERATIONS_CNT;
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int waiters_cnt;
+   int i;
+
+   _tn_list_reset(&_wait_queue);
+
+   for (i = 0; i < WAITERS_MAX_CNT + 1; i++){
+      TEST_CHECK(
+            tn_task_create_wname(
+               &_tasks[i], _task_body, TEST_MAIN_TASK_PRIORITY + 1,
+               _stacks[i], TEST_TASK_STACK_SIZE, TN_NULL,
+               0, "waiter"
+               ) == TN_RC_OK
+            );
+   }
+
+   printf("add task to the wait queue:\n");
+
+   for (waiters_cnt = 1; waiters_cnt <= WAITERS_MAX_CNT; waiters_cnt *= 4){
+      unsigned long fifo_avg, fifo_p99;
+      unsigned long prio_avg, prio_p99;
+
+      fifo_avg = _bench(waiters_cnt, TN_WAIT_ORDER_FIFO, &fifo_p99);
+      prio_avg = _bench(waiters_cnt, TN_WAIT_ORDER_PRIORITY, &prio_p99);
+
+      printf("  %2d waiters: fifo avg %4lu p99 %4lu ns, "
+            "priority avg %4lu p99 %4lu ns\n",
+            waiters_cnt, fifo_avg, fifo_p99, prio_avg, prio_p99
+            );
+   }
+
+   for (i = 0; i < WAITERS_MAX_CNT + 1; i++){
+      TEST_CHECK(tn_task_delete(&_tasks[i]) == TN_RC_OK);
+   }
+}
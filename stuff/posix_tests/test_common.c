@@ -0,0 +1,144 @@
+/*
+ * Common stuff for host-side tests and benchmarks, see test_common.h.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+TN_STACK_ARR_DEF(_idle_task_stack, TEST_TASK_STACK_SIZE);
+TN_STACK_ARR_DEF(_int_stack, TN_MIN_STACK_SIZE);
+TN_STACK_ARR_DEF(_main_task_stack, TEST_TASK_STACK_SIZE);
+
+static struct TN_Task _main_task;
+
+static int _fail_cnt = 0;
+
+#if TN_DYNAMIC_TICK
+//-- there's no tick source in dynamic tick mode: programs which need time to
+//   pass should drive it themselves
+static TN_TickCnt _tick_cnt = 0;
+#endif
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _main_task_body(void *param)
+{
+   (void)param;
+
+   test_main();
+
+   if (_fail_cnt != 0){
+      printf("FAILED: %d check(s)\n", _fail_cnt);
+   }
+
+   fflush(stdout);
+   exit(_fail_cnt != 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static void _cb_user_task_create(void)
+{
+#if !TN_DYNAMIC_TICK
+   tn_posix_tick_start(1000);
+#endif
+
+   tn_task_create_wname(
+         &_main_task,
+         _main_task_body,
+         TEST_MAIN_TASK_PRIORITY,
+         _main_task_stack,
+         TEST_TASK_STACK_SIZE,
+         TN_NULL,
+         TN_TASK_CREATE_OPT_START,
+         "main"
+         );
+}
+
+static void _cb_idle(void)
+{
+#if TN_DYNAMIC_TICK
+   //-- nobody is going to wake up anyone
+   printf("FAILED: all tasks are waiting, and there's no tick\n");
+   fflush(stdout);
+   abort();
+#else
+   pause();
+#endif
+}
+
+#if TN_DYNAMIC_TICK
+static void _cb_tick_schedule(TN_TickCnt timeout)
+{
+   (void)timeout;
+}
+
+static TN_TickCnt _cb_tick_cnt_get(void)
+{
+   return _tick_cnt;
+}
+#endif
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_fail(const char *file, int line, const char *cond)
+{
+   printf("%s:%d: check failed: %s\n", file, line, cond);
+   _fail_cnt++;
+}
+
+unsigned long test_ns(void)
+{
+   return tn_arch_timestamp_get();
+}
+
+unsigned long test_rand(unsigned long *p_state)
+{
+   //-- xorshift
+   unsigned long x = *p_state;
+
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   *p_state = x;
+
+   return x;
+}
+
+int main(void)
+{
+   setvbuf(stdout, TN_NULL, _IOLBF, 0);
+
+#if TN_DYNAMIC_TICK
+   tn_callback_dyn_tick_set(_cb_tick_schedule, _cb_tick_cnt_get);
+#endif
+
+#if TN_PROFILER_TIMESTAMP
+   tn_callback_profiler_timestamp_set(tn_arch_timestamp_get);
+#endif
+
+   tn_sys_start(
+         _idle_task_stack,
+         TEST_TASK_STACK_SIZE,
+         _int_stack,
+         TN_MIN_STACK_SIZE,
+         _cb_user_task_create,
+         _cb_idle
+         );
+
+   return EXIT_FAILURE;
+}
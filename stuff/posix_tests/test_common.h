@@ -0,0 +1,68 @@
+/*
+ * Common stuff for host-side tests and benchmarks, see Makefile.
+ *
+ * `main()` is implemented in test_common.c: it starts the kernel and creates
+ * the main test task which calls `test_main()`, provided by each program.
+ * When `test_main()` returns, the process exits; exit status is non-zero if
+ * some `TEST_CHECK()` has failed.
+ */
+
+#ifndef _TEST_COMMON_H
+#define _TEST_COMMON_H
+
+#include <stdio.h>
+
+#include "tn.h"
+
+
+
+/*******************************************************************************
+ *    PUBLIC DEFINITIONS
+ ******************************************************************************/
+
+/// Priority of the main test task: programs may create tasks with both
+/// higher and lower priorities
+#define  TEST_MAIN_TASK_PRIORITY    5
+
+/// Size of the stack of test tasks, in words
+#define  TEST_TASK_STACK_SIZE       (TN_MIN_STACK_SIZE + 256)
+
+#define  TEST_MIN(a, b)             ((a) < (b) ? (a) : (b))
+#define  TEST_MAX(a, b)             ((a) > (b) ? (a) : (b))
+
+/// Check the condition; if it's false, report the failure (the test goes on)
+#define  TEST_CHECK(cond)                                               \
+   do {                                                                 \
+      if (!(cond)){                                                     \
+         test_fail(__FILE__, __LINE__, #cond);                          \
+      }                                                                 \
+   } while (0)
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTION PROTOTYPES
+ ******************************************************************************/
+
+/**
+ * Body of the main test task, provided by each program.
+ */
+void test_main(void);
+
+/**
+ * Report failed check; called by `TEST_CHECK()`.
+ */
+void test_fail(const char *file, int line, const char *cond);
+
+/**
+ * Current timestamp, in nanoseconds.
+ */
+unsigned long test_ns(void);
+
+/**
+ * Pseudo-random number generator with explicit state, so that the sequence
+ * is the same for the same seed regardless of anything else.
+ */
+unsigned long test_rand(unsigned long *p_state);
+
+#endif // _TEST_COMMON_H
@@ -0,0 +1,125 @@
+/*
+ * Test of the deadline variants of blocking services (`tn_sem_wait_until()`
+ * and friends): the task should wake up exactly at the deadline tick, and
+ * a deadline which is already reached should behave like polling.
+ */
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+//-- number of waits for each service
+#define  ITERATIONS_CNT       50
+
+//-- how far in the future deadlines are, in ticks
+#define  DEADLINE_TICKS       2
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_Sem       _sem;
+static struct TN_DQueue    _dque;
+static struct TN_EventGrp  _eventgrp;
+static struct TN_MsgQ      _msgq;
+
+static void *_dque_fifo[1];
+static TN_UWord _msgq_buf[1];
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Wait for the object which is never signalled, using the deadline variant
+ * of the given kind.
+ */
+static enum TN_RCode _wait_until(int kind, TN_TickCnt deadline)
+{
+   enum TN_RCode rc = TN_RC_INTERNAL;
+   void *p_data;
+   TN_UWord flags;
+   TN_UWord msg;
+
+   switch (kind){
+      case 0:
+         rc = tn_sem_wait_until(&_sem, deadline);
+         break;
+      case 1:
+         rc = tn_queue_receive_until(&_dque, &p_data, deadline);
+         break;
+      case 2:
+         rc = tn_eventgrp_wait_until(
+               &_eventgrp, 0x01, TN_EVENTGRP_WMODE_OR, &flags, deadline
+               );
+         break;
+      case 3:
+         rc = tn_msgq_receive_until(&_msgq, &msg, deadline);
+         break;
+   }
+
+   return rc;
+}
+
+static void _test_kind(int kind, const char *name)
+{
+   int late_cnt = 0;
+   int i;
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      TN_TickCnt deadline = tn_sys_time_get() + DEADLINE_TICKS;
+      TN_TickCnt woken_at;
+
+      TEST_CHECK(_wait_until(kind, deadline) == TN_RC_TIMEOUT);
+      woken_at = tn_sys_time_get();
+
+      //-- should never wake up before the deadline
+      TEST_CHECK((TN_TickCnt)(woken_at - deadline) < (TN_WAIT_INFINITE / 2));
+
+      if (woken_at != deadline){
+         late_cnt++;
+      }
+   }
+
+   //-- The task is the highest-priority one, so it reads the time right
+   //   after the tick which woke it up; the next tick can come in between
+   //   only if the host has preempted the whole process for the tick
+   //   period, so, tolerate a couple of such cases.
+   TEST_CHECK(late_cnt <= 2);
+
+   //-- deadline that is already reached: behaves like polling
+   TEST_CHECK(_wait_until(kind, tn_sys_time_get()) == TN_RC_TIMEOUT);
+   TEST_CHECK(_wait_until(kind, tn_sys_time_get() - 1) == TN_RC_TIMEOUT);
+
+   printf("%-24s late wakeups: %d of %d\n", name, late_cnt, ITERATIONS_CNT);
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   TEST_CHECK(tn_sem_create(&_sem, 0, 1) == TN_RC_OK);
+   TEST_CHECK(tn_queue_create(&_dque, _dque_fifo, 1) == TN_RC_OK);
+   TEST_CHECK(tn_eventgrp_create(&_eventgrp, 0) == TN_RC_OK);
+   TEST_CHECK(
+         tn_msgq_create(&_msgq, _msgq_buf, sizeof(_msgq_buf[0]), 1)
+         == TN_RC_OK
+         );
+
+   _test_kind(0, "tn_sem_wait_until");
+   _test_kind(1, "tn_queue_receive_until");
+   _test_kind(2, "tn_eventgrp_wait_until");
+   _test_kind(3, "tn_msgq_receive_until");
+}
@@ -0,0 +1,387 @@
+/*
+ * Test of deferred procedure calls, posted from the ISR (`SIGUSR1` handler):
+ *
+ *    - the worker task takes all the calls pending at the moment as a single
+ *      batch, and calls them in order, in its own context;
+ *    - when the ring buffer is full, the call is discarded with
+ *      `#TN_RC_OVERFLOW`, and counted in `overflow_cnt`;
+ *    - the post wakes the worker task up if only it waits for the work: the
+ *      worker with higher priority runs before `raise()` returns, and the
+ *      worker which is already woken up by someone else isn't woken up
+ *      again;
+ *    - drain latency given by `tn_dpc_stat_get()` is within the time measured
+ *      by the test itself (the profiler uses the same host timestamp);
+ *    - finally, calls are posted by the host timer interrupt, which comes at
+ *      arbitrary points of the worker task, while the main task sometimes
+ *      keeps the worker from running, so the ring buffer overflows: no call
+ *      is lost, duplicated or reordered, and all of them are accounted in
+ *      the statistics.
+ */
+
+#include <signal.h>
+#include <time.h>
+#include <string.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  DPC_ITEMS_CNT        8
+
+#define  WORKER_LO_PRIORITY   (TEST_MAIN_TASK_PRIORITY + 1)
+#define  WORKER_HI_PRIORITY   (TEST_MAIN_TASK_PRIORITY - 1)
+
+//-- max number of calls logged by `_func()`
+#define  CALLS_MAX            16
+
+//-- the time the main task keeps the worker from running, in ns
+#define  SPIN_NS              1000000
+
+//-- period of the timer interrupt, and number of calls it posts
+#define  ISR_PERIOD_NS        20000
+#define  STRESS_CALLS_CNT     20000
+
+enum _IsrMode {
+   _ISR_MODE_STOP,
+   //-- post `_burst_cnt` calls at once
+   _ISR_MODE_BURST,
+   //-- post one call of the sequence
+   _ISR_MODE_SEQ,
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_DPC       _dpc;
+static struct TN_DPCItem   _dpc_items[DPC_ITEMS_CNT];
+static TN_UWord            _dpc_stack[TEST_TASK_STACK_SIZE];
+
+static timer_t             _timer;
+
+static volatile enum _IsrMode _isr_mode;
+
+//-- burst mode: number of calls to post, and results
+static int                 _burst_cnt;
+static enum TN_RCode       _burst_rc[CALLS_MAX];
+static unsigned long       _post_ns[CALLS_MAX];
+static unsigned long       _burst_end_ns;
+
+//-- calls done by `_func()`
+static volatile int        _calls_cnt;
+static int                 _calls[CALLS_MAX];
+static unsigned long       _call_ns[CALLS_MAX];
+
+//-- sequence mode: number of calls posted and discarded by the ISR, and
+//   number of calls done by `_seq_func()`
+static volatile unsigned long _seq_posted_cnt;
+static volatile unsigned long _seq_overflow_cnt;
+static volatile unsigned long _seq_done_cnt;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _func(void *p_user_data)
+{
+   int n = (int)(TN_UIntPtr)p_user_data;
+
+   TEST_CHECK(tn_cur_task_get() == &_dpc.worker);
+   TEST_CHECK(_calls_cnt < CALLS_MAX);
+
+   _calls[_calls_cnt] = n;
+   _call_ns[_calls_cnt] = test_ns();
+   _calls_cnt++;
+}
+
+static void _seq_func(void *p_user_data)
+{
+   TEST_CHECK((unsigned long)(TN_UIntPtr)p_user_data == _seq_done_cnt);
+   _seq_done_cnt++;
+}
+
+static void _isr(void)
+{
+   int i;
+
+   switch (_isr_mode){
+      case _ISR_MODE_STOP:
+         break;
+
+      case _ISR_MODE_BURST:
+         TEST_CHECK(tn_dpc_post(&_dpc, _func, TN_NULL) == TN_RC_WCONTEXT);
+
+         for (i = 0; i < _burst_cnt; i++){
+            _post_ns[i] = test_ns();
+            _burst_rc[i] = tn_dpc_ipost(&_dpc, _func, (void *)(TN_UIntPtr)i);
+         }
+         _burst_end_ns = test_ns();
+         break;
+
+      case _ISR_MODE_SEQ:
+         if (
+               tn_dpc_ipost(
+                  &_dpc, _seq_func, (void *)(TN_UIntPtr)_seq_posted_cnt
+                  ) == TN_RC_OK
+            )
+         {
+            _seq_posted_cnt++;
+         } else {
+            _seq_overflow_cnt++;
+         }
+         break;
+   }
+}
+
+/**
+ * Post `cnt` calls from the ISR at once
+ */
+static void _burst_post(int cnt)
+{
+   _burst_cnt = cnt;
+   _isr_mode = _ISR_MODE_BURST;
+   raise(SIGUSR1);
+   _isr_mode = _ISR_MODE_STOP;
+}
+
+static void _spin(unsigned long ns)
+{
+   unsigned long start = test_ns();
+
+   while (test_ns() - start < ns){
+      //-- just wait
+   }
+}
+
+static void _dpc_create(int priority)
+{
+   TEST_CHECK(
+         tn_dpc_create(
+            &_dpc, _dpc_items, DPC_ITEMS_CNT,
+            _dpc_stack, TEST_TASK_STACK_SIZE, priority
+            ) == TN_RC_OK
+         );
+
+   //-- let the worker with lower priority start waiting
+   tn_task_sleep(1);
+   TEST_CHECK(_dpc.worker_waiting);
+}
+
+static void _calls_check(int cnt)
+{
+   int i;
+
+   TEST_CHECK(_calls_cnt == cnt);
+   for (i = 0; i < _calls_cnt; i++){
+      TEST_CHECK(_calls[i] == i);
+   }
+   _calls_cnt = 0;
+}
+
+static void _test_batch(void)
+{
+   struct TN_DPCStat stat;
+   unsigned long latency_max = 0;
+   unsigned long latency;
+   unsigned long spin_end_ns;
+   int i;
+
+   _dpc_create(WORKER_LO_PRIORITY);
+
+   //-- the first call wakes the worker up, but it doesn't run until we
+   //   sleep; meanwhile, the calls are pending
+   _burst_post(5);
+   for (i = 0; i < 5; i++){
+      TEST_CHECK(_burst_rc[i] == TN_RC_OK);
+   }
+   TEST_CHECK(!_dpc.worker_waiting);
+   TEST_CHECK(_dpc.worker.task_state == TN_TASK_STATE_RUNNABLE);
+   TEST_CHECK(_calls_cnt == 0);
+
+   _spin(SPIN_NS);
+   spin_end_ns = test_ns();
+
+   //-- now, the worker takes all of them as a single batch
+   tn_task_sleep(1);
+   _calls_check(5);
+   TEST_CHECK(_dpc.worker_waiting);
+
+   TEST_CHECK(tn_dpc_stat_get(&_dpc, &stat, TN_TRUE) == TN_RC_OK);
+   TEST_CHECK(stat.batch_max == 5);
+   TEST_CHECK(stat.backlog_max == 5);
+   TEST_CHECK(stat.done_cnt == 5);
+   TEST_CHECK(stat.overflow_cnt == 0);
+
+   //-- each call is posted before the burst ends, and it's done after the
+   //   spin ends, and before `_func()` logs it
+   for (i = 0; i < 5; i++){
+      latency_max = TEST_MAX(latency_max, _call_ns[i] - _post_ns[i]);
+   }
+   TEST_CHECK(stat.latency_last >= spin_end_ns - _burst_end_ns);
+   TEST_CHECK(stat.latency_last <= _call_ns[4] - _post_ns[4]);
+   TEST_CHECK(stat.latency_max >= stat.latency_last);
+   TEST_CHECK(stat.latency_max <= latency_max);
+   latency = stat.latency_max;
+
+   //-- statistics is reset
+   TEST_CHECK(tn_dpc_stat_get(&_dpc, &stat, TN_FALSE) == TN_RC_OK);
+   TEST_CHECK(stat.batch_max == 0 && stat.backlog_max == 0);
+   TEST_CHECK(stat.done_cnt == 0 && stat.latency_max == 0);
+
+   printf("batch: done, latency %lu ns (test: %lu..%lu ns)\n",
+         latency, spin_end_ns - _burst_end_ns, latency_max
+         );
+}
+
+static void _test_overflow(void)
+{
+   struct TN_DPCStat stat;
+   int i;
+
+   //-- the ring buffer gets full, and the rest of calls are discarded
+   _burst_post(DPC_ITEMS_CNT + 3);
+   for (i = 0; i < DPC_ITEMS_CNT + 3; i++){
+      TEST_CHECK(
+            _burst_rc[i] == ((i < DPC_ITEMS_CNT) ? TN_RC_OK : TN_RC_OVERFLOW)
+            );
+   }
+   TEST_CHECK(tn_dpc_post(&_dpc, _func, TN_NULL) == TN_RC_OVERFLOW);
+   TEST_CHECK(tn_dpc_ipost(&_dpc, _func, TN_NULL) == TN_RC_WCONTEXT);
+   TEST_CHECK(_dpc.filled_cnt == DPC_ITEMS_CNT);
+
+   tn_task_sleep(1);
+   _calls_check(DPC_ITEMS_CNT);
+
+   TEST_CHECK(tn_dpc_stat_get(&_dpc, &stat, TN_TRUE) == TN_RC_OK);
+   TEST_CHECK(stat.overflow_cnt == 4);
+   TEST_CHECK(stat.done_cnt == DPC_ITEMS_CNT);
+   TEST_CHECK(stat.backlog_max == DPC_ITEMS_CNT);
+   TEST_CHECK(stat.batch_max == DPC_ITEMS_CNT);
+
+   //-- there is room again
+   TEST_CHECK(tn_dpc_post(&_dpc, _func, (void *)0) == TN_RC_OK);
+   tn_task_sleep(1);
+   _calls_check(1);
+
+   printf("overflow: done\n");
+}
+
+static void _test_wakeup(void)
+{
+   struct TN_DPCStat stat;
+   int i;
+
+   //-- the worker is woken up by someone else, and doesn't run yet: the
+   //   post sees the flag, but the worker isn't waiting anymore, so it
+   //   shouldn't be woken up again (it would be a fatal error with
+   //   `TN_DEBUG`)
+   TEST_CHECK(tn_task_wakeup(&_dpc.worker) == TN_RC_OK);
+   TEST_CHECK(_dpc.worker_waiting);
+   _burst_post(1);
+   TEST_CHECK(_burst_rc[0] == TN_RC_OK);
+
+   tn_task_sleep(1);
+   _calls_check(1);
+   TEST_CHECK(_dpc.worker_waiting);
+
+   TEST_CHECK(tn_dpc_delete(&_dpc) == TN_RC_OK);
+
+   //-- the worker with higher priority does each call before `raise()`
+   //   returns, and waits again
+   _dpc_create(WORKER_HI_PRIORITY);
+
+   for (i = 0; i < 3; i++){
+      _burst_post(1);
+      TEST_CHECK(_burst_rc[0] == TN_RC_OK);
+      _calls_check(1);
+      TEST_CHECK(_dpc.worker_waiting);
+      TEST_CHECK(_dpc.worker.task_state == TN_TASK_STATE_WAIT);
+   }
+
+   TEST_CHECK(tn_dpc_stat_get(&_dpc, &stat, TN_FALSE) == TN_RC_OK);
+   TEST_CHECK(stat.done_cnt == 3 && stat.batch_max == 1);
+
+   TEST_CHECK(tn_dpc_delete(&_dpc) == TN_RC_OK);
+
+   printf("wakeup: done\n");
+}
+
+static void _timer_start(void)
+{
+   struct sigevent sev;
+   struct itimerspec its;
+
+   memset(&sev, 0, sizeof(sev));
+   sev.sigev_notify = SIGEV_SIGNAL;
+   sev.sigev_signo = SIGUSR1;
+   TEST_CHECK(timer_create(CLOCK_MONOTONIC, &sev, &_timer) == 0);
+
+   memset(&its, 0, sizeof(its));
+   its.it_value.tv_nsec = ISR_PERIOD_NS;
+   its.it_interval.tv_nsec = ISR_PERIOD_NS;
+   TEST_CHECK(timer_settime(_timer, 0, &its, TN_NULL) == 0);
+}
+
+static void _test_stress(void)
+{
+   struct TN_DPCStat stat;
+   unsigned long rand_state = 1;
+
+   _dpc_create(WORKER_LO_PRIORITY);
+
+   _isr_mode = _ISR_MODE_SEQ;
+   _timer_start();
+
+   while (_seq_posted_cnt < STRESS_CALLS_CNT){
+      if (test_rand(&rand_state) % 4 == 0){
+         _spin(ISR_PERIOD_NS * DPC_ITEMS_CNT * 2);
+      }
+      tn_task_sleep(1);
+   }
+
+   _isr_mode = _ISR_MODE_STOP;
+   TEST_CHECK(timer_delete(_timer) == 0);
+
+   //-- let the worker finish
+   tn_task_sleep(1);
+   TEST_CHECK(_dpc.worker_waiting);
+   TEST_CHECK(_dpc.filled_cnt == 0);
+   TEST_CHECK(_seq_done_cnt == _seq_posted_cnt);
+
+   TEST_CHECK(tn_dpc_stat_get(&_dpc, &stat, TN_FALSE) == TN_RC_OK);
+   TEST_CHECK(stat.done_cnt == _seq_done_cnt);
+   TEST_CHECK(stat.overflow_cnt == _seq_overflow_cnt);
+   TEST_CHECK(stat.overflow_cnt > 0);
+   TEST_CHECK(stat.backlog_max == DPC_ITEMS_CNT);
+   TEST_CHECK(stat.batch_max > 1);
+
+   TEST_CHECK(tn_dpc_delete(&_dpc) == TN_RC_OK);
+
+   printf("stress: done, %lu calls, %lu overflows, batch max %d\n",
+         stat.done_cnt, stat.overflow_cnt, stat.batch_max
+         );
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   TEST_CHECK(tn_posix_isr_set(SIGUSR1, _isr) == 0);
+
+   _test_batch();
+   _test_overflow();
+   _test_wakeup();
+   _test_stress();
+}
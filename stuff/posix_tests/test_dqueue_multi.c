@@ -0,0 +1,383 @@
+/*
+ * Test of the batch data queue services, `tn_queue_send_multi()` and
+ * `tn_queue_receive_multi()`, with the tasks which wait in the middle of the
+ * batch:
+ *
+ *    - the sender of the batch which doesn't fit waits for each next item,
+ *      and is fed by several receives; items come in order;
+ *    - the receive which wants more than the FIFO holds takes the items of
+ *      the waiting senders as well;
+ *    - `timeout` is for the whole batch: each wait gets what is left of it;
+ *    - the queue deleted while the sender waits, or after it is woken up but
+ *      before it continues, stops the batch with `#TN_RC_DELETED`, and the
+ *      items sent so far are reported;
+ *    - one batch wakes up several waiting receivers, one item each, and the
+ *      rest goes to the FIFO;
+ *    - the woken-up receiver takes more items which are in the FIFO by the
+ *      time it runs.
+ *
+ * Workers with higher priority than the main task run as soon as they are
+ * woken up, so the main task checks the state right after each call; the
+ * worker with lower priority runs only when the main task sleeps.
+ */
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  QUEUE_ITEMS_CNT      4
+
+#define  WORKER_ITEMS_MAX     16
+
+//-- workers with higher priority than the main task, and the one with lower
+#define  WORKERS_HI_CNT       3
+#define  WORKER_HI_PRIORITY   (TEST_MAIN_TASK_PRIORITY - 1)
+#define  WORKER_LO_PRIORITY   (TEST_MAIN_TASK_PRIORITY + 1)
+
+//-- the value of the n-th item; items are never `TN_NULL`
+#define  ITEM(n)              ((void *)(TN_UIntPtr)((n) + 1))
+
+enum _JobType {
+   _JOB_SEND,
+   _JOB_RECEIVE,
+};
+
+struct _Worker {
+   struct TN_Task    task;
+   TN_UWord          stack[TEST_TASK_STACK_SIZE];
+   enum _JobType     job_type;
+   void             *items[WORKER_ITEMS_MAX];
+   int               cnt;
+   TN_TickCnt        timeout;
+   volatile enum TN_RCode rc;
+   volatile int      done_cnt;
+   volatile TN_BOOL  done;
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_DQueue    _dque;
+static void               *_dque_fifo[QUEUE_ITEMS_CNT];
+
+static struct _Worker      _workers_hi[WORKERS_HI_CNT];
+static struct _Worker      _worker_lo;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _worker_body(void *param)
+{
+   struct _Worker *worker = (struct _Worker *)param;
+   int done_cnt = -1;
+
+   if (worker->job_type == _JOB_SEND){
+      worker->rc = tn_queue_send_multi(
+            &_dque, worker->items, worker->cnt, &done_cnt, worker->timeout
+            );
+   } else {
+      worker->rc = tn_queue_receive_multi(
+            &_dque, worker->items, worker->cnt, &done_cnt, worker->timeout
+            );
+   }
+
+   worker->done_cnt = done_cnt;
+   worker->done = TN_TRUE;
+}
+
+/**
+ * Start the worker; the sender sends `cnt` items from the `first` one.
+ */
+static void _worker_start(
+      struct _Worker *worker,
+      enum _JobType job_type,
+      int first,
+      int cnt,
+      TN_TickCnt timeout
+      )
+{
+   int i;
+
+   worker->job_type = job_type;
+   worker->cnt = cnt;
+   worker->timeout = timeout;
+   worker->rc = TN_RC_INTERNAL;
+   worker->done_cnt = -1;
+   worker->done = TN_FALSE;
+
+   for (i = 0; i < cnt; i++){
+      worker->items[i] = (job_type == _JOB_SEND) ? ITEM(first + i) : TN_NULL;
+   }
+
+   TEST_CHECK(tn_task_activate(&worker->task) == TN_RC_OK);
+}
+
+static TN_BOOL _worker_is_waiting(
+      struct _Worker *worker,
+      enum TN_WaitReason reason
+      )
+{
+   return (
+            (worker->task.task_state & TN_TASK_STATE_WAIT)
+         && worker->task.task_wait_reason == reason
+         );
+}
+
+static void _queue_create(void)
+{
+   TEST_CHECK(
+         tn_queue_create(&_dque, _dque_fifo, QUEUE_ITEMS_CNT) == TN_RC_OK
+         );
+}
+
+/**
+ * Receive up to `cnt` items by polling, check that exactly `expected_cnt`
+ * are received and that they go in order from the `first` one.
+ */
+static void _receive(int first, int cnt, int expected_cnt)
+{
+   void *items[WORKER_ITEMS_MAX];
+   int received_cnt = -1;
+   int i;
+
+   TEST_CHECK(
+         tn_queue_receive_multi_polling(&_dque, items, cnt, &received_cnt)
+         == TN_RC_OK
+         );
+   TEST_CHECK(received_cnt == expected_cnt);
+
+   for (i = 0; i < received_cnt; i++){
+      TEST_CHECK(items[i] == ITEM(first + i));
+   }
+}
+
+static void _test_partial(void)
+{
+   struct _Worker *sender = &_workers_hi[0];
+   int received = 0;
+   int cnt = 1;
+
+   _queue_create();
+
+   //-- the sender fills the FIFO, and waits with the next item
+   _worker_start(sender, _JOB_SEND, 0, 10, TN_WAIT_INFINITE);
+   TEST_CHECK(_worker_is_waiting(sender, TN_WAIT_REASON_DQUE_WSEND));
+   TEST_CHECK(sender->task.subsys_wait.dqueue.data_elem == ITEM(4));
+
+   //-- each receive frees some room, which the sender fills right away
+   while (received < 10){
+      int expected_cnt = TEST_MIN(cnt, QUEUE_ITEMS_CNT);
+
+      _receive(received, cnt, expected_cnt);
+      received += expected_cnt;
+      cnt = cnt % 3 + 1;
+
+      if (received + QUEUE_ITEMS_CNT < 10){
+         TEST_CHECK(_worker_is_waiting(sender, TN_WAIT_REASON_DQUE_WSEND));
+         TEST_CHECK(
+               sender->task.subsys_wait.dqueue.data_elem
+               == ITEM(received + QUEUE_ITEMS_CNT)
+               );
+         TEST_CHECK(_dque.filled_items_cnt == QUEUE_ITEMS_CNT);
+      } else {
+         TEST_CHECK(sender->done && sender->rc == TN_RC_OK);
+         TEST_CHECK(sender->done_cnt == 10);
+         TEST_CHECK(_dque.filled_items_cnt == 10 - received);
+         cnt = TEST_MIN(cnt, 10 - received);
+      }
+   }
+
+   //-- two senders wait; the receive which wants more than the FIFO holds
+   //   takes their items as well, after they are moved to the FIFO
+   _worker_start(&_workers_hi[0], _JOB_SEND, 0, 6, TN_WAIT_INFINITE);
+   _worker_start(&_workers_hi[1], _JOB_SEND, 100, 2, TN_WAIT_INFINITE);
+   TEST_CHECK(
+         _worker_is_waiting(&_workers_hi[1], TN_WAIT_REASON_DQUE_WSEND)
+         );
+
+   _receive(0, 5, 5);
+
+   //-- both senders are woken up, and send the rest in turn
+   TEST_CHECK(_workers_hi[0].done && _workers_hi[0].done_cnt == 6);
+   TEST_CHECK(_workers_hi[1].done && _workers_hi[1].done_cnt == 2);
+   _receive(100, 1, 1);
+   _receive(5, 1, 1);
+   _receive(101, 1, 1);
+   TEST_CHECK(_dque.filled_items_cnt == 0);
+
+   TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+
+   printf("partial: done\n");
+}
+
+static void _test_timeout(void)
+{
+   struct _Worker *sender = &_workers_hi[0];
+
+   _queue_create();
+
+   //-- the sender gets 10 ticks for the whole batch; after 4 and 8 ticks
+   //   one item is received, so it waits three times, and the last wait
+   //   gets just what is left of 10 ticks
+   _worker_start(sender, _JOB_SEND, 0, 8, 10);
+   TEST_CHECK(_worker_is_waiting(sender, TN_WAIT_REASON_DQUE_WSEND));
+
+   tn_task_sleep(4);
+   _receive(0, 1, 1);
+   TEST_CHECK(_worker_is_waiting(sender, TN_WAIT_REASON_DQUE_WSEND));
+   TEST_CHECK(sender->task.subsys_wait.dqueue.data_elem == ITEM(5));
+
+   tn_task_sleep(4);
+   _receive(1, 1, 1);
+   TEST_CHECK(_worker_is_waiting(sender, TN_WAIT_REASON_DQUE_WSEND));
+   TEST_CHECK(sender->task.subsys_wait.dqueue.data_elem == ITEM(6));
+
+   //-- if each wait got the whole timeout, the sender would still wait
+   tn_task_sleep(4);
+   TEST_CHECK(sender->done && sender->rc == TN_RC_TIMEOUT);
+   TEST_CHECK(sender->done_cnt == 6);
+
+   _receive(2, QUEUE_ITEMS_CNT, QUEUE_ITEMS_CNT);
+
+   TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+
+   printf("timeout: done\n");
+}
+
+static void _test_deleted(void)
+{
+   struct _Worker *sender = &_workers_hi[0];
+
+   //-- the queue is deleted while the sender waits
+   _queue_create();
+   _worker_start(sender, _JOB_SEND, 0, 10, TN_WAIT_INFINITE);
+   _receive(0, 1, 1);
+   TEST_CHECK(_worker_is_waiting(sender, TN_WAIT_REASON_DQUE_WSEND));
+
+   TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+   TEST_CHECK(sender->done && sender->rc == TN_RC_DELETED);
+   TEST_CHECK(sender->done_cnt == 5);
+
+   //-- the queue is deleted after the sender is woken up, but before it
+   //   continues: the item it waited with is sent, and that's it
+   _queue_create();
+   _worker_start(&_worker_lo, _JOB_SEND, 0, 10, TN_WAIT_INFINITE);
+   tn_task_sleep(1);
+   TEST_CHECK(_worker_is_waiting(&_worker_lo, TN_WAIT_REASON_DQUE_WSEND));
+
+   _receive(0, 1, 1);
+   TEST_CHECK(_worker_lo.task.task_state == TN_TASK_STATE_RUNNABLE);
+
+   TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+   tn_task_sleep(1);
+   TEST_CHECK(_worker_lo.done && _worker_lo.rc == TN_RC_DELETED);
+   TEST_CHECK(_worker_lo.done_cnt == 5);
+
+   printf("deleted: done\n");
+}
+
+static void _test_receivers(void)
+{
+   int sent_cnt = -1;
+   void *items[5];
+   int i;
+
+   _queue_create();
+
+   //-- all the receivers wait, and the batch gives one item to each of
+   //   them in one pass; the rest goes to the FIFO. The first receiver runs
+   //   first, and takes the rest as well.
+   for (i = 0; i < WORKERS_HI_CNT; i++){
+      _worker_start(&_workers_hi[i], _JOB_RECEIVE, 0, 4, TN_WAIT_INFINITE);
+      TEST_CHECK(
+            _worker_is_waiting(&_workers_hi[i], TN_WAIT_REASON_DQUE_WRECEIVE)
+            );
+   }
+
+   for (i = 0; i < 5; i++){
+      items[i] = ITEM(i);
+   }
+   TEST_CHECK(
+         tn_queue_send_multi_polling(&_dque, items, 5, &sent_cnt) == TN_RC_OK
+         );
+   TEST_CHECK(sent_cnt == 5);
+
+   TEST_CHECK(_workers_hi[0].done && _workers_hi[0].rc == TN_RC_OK);
+   TEST_CHECK(_workers_hi[0].done_cnt == 3);
+   TEST_CHECK(_workers_hi[0].items[0] == ITEM(0));
+   TEST_CHECK(_workers_hi[0].items[1] == ITEM(3));
+   TEST_CHECK(_workers_hi[0].items[2] == ITEM(4));
+
+   for (i = 1; i < WORKERS_HI_CNT; i++){
+      TEST_CHECK(_workers_hi[i].done && _workers_hi[i].rc == TN_RC_OK);
+      TEST_CHECK(_workers_hi[i].done_cnt == 1);
+      TEST_CHECK(_workers_hi[i].items[0] == ITEM(i));
+   }
+   TEST_CHECK(_dque.filled_items_cnt == 0);
+
+   //-- the receiver with lower priority is woken up by the first item, and
+   //   by the time it runs, there are more
+   _worker_start(&_worker_lo, _JOB_RECEIVE, 0, 4, TN_WAIT_INFINITE);
+   tn_task_sleep(1);
+   TEST_CHECK(
+         _worker_is_waiting(&_worker_lo, TN_WAIT_REASON_DQUE_WRECEIVE)
+         );
+
+   for (i = 0; i < 3; i++){
+      TEST_CHECK(tn_queue_send_polling(&_dque, ITEM(10 + i)) == TN_RC_OK);
+   }
+   TEST_CHECK(!_worker_lo.done);
+
+   tn_task_sleep(1);
+   TEST_CHECK(_worker_lo.done && _worker_lo.rc == TN_RC_OK);
+   TEST_CHECK(_worker_lo.done_cnt == 3);
+   for (i = 0; i < 3; i++){
+      TEST_CHECK(_worker_lo.items[i] == ITEM(10 + i));
+   }
+   TEST_CHECK(_dque.filled_items_cnt == 0);
+
+   TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+
+   printf("receivers: done\n");
+}
+
+static void _worker_create(struct _Worker *worker, int priority)
+{
+   TEST_CHECK(
+         tn_task_create_wname(
+            &worker->task, _worker_body, priority,
+            worker->stack, TEST_TASK_STACK_SIZE, worker, 0, "worker"
+            ) == TN_RC_OK
+         );
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int i;
+
+   for (i = 0; i < WORKERS_HI_CNT; i++){
+      _worker_create(&_workers_hi[i], WORKER_HI_PRIORITY);
+   }
+   _worker_create(&_worker_lo, WORKER_LO_PRIORITY);
+
+   _test_partial();
+   _test_timeout();
+   _test_deleted();
+   _test_receivers();
+}
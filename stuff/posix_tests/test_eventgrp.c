@@ -0,0 +1,312 @@
+/*
+ * Randomized test of event group: a number of tasks wait for random patterns
+ * (single and multiple bits, OR/AND, with and without AUTOCLR) while the
+ * main task modifies the pattern and changes priorities of the waiting
+ * tasks; it is repeated for FIFO and priority order of waiters and for
+ * several seeds.
+ *
+ * After each step, it checks that no waiting task is left whose condition
+ * is satisfied by the current pattern, and each woken-up task checks that
+ * its condition was satisfied indeed.
+ *
+ * Every wakeup (which task, at which step, with which pattern) is folded
+ * into the hash which is printed for each seed. The same source is built
+ * with and without `#TN_EVENTGRP_BIT_INDEX`, and `make run` checks that
+ * outputs are identical: i.e. the same tasks are woken up in the same
+ * order.
+ */
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  WAITERS_CNT          24
+#define  SEEDS_CNT            8
+#define  STEPS_CNT            2000
+
+//-- bits the main task operates on; it never sets all of them at once, so
+//   that a waiter can always find a pattern it has to wait for.
+//   Bit 5 is in the upper half of `TN_UWord` on 64-bit host.
+#define  BITS_CNT             6
+#define  BIT(n)               \
+   ((n) == 5                                                            \
+    ? ((TN_UWord)1 << (sizeof(TN_UWord) * 8 - 1))                       \
+    : ((TN_UWord)1 << (n)))
+#define  BITS_ALL             \
+   (BIT(0) | BIT(1) | BIT(2) | BIT(3) | BIT(4) | BIT(5))
+
+//-- waiters have higher priorities than the main task, so woken-up ones
+//   run as soon as the main task modifies the event group
+#define  WAITER_PRIORITY_LOWEST (TEST_MAIN_TASK_PRIORITY - 1)
+#define  WAITER_PRIORITIES    4
+
+struct _Waiter {
+   struct TN_Task    task;
+   TN_UWord          stack[TEST_TASK_STACK_SIZE];
+   unsigned long     rand_state;
+   int               idx;
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct _Waiter      _waiters[WAITERS_CNT];
+static struct TN_EventGrp  _eventgrp;
+
+static unsigned long _rand_state;
+
+//-- current step of the main task, and the hash of all wakeups so far
+static int           _step;
+static unsigned long _hash;
+static int           _wakeups_cnt;
+static int           _deleted_cnt;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _hash_add(unsigned long value)
+{
+   //-- FNV-1a, word by word
+   _hash = (_hash ^ value) * 16777619ul;
+}
+
+/**
+ * Returns random pattern of 1 to 3 bits
+ */
+static TN_UWord _rand_pattern(unsigned long *p_state)
+{
+   TN_UWord pattern = 0;
+   int bits_cnt = 1 + (int)(test_rand(p_state) % 3);
+   int i;
+
+   for (i = 0; i < bits_cnt; i++){
+      int bit = (int)(test_rand(p_state) % BITS_CNT);
+
+      pattern |= BIT(bit);
+   }
+
+   return pattern;
+}
+
+static TN_BOOL _is_satisfied(
+      TN_UWord pattern,
+      TN_UWord wait_pattern,
+      enum TN_EGrpWaitMode wait_mode
+      )
+{
+   return (wait_mode & TN_EVENTGRP_WMODE_AND)
+      ? ((pattern & wait_pattern) == wait_pattern)
+      : ((pattern & wait_pattern) != 0);
+}
+
+/**
+ * Pick random pattern and mode to wait for, which isn't satisfied by the
+ * current pattern, so that the task really waits.
+ */
+static void _wait_params_get(
+      struct _Waiter *waiter,
+      TN_UWord *p_wait_pattern,
+      enum TN_EGrpWaitMode *p_wait_mode
+      )
+{
+   TN_UWord pattern = _eventgrp.pattern;
+   TN_UWord wait_pattern;
+   enum TN_EGrpWaitMode wait_mode;
+   int tries = 0;
+
+   do {
+      wait_pattern = _rand_pattern(&waiter->rand_state);
+      wait_mode = (test_rand(&waiter->rand_state) % 2)
+         ? TN_EVENTGRP_WMODE_AND
+         : TN_EVENTGRP_WMODE_OR;
+   } while (
+         _is_satisfied(pattern, wait_pattern, wait_mode)
+         && ++tries < 8
+         );
+
+   if (_is_satisfied(pattern, wait_pattern, wait_mode)){
+      //-- give up: wait for the lowest bit which isn't set
+      int bit = 0;
+
+      while (pattern & BIT(bit)){
+         bit++;
+      }
+
+      wait_pattern = BIT(bit);
+   }
+
+   if (test_rand(&waiter->rand_state) % 3 == 0){
+      wait_mode |= TN_EVENTGRP_WMODE_AUTOCLR;
+   }
+
+   *p_wait_pattern = wait_pattern;
+   *p_wait_mode = wait_mode;
+}
+
+static void _waiter_body(void *param)
+{
+   struct _Waiter *waiter = (struct _Waiter *)param;
+   enum TN_RCode rc = TN_RC_OK;
+
+   while (rc == TN_RC_OK){
+      TN_UWord wait_pattern;
+      enum TN_EGrpWaitMode wait_mode;
+      TN_UWord flags = 0;
+
+      _wait_params_get(waiter, &wait_pattern, &wait_mode);
+
+      rc = tn_eventgrp_wait(
+            &_eventgrp, wait_pattern, wait_mode, &flags, TN_WAIT_INFINITE
+            );
+
+      if (rc == TN_RC_OK){
+         TEST_CHECK(_is_satisfied(flags, wait_pattern, wait_mode));
+         _wakeups_cnt++;
+      } else {
+         TEST_CHECK(rc == TN_RC_DELETED);
+         _deleted_cnt++;
+      }
+
+      _hash_add((unsigned long)_step);
+      _hash_add((unsigned long)waiter->idx);
+      _hash_add((unsigned long)rc);
+      _hash_add((unsigned long)flags);
+   }
+}
+
+/**
+ * Check that no waiting task is left whose condition is satisfied.
+ */
+static void _waiters_check(void)
+{
+   int i;
+
+   for (i = 0; i < WAITERS_CNT; i++){
+      struct TN_Task *task = &_waiters[i].task;
+
+      TEST_CHECK(task->task_state == TN_TASK_STATE_WAIT);
+      TEST_CHECK(task->task_wait_reason == TN_WAIT_REASON_EVENT);
+      TEST_CHECK(
+            !_is_satisfied(
+               _eventgrp.pattern,
+               task->subsys_wait.eventgrp.wait_pattern,
+               task->subsys_wait.eventgrp.wait_mode
+               )
+            );
+   }
+}
+
+static void _step_perform(void)
+{
+   if (test_rand(&_rand_state) % 5 == 0){
+      //-- change priority of some waiter
+      struct _Waiter *waiter = &_waiters[test_rand(&_rand_state) % WAITERS_CNT];
+      int priority = WAITER_PRIORITY_LOWEST
+         - (int)(test_rand(&_rand_state) % WAITER_PRIORITIES);
+
+      TEST_CHECK(
+            tn_task_change_priority(&waiter->task, priority) == TN_RC_OK
+            );
+   } else {
+      //-- modify the pattern, but never set all bits
+      enum TN_EGrpOp operation =
+         (enum TN_EGrpOp)(test_rand(&_rand_state) % 3);
+      TN_UWord pattern = _rand_pattern(&_rand_state);
+      TN_UWord result = _eventgrp.pattern;
+
+      switch (operation){
+         case TN_EVENTGRP_OP_SET:      result |= pattern;   break;
+         case TN_EVENTGRP_OP_CLEAR:    result &= ~pattern;  break;
+         case TN_EVENTGRP_OP_TOGGLE:   result ^= pattern;   break;
+      }
+
+      if (result == BITS_ALL){
+         operation = TN_EVENTGRP_OP_CLEAR;
+      }
+
+      TEST_CHECK(
+            tn_eventgrp_modify(&_eventgrp, operation, pattern) == TN_RC_OK
+            );
+   }
+}
+
+static void _test_seed(unsigned long seed, enum TN_EGrpAttr attr)
+{
+   int i;
+
+   _rand_state = seed;
+   _hash = 2166136261ul;
+   _wakeups_cnt = 0;
+   _deleted_cnt = 0;
+   _step = 0;
+
+   TEST_CHECK(tn_eventgrp_create_wattr(&_eventgrp, attr, 0) == TN_RC_OK);
+
+   for (i = 0; i < WAITERS_CNT; i++){
+      struct _Waiter *waiter = &_waiters[i];
+
+      waiter->idx = i;
+      waiter->rand_state = seed * 1000 + (unsigned long)i + 1;
+
+      TEST_CHECK(
+            tn_task_create_wname(
+               &waiter->task, _waiter_body,
+               WAITER_PRIORITY_LOWEST
+               - (int)(test_rand(&_rand_state) % WAITER_PRIORITIES),
+               waiter->stack, TEST_TASK_STACK_SIZE, waiter,
+               0, "waiter"
+               ) == TN_RC_OK
+            );
+
+      //-- `tn_task_create()` doesn't switch context even if the new task
+      //   has higher priority, so the task would start at some random
+      //   moment later (say, on the tick); `tn_task_activate()` switches
+      //   context right away, so the waiters start in a deterministic order
+      TEST_CHECK(tn_task_activate(&waiter->task) == TN_RC_OK);
+   }
+
+   for (_step = 0; _step < STEPS_CNT; _step++){
+      _step_perform();
+      _waiters_check();
+   }
+
+   //-- wake up everybody with `TN_RC_DELETED`: they exit then
+   TEST_CHECK(tn_eventgrp_delete(&_eventgrp) == TN_RC_OK);
+   TEST_CHECK(_deleted_cnt == WAITERS_CNT);
+
+   for (i = 0; i < WAITERS_CNT; i++){
+      TEST_CHECK(tn_task_delete(&_waiters[i].task) == TN_RC_OK);
+   }
+
+   printf("seed %lu, %s order: wakeups %d, hash 0x%08lx\n",
+         seed,
+         (attr & TN_EVENTGRP_ATTR_WAIT_PRIO) ? "priority" : "fifo",
+         _wakeups_cnt, _hash & 0xfffffffful
+         );
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   unsigned long seed;
+
+   for (seed = 1; seed <= SEEDS_CNT; seed++){
+      _test_seed(seed, TN_EVENTGRP_ATTR_NONE);
+      _test_seed(seed, TN_EVENTGRP_ATTR_WAIT_PRIO);
+   }
+}
@@ -0,0 +1,658 @@
+/*
+ * Test of the heap.
+ *
+ * First, the random test: blocks of random sizes are allocated and freed,
+ * each block is filled with its own pattern, and after each step the heap
+ * is checked against the list of allocated blocks:
+ *
+ *    - blocks are inside the heap, aligned, and don't overlap; their
+ *      content is intact, and so are the guard words around the buffer;
+ *    - free neighbours are merged: there is exactly one free block in
+ *      each gap between allocated blocks which is large enough to hold
+ *      one, and none in the others (see `_heap_check()`);
+ *    - statistics agree with the list.
+ *
+ * Then, explicit cases:
+ *
+ *    - the block of exactly the same size as the just freed one is
+ *      allocated, although its size class isn't searched otherwise; only
+ *      the first block of the class is checked;
+ *    - waiting tasks are served in order, and the small request doesn't
+ *      overtake the large one which can't be satisfied yet;
+ *    - waiting with timeout;
+ *    - `tn_heap_ifree()` from the ISR (`SIGUSR1` handler) wakes up the
+ *      waiting task;
+ *    - deletion of the heap wakes up the waiting task with `TN_RC_DELETED`.
+ *
+ * Layout of the blocks is private to the heap, so the test finds out the
+ * header size and minimum block size from the statistics at the beginning,
+ * see `_layout_detect()`.
+ */
+
+#include <signal.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  HEAP_SIZE            8192
+#define  BLOCKS_MAX           64
+#define  BLOCK_SIZE_MAX       512
+#define  STEPS_CNT            50000
+
+#define  GUARD_WORDS          8
+#define  GUARD_VAL            ((TN_UWord)0xa5c35a3cul)
+
+//-- waiters have higher priorities than the main task, so they run as soon
+//   as they get memory
+#define  WAITER_PRIORITY      (TEST_MAIN_TASK_PRIORITY - 1)
+#define  WAITERS_CNT          2
+
+struct _Block {
+   unsigned char    *ptr;
+   unsigned int      size;
+   unsigned char     fill;
+};
+
+struct _Waiter {
+   struct TN_Task    task;
+   TN_UWord          stack[TEST_TASK_STACK_SIZE];
+   unsigned int      size;
+   TN_TickCnt        timeout;
+   volatile enum TN_RCode rc;
+   void             *ptr;
+   volatile TN_BOOL  done;
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct {
+   TN_UWord          guard_before[GUARD_WORDS];
+   TN_HEAP_BUF_DEF(  buf, HEAP_SIZE);
+   TN_UWord          guard_after[GUARD_WORDS];
+} _mem;
+
+static struct TN_Heap   _heap;
+
+static struct _Block    _blocks[BLOCKS_MAX];
+static int              _blocks_cnt;
+
+static struct _Waiter   _waiters[WAITERS_CNT];
+
+static unsigned long    _rand_state = 0x13572468;
+
+//-- layout of the heap, see `_layout_detect()`
+static unsigned char   *_data_start;
+static unsigned int     _data_size;
+static unsigned int     _overhead;
+static unsigned int     _size_min;
+static unsigned int     _align;
+
+//-- block to free from the ISR
+static void            *_isr_ptr;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _isr(void)
+{
+   TEST_CHECK(tn_heap_ifree(&_heap, _isr_ptr) == TN_RC_OK);
+}
+
+static void _waiter_body(void *param)
+{
+   struct _Waiter *waiter = (struct _Waiter *)param;
+
+   waiter->rc = tn_heap_alloc(
+         &_heap, waiter->size, &waiter->ptr, waiter->timeout
+         );
+   waiter->done = TN_TRUE;
+}
+
+/**
+ * Start the waiter which allocates the block of the given size; when it
+ * returns, the waiter has either got the memory, or it waits for it.
+ */
+static void _waiter_start(
+      struct _Waiter *waiter,
+      unsigned int size,
+      TN_TickCnt timeout
+      )
+{
+   waiter->size = size;
+   waiter->timeout = timeout;
+   waiter->rc = TN_RC_INTERNAL;
+   waiter->ptr = TN_NULL;
+   waiter->done = TN_FALSE;
+
+   TEST_CHECK(tn_task_activate(&waiter->task) == TN_RC_OK);
+}
+
+static TN_BOOL _waiter_is_waiting(struct _Waiter *waiter)
+{
+   return (
+            (waiter->task.task_state & TN_TASK_STATE_WAIT)
+         && waiter->task.task_wait_reason == TN_WAIT_REASON_WHEAP
+         );
+}
+
+/**
+ * Size the heap actually takes for the request (not counting the blocks
+ * which are taken entirely, since the rest is too small to be split)
+ */
+static unsigned int _size_adjust(unsigned int size)
+{
+   size = (size + _align - 1) & ~(_align - 1);
+   return TEST_MAX(size, _size_min);
+}
+
+static void _fill(struct _Block *block)
+{
+   unsigned int i;
+
+   for (i = 0; i < block->size; i++){
+      block->ptr[i] = (unsigned char)(block->fill + i);
+   }
+}
+
+static TN_BOOL _fill_is_intact(const struct _Block *block)
+{
+   TN_BOOL ret = TN_TRUE;
+   unsigned int i;
+
+   for (i = 0; i < block->size; i++){
+      if (block->ptr[i] != (unsigned char)(block->fill + i)){
+         ret = TN_FALSE;
+      }
+   }
+
+   return ret;
+}
+
+static void _guards_set(void)
+{
+   int i;
+
+   for (i = 0; i < GUARD_WORDS; i++){
+      _mem.guard_before[i] = GUARD_VAL;
+      _mem.guard_after[i] = GUARD_VAL;
+   }
+}
+
+static void _guards_check(void)
+{
+   int i;
+
+   for (i = 0; i < GUARD_WORDS; i++){
+      TEST_CHECK(_mem.guard_before[i] == GUARD_VAL);
+      TEST_CHECK(_mem.guard_after[i] == GUARD_VAL);
+   }
+}
+
+/**
+ * Allocate the block by polling, register it in the list and fill it.
+ */
+static enum TN_RCode _alloc(unsigned int size, struct _Block **pp_block)
+{
+   void *ptr;
+   enum TN_RCode rc = tn_heap_alloc_polling(&_heap, size, &ptr);
+
+   if (rc == TN_RC_OK){
+      struct _Block *block = &_blocks[_blocks_cnt++];
+
+      block->ptr = (unsigned char *)ptr;
+      block->size = size;
+      block->fill = (unsigned char)test_rand(&_rand_state);
+      _fill(block);
+
+      if (pp_block != TN_NULL){
+         *pp_block = block;
+      }
+   }
+
+   return rc;
+}
+
+/**
+ * Check content of the block, free it and remove it from the list.
+ */
+static void _free(struct _Block *block)
+{
+   TEST_CHECK(_fill_is_intact(block));
+   TEST_CHECK(tn_heap_free(&_heap, block->ptr) == TN_RC_OK);
+
+   *block = _blocks[--_blocks_cnt];
+}
+
+static struct _Block *_block_find(void *ptr)
+{
+   struct _Block *ret = TN_NULL;
+   int i;
+
+   for (i = 0; i < _blocks_cnt; i++){
+      if (_blocks[i].ptr == ptr){
+         ret = &_blocks[i];
+      }
+   }
+
+   return ret;
+}
+
+static void _free_all(void)
+{
+   while (_blocks_cnt > 0){
+      _free(&_blocks[_blocks_cnt - 1]);
+   }
+}
+
+/**
+ * Create the heap and find out its layout:
+ *
+ *    - `_data_start`, `_data_size`: data of the single free block of the
+ *      empty heap;
+ *    - `_overhead`: memory taken by the header of the used block;
+ *    - `_size_min`: minimum size of the block data;
+ *    - `_align`: granularity of block sizes.
+ */
+static void _layout_detect(void)
+{
+   struct TN_HeapStat stat;
+   void *ptr;
+   unsigned int base;
+
+   _guards_set();
+   TEST_CHECK(
+         tn_heap_create(&_heap, _mem.buf, sizeof(_mem.buf)) == TN_RC_OK
+         );
+
+   tn_heap_stat_get(&_heap, &stat);
+   _data_size = stat.largest_free_size;
+
+   //-- the header takes at least a word, and blocks are aligned at least
+   //   to the word
+   base = 16 * sizeof(TN_UWord);
+   TEST_CHECK(tn_heap_alloc_polling(&_heap, base, &ptr) == TN_RC_OK);
+   tn_heap_stat_get(&_heap, &stat);
+   _data_start = (unsigned char *)ptr;
+   _overhead = stat.used_size - base;
+   TEST_CHECK(tn_heap_free(&_heap, ptr) == TN_RC_OK);
+
+   TEST_CHECK(tn_heap_alloc_polling(&_heap, base + 1, &ptr) == TN_RC_OK);
+   tn_heap_stat_get(&_heap, &stat);
+   _align = stat.used_size - _overhead - base;
+   TEST_CHECK(tn_heap_free(&_heap, ptr) == TN_RC_OK);
+
+   TEST_CHECK(tn_heap_alloc_polling(&_heap, 1, &ptr) == TN_RC_OK);
+   tn_heap_stat_get(&_heap, &stat);
+   _size_min = stat.used_size - _overhead;
+   TEST_CHECK(tn_heap_free(&_heap, ptr) == TN_RC_OK);
+
+   TEST_CHECK(_overhead >= sizeof(TN_UWord));
+   TEST_CHECK(_align >= sizeof(TN_UWord) && (_align & (_align - 1)) == 0);
+   TEST_CHECK(_size_min >= _align && _size_min % _align == 0);
+   TEST_CHECK(stat.total_size == _data_size + _overhead);
+   TEST_CHECK(
+         _data_start >= (unsigned char *)_mem.buf
+         && _data_start + _data_size
+            <= (unsigned char *)_mem.buf + sizeof(_mem.buf)
+         );
+
+   printf("layout: data %u bytes, header %u, min block %u, align %u\n",
+         _data_size, _overhead, _size_min, _align
+         );
+}
+
+/**
+ * Check the heap against the list of allocated blocks, see the comment at
+ * the top of the file.
+ *
+ * The gap between two allocated blocks (or the edge of the heap) consists
+ * of the unused tail of the first block (which is less than the header
+ * plus minimum block size, otherwise the block would be split) and the
+ * free block, if any (which takes at least the header plus minimum block
+ * size). So, the free block is there iff the gap is at least that large.
+ */
+static void _heap_check(void)
+{
+   struct _Block *sorted[BLOCKS_MAX];
+   struct TN_HeapStat stat;
+   unsigned char *prev_end = _data_start - _overhead;
+   unsigned int used_min = 0;
+   int gaps_cnt = 0;
+   int i, j;
+
+   _guards_check();
+
+   //-- sort blocks by address
+   for (i = 0; i < _blocks_cnt; i++){
+      struct _Block *block = &_blocks[i];
+
+      for (j = i; j > 0 && sorted[j - 1]->ptr > block->ptr; j--){
+         sorted[j] = sorted[j - 1];
+      }
+      sorted[j] = block;
+   }
+
+   for (i = 0; i <= _blocks_cnt; i++){
+      //-- start of the header of the next block, or of the sentinel
+      unsigned char *next_start = (i < _blocks_cnt)
+         ? sorted[i]->ptr - _overhead
+         : _data_start + _data_size;
+
+      TEST_CHECK(next_start >= prev_end);
+      if ((unsigned int)(next_start - prev_end) >= _overhead + _size_min){
+         gaps_cnt++;
+      }
+
+      if (i < _blocks_cnt){
+         struct _Block *block = sorted[i];
+
+         TEST_CHECK((TN_UIntPtr)block->ptr % sizeof(TN_UWord) == 0);
+         TEST_CHECK(_fill_is_intact(block));
+
+         prev_end = block->ptr + _size_adjust(block->size);
+         used_min += _size_adjust(block->size) + _overhead;
+      }
+   }
+
+   TEST_CHECK(prev_end <= _data_start + _data_size);
+
+   TEST_CHECK(tn_heap_stat_get(&_heap, &stat) == TN_RC_OK);
+   TEST_CHECK(stat.used_blocks_cnt == _blocks_cnt);
+   TEST_CHECK(stat.free_blocks_cnt == gaps_cnt);
+   TEST_CHECK(stat.used_size >= used_min);
+   TEST_CHECK(
+         stat.used_size
+         < used_min + (unsigned int)_blocks_cnt * (_overhead + _size_min)
+         || _blocks_cnt == 0
+         );
+   TEST_CHECK(stat.used_size <= stat.used_size_max);
+   TEST_CHECK((stat.largest_free_size == 0) == (gaps_cnt == 0));
+   TEST_CHECK(stat.largest_free_size <= stat.free_size);
+   TEST_CHECK(
+         stat.free_size
+         == stat.total_size - stat.used_size
+            - (unsigned int)gaps_cnt * _overhead
+         );
+}
+
+/**
+ * Random sizes: mostly small, sometimes up to `#BLOCK_SIZE_MAX`
+ */
+static unsigned int _rand_size(void)
+{
+   unsigned int size = 1 + (unsigned int)(test_rand(&_rand_state) % 64);
+
+   if (test_rand(&_rand_state) % 4 == 0){
+      size = 1 + (unsigned int)(test_rand(&_rand_state) % BLOCK_SIZE_MAX);
+   }
+
+   return size;
+}
+
+static void _test_random(void)
+{
+   unsigned int fail_cnt = 0;
+   struct TN_HeapStat stat;
+   int step;
+
+   for (step = 0; step < STEPS_CNT; step++){
+      if (     _blocks_cnt < BLOCKS_MAX
+            && (_blocks_cnt == 0 || test_rand(&_rand_state) % 2)
+         )
+      {
+         enum TN_RCode rc = _alloc(_rand_size(), TN_NULL);
+
+         TEST_CHECK(rc == TN_RC_OK || rc == TN_RC_TIMEOUT);
+         if (rc == TN_RC_TIMEOUT){
+            fail_cnt++;
+         }
+      } else {
+         _free(&_blocks[test_rand(&_rand_state) % _blocks_cnt]);
+      }
+
+      _heap_check();
+   }
+
+   tn_heap_stat_get(&_heap, &stat);
+   TEST_CHECK(stat.fail_cnt == fail_cnt);
+
+   printf("random: %d steps, %u failed allocations, max used %u of %u\n",
+         STEPS_CNT, fail_cnt, stat.used_size_max, stat.total_size
+         );
+
+   _free_all();
+   _heap_check();
+
+   //-- everything is merged back into a single block
+   tn_heap_stat_get(&_heap, &stat);
+   TEST_CHECK(stat.free_blocks_cnt == 1);
+   TEST_CHECK(stat.largest_free_size == _data_size);
+}
+
+/**
+ * Allocate the rest of the heap: the largest free block entirely
+ */
+static void _alloc_rest(void)
+{
+   struct TN_HeapStat stat;
+
+   tn_heap_stat_get(&_heap, &stat);
+   TEST_CHECK(stat.free_blocks_cnt == 1);
+   TEST_CHECK(_alloc(stat.largest_free_size, TN_NULL) == TN_RC_OK);
+
+   tn_heap_stat_get(&_heap, &stat);
+   TEST_CHECK(stat.free_blocks_cnt == 0);
+}
+
+/**
+ * Two blocks of the same size class (but of different sizes) are freed,
+ * and there are no other free blocks. The one of exactly the requested
+ * size is found only if it is the first in the list.
+ */
+static void _test_exact_reuse(void)
+{
+   //-- these sizes are in the same size class, but not at its start, so
+   //   the class isn't searched for them otherwise
+   const unsigned int size_large = 200;
+   const unsigned int size_small = 192;
+   unsigned char *large_ptr, *small_ptr;
+   struct _Block *block;
+
+   TEST_CHECK(_alloc(size_large, &block) == TN_RC_OK);
+   large_ptr = block->ptr;
+   TEST_CHECK(_alloc(8, TN_NULL) == TN_RC_OK);
+   TEST_CHECK(_alloc(size_small, &block) == TN_RC_OK);
+   small_ptr = block->ptr;
+   TEST_CHECK(_alloc(8, TN_NULL) == TN_RC_OK);
+   _alloc_rest();
+   _heap_check();
+
+   //-- the block of the same size as the just freed one is allocated
+   _free(_block_find(large_ptr));
+   _heap_check();
+   TEST_CHECK(_alloc(size_large, &block) == TN_RC_OK);
+   TEST_CHECK(block->ptr == large_ptr);
+
+   //-- the same, but the block is split, since the rest is large enough
+   _free(block);
+   TEST_CHECK(_alloc(size_large - 64, &block) == TN_RC_OK);
+   TEST_CHECK(block->ptr == large_ptr);
+   _heap_check();
+   _free(block);
+   _heap_check();
+
+   //-- now, free the smaller one as well: it is the first in the list, so
+   //   the larger block isn't found
+   _free(_block_find(small_ptr));
+   _heap_check();
+
+   TEST_CHECK(_alloc(size_large, TN_NULL) == TN_RC_TIMEOUT);
+   TEST_CHECK(_alloc(size_small, &block) == TN_RC_OK);
+   TEST_CHECK(block->ptr == small_ptr);
+   TEST_CHECK(_alloc(size_large, &block) == TN_RC_OK);
+   TEST_CHECK(block->ptr == large_ptr);
+   _heap_check();
+
+   _free_all();
+   _heap_check();
+
+   printf("exact size reuse: done\n");
+}
+
+/**
+ * The heap is full; the first waiter waits for the large block, and the
+ * second one for the small block. The small block is freed, but the second
+ * waiter doesn't get it, since the first one can't be satisfied yet.
+ */
+static void _test_waiters_order(void)
+{
+   struct _Waiter *large = &_waiters[0];
+   struct _Waiter *small = &_waiters[1];
+   struct _Block *block_small, *block_large;
+
+   TEST_CHECK(_alloc(32, &block_small) == TN_RC_OK);
+   TEST_CHECK(_alloc(8, TN_NULL) == TN_RC_OK);
+   TEST_CHECK(_alloc(256, &block_large) == TN_RC_OK);
+   TEST_CHECK(_alloc(8, TN_NULL) == TN_RC_OK);
+   _alloc_rest();
+
+   _waiter_start(large, 256, TN_WAIT_INFINITE);
+   _waiter_start(small, 32, TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter_is_waiting(large));
+   TEST_CHECK(_waiter_is_waiting(small));
+
+   _free(block_small);
+   TEST_CHECK(_waiter_is_waiting(large));
+   TEST_CHECK(_waiter_is_waiting(small));
+
+   //-- now, both can be satisfied
+   _free(block_large);
+   TEST_CHECK(large->done && large->rc == TN_RC_OK);
+   TEST_CHECK(small->done && small->rc == TN_RC_OK);
+   TEST_CHECK(large->ptr != TN_NULL && small->ptr != TN_NULL);
+
+   TEST_CHECK(tn_heap_free(&_heap, large->ptr) == TN_RC_OK);
+   TEST_CHECK(tn_heap_free(&_heap, small->ptr) == TN_RC_OK);
+   _free_all();
+   _heap_check();
+
+   printf("waiters order: done\n");
+}
+
+static void _test_timeout(void)
+{
+   struct _Waiter *waiter = &_waiters[0];
+   struct TN_HeapStat stat;
+   unsigned int fail_cnt;
+
+   _alloc_rest();
+
+   tn_heap_stat_get(&_heap, &stat);
+   fail_cnt = stat.fail_cnt;
+
+   _waiter_start(waiter, 16, 2);
+   TEST_CHECK(_waiter_is_waiting(waiter));
+
+   tn_task_sleep(4);
+
+   TEST_CHECK(waiter->done && waiter->rc == TN_RC_TIMEOUT);
+   tn_heap_stat_get(&_heap, &stat);
+   TEST_CHECK(stat.fail_cnt == fail_cnt + 1);
+   _heap_check();
+
+   _free_all();
+   _heap_check();
+
+   printf("timeout: done\n");
+}
+
+static void _test_ifree(void)
+{
+   struct _Waiter *waiter = &_waiters[0];
+   struct _Block *block;
+
+   TEST_CHECK(_alloc(64, &block) == TN_RC_OK);
+   _alloc_rest();
+
+   _waiter_start(waiter, 64, TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter_is_waiting(waiter));
+
+   //-- the block is freed by the ISR, and the waiter gets it before
+   //   `raise()` returns, since it has higher priority
+   _isr_ptr = block->ptr;
+   *block = _blocks[--_blocks_cnt];
+   raise(SIGUSR1);
+
+   TEST_CHECK(waiter->done && waiter->rc == TN_RC_OK);
+   TEST_CHECK(waiter->ptr == _isr_ptr);
+
+   TEST_CHECK(tn_heap_free(&_heap, waiter->ptr) == TN_RC_OK);
+   _free_all();
+   _heap_check();
+
+   printf("ifree: done\n");
+}
+
+static void _test_delete(void)
+{
+   struct _Waiter *waiter = &_waiters[0];
+
+   _alloc_rest();
+
+   _waiter_start(waiter, 16, TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter_is_waiting(waiter));
+
+   TEST_CHECK(tn_heap_delete(&_heap) == TN_RC_OK);
+   TEST_CHECK(waiter->done && waiter->rc == TN_RC_DELETED);
+
+   _blocks_cnt = 0;
+
+   printf("delete: done\n");
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int i;
+
+   TEST_CHECK(tn_posix_isr_set(SIGUSR1, _isr) == 0);
+
+   for (i = 0; i < WAITERS_CNT; i++){
+      struct _Waiter *waiter = &_waiters[i];
+
+      TEST_CHECK(
+            tn_task_create_wname(
+               &waiter->task, _waiter_body, WAITER_PRIORITY,
+               waiter->stack, TEST_TASK_STACK_SIZE, waiter,
+               0, "waiter"
+               ) == TN_RC_OK
+            );
+   }
+
+   _layout_detect();
+   _heap_check();
+
+   _test_random();
+   _test_exact_reuse();
+   _test_waiters_order();
+   _test_timeout();
+   _test_ifree();
+   _test_delete();
+}
@@ -0,0 +1,111 @@
+/*
+ * Test of interrupts-disabled duration statistics (`#TN_INT_DIS_STAT`):
+ * critical sections of kernel services should be accounted to the call
+ * sites inside these services.
+ */
+
+#include <string.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  ITERATIONS_CNT       100
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_Timer     _timer;
+static struct TN_DQueue    _dque;
+static struct TN_EventGrp  _eventgrp;
+
+static void *_dque_fifo[4];
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _timer_func(struct TN_Timer *timer, void *p_user_data)
+{
+   (void)timer;
+   (void)p_user_data;
+}
+
+/**
+ * Returns total number of measured critical sections entered in the given
+ * source file (compared by the name suffix).
+ */
+static unsigned long _file_sections_cnt(const char *file_suffix)
+{
+   const struct TN_IntDisSite *site;
+   unsigned long cnt = 0;
+   size_t suffix_len = strlen(file_suffix);
+
+   TN_INTSAVE_DATA;
+
+   TN_INT_DIS_SAVE();
+
+   site = tn_int_dis_stat_sites_get();
+
+   for (; site != TN_NULL; site = site->next){
+      size_t len = strlen(site->file);
+
+      if (
+            len >= suffix_len
+            && strcmp(site->file + len - suffix_len, file_suffix) == 0
+         )
+      {
+         cnt += site->cnt;
+      }
+   }
+
+   TN_INT_RESTORE();
+
+   return cnt;
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   TN_BOOL is_active;
+   int i;
+
+   TEST_CHECK(tn_timer_create(&_timer, _timer_func, TN_NULL) == TN_RC_OK);
+   TEST_CHECK(tn_queue_create(&_dque, _dque_fifo, 4) == TN_RC_OK);
+   TEST_CHECK(tn_eventgrp_create(&_eventgrp, 0) == TN_RC_OK);
+
+   tn_int_dis_stat_reset();
+
+   for (i = 0; i < ITERATIONS_CNT; i++){
+      tn_timer_start(&_timer, 1000);
+      tn_timer_is_active(&_timer, &is_active);
+      tn_timer_cancel(&_timer);
+
+      tn_queue_eventgrp_connect(&_dque, &_eventgrp, 0x01);
+      tn_queue_eventgrp_disconnect(&_dque);
+   }
+
+   //-- each iteration enters 3 critical sections in tn_timer.c and 2 ones
+   //   in tn_dqueue.c
+   TEST_CHECK(_file_sections_cnt("tn_timer.c") >= 3 * ITERATIONS_CNT);
+   TEST_CHECK(_file_sections_cnt("tn_dqueue.c") >= 2 * ITERATIONS_CNT);
+
+   printf("sections measured: tn_timer.c %lu, tn_dqueue.c %lu\n",
+         _file_sections_cnt("tn_timer.c"),
+         _file_sections_cnt("tn_dqueue.c")
+         );
+}
@@ -0,0 +1,709 @@
+/*
+ * Test of mutexes with priority inheritance and priority ceiling: worker
+ * tasks lock and unlock mutexes by commands of the main task, and after
+ * each step the main task checks the kernel state against the one computed
+ * from scratch:
+ *
+ *    - priority of each task is its base priority raised by the ceilings of
+ *      the ceiling mutexes it holds and by the priorities of the tasks
+ *      waiting for the inheriting mutexes it holds (transitively);
+ *    - `prio_wait_queue` of each inheriting mutex contains the same tasks
+ *      as its `wait_queue`, ordered by priority;
+ *    - `mutex_queue` of each task contains the mutexes it holds, ordered by
+ *      the priority they impose.
+ *
+ * First, there is the random test: workers lock up to 4 mutexes nested,
+ * with and without timeouts, and the main task releases waiting workers by
+ * force. Mutexes are locked either in the same order by all workers, or in
+ * any order, so that there are lock cycles.
+ *
+ * Then, the explicit lock cycle of three tasks where one of the tasks gives
+ * up by timeout: it used to hang the kernel in the holder chain walk.
+ *
+ * Then, the kernel takes over mutexes locked through the fast path (see
+ * `#TN_MUTEX_FAST_LOCK`): on contention with timeout, and when the holder
+ * is terminated.
+ *
+ * Lock cycles are real deadlocks, so the test is built with
+ * `#TN_MUTEX_DEADLOCK_DETECT` disabled (see Makefile). Priorities of the
+ * tasks in the lock cycle are only checked not to be lower than expected,
+ * see `_state_check()`.
+ *
+ * The same source is built with and without `#TN_MUTEX_FAST_LOCK`. With the
+ * fast path, the uncontended mutex has no `holder` and isn't in the
+ * holder's `mutex_queue` until the kernel takes it over: the holder is in
+ * the `owner` word then, and the mutex is in the holder's
+ * `mutex_fast_list`.
+ */
+
+#include "test_common.h"
+#include "_tn_sys.h"
+#include "_tn_list.h"
+#include "_tn_mutex.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  WORKERS_CNT          7
+
+//-- mutexes with priority inheritance, plus one with priority ceiling
+#define  MUTEXES_I_CNT        5
+#define  MUTEXES_CNT          (MUTEXES_I_CNT + 1)
+#define  MUTEX_C_IDX          MUTEXES_I_CNT
+
+#define  NESTING_MAX          4
+#define  STEPS_CNT            3000
+
+//-- workers have higher priorities than the main task, so they run as soon
+//   as they get a command or a mutex
+#define  WORKER_PRIORITY_LOWEST  (TEST_MAIN_TASK_PRIORITY - 1)
+#define  WORKER_PRIORITIES       4
+#define  CEIL_PRIORITY                                               \
+   (WORKER_PRIORITY_LOWEST - WORKER_PRIORITIES + 1)
+
+enum _Cmd {
+   _CMD_NONE,
+   _CMD_LOCK,
+   _CMD_UNLOCK,
+};
+
+struct _Worker {
+   struct TN_Task    task;
+   TN_UWord          stack[TEST_TASK_STACK_SIZE];
+   struct TN_Sem     cmd_sem;
+
+   //-- current command, `_CMD_NONE` when the worker is done with it
+   volatile enum _Cmd cmd;
+   int               cmd_mutex_idx;
+   TN_TickCnt        cmd_timeout;
+   volatile enum TN_RCode rc;
+
+   //-- indexes of the mutexes held, in the order of locking
+   int               held[NESTING_MAX];
+   int               held_cnt;
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct _Worker   _workers[WORKERS_CNT];
+static struct TN_Mutex  _mutexes[MUTEXES_CNT];
+
+static unsigned long _rand_state = 0x12345678;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _worker_body(void *param)
+{
+   struct _Worker *worker = (struct _Worker *)param;
+
+   for (;;){
+      tn_sem_wait(&worker->cmd_sem, TN_WAIT_INFINITE);
+
+      switch (worker->cmd){
+         case _CMD_LOCK:
+            worker->rc = tn_mutex_lock(
+                  &_mutexes[worker->cmd_mutex_idx], worker->cmd_timeout
+                  );
+            if (worker->rc == TN_RC_OK){
+               worker->held[worker->held_cnt++] = worker->cmd_mutex_idx;
+            }
+            break;
+
+         case _CMD_UNLOCK:
+            worker->held_cnt--;
+            worker->rc = tn_mutex_unlock(
+                  &_mutexes[worker->held[worker->held_cnt]]
+                  );
+            TEST_CHECK(worker->rc == TN_RC_OK);
+            break;
+
+         case _CMD_NONE:
+            break;
+      }
+
+      worker->cmd = _CMD_NONE;
+   }
+}
+
+/**
+ * Give the command to the worker; when it returns, the worker has either
+ * done it, or it waits for the mutex.
+ */
+static void _cmd(
+      struct _Worker *worker,
+      enum _Cmd cmd,
+      int mutex_idx,
+      TN_TickCnt timeout
+      )
+{
+   worker->cmd = cmd;
+   worker->cmd_mutex_idx = mutex_idx;
+   worker->cmd_timeout = timeout;
+
+   TEST_CHECK(tn_sem_signal(&worker->cmd_sem) == TN_RC_OK);
+}
+
+/**
+ * Returns the task which holds the mutex, or `TN_NULL` if it's free.
+ */
+static struct TN_Task *_holder_get(struct TN_Mutex *mutex)
+{
+   struct TN_Task *ret = mutex->holder;
+
+#if TN_MUTEX_FAST_LOCK
+   if (!(mutex->owner & _TN_MUTEX_OWNER_KERNEL)){
+      //-- free, or locked through the fast path
+      TEST_CHECK(mutex->holder == TN_NULL);
+      ret = (struct TN_Task *)mutex->owner;
+   } else {
+      TEST_CHECK(
+            mutex->owner == ((TN_UWord)mutex->holder | _TN_MUTEX_OWNER_KERNEL)
+            );
+   }
+#endif
+
+   return ret;
+}
+
+/**
+ * Returns whether the mutex is locked through the fast path and isn't taken
+ * over by the kernel; always false without `#TN_MUTEX_FAST_LOCK`.
+ */
+static TN_BOOL _is_fast_locked(struct TN_Mutex *mutex)
+{
+#if TN_MUTEX_FAST_LOCK
+   return (mutex->owner != 0 && !(mutex->owner & _TN_MUTEX_OWNER_KERNEL));
+#else
+   (void)mutex;
+   return TN_FALSE;
+#endif
+}
+
+/**
+ * Returns number of mutexes held by the task, the way the kernel sees it:
+ * the ones in `mutex_queue`, plus the ones locked through the fast path.
+ */
+static int _held_mutexes_cnt_get(struct TN_Task *task)
+{
+   struct TN_ListItem *item;
+   int ret = 0;
+
+   _tn_list_for_each(item, &task->mutex_queue){
+      ret++;
+   }
+
+#if TN_MUTEX_FAST_LOCK
+   {
+      struct TN_Mutex *mutex;
+
+      TEST_CHECK(task->mutex_fast_pending == TN_NULL);
+
+      //-- taken over mutexes stay in the fast list until they're unlocked,
+      //   but they're counted in `mutex_queue` already
+      for (
+            mutex = task->mutex_fast_list;
+            mutex != TN_NULL;
+            mutex = mutex->fast_next
+          )
+      {
+         if (_is_fast_locked(mutex)){
+            TEST_CHECK(_holder_get(mutex) == task);
+            ret++;
+         }
+      }
+   }
+#endif
+
+   return ret;
+}
+
+static struct _Worker *_mutex_waiter_get(struct TN_Task *task)
+{
+   struct _Worker *ret = TN_NULL;
+
+   if (     (task->task_state & TN_TASK_STATE_WAIT)
+         && (     task->task_wait_reason == TN_WAIT_REASON_MUTEX_I
+               || task->task_wait_reason == TN_WAIT_REASON_MUTEX_C)
+      )
+   {
+      ret = (struct _Worker *)task->task_func_param;
+   }
+
+   return ret;
+}
+
+/**
+ * Returns whether the worker waits for the mutex whose holder waits for the
+ * mutex whose holder ... and so on, waits for the mutex held by the worker.
+ */
+static TN_BOOL _is_in_lock_cycle(struct _Worker *worker)
+{
+   struct TN_Task *task = &worker->task;
+   TN_BOOL ret = TN_FALSE;
+   int hops;
+
+   for (hops = 0; !ret && task != TN_NULL && hops < WORKERS_CNT; hops++){
+      if (_mutex_waiter_get(task) != TN_NULL){
+         task = _holder_get(
+               container_of(task->pwait_queue, struct TN_Mutex, wait_queue)
+               );
+         ret = (task == &worker->task);
+      } else {
+         task = TN_NULL;
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * Priority imposed by the mutex on its holder, the same way as the kernel
+ * orders mutexes in the holder's `mutex_queue`.
+ */
+static int _imposed_priority(struct TN_Mutex *mutex)
+{
+   int priority = TN_PRIORITIES_CNT - 1;
+
+   if (mutex->protocol == TN_MUTEX_PROT_CEILING){
+      priority = mutex->ceil_priority;
+   } else if (!_tn_list_is_empty(&mutex->prio_wait_queue)){
+      priority = _tn_list_first_entry(
+            &mutex->prio_wait_queue, struct TN_Task, mutex_prio_queue
+            )->priority;
+   }
+
+   return priority;
+}
+
+/**
+ * Check the kernel state against the one computed from scratch, see the
+ * comment at the top of the file.
+ */
+static void _state_check(void)
+{
+   int priorities[WORKERS_CNT];
+   TN_BOOL changed = TN_TRUE;
+   int i, j;
+
+   TN_INTSAVE_DATA;
+
+   //-- timeouts may wake up workers, so keep the state still
+   TN_INT_DIS_SAVE();
+
+   //-- start from base priorities raised by the ceiling mutexes held
+   for (i = 0; i < WORKERS_CNT; i++){
+      struct _Worker *worker = &_workers[i];
+
+      priorities[i] = worker->task.base_priority;
+
+      for (j = 0; j < worker->held_cnt; j++){
+         struct TN_Mutex *mutex = &_mutexes[worker->held[j]];
+
+         TEST_CHECK(_holder_get(mutex) == &worker->task);
+         if (     mutex->protocol == TN_MUTEX_PROT_CEILING
+               && mutex->ceil_priority < priorities[i]
+            )
+         {
+            priorities[i] = mutex->ceil_priority;
+         }
+      }
+   }
+
+   //-- pass priorities of the waiting tasks to the holders of inheriting
+   //   mutexes, until there's nothing to raise
+   while (changed){
+      changed = TN_FALSE;
+
+      for (i = 0; i < WORKERS_CNT; i++){
+         struct TN_Task *task = &_workers[i].task;
+
+         for (j = 0; j < MUTEXES_CNT; j++){
+            struct TN_Mutex *mutex = &_mutexes[j];
+
+            if (     _mutex_waiter_get(task) != TN_NULL
+                  && task->pwait_queue == &mutex->wait_queue
+                  && mutex->protocol == TN_MUTEX_PROT_INHERIT
+               )
+            {
+               int holder_idx = (int)(
+                     (struct _Worker *)_holder_get(mutex)->task_func_param
+                     - _workers
+                     );
+
+               //-- the mutex someone waits for is managed by the kernel
+               TEST_CHECK(!_is_fast_locked(mutex));
+
+               if (priorities[i] < priorities[holder_idx]){
+                  priorities[holder_idx] = priorities[i];
+                  changed = TN_TRUE;
+               }
+            }
+         }
+      }
+   }
+
+   for (i = 0; i < WORKERS_CNT; i++){
+      struct _Worker *worker = &_workers[i];
+      struct TN_ListItem *item;
+      int prev_priority = 0;
+
+      if (_is_in_lock_cycle(worker)){
+         //-- tasks in the lock cycle are deadlocked, and inherited
+         //   priorities may sustain each other there even after the task
+         //   which has raised them has gone; it lasts until the cycle is
+         //   broken. So, the priority can only be higher than expected.
+         TEST_CHECK(worker->task.priority <= priorities[i]);
+      } else {
+         TEST_CHECK(worker->task.priority == priorities[i]);
+      }
+
+      //-- held mutexes should be ordered by the priority they impose
+      _tn_list_for_each(item, &worker->task.mutex_queue){
+         int priority = _imposed_priority(
+               _tn_list_entry(item, struct TN_Mutex, mutex_queue)
+               );
+
+         TEST_CHECK(priority >= prev_priority);
+         prev_priority = priority;
+      }
+
+      TEST_CHECK(_held_mutexes_cnt_get(&worker->task) == worker->held_cnt);
+   }
+
+   //-- waiters of inheriting mutexes should be ordered by priority
+   for (j = 0; j < MUTEXES_I_CNT; j++){
+      struct TN_Mutex *mutex = &_mutexes[j];
+      struct TN_ListItem *item;
+      int prev_priority = 0;
+      int waiters_cnt = 0;
+      int prio_waiters_cnt = 0;
+
+      _tn_list_for_each(item, &mutex->wait_queue){
+         waiters_cnt++;
+      }
+
+      _tn_list_for_each(item, &mutex->prio_wait_queue){
+         struct TN_Task *task = _tn_list_entry(
+               item, struct TN_Task, mutex_prio_queue
+               );
+
+         TEST_CHECK(task->pwait_queue == &mutex->wait_queue);
+         TEST_CHECK(task->priority >= prev_priority);
+         prev_priority = task->priority;
+         prio_waiters_cnt++;
+      }
+
+      TEST_CHECK(prio_waiters_cnt == waiters_cnt);
+   }
+
+   TN_INT_RESTORE();
+}
+
+/**
+ * Pick the mutex for the worker to lock: if `ordered`, only mutexes after
+ * the ones it already holds are taken, so there are no lock cycles.
+ * Returns -1 if there's no suitable mutex.
+ */
+static int _mutex_to_lock_get(struct _Worker *worker, TN_BOOL ordered)
+{
+   int first = 0;
+   int idx;
+   int i;
+
+   if (ordered){
+      for (i = 0; i < worker->held_cnt; i++){
+         first = TEST_MAX(first, worker->held[i] + 1);
+      }
+   }
+
+   idx = -1;
+   if (first < MUTEXES_CNT){
+      idx = first + (int)(test_rand(&_rand_state) % (MUTEXES_CNT - first));
+
+      for (i = 0; i < worker->held_cnt; i++){
+         if (worker->held[i] == idx){
+            idx = -1;
+         }
+      }
+   }
+
+   return idx;
+}
+
+static void _step_perform(TN_BOOL ordered)
+{
+   struct _Worker *worker = &_workers[test_rand(&_rand_state) % WORKERS_CNT];
+   int op = (int)(test_rand(&_rand_state) % 10);
+
+   if (op < 6){
+      //-- lock or unlock, if the worker isn't busy with previous command
+      if (worker->cmd == _CMD_NONE){
+         int idx = -1;
+
+         if (     worker->held_cnt < NESTING_MAX
+               && (worker->held_cnt == 0 || test_rand(&_rand_state) % 2)
+            )
+         {
+            idx = _mutex_to_lock_get(worker, ordered);
+         }
+
+         if (idx >= 0){
+            TN_TickCnt timeout = (test_rand(&_rand_state) % 2)
+               ? TN_WAIT_INFINITE
+               : (TN_TickCnt)(1 + test_rand(&_rand_state) % 3);
+
+            _cmd(worker, _CMD_LOCK, idx, timeout);
+         } else if (worker->held_cnt > 0){
+            _cmd(worker, _CMD_UNLOCK, 0, 0);
+         }
+      }
+   } else if (op < 9){
+      //-- release the worker waiting for the mutex by force
+      if (_mutex_waiter_get(&worker->task) != TN_NULL){
+         TEST_CHECK(tn_task_release_wait(&worker->task) == TN_RC_OK);
+      }
+   } else {
+      //-- let some timeouts expire
+      tn_task_sleep(2);
+   }
+}
+
+/**
+ * Release all waiting workers and unlock all mutexes.
+ */
+static void _workers_reset(void)
+{
+   int i;
+
+   for (i = 0; i < WORKERS_CNT; i++){
+      if (_mutex_waiter_get(&_workers[i].task) != TN_NULL){
+         TEST_CHECK(tn_task_release_wait(&_workers[i].task) == TN_RC_OK);
+      }
+   }
+
+   for (i = 0; i < WORKERS_CNT; i++){
+      while (_workers[i].held_cnt > 0){
+         TEST_CHECK(_workers[i].cmd == _CMD_NONE);
+         _cmd(&_workers[i], _CMD_UNLOCK, 0, 0);
+      }
+   }
+
+   _state_check();
+
+   for (i = 0; i < MUTEXES_CNT; i++){
+      TEST_CHECK(_holder_get(&_mutexes[i]) == TN_NULL);
+   }
+}
+
+static void _test_random(TN_BOOL ordered)
+{
+   int step;
+
+   for (step = 0; step < STEPS_CNT; step++){
+      _step_perform(ordered);
+      _state_check();
+   }
+
+   _workers_reset();
+
+   printf("random, %s locking: done\n", ordered ? "ordered" : "any order");
+}
+
+/**
+ * Three workers lock mutexes in a cycle: each one holds its mutex and waits
+ * for the next one's, and the worker `timeout_idx` waits with timeout.
+ */
+static void _test_cycle(int timeout_idx)
+{
+   int i;
+
+   for (i = 0; i < 3; i++){
+      _cmd(&_workers[i], _CMD_LOCK, i, TN_WAIT_INFINITE);
+      TEST_CHECK(_workers[i].rc == TN_RC_OK);
+   }
+
+   for (i = 0; i < 3; i++){
+      int next = (i + 1) % 3;
+
+      _cmd(
+            &_workers[i], _CMD_LOCK, next,
+            (i == timeout_idx) ? 2 : TN_WAIT_INFINITE
+            );
+      _state_check();
+   }
+
+   //-- let the timeout expire: the worker gives up, and the priorities of
+   //   the others should be recalculated
+   tn_task_sleep(4);
+
+   TEST_CHECK(_workers[timeout_idx].cmd == _CMD_NONE);
+   TEST_CHECK(_workers[timeout_idx].rc == TN_RC_TIMEOUT);
+   _state_check();
+
+   _workers_reset();
+
+   printf("lock cycle, worker %d times out: done\n", timeout_idx);
+}
+
+/**
+ * The holder locks the mutex, another worker waits for it with timeout and
+ * gives up; then the holder unlocks the mutex and locks it again.
+ *
+ * With `#TN_MUTEX_FAST_LOCK`, the mutex is locked through the fast path,
+ * taken over by the kernel when the waiter comes, unlocked through the
+ * kernel, and then the fast path works again.
+ */
+static void _test_takeover_timeout(int mutex_idx)
+{
+   struct _Worker *holder = &_workers[1];
+   struct _Worker *waiter = &_workers[2];
+   struct TN_Mutex *mutex = &_mutexes[mutex_idx];
+
+   _cmd(holder, _CMD_LOCK, mutex_idx, TN_WAIT_INFINITE);
+   TEST_CHECK(holder->rc == TN_RC_OK);
+   TEST_CHECK(_is_fast_locked(mutex) == !!TN_MUTEX_FAST_LOCK);
+   _state_check();
+
+   _cmd(waiter, _CMD_LOCK, mutex_idx, 2);
+   TEST_CHECK(_mutex_waiter_get(&waiter->task) == waiter);
+   TEST_CHECK(!_is_fast_locked(mutex));
+   TEST_CHECK(holder->task.priority == waiter->task.priority);
+   _state_check();
+
+   tn_task_sleep(4);
+
+   TEST_CHECK(waiter->cmd == _CMD_NONE);
+   TEST_CHECK(waiter->rc == TN_RC_TIMEOUT);
+   TEST_CHECK(holder->task.priority == holder->task.base_priority);
+   _state_check();
+
+   _cmd(holder, _CMD_UNLOCK, 0, 0);
+   TEST_CHECK(_holder_get(mutex) == TN_NULL);
+   _state_check();
+
+   _cmd(holder, _CMD_LOCK, mutex_idx, TN_WAIT_INFINITE);
+   TEST_CHECK(holder->rc == TN_RC_OK);
+   TEST_CHECK(_is_fast_locked(mutex) == !!TN_MUTEX_FAST_LOCK);
+   _state_check();
+
+   _workers_reset();
+
+   printf("takeover on timeout: done\n");
+}
+
+/**
+ * The holder locks the ceiling mutex and the inheriting one, another worker
+ * waits for the latter, and the holder is terminated: the waiter should get
+ * the mutex, and the ceiling one should be free.
+ *
+ * With `#TN_MUTEX_FAST_LOCK`, both mutexes are locked through the fast
+ * path (base priority of the holder is equal to the ceiling); the
+ * inheriting one is taken over by the kernel when the waiter comes, and the
+ * ceiling one is still in the fast list when the holder is terminated.
+ */
+static void _test_takeover_terminate(void)
+{
+   struct _Worker *holder = &_workers[WORKER_PRIORITIES - 1];
+   struct _Worker *waiter = &_workers[0];
+
+   TEST_CHECK(holder->task.base_priority == CEIL_PRIORITY);
+
+   _cmd(holder, _CMD_LOCK, MUTEX_C_IDX, TN_WAIT_INFINITE);
+   TEST_CHECK(holder->rc == TN_RC_OK);
+   _cmd(holder, _CMD_LOCK, 0, TN_WAIT_INFINITE);
+   TEST_CHECK(holder->rc == TN_RC_OK);
+   TEST_CHECK(_is_fast_locked(&_mutexes[0]) == !!TN_MUTEX_FAST_LOCK);
+   TEST_CHECK(
+         _is_fast_locked(&_mutexes[MUTEX_C_IDX]) == !!TN_MUTEX_FAST_LOCK
+         );
+   _state_check();
+
+   _cmd(waiter, _CMD_LOCK, 0, TN_WAIT_INFINITE);
+   TEST_CHECK(_mutex_waiter_get(&waiter->task) == waiter);
+   TEST_CHECK(!_is_fast_locked(&_mutexes[0]));
+   _state_check();
+
+   TEST_CHECK(tn_task_terminate(&holder->task) == TN_RC_OK);
+   holder->held_cnt = 0;
+
+   TEST_CHECK(waiter->cmd == _CMD_NONE);
+   TEST_CHECK(waiter->rc == TN_RC_OK);
+   TEST_CHECK(_holder_get(&_mutexes[0]) == &waiter->task);
+   TEST_CHECK(_holder_get(&_mutexes[MUTEX_C_IDX]) == TN_NULL);
+   _state_check();
+
+   TEST_CHECK(tn_task_activate(&holder->task) == TN_RC_OK);
+
+   //-- the ceiling mutex should be usable as usual
+   _cmd(holder, _CMD_LOCK, MUTEX_C_IDX, TN_WAIT_INFINITE);
+   TEST_CHECK(holder->rc == TN_RC_OK);
+   _state_check();
+
+   _workers_reset();
+
+   printf("takeover on termination: done\n");
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int i;
+
+   for (i = 0; i < MUTEXES_I_CNT; i++){
+      TEST_CHECK(
+            tn_mutex_create_worder(
+               &_mutexes[i], TN_MUTEX_PROT_INHERIT, 0,
+               (i % 2) ? TN_WAIT_ORDER_PRIORITY : TN_WAIT_ORDER_FIFO
+               ) == TN_RC_OK
+            );
+   }
+
+   TEST_CHECK(
+         tn_mutex_create(
+            &_mutexes[MUTEX_C_IDX], TN_MUTEX_PROT_CEILING, CEIL_PRIORITY
+            ) == TN_RC_OK
+         );
+
+   for (i = 0; i < WORKERS_CNT; i++){
+      struct _Worker *worker = &_workers[i];
+
+      TEST_CHECK(tn_sem_create(&worker->cmd_sem, 0, 1) == TN_RC_OK);
+      TEST_CHECK(
+            tn_task_create_wname(
+               &worker->task, _worker_body,
+               WORKER_PRIORITY_LOWEST - (i % WORKER_PRIORITIES),
+               worker->stack, TEST_TASK_STACK_SIZE, worker,
+               0, "worker"
+               ) == TN_RC_OK
+            );
+      TEST_CHECK(tn_task_activate(&worker->task) == TN_RC_OK);
+   }
+
+   _test_random(TN_TRUE);
+   _test_random(TN_FALSE);
+
+   for (i = 0; i < 3; i++){
+      _test_cycle(i);
+   }
+
+   //-- FIFO and priority wait order
+   _test_takeover_timeout(0);
+   _test_takeover_timeout(1);
+   _test_takeover_terminate();
+}
@@ -0,0 +1,308 @@
+/*
+ * Test of the lock-free ring buffer with the producer in the ISR: the
+ * `SIGUSR1` handler is driven by the host timer with a short period, so it
+ * comes at arbitrary points of the consumer's code, including the window
+ * between `_ring_read()` finding the buffer empty and the consumer going to
+ * wait. Each interrupt writes a burst of sequence-numbered items by
+ * `tn_ring_iwrite()`; items which didn't fit are written by the next
+ * interrupts. The main task reads chunks of random size by `tn_ring_read()`
+ * with timeout, and checks that no item is lost, duplicated or reordered.
+ *
+ * Items are 7 bytes long, so the items are copied byte-by-byte, and the
+ * buffer of 8 items wraps around in the middle of most of the writes and
+ * reads.
+ *
+ * There are two phases:
+ *
+ *    - free-running: the producer writes as long as there is room, and the
+ *      consumer sometimes busy-waits for a while without reading, so the
+ *      buffer gets full and writes are partial;
+ *    - handshake: the producer writes the next burst only after the
+ *      consumer has read all the previous ones, so the consumer waits for
+ *      each burst, and the only way for it to get the data is to be woken
+ *      up by the producer: a lost wakeup is caught by the read timeout.
+ *
+ * Finally, the consumer waits for the data which never comes: it gets
+ * `#TN_RC_TIMEOUT`, and the `reader_waiting` flag is cleared.
+ */
+
+#include <signal.h>
+#include <time.h>
+#include <string.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+//-- item size: not a power of two, and not a multiple of `TN_UWord`
+#define  ITEM_SIZE            7
+
+#define  RING_ITEMS_CNT       8
+
+//-- max number of items written by the ISR at once
+#define  BURST_MAX            5
+
+//-- max number of items read by the consumer at once
+#define  READ_MAX             6
+
+//-- period of the producer interrupt
+#define  ISR_PERIOD_NS        20000
+
+//-- number of items to transfer in each phase
+#define  FREE_RUN_ITEMS_CNT   100000
+#define  HANDSHAKE_ITEMS_CNT  50000
+
+//-- read timeout, in ticks: the producer interrupt comes every 20 us, so if
+//   the consumer waits for 100 ms, it has surely missed the wakeup
+#define  READ_TIMEOUT         100
+
+struct _Item {
+   unsigned char bytes[ITEM_SIZE];
+};
+
+enum _Phase {
+   _PHASE_STOP,
+   _PHASE_FREE_RUN,
+   _PHASE_HANDSHAKE,
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+TN_RING_BUF_DEF(_ring_buf, struct _Item, RING_ITEMS_CNT);
+static struct TN_Ring _ring;
+
+static timer_t _timer;
+
+static volatile enum _Phase _phase;
+
+//-- sequence number of the next item to write, and to read
+static volatile unsigned long _write_seq;
+static volatile unsigned long _read_seq;
+
+//-- number of writes in which not all the items fit
+static volatile unsigned long _partial_writes_cnt;
+
+//-- number of reads which found the buffer empty before the call
+static unsigned long _empty_reads_cnt;
+
+//-- state of pseudo-random generator of the producer
+static unsigned long _isr_rand_state = 1;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Fill the item with the sequence number and bytes derived from it
+ */
+static void _item_fill(struct _Item *item, unsigned long seq)
+{
+   unsigned long hash = seq * 2654435761ul;
+
+   item->bytes[0] = (unsigned char)(seq);
+   item->bytes[1] = (unsigned char)(seq >> 8);
+   item->bytes[2] = (unsigned char)(seq >> 16);
+   item->bytes[3] = (unsigned char)(seq >> 24);
+   item->bytes[4] = (unsigned char)(hash >> 8);
+   item->bytes[5] = (unsigned char)(hash >> 16);
+   item->bytes[6] = (unsigned char)(hash >> 24);
+}
+
+static void _isr(void)
+{
+   struct _Item items[BURST_MAX];
+   unsigned long seq = _write_seq;
+   int written_cnt = 0;
+   int cnt;
+   int i;
+   enum TN_RCode rc;
+
+   if (_phase == _PHASE_STOP){
+      //-- nothing to do
+   } else if (_phase == _PHASE_HANDSHAKE && _read_seq != seq){
+      //-- the consumer hasn't read the previous burst yet
+   } else {
+      cnt = 1 + (int)(test_rand(&_isr_rand_state) % BURST_MAX);
+      for (i = 0; i < cnt; i++){
+         _item_fill(&items[i], seq + i);
+      }
+
+      rc = tn_ring_iwrite(&_ring, items, cnt, &written_cnt);
+      TEST_CHECK(rc == ((written_cnt == cnt) ? TN_RC_OK : TN_RC_TIMEOUT));
+
+      if (written_cnt < cnt){
+         _partial_writes_cnt++;
+      }
+
+      //-- items which didn't fit will be written next time, with the same
+      //   sequence numbers
+      _write_seq = seq + written_cnt;
+   }
+}
+
+static void _timer_start(void)
+{
+   struct sigevent sev;
+   struct itimerspec its;
+
+   memset(&sev, 0, sizeof(sev));
+   sev.sigev_notify = SIGEV_SIGNAL;
+   sev.sigev_signo = SIGUSR1;
+   TEST_CHECK(timer_create(CLOCK_MONOTONIC, &sev, &_timer) == 0);
+
+   memset(&its, 0, sizeof(its));
+   its.it_value.tv_nsec = ISR_PERIOD_NS;
+   its.it_interval.tv_nsec = ISR_PERIOD_NS;
+   TEST_CHECK(timer_settime(_timer, 0, &its, TN_NULL) == 0);
+}
+
+static void _timer_stop(void)
+{
+   TEST_CHECK(timer_delete(_timer) == 0);
+}
+
+/**
+ * Busy-wait for given time, so that the producer may fill the buffer
+ */
+static void _spin(unsigned long ns)
+{
+   unsigned long start = test_ns();
+
+   while (test_ns() - start < ns){
+      //-- just wait
+   }
+}
+
+/**
+ * Read items until `items_cnt` of them are read in total, checking their
+ * sequence numbers
+ */
+static void _stream_read(unsigned long items_cnt, TN_BOOL spin)
+{
+   unsigned long rand_state = 1;
+   unsigned long end_seq = _read_seq + items_cnt;
+   TN_BOOL ok = TN_TRUE;
+
+   while (ok && _read_seq != end_seq){
+      struct _Item items[READ_MAX];
+      struct _Item expected;
+      int cnt = 1 + (int)(test_rand(&rand_state) % READ_MAX);
+      int read_cnt = 0;
+      int i;
+      enum TN_RCode rc;
+
+      //-- don't read beyond the end, so that the caller may change the
+      //   phase right after that
+      cnt = (int)TEST_MIN((unsigned long)cnt, end_seq - _read_seq);
+
+      if (tn_ring_used_items_cnt_get(&_ring) == 0){
+         _empty_reads_cnt++;
+      }
+
+      rc = tn_ring_read(&_ring, items, cnt, &read_cnt, READ_TIMEOUT);
+      TEST_CHECK(rc == TN_RC_OK);
+      TEST_CHECK(read_cnt > 0 && read_cnt <= cnt);
+      ok = (rc == TN_RC_OK);
+
+      for (i = 0; ok && i < read_cnt; i++){
+         _item_fill(&expected, _read_seq);
+         ok = (memcmp(&items[i], &expected, sizeof(expected)) == 0);
+         TEST_CHECK(ok);
+         _read_seq++;
+      }
+
+      if (spin && test_rand(&rand_state) % 64 == 0){
+         _spin(ISR_PERIOD_NS * 10);
+      }
+   }
+}
+
+/**
+ * Stop the producer, and read the rest of what it has written
+ */
+static void _phase_finish(void)
+{
+   _phase = _PHASE_STOP;
+   _stream_read(_write_seq - _read_seq, TN_FALSE);
+}
+
+static void _test_stream(void)
+{
+   TEST_CHECK(
+         tn_ring_create(
+            &_ring, _ring_buf, sizeof(struct _Item), RING_ITEMS_CNT
+            ) == TN_RC_OK
+         );
+
+   _timer_start();
+
+   _phase = _PHASE_FREE_RUN;
+   _stream_read(FREE_RUN_ITEMS_CNT, TN_TRUE);
+   _phase_finish();
+   TEST_CHECK(_partial_writes_cnt > 0);
+
+   _empty_reads_cnt = 0;
+   _phase = _PHASE_HANDSHAKE;
+   _stream_read(HANDSHAKE_ITEMS_CNT, TN_FALSE);
+   _phase_finish();
+
+   //-- the consumer has waited for the most of the bursts
+   TEST_CHECK(_empty_reads_cnt > HANDSHAKE_ITEMS_CNT / BURST_MAX / 2);
+
+   _timer_stop();
+
+   TEST_CHECK(_write_seq == _read_seq);
+   TEST_CHECK(tn_ring_used_items_cnt_get(&_ring) == 0);
+   TEST_CHECK(!_ring.reader_waiting);
+
+   printf("stream: done\n");
+}
+
+static void _test_timeout(void)
+{
+   struct _Item item;
+   int read_cnt = -1;
+
+   TEST_CHECK(
+         tn_ring_read(&_ring, &item, 1, &read_cnt, 3) == TN_RC_TIMEOUT
+         );
+   TEST_CHECK(read_cnt == 0);
+
+   //-- nobody has woken the consumer up, so it should have cleared the
+   //   flag itself
+   TEST_CHECK(!_ring.reader_waiting);
+
+   //-- the next write doesn't try to wake anybody up, and the data is there
+   _item_fill(&item, 0);
+   TEST_CHECK(tn_ring_write(&_ring, &item, 1, TN_NULL) == TN_RC_OK);
+   TEST_CHECK(tn_ring_read_polling(&_ring, &item, 1, &read_cnt) == TN_RC_OK);
+   TEST_CHECK(read_cnt == 1);
+
+   TEST_CHECK(tn_ring_delete(&_ring) == TN_RC_OK);
+
+   printf("timeout: done\n");
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   TEST_CHECK(tn_posix_isr_set(SIGUSR1, _isr) == 0);
+
+   _test_stream();
+   _test_timeout();
+}
@@ -0,0 +1,433 @@
+/*
+ * Test of the slab allocator on top of fixed memory pools:
+ *
+ *    - each size is routed to the smallest class which is large enough,
+ *      and sizes larger than any class are rejected;
+ *    - without `#TN_SLAB_ATTR_FALLBACK`, the request fails when its class
+ *      is empty; with it, the request falls back to the next larger class
+ *      which has free blocks;
+ *    - the block is returned to its pool by address; addresses which aren't
+ *      the start of some block are rejected;
+ *    - the bit of the class in the bitmap of non-empty classes may be
+ *      stale for a while (see `tn_slab_alloc()`): allocation still takes
+ *      the block from the larger class, without counting a failure;
+ *    - the task waiting for the block is woken up by `tn_slab_free()`, and
+ *      it gives up by timeout if nobody frees the block.
+ *
+ * After each case, the bitmap of non-empty classes is checked against the
+ * pools.
+ */
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  CLASSES_CNT          4
+
+//-- block sizes of the classes: 2, 4, 8 and 16 words
+#define  CLASS_WORDS(idx)     (2 << (idx))
+#define  CLASS_BLOCKS_CNT     3
+
+//-- the waiter has higher priority than the main task, so it runs as soon
+//   as it gets the block
+#define  WAITER_PRIORITY      (TEST_MAIN_TASK_PRIORITY - 1)
+
+struct _Waiter {
+   struct TN_Task    task;
+   TN_UWord          stack[TEST_TASK_STACK_SIZE];
+   unsigned int      size;
+   TN_TickCnt        timeout;
+   volatile enum TN_RCode rc;
+   void             *ptr;
+   volatile TN_BOOL  done;
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+//-- buffers are defined from the largest to the smallest, so that the
+//   order of pools by address is likely to differ from the order by size
+TN_FMEM_BUF_DEF(_buf_3, TN_UWord[CLASS_WORDS(3)], CLASS_BLOCKS_CNT);
+TN_FMEM_BUF_DEF(_buf_2, TN_UWord[CLASS_WORDS(2)], CLASS_BLOCKS_CNT);
+TN_FMEM_BUF_DEF(_buf_1, TN_UWord[CLASS_WORDS(1)], CLASS_BLOCKS_CNT);
+TN_FMEM_BUF_DEF(_buf_0, TN_UWord[CLASS_WORDS(0)], CLASS_BLOCKS_CNT);
+
+static TN_UWord *const _bufs[CLASSES_CNT] = { _buf_0, _buf_1, _buf_2, _buf_3 };
+
+static struct TN_FMem _fmem[CLASSES_CNT];
+static struct TN_FMem *const _pools[CLASSES_CNT] = {
+   &_fmem[0], &_fmem[1], &_fmem[2], &_fmem[3],
+};
+
+static struct TN_Slab   _slab;
+static struct _Waiter   _waiter;
+
+//-- blocks allocated by the test, to be freed by `_free_all()`
+static void            *_ptrs[CLASSES_CNT * CLASS_BLOCKS_CNT];
+static int              _ptrs_cnt;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void _waiter_body(void *param)
+{
+   struct _Waiter *waiter = (struct _Waiter *)param;
+
+   waiter->rc = tn_slab_alloc(
+         &_slab, waiter->size, &waiter->ptr, waiter->timeout
+         );
+   waiter->done = TN_TRUE;
+}
+
+/**
+ * Start the waiter which allocates the block of the given size; when it
+ * returns, the waiter has either got the block, or it waits for it.
+ */
+static void _waiter_start(unsigned int size, TN_TickCnt timeout)
+{
+   _waiter.size = size;
+   _waiter.timeout = timeout;
+   _waiter.rc = TN_RC_INTERNAL;
+   _waiter.ptr = TN_NULL;
+   _waiter.done = TN_FALSE;
+
+   TEST_CHECK(tn_task_activate(&_waiter.task) == TN_RC_OK);
+}
+
+static unsigned int _class_size(int class_idx)
+{
+   return CLASS_WORDS(class_idx) * sizeof(TN_UWord);
+}
+
+/**
+ * Returns the class which the block belongs to, or -1.
+ */
+static int _class_of(const void *ptr)
+{
+   int ret = -1;
+   int i;
+
+   for (i = 0; i < CLASSES_CNT; i++){
+      const unsigned char *start = (const unsigned char *)_bufs[i];
+
+      if (     (const unsigned char *)ptr >= start
+            && (const unsigned char *)ptr
+               < start + _class_size(i) * CLASS_BLOCKS_CNT
+         )
+      {
+         ret = i;
+      }
+   }
+
+   return ret;
+}
+
+static int _free_cnt_get(int class_idx)
+{
+   struct TN_SlabClassStat stat;
+
+   TEST_CHECK(
+         tn_slab_class_stat_get(&_slab, class_idx, &stat) == TN_RC_OK
+         );
+
+   return stat.free_blocks_cnt;
+}
+
+static void _bitmap_check(void)
+{
+   int i;
+
+   for (i = 0; i < CLASSES_CNT; i++){
+      TEST_CHECK(
+            !!(_slab.free_bmp & (1u << i)) == (_free_cnt_get(i) > 0)
+            );
+   }
+}
+
+static enum TN_RCode _alloc(unsigned int size, void **p_ptr)
+{
+   void *ptr = TN_NULL;
+   enum TN_RCode rc = tn_slab_alloc_polling(&_slab, size, &ptr);
+
+   if (rc == TN_RC_OK){
+      _ptrs[_ptrs_cnt++] = ptr;
+   }
+
+   if (p_ptr != TN_NULL){
+      *p_ptr = ptr;
+   }
+
+   return rc;
+}
+
+/**
+ * Take all the blocks of the class
+ */
+static void _class_exhaust(int class_idx)
+{
+   void *ptr;
+
+   while (_free_cnt_get(class_idx) > 0){
+      TEST_CHECK(_alloc(_class_size(class_idx), &ptr) == TN_RC_OK);
+      TEST_CHECK(_class_of(ptr) == class_idx);
+   }
+}
+
+static void _free_all(void)
+{
+   while (_ptrs_cnt > 0){
+      TEST_CHECK(tn_slab_free(&_slab, _ptrs[--_ptrs_cnt]) == TN_RC_OK);
+   }
+
+   _bitmap_check();
+}
+
+/**
+ * (Re)create the slab, so that its statistics are reset
+ */
+static void _slab_create(enum TN_SlabAttr attr)
+{
+   if (_slab.id_slab == TN_ID_SLAB){
+      TEST_CHECK(tn_slab_delete(&_slab) == TN_RC_OK);
+   }
+
+   TEST_CHECK(
+         tn_slab_create(&_slab, _pools, CLASSES_CNT, attr) == TN_RC_OK
+         );
+   _bitmap_check();
+}
+
+static void _stat_check(unsigned int fallback_cnt, unsigned int fail_cnt)
+{
+   struct TN_SlabStat stat;
+
+   TEST_CHECK(tn_slab_stat_get(&_slab, &stat) == TN_RC_OK);
+   TEST_CHECK(stat.classes_cnt == CLASSES_CNT);
+   TEST_CHECK(stat.fallback_cnt == fallback_cnt);
+   TEST_CHECK(stat.fail_cnt == fail_cnt);
+}
+
+static void _test_routing(void)
+{
+   unsigned int size;
+   void *ptr;
+
+   _slab_create(TN_SLAB_ATTR_NONE);
+
+   for (size = 1; size <= _class_size(CLASSES_CNT - 1); size++){
+      int expected = 0;
+
+      while (_class_size(expected) < size){
+         expected++;
+      }
+
+      TEST_CHECK(_alloc(size, &ptr) == TN_RC_OK);
+      TEST_CHECK(_class_of(ptr) == expected);
+      TEST_CHECK(_free_cnt_get(expected) == CLASS_BLOCKS_CNT - 1);
+      _free_all();
+   }
+
+   //-- sizes which no class can provide
+   TEST_CHECK(_alloc(0, &ptr) == TN_RC_WPARAM);
+   TEST_CHECK(
+         _alloc(_class_size(CLASSES_CNT - 1) + 1, &ptr) == TN_RC_WPARAM
+         );
+   _stat_check(0, 0);
+
+   printf("routing: done\n");
+}
+
+static void _test_fallback(void)
+{
+   void *ptr;
+
+   //-- without fallback, the request fails when its class is empty
+   _slab_create(TN_SLAB_ATTR_NONE);
+   _class_exhaust(0);
+   TEST_CHECK(_alloc(1, &ptr) == TN_RC_TIMEOUT);
+   _stat_check(0, 1);
+   _bitmap_check();
+   _free_all();
+
+   //-- with fallback, it takes the block from the next non-empty class
+   _slab_create(TN_SLAB_ATTR_FALLBACK);
+   _class_exhaust(0);
+   _class_exhaust(1);
+   TEST_CHECK(_alloc(1, &ptr) == TN_RC_OK);
+   TEST_CHECK(_class_of(ptr) == 2);
+   _stat_check(1, 0);
+   _bitmap_check();
+
+   //-- nothing is larger than the last class
+   _class_exhaust(2);
+   _class_exhaust(3);
+   TEST_CHECK(_alloc(_class_size(3), &ptr) == TN_RC_TIMEOUT);
+   TEST_CHECK(_alloc(1, &ptr) == TN_RC_TIMEOUT);
+   _stat_check(1, 2);
+   _bitmap_check();
+   _free_all();
+
+   printf("fallback: done\n");
+}
+
+static void _test_free_by_address(void)
+{
+   void *ptrs[CLASSES_CNT];
+   unsigned char *bytes;
+   int i;
+
+   _slab_create(TN_SLAB_ATTR_NONE);
+
+   for (i = 0; i < CLASSES_CNT; i++){
+      TEST_CHECK(
+            tn_slab_alloc_polling(&_slab, _class_size(i), &ptrs[i])
+            == TN_RC_OK
+            );
+      TEST_CHECK(_class_of(ptrs[i]) == i);
+   }
+
+   for (i = 0; i < CLASSES_CNT; i++){
+      bytes = (unsigned char *)ptrs[i];
+
+      //-- misaligned pointers into the block are rejected, and the block
+      //   stays allocated
+      TEST_CHECK(
+            tn_slab_free(&_slab, bytes + sizeof(TN_UWord)) == TN_RC_WPARAM
+            );
+      TEST_CHECK(tn_slab_free(&_slab, bytes + 1) == TN_RC_WPARAM);
+      TEST_CHECK(_free_cnt_get(i) == CLASS_BLOCKS_CNT - 1);
+
+      //-- the block goes back to its own pool
+      TEST_CHECK(tn_slab_free(&_slab, ptrs[i]) == TN_RC_OK);
+      TEST_CHECK(_free_cnt_get(i) == CLASS_BLOCKS_CNT);
+   }
+
+   //-- pointers which don't belong to any pool
+   TEST_CHECK(tn_slab_free(&_slab, &_slab) == TN_RC_WPARAM);
+   TEST_CHECK(
+         tn_slab_free(
+            &_slab, _buf_3 + CLASS_WORDS(3) * CLASS_BLOCKS_CNT
+            ) == TN_RC_WPARAM
+         );
+
+   _bitmap_check();
+
+   printf("free by address: done\n");
+}
+
+/**
+ * The last block of the class is taken from the pool directly, the way the
+ * blocking path of `tn_slab_alloc()` takes it, so the class bit is stale
+ * until the bitmap is updated.
+ */
+static void _test_stale_bitmap(void)
+{
+   void *ptr;
+   void *direct;
+
+   _slab_create(TN_SLAB_ATTR_FALLBACK);
+
+   while (_free_cnt_get(0) > 1){
+      TEST_CHECK(_alloc(1, &ptr) == TN_RC_OK);
+      TEST_CHECK(_class_of(ptr) == 0);
+   }
+
+   TEST_CHECK(tn_fmem_get_polling(&_fmem[0], &direct) == TN_RC_OK);
+   TEST_CHECK(_slab.free_bmp & (1u << 0));
+
+   TEST_CHECK(_alloc(1, &ptr) == TN_RC_OK);
+   TEST_CHECK(_class_of(ptr) == 1);
+   _stat_check(1, 0);
+
+   //-- the stale bit is cleared by the allocation
+   _bitmap_check();
+
+   TEST_CHECK(tn_slab_free(&_slab, direct) == TN_RC_OK);
+   _bitmap_check();
+   _free_all();
+
+   printf("stale bitmap: done\n");
+}
+
+static void _test_waiter(void)
+{
+   void *ptr;
+
+   _slab_create(TN_SLAB_ATTR_NONE);
+   _class_exhaust(2);
+
+   //-- the block is freed: the waiter gets it right away
+   _waiter_start(_class_size(2), TN_WAIT_INFINITE);
+   TEST_CHECK(!_waiter.done);
+
+   ptr = _ptrs[--_ptrs_cnt];
+   TEST_CHECK(tn_slab_free(&_slab, ptr) == TN_RC_OK);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.ptr == ptr);
+   TEST_CHECK(_free_cnt_get(2) == 0);
+   _bitmap_check();
+   _ptrs[_ptrs_cnt++] = _waiter.ptr;
+
+   //-- nobody frees the block: the waiter gives up
+   _waiter_start(_class_size(2), 2);
+   TEST_CHECK(!_waiter.done);
+   tn_task_sleep(4);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_TIMEOUT);
+   _bitmap_check();
+
+   //-- the block is there already: the waiter takes it without waiting,
+   //   and the bitmap is updated
+   TEST_CHECK(tn_slab_free(&_slab, _ptrs[--_ptrs_cnt]) == TN_RC_OK);
+   _bitmap_check();
+   _waiter_start(_class_size(2), TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   _ptrs[_ptrs_cnt++] = _waiter.ptr;
+   _bitmap_check();
+
+   _free_all();
+
+   printf("waiter: done\n");
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int i;
+
+   for (i = 0; i < CLASSES_CNT; i++){
+      TEST_CHECK(
+            tn_fmem_create(
+               &_fmem[i], _bufs[i], _class_size(i), CLASS_BLOCKS_CNT
+               ) == TN_RC_OK
+            );
+   }
+
+   TEST_CHECK(
+         tn_task_create_wname(
+            &_waiter.task, _waiter_body, WAITER_PRIORITY,
+            _waiter.stack, TEST_TASK_STACK_SIZE, &_waiter,
+            0, "waiter"
+            ) == TN_RC_OK
+         );
+
+   _test_routing();
+   _test_fallback();
+   _test_free_by_address();
+   _test_stale_bitmap();
+   _test_waiter();
+}
@@ -0,0 +1,454 @@
+/*
+ * Test of the stream buffer. Waiting readers and writers are tasks with
+ * higher priority than the main task, so they run as soon as they're woken
+ * up, and the main task checks the state right after each call:
+ *
+ *    - the waiting reader is woken up only when there are as many bytes as
+ *      the trigger level (or as it asked for, if it is less), and gets all
+ *      of them at once;
+ *    - the reader whose timeout has expired takes whatever is there;
+ *    - the writer which doesn't fit is fed by several reads, its bytes go
+ *      to the buffer as soon as there is room, so the new writer gets no
+ *      room;
+ *    - lowering of the trigger level by `tn_stream_trigger_level_set()`
+ *      wakes up the waiting reader;
+ *    - regions for zero-copy writing and reading end at the end of the
+ *      buffer, the next ones start at its beginning, and commits serve
+ *      waiting tasks.
+ *
+ * All bytes are taken from the same pattern, so that each byte tells its
+ * offset in the stream, see `_pattern_fill()`.
+ */
+
+#include <string.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  STREAM_SIZE          16
+
+//-- the waiter has higher priority than the main task
+#define  WAITER_PRIORITY      (TEST_MAIN_TASK_PRIORITY - 1)
+
+//-- max number of bytes the waiter writes or reads
+#define  WAITER_BUF_SIZE      64
+
+enum _JobType {
+   _JOB_WRITE,
+   _JOB_READ,
+};
+
+struct _Waiter {
+   struct TN_Task    task;
+   TN_UWord          stack[TEST_TASK_STACK_SIZE];
+   enum _JobType     job_type;
+   unsigned char     buf[WAITER_BUF_SIZE];
+   unsigned int      size;
+   TN_TickCnt        timeout;
+   volatile enum TN_RCode rc;
+   volatile unsigned int done_size;
+   volatile TN_BOOL  done;
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static unsigned char       _stream_buf[STREAM_SIZE];
+static struct TN_StreamBuf _stream;
+
+static struct _Waiter      _waiter;
+
+static unsigned long       _rand_state = 1;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Fill `size` bytes with the pattern, starting from the stream offset `ofs`
+ */
+static void _pattern_fill(unsigned char *p, unsigned int ofs, unsigned int size)
+{
+   unsigned int i;
+
+   for (i = 0; i < size; i++){
+      p[i] = (unsigned char)((ofs + i) * 13 + 5);
+   }
+}
+
+static TN_BOOL _pattern_is_intact(
+      const unsigned char *p,
+      unsigned int ofs,
+      unsigned int size
+      )
+{
+   TN_BOOL ret = TN_TRUE;
+   unsigned int i;
+
+   for (i = 0; i < size; i++){
+      if (p[i] != (unsigned char)((ofs + i) * 13 + 5)){
+         ret = TN_FALSE;
+      }
+   }
+
+   return ret;
+}
+
+static void _waiter_body(void *param)
+{
+   struct _Waiter *waiter = (struct _Waiter *)param;
+   unsigned int done_size = 0;
+
+   if (waiter->job_type == _JOB_WRITE){
+      waiter->rc = tn_stream_write(
+            &_stream, waiter->buf, waiter->size, &done_size, waiter->timeout
+            );
+   } else {
+      waiter->rc = tn_stream_read(
+            &_stream, waiter->buf, waiter->size, &done_size, waiter->timeout
+            );
+   }
+
+   waiter->done_size = done_size;
+   waiter->done = TN_TRUE;
+}
+
+/**
+ * Start the waiter; when it returns, the waiter has either done its job,
+ * or it waits. The writer writes the pattern from the offset `ofs`.
+ */
+static void _waiter_start(
+      enum _JobType job_type,
+      unsigned int ofs,
+      unsigned int size,
+      TN_TickCnt timeout
+      )
+{
+   _waiter.job_type = job_type;
+   _waiter.size = size;
+   _waiter.timeout = timeout;
+   _waiter.rc = TN_RC_INTERNAL;
+   _waiter.done_size = 0;
+   _waiter.done = TN_FALSE;
+
+   if (job_type == _JOB_WRITE){
+      _pattern_fill(_waiter.buf, ofs, size);
+   } else {
+      memset(_waiter.buf, 0, sizeof(_waiter.buf));
+   }
+
+   TEST_CHECK(tn_task_activate(&_waiter.task) == TN_RC_OK);
+}
+
+static TN_BOOL _waiter_is_waiting(enum TN_WaitReason reason)
+{
+   return (
+            (_waiter.task.task_state & TN_TASK_STATE_WAIT)
+         && _waiter.task.task_wait_reason == reason
+         );
+}
+
+/**
+ * Write the pattern from the offset `ofs` by polling, all the bytes should
+ * fit
+ */
+static void _write(unsigned int ofs, unsigned int size)
+{
+   unsigned char buf[STREAM_SIZE];
+   unsigned int written_size = 0;
+
+   _pattern_fill(buf, ofs, size);
+   TEST_CHECK(
+         tn_stream_write_polling(&_stream, buf, size, &written_size)
+         == TN_RC_OK
+         );
+   TEST_CHECK(written_size == size);
+}
+
+/**
+ * Read exactly `size` bytes by polling, and check that they are the pattern
+ * from the offset `ofs`
+ */
+static void _read(unsigned int ofs, unsigned int size)
+{
+   unsigned char buf[STREAM_SIZE];
+   unsigned int read_size = 0;
+
+   TEST_CHECK(
+         tn_stream_read_polling(&_stream, buf, size, &read_size) == TN_RC_OK
+         );
+   TEST_CHECK(read_size == size);
+   TEST_CHECK(_pattern_is_intact(buf, ofs, size));
+}
+
+static void _stream_create(unsigned int trigger_level)
+{
+   TEST_CHECK(
+         tn_stream_create(
+            &_stream, _stream_buf, STREAM_SIZE, trigger_level
+            ) == TN_RC_OK
+         );
+}
+
+static void _test_trigger(void)
+{
+   _stream_create(8);
+
+   //-- reader which wants more than the trigger level waits for 8 bytes
+   _waiter_start(_JOB_READ, 0, 12, TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+
+   _write(0, 3);
+   _write(3, 4);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+   TEST_CHECK(tn_stream_used_size_get(&_stream) == 7);
+
+   //-- all 8 bytes are copied right to the reader's buffer
+   _write(7, 1);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.done_size == 8);
+   TEST_CHECK(_pattern_is_intact(_waiter.buf, 0, 8));
+   TEST_CHECK(tn_stream_used_size_get(&_stream) == 0);
+
+   //-- reader which wants less than the trigger level waits for as many
+   //   bytes as it wants
+   _waiter_start(_JOB_READ, 0, 4, TN_WAIT_INFINITE);
+   _write(8, 3);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+   _write(11, 2);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.done_size == 4);
+   TEST_CHECK(_pattern_is_intact(_waiter.buf, 8, 4));
+
+   //-- the byte which didn't fit to the reader's buffer is still there;
+   //   the reader finds enough bytes right away
+   TEST_CHECK(tn_stream_used_size_get(&_stream) == 1);
+   _waiter_start(_JOB_READ, 0, 1, TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.done_size == 1);
+   TEST_CHECK(_pattern_is_intact(_waiter.buf, 12, 1));
+
+   TEST_CHECK(tn_stream_delete(&_stream) == TN_RC_OK);
+
+   printf("trigger: done\n");
+}
+
+static void _test_timeout(void)
+{
+   _stream_create(8);
+
+   //-- not enough bytes for the trigger level: when the timeout expires,
+   //   the reader takes what is there
+   _waiter_start(_JOB_READ, 0, 12, 5);
+   _write(0, 3);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+
+   tn_task_sleep(10);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.done_size == 3);
+   TEST_CHECK(_pattern_is_intact(_waiter.buf, 0, 3));
+   TEST_CHECK(tn_stream_used_size_get(&_stream) == 0);
+
+   //-- and if there's nothing, the reader gets `TN_RC_TIMEOUT`
+   _waiter_start(_JOB_READ, 0, 12, 5);
+   tn_task_sleep(10);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_TIMEOUT);
+   TEST_CHECK(_waiter.done_size == 0);
+
+   TEST_CHECK(tn_stream_delete(&_stream) == TN_RC_OK);
+
+   printf("timeout: done\n");
+}
+
+static void _test_writer(void)
+{
+   unsigned int total_size = 40;
+   unsigned int read_total = 0;
+   unsigned int reads_cnt = 0;
+   unsigned char byte = 0;
+   unsigned int written_size = 1;
+
+   _stream_create(1);
+
+   //-- the writer fills the buffer and waits for the rest
+   _waiter_start(_JOB_WRITE, 0, total_size, TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WSEND));
+   TEST_CHECK(_waiter.task.subsys_wait.stream.done_size == STREAM_SIZE);
+
+   //-- the room made by the read goes to the waiting writer at once, so
+   //   another writer gets nothing
+   _read(0, 1);
+   read_total = 1;
+   TEST_CHECK(tn_stream_used_size_get(&_stream) == STREAM_SIZE);
+   TEST_CHECK(
+         tn_stream_write_polling(&_stream, &byte, 1, &written_size)
+         == TN_RC_TIMEOUT
+         );
+   TEST_CHECK(written_size == 0);
+
+   //-- each read feeds the writer, until all its bytes are written
+   while (read_total < total_size){
+      unsigned int size = 1 + (unsigned int)(test_rand(&_rand_state) % 7);
+
+      size = TEST_MIN(size, total_size - read_total);
+      size = TEST_MIN(size, (unsigned int)tn_stream_used_size_get(&_stream));
+      _read(read_total, size);
+      read_total += size;
+      reads_cnt++;
+
+      if (read_total + STREAM_SIZE < total_size){
+         TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WSEND));
+         TEST_CHECK(
+               _waiter.task.subsys_wait.stream.done_size
+               == read_total + STREAM_SIZE
+               );
+         TEST_CHECK(tn_stream_used_size_get(&_stream) == STREAM_SIZE);
+      } else {
+         TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+         TEST_CHECK(_waiter.done_size == total_size);
+         TEST_CHECK(
+               (unsigned int)tn_stream_used_size_get(&_stream)
+               == total_size - read_total
+               );
+      }
+   }
+
+   TEST_CHECK(reads_cnt >= 3);
+
+   TEST_CHECK(tn_stream_delete(&_stream) == TN_RC_OK);
+
+   printf("writer: done\n");
+}
+
+static void _test_trigger_level_set(void)
+{
+   _stream_create(12);
+
+   TEST_CHECK(tn_stream_trigger_level_set(&_stream, 0) == TN_RC_WPARAM);
+   TEST_CHECK(
+         tn_stream_trigger_level_set(&_stream, STREAM_SIZE + 1)
+         == TN_RC_WPARAM
+         );
+
+   _waiter_start(_JOB_READ, 0, STREAM_SIZE, TN_WAIT_INFINITE);
+   _write(0, 5);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+
+   //-- still not enough
+   TEST_CHECK(tn_stream_trigger_level_set(&_stream, 8) == TN_RC_OK);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+
+   //-- now the reader is woken up right away
+   TEST_CHECK(tn_stream_trigger_level_set(&_stream, 4) == TN_RC_OK);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.done_size == 5);
+   TEST_CHECK(_pattern_is_intact(_waiter.buf, 0, 5));
+
+   //-- and the new level is used for the next reader
+   _waiter_start(_JOB_READ, 0, STREAM_SIZE, TN_WAIT_INFINITE);
+   _write(5, 3);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+   _write(8, 1);
+   TEST_CHECK(_waiter.done && _waiter.done_size == 4);
+   TEST_CHECK(_pattern_is_intact(_waiter.buf, 5, 4));
+
+   TEST_CHECK(tn_stream_delete(&_stream) == TN_RC_OK);
+
+   printf("trigger_level_set: done\n");
+}
+
+static void _test_regions(void)
+{
+   void *p_wr;
+   const void *p_rd;
+   unsigned int size;
+
+   _stream_create(8);
+
+   //-- move both indexes to 10
+   _write(0, 10);
+   _read(0, 10);
+
+   //-- the write region ends at the end of the buffer
+   _waiter_start(_JOB_READ, 0, STREAM_SIZE, TN_WAIT_INFINITE);
+   TEST_CHECK(tn_stream_write_region_get(&_stream, &p_wr, &size) == TN_RC_OK);
+   TEST_CHECK(p_wr == _stream_buf + 10 && size == 6);
+   _pattern_fill((unsigned char *)p_wr, 10, 6);
+   TEST_CHECK(tn_stream_write_commit(&_stream, 6) == TN_RC_OK);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WRECEIVE));
+
+   //-- the next one starts at the beginning; the commit which makes enough
+   //   bytes wakes up the reader, and it gets them across the wraparound
+   TEST_CHECK(tn_stream_write_region_get(&_stream, &p_wr, &size) == TN_RC_OK);
+   TEST_CHECK(p_wr == _stream_buf && size == 10);
+   TEST_CHECK(tn_stream_write_commit(&_stream, 11) == TN_RC_OVERFLOW);
+   _pattern_fill((unsigned char *)p_wr, 16, 2);
+   TEST_CHECK(tn_stream_write_commit(&_stream, 2) == TN_RC_OK);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.done_size == 8);
+   TEST_CHECK(_pattern_is_intact(_waiter.buf, 10, 8));
+
+   //-- both indexes are at 2: fill the buffer, and make the writer wait
+   _write(18, STREAM_SIZE);
+   _waiter_start(_JOB_WRITE, 18 + STREAM_SIZE, 5, TN_WAIT_INFINITE);
+   TEST_CHECK(_waiter_is_waiting(TN_WAIT_REASON_STREAM_WSEND));
+
+   //-- the read region ends at the end of the buffer, too
+   TEST_CHECK(tn_stream_read_region_get(&_stream, &p_rd, &size) == TN_RC_OK);
+   TEST_CHECK(p_rd == _stream_buf + 2 && size == 14);
+   TEST_CHECK(_pattern_is_intact(p_rd, 18, 14));
+   TEST_CHECK(tn_stream_read_commit(&_stream, 15) == TN_RC_OVERFLOW);
+
+   //-- the commit makes room for the writer
+   TEST_CHECK(tn_stream_read_commit(&_stream, 14) == TN_RC_OK);
+   TEST_CHECK(_waiter.done && _waiter.rc == TN_RC_OK);
+   TEST_CHECK(_waiter.done_size == 5);
+
+   //-- the next region starts at the beginning, and includes the bytes of
+   //   the writer
+   TEST_CHECK(tn_stream_read_region_get(&_stream, &p_rd, &size) == TN_RC_OK);
+   TEST_CHECK(p_rd == _stream_buf && size == 7);
+   TEST_CHECK(_pattern_is_intact(p_rd, 32, 7));
+   TEST_CHECK(tn_stream_read_commit(&_stream, 7) == TN_RC_OK);
+
+   //-- nothing to read now
+   TEST_CHECK(tn_stream_read_region_get(&_stream, &p_rd, &size) == TN_RC_OK);
+   TEST_CHECK(p_rd == _stream_buf + 7 && size == 0);
+   TEST_CHECK(tn_stream_used_size_get(&_stream) == 0);
+
+   TEST_CHECK(tn_stream_delete(&_stream) == TN_RC_OK);
+
+   printf("regions: done\n");
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   TEST_CHECK(
+         tn_task_create_wname(
+            &_waiter.task, _waiter_body, WAITER_PRIORITY,
+            _waiter.stack, TEST_TASK_STACK_SIZE, &_waiter, 0, "waiter"
+            ) == TN_RC_OK
+         );
+
+   _test_trigger();
+   _test_timeout();
+   _test_writer();
+   _test_trigger_level_set();
+   _test_regions();
+}
@@ -0,0 +1,121 @@
+/*
+ * Test of the kernel event trace (`#TN_TRACE`): data queue and message queue
+ * operations should produce their own events.
+ *
+ * If the environment variable `TEST_TRACE_SNAPSHOT` is set, the snapshot of
+ * the trace buffer is written to the file it names, so that it can be fed to
+ * the decoder (`make run` does that).
+ */
+
+#include <stdlib.h>
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  ITEMS_CNT            4
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static struct TN_DQueue    _dque;
+static struct TN_MsgQ      _msgq;
+
+static void *_dque_fifo[ITEMS_CNT];
+static TN_UWord _msgq_buf[ITEMS_CNT];
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Returns number of records with the given event and object.
+ */
+static int _events_cnt(enum TN_TraceEvent event, const void *p_obj)
+{
+   const struct TN_TraceBuf *buf = tn_trace_buf_get();
+   TN_UWord recs_cnt = TEST_MIN(buf->wr_cnt, buf->recs_cnt);
+   int cnt = 0;
+   TN_UWord i;
+
+   for (i = 0; i < recs_cnt; i++){
+      if (
+            buf->recs[i].event == (TN_UWord)event
+            && buf->recs[i].p_obj == p_obj
+         )
+      {
+         cnt++;
+      }
+   }
+
+   return cnt;
+}
+
+static void _snapshot_write(void)
+{
+   const char *path = getenv("TEST_TRACE_SNAPSHOT");
+
+   if (path != TN_NULL){
+      FILE *f = fopen(path, "wb");
+
+      TEST_CHECK(f != TN_NULL);
+      if (f != TN_NULL){
+         fwrite(tn_trace_buf_get(), sizeof(struct TN_TraceBuf), 1, f);
+         fclose(f);
+      }
+   }
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   TN_UWord msg = 0x1234;
+   void *p_data;
+   int i;
+
+   TEST_CHECK(tn_queue_create(&_dque, _dque_fifo, ITEMS_CNT) == TN_RC_OK);
+   TEST_CHECK(
+         tn_msgq_create(&_msgq, _msgq_buf, sizeof(_msgq_buf[0]), ITEMS_CNT)
+         == TN_RC_OK
+         );
+
+   for (i = 0; i < ITEMS_CNT; i++){
+      TEST_CHECK(tn_queue_send_polling(&_dque, (void *)&msg) == TN_RC_OK);
+      TEST_CHECK(tn_msgq_send_polling(&_msgq, &msg) == TN_RC_OK);
+   }
+
+   for (i = 0; i < ITEMS_CNT; i++){
+      TEST_CHECK(tn_queue_receive_polling(&_dque, &p_data) == TN_RC_OK);
+      TEST_CHECK(tn_msgq_receive_polling(&_msgq, &msg) == TN_RC_OK);
+   }
+
+   //-- stop tracing, so that the buffer isn't changed while we examine it
+   tn_trace_active_set(TN_FALSE);
+
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_QUEUE_SEND, &_dque) == ITEMS_CNT);
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_QUEUE_RECEIVE, &_dque) == ITEMS_CNT);
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_MSGQ_SEND, &_msgq) == ITEMS_CNT);
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_MSGQ_RECEIVE, &_msgq) == ITEMS_CNT);
+
+   //-- message queue should never produce data queue events, and vice versa
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_QUEUE_SEND, &_msgq) == 0);
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_QUEUE_RECEIVE, &_msgq) == 0);
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_MSGQ_SEND, &_dque) == 0);
+   TEST_CHECK(_events_cnt(TN_TRACE_EV_MSGQ_RECEIVE, &_dque) == 0);
+
+   _snapshot_write();
+}
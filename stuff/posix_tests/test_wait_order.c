@@ -0,0 +1,399 @@
+/*
+ * Test of the order of waiting tasks (see `enum #TN_WaitOrder`) for each
+ * kind of object which supports it: semaphore, data queue, memory pool,
+ * mutex (both protocols) and event group.
+ *
+ * Waiters with mixed priorities start waiting for the object one by one;
+ * then, while they wait:
+ *
+ *    - priorities of two waiters are changed by `tn_task_change_priority()`;
+ *    - one waiter holds the mutex with priority inheritance, and another
+ *      task blocks on it, so the waiter inherits its priority.
+ *
+ * Then the main task releases the object once, and each waiter passes it
+ * on to the next one after it has got it, so the waiters get the object in
+ * the order of the wait queue. With `#TN_WAIT_ORDER_FIFO`, it should be the
+ * order in which they started waiting, regardless of priority changes; with
+ * `#TN_WAIT_ORDER_PRIORITY`, it should be the order of their current
+ * priorities, and the order in which they started waiting for equal
+ * priorities.
+ *
+ * The same tasks are used for all the objects, and for each object the
+ * priority order goes first: so if a task remembered the order of its
+ * previous wait queue, the next FIFO case would catch it.
+ *
+ * The test is built with and without `#TN_EVENTGRP_BIT_INDEX` (see
+ * Makefile), since with the bit index the waiter for a single bit waits in
+ * the separate queue of that bit.
+ */
+
+#include "test_common.h"
+
+
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+#define  WAITERS_CNT          5
+
+//-- index of the waiter which holds the inheriting mutex `_mutex_i`
+#define  WAITER_INHERIT_IDX   4
+
+//-- priority of the task which blocks on `_mutex_i`: it's inherited by the
+//   waiter `WAITER_INHERIT_IDX`
+#define  BLOCKER_PRIORITY     6
+
+//-- event bit the waiters wait for
+#define  EVENT_BIT            (1 << 0)
+
+enum _ObjKind {
+   _OBJ_SEM,
+   _OBJ_DQUEUE,
+   _OBJ_FMEM,
+   _OBJ_MUTEX_INHERIT,
+   _OBJ_MUTEX_CEILING,
+   _OBJ_EVENTGRP,
+
+   _OBJ_KINDS_CNT
+};
+
+struct _Task {
+   struct TN_Task    task;
+   TN_UWord          stack[TEST_TASK_STACK_SIZE];
+};
+
+
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+static const char *const _obj_names[_OBJ_KINDS_CNT] = {
+   "sem", "dqueue", "fmem", "mutex inherit", "mutex ceiling", "eventgrp",
+};
+
+//-- base priorities of the waiters, in the order they start waiting. All of
+//   them are lower than the one of the main task, so the main task decides
+//   when they run.
+static const int _base_priorities[WAITERS_CNT] = { 8, 7, 9, 7, 8 };
+
+//-- after all the waiters have started waiting, waiter 1 gets priority 9,
+//   waiter 2 gets priority 6, and waiter 4 inherits `BLOCKER_PRIORITY`. So
+//   the current priorities are: 8, 9, 6, 7, 6.
+static const int _expected_prio_order[WAITERS_CNT] = { 2, 4, 3, 0, 1 };
+static const int _expected_fifo_order[WAITERS_CNT] = { 0, 1, 2, 3, 4 };
+
+static struct _Task     _waiters[WAITERS_CNT];
+static struct _Task     _blocker;
+
+static volatile enum _ObjKind _obj_kind;
+
+static struct TN_Sem       _sem;
+static struct TN_DQueue    _dque;
+static void               *_dque_buf[WAITERS_CNT];
+static struct TN_FMem      _fmem;
+//-- the pool can't have less than 2 blocks, so the main task takes both of
+//   them, and passes one around
+TN_FMEM_BUF_DEF(_fmem_buf, TN_UWord, 2);
+static struct TN_Mutex     _mutex;
+static struct TN_EventGrp  _eventgrp;
+
+//-- the mutex held by the waiter `WAITER_INHERIT_IDX`
+static struct TN_Mutex     _mutex_i;
+
+//-- indexes of the waiters in the order they've got the object
+static int                 _log[WAITERS_CNT];
+static volatile int        _log_cnt;
+
+
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Wait for the object; returns the data to be given to `_obj_pass()`
+ */
+static void *_obj_wait(void)
+{
+   void *data = TN_NULL;
+   TN_UWord pattern;
+
+   switch (_obj_kind){
+      case _OBJ_SEM:
+         TEST_CHECK(tn_sem_wait(&_sem, TN_WAIT_INFINITE) == TN_RC_OK);
+         break;
+      case _OBJ_DQUEUE:
+         TEST_CHECK(
+               tn_queue_receive(&_dque, &data, TN_WAIT_INFINITE) == TN_RC_OK
+               );
+         break;
+      case _OBJ_FMEM:
+         TEST_CHECK(tn_fmem_get(&_fmem, &data, TN_WAIT_INFINITE) == TN_RC_OK);
+         break;
+      case _OBJ_MUTEX_INHERIT:
+      case _OBJ_MUTEX_CEILING:
+         TEST_CHECK(tn_mutex_lock(&_mutex, TN_WAIT_INFINITE) == TN_RC_OK);
+         break;
+      case _OBJ_EVENTGRP:
+         TEST_CHECK(
+               tn_eventgrp_wait(
+                  &_eventgrp, EVENT_BIT,
+                  TN_EVENTGRP_WMODE_OR | TN_EVENTGRP_WMODE_AUTOCLR,
+                  &pattern, TN_WAIT_INFINITE
+                  ) == TN_RC_OK
+               );
+         break;
+      default:
+         TEST_CHECK(0 /* wrong object kind */);
+         break;
+   }
+
+   return data;
+}
+
+/**
+ * Release the object so that exactly one waiter gets it: called by the
+ * main task once, and then by each waiter after it has got the object.
+ */
+static void _obj_pass(void *data)
+{
+   switch (_obj_kind){
+      case _OBJ_SEM:
+         TEST_CHECK(tn_sem_signal(&_sem) == TN_RC_OK);
+         break;
+      case _OBJ_DQUEUE:
+         TEST_CHECK(tn_queue_send_polling(&_dque, data) == TN_RC_OK);
+         break;
+      case _OBJ_FMEM:
+         TEST_CHECK(tn_fmem_release(&_fmem, data) == TN_RC_OK);
+         break;
+      case _OBJ_MUTEX_INHERIT:
+      case _OBJ_MUTEX_CEILING:
+         TEST_CHECK(tn_mutex_unlock(&_mutex) == TN_RC_OK);
+         break;
+      case _OBJ_EVENTGRP:
+         TEST_CHECK(
+               tn_eventgrp_modify(
+                  &_eventgrp, TN_EVENTGRP_OP_SET, EVENT_BIT
+                  ) == TN_RC_OK
+               );
+         break;
+      default:
+         TEST_CHECK(0 /* wrong object kind */);
+         break;
+   }
+}
+
+/**
+ * Create the object so that it isn't available: the main task holds it.
+ * Returns the data to be given to `_obj_pass()`.
+ */
+static void *_obj_create(enum TN_WaitOrder wait_order)
+{
+   void *data = TN_NULL;
+
+   switch (_obj_kind){
+      case _OBJ_SEM:
+         TEST_CHECK(
+               tn_sem_create_worder(&_sem, 0, 1, wait_order) == TN_RC_OK
+               );
+         break;
+      case _OBJ_DQUEUE:
+         TEST_CHECK(
+               tn_queue_create_worder(
+                  &_dque, _dque_buf, WAITERS_CNT, wait_order
+                  ) == TN_RC_OK
+               );
+         data = &_dque;
+         break;
+      case _OBJ_FMEM:
+         TEST_CHECK(
+               tn_fmem_create_worder(
+                  &_fmem, _fmem_buf, sizeof(TN_UWord), 2, wait_order
+                  ) == TN_RC_OK
+               );
+         TEST_CHECK(tn_fmem_get_polling(&_fmem, &data) == TN_RC_OK);
+         TEST_CHECK(tn_fmem_get_polling(&_fmem, &data) == TN_RC_OK);
+         break;
+      case _OBJ_MUTEX_INHERIT:
+         TEST_CHECK(
+               tn_mutex_create_worder(
+                  &_mutex, TN_MUTEX_PROT_INHERIT, 0, wait_order
+                  ) == TN_RC_OK
+               );
+         TEST_CHECK(tn_mutex_lock_polling(&_mutex) == TN_RC_OK);
+         break;
+      case _OBJ_MUTEX_CEILING:
+         TEST_CHECK(
+               tn_mutex_create_worder(
+                  &_mutex, TN_MUTEX_PROT_CEILING, 1, wait_order
+                  ) == TN_RC_OK
+               );
+         TEST_CHECK(tn_mutex_lock_polling(&_mutex) == TN_RC_OK);
+         break;
+      case _OBJ_EVENTGRP:
+         TEST_CHECK(
+               tn_eventgrp_create_wattr(
+                  &_eventgrp,
+                  (wait_order == TN_WAIT_ORDER_PRIORITY)
+                     ? TN_EVENTGRP_ATTR_WAIT_PRIO
+                     : TN_EVENTGRP_ATTR_NONE,
+                  0
+                  ) == TN_RC_OK
+               );
+         break;
+      default:
+         TEST_CHECK(0 /* wrong object kind */);
+         break;
+   }
+
+   return data;
+}
+
+static void _obj_delete(void)
+{
+   switch (_obj_kind){
+      case _OBJ_SEM:
+         TEST_CHECK(tn_sem_delete(&_sem) == TN_RC_OK);
+         break;
+      case _OBJ_DQUEUE:
+         TEST_CHECK(tn_queue_delete(&_dque) == TN_RC_OK);
+         break;
+      case _OBJ_FMEM:
+         TEST_CHECK(tn_fmem_delete(&_fmem) == TN_RC_OK);
+         break;
+      case _OBJ_MUTEX_INHERIT:
+      case _OBJ_MUTEX_CEILING:
+         TEST_CHECK(tn_mutex_delete(&_mutex) == TN_RC_OK);
+         break;
+      case _OBJ_EVENTGRP:
+         TEST_CHECK(tn_eventgrp_delete(&_eventgrp) == TN_RC_OK);
+         break;
+      default:
+         TEST_CHECK(0 /* wrong object kind */);
+         break;
+   }
+}
+
+static void _waiter_body(void *param)
+{
+   int idx = (int)(TN_UWord)param;
+   void *data;
+
+   if (idx == WAITER_INHERIT_IDX){
+      TEST_CHECK(tn_mutex_lock(&_mutex_i, TN_WAIT_INFINITE) == TN_RC_OK);
+   }
+
+   data = _obj_wait();
+   _log[_log_cnt++] = idx;
+   _obj_pass(data);
+
+   if (idx == WAITER_INHERIT_IDX){
+      TEST_CHECK(tn_mutex_unlock(&_mutex_i) == TN_RC_OK);
+   }
+}
+
+static void _blocker_body(void *param)
+{
+   (void)param;
+
+   TEST_CHECK(tn_mutex_lock(&_mutex_i, TN_WAIT_INFINITE) == TN_RC_OK);
+   TEST_CHECK(tn_mutex_unlock(&_mutex_i) == TN_RC_OK);
+}
+
+static int _priority_get(int idx)
+{
+   return _waiters[idx].task.priority;
+}
+
+static void _dormant_check(struct TN_Task *task)
+{
+   enum TN_TaskState state;
+
+   TEST_CHECK(tn_task_state_get(task, &state) == TN_RC_OK);
+   TEST_CHECK(state == TN_TASK_STATE_DORMANT);
+}
+
+static void _test(enum _ObjKind obj_kind, enum TN_WaitOrder wait_order)
+{
+   const int *expected = (wait_order == TN_WAIT_ORDER_PRIORITY)
+      ? _expected_prio_order
+      : _expected_fifo_order;
+   void *data;
+   int i;
+
+   _obj_kind = obj_kind;
+   _log_cnt = 0;
+   data = _obj_create(wait_order);
+
+   //-- waiters start waiting one by one, in order of their indexes
+   for (i = 0; i < WAITERS_CNT; i++){
+      TEST_CHECK(tn_task_activate(&_waiters[i].task) == TN_RC_OK);
+      tn_task_sleep(1);
+   }
+
+   TEST_CHECK(tn_task_change_priority(&_waiters[1].task, 9) == TN_RC_OK);
+   TEST_CHECK(tn_task_change_priority(&_waiters[2].task, 6) == TN_RC_OK);
+
+   TEST_CHECK(tn_task_activate(&_blocker.task) == TN_RC_OK);
+   tn_task_sleep(1);
+   TEST_CHECK(_priority_get(WAITER_INHERIT_IDX) == BLOCKER_PRIORITY);
+
+   //-- nobody has got the object yet
+   TEST_CHECK(_log_cnt == 0);
+
+   _obj_pass(data);
+   tn_task_sleep(2);
+
+   TEST_CHECK(_log_cnt == WAITERS_CNT);
+   for (i = 0; i < WAITERS_CNT; i++){
+      TEST_CHECK(_log[i] == expected[i]);
+      _dormant_check(&_waiters[i].task);
+   }
+   _dormant_check(&_blocker.task);
+
+   _obj_delete();
+
+   printf("%s, %s order: done\n",
+         _obj_names[obj_kind],
+         (wait_order == TN_WAIT_ORDER_PRIORITY) ? "priority" : "fifo"
+         );
+}
+
+
+
+/*******************************************************************************
+ *    PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+void test_main(void)
+{
+   int i;
+
+   TEST_CHECK(tn_mutex_create(&_mutex_i, TN_MUTEX_PROT_INHERIT, 0)
+         == TN_RC_OK);
+
+   for (i = 0; i < WAITERS_CNT; i++){
+      TEST_CHECK(
+            tn_task_create_wname(
+               &_waiters[i].task, _waiter_body, _base_priorities[i],
+               _waiters[i].stack, TEST_TASK_STACK_SIZE,
+               (void *)(TN_UWord)i, 0, "waiter"
+               ) == TN_RC_OK
+            );
+   }
+
+   TEST_CHECK(
+         tn_task_create_wname(
+            &_blocker.task, _blocker_body, BLOCKER_PRIORITY,
+            _blocker.stack, TEST_TASK_STACK_SIZE, TN_NULL, 0, "blocker"
+            ) == TN_RC_OK
+         );
+
+   for (i = 0; i < _OBJ_KINDS_CNT; i++){
+      _test((enum _ObjKind)i, TN_WAIT_ORDER_PRIORITY);
+      _test((enum _ObjKind)i, TN_WAIT_ORDER_FIFO);
+   }
+}
@@ -0,0 +1,12 @@
+/*
+ * Base kernel configuration for host-side tests and benchmarks: defaults from
+ * tn_cfg_default.h are used, and each program overrides options it needs by
+ * its CFLAGS, see Makefile.
+ */
+
+#ifndef _TN_CFG_H
+#define _TN_CFG_H
+
+//-- there is nothing to override for all programs at once
+
+#endif // _TN_CFG_H
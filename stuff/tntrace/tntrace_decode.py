@@ -0,0 +1,352 @@
+#!/usr/bin/env python3
+#
+# Offline decoder of the TNeo kernel event trace (see src/core/tn_trace.h).
+#
+# Input is a raw snapshot of `struct TN_TraceBuf` taken from the target (say,
+# by the debugger: `dump binary memory trace.bin &_tn_trace_buf
+# (char *)&_tn_trace_buf + sizeof(_tn_trace_buf)` in GDB). The decoder
+# doesn't need to know the target architecture: byte order is found out by
+# the magic number, and sizes of the types are taken from the header of the
+# buffer.
+#
+# Output is the timeline of events and per-task wakeup latency histograms
+# (wakeup latency is the time from the moment task finishes waiting to the
+# moment it actually starts running).
+#
+# Usage:
+#
+#     tntrace_decode.py trace.bin [--map MAP] [--ts-freq HZ]
+#
+# MAP is a text file which maps addresses to names: the first column of each
+# line is a hex address, the last column is a name, so the output of `nm`
+# for the firmware ELF file can be used as is. If --ts-freq is given (the
+# frequency of the timestamp source, in Hz), times are printed in
+# microseconds; otherwise, in raw timestamp units.
+#
+
+import argparse
+import struct
+import sys
+
+
+TN_TRACE_MAGIC = 0x544E5452
+
+#-- must match `enum TN_TraceEvent`
+EV_CONTEXT_SWITCH = 1
+EV_TASK_WAIT      = 2
+EV_TASK_WAIT_END  = 3
+EV_MUTEX_LOCK     = 4
+EV_MUTEX_UNLOCK   = 5
+EV_QUEUE_SEND     = 6
+EV_QUEUE_RECEIVE  = 7
+EV_TIMER_FIRE     = 8
+EV_MSGQ_SEND      = 9
+EV_MSGQ_RECEIVE   = 10
+
+EV_NAMES = {
+    EV_CONTEXT_SWITCH: "CONTEXT_SWITCH",
+    EV_TASK_WAIT:      "TASK_WAIT",
+    EV_TASK_WAIT_END:  "TASK_WAIT_END",
+    EV_MUTEX_LOCK:     "MUTEX_LOCK",
+    EV_MUTEX_UNLOCK:   "MUTEX_UNLOCK",
+    EV_QUEUE_SEND:     "QUEUE_SEND",
+    EV_QUEUE_RECEIVE:  "QUEUE_RECEIVE",
+    EV_TIMER_FIRE:     "TIMER_FIRE",
+    EV_MSGQ_SEND:      "MSGQ_SEND",
+    EV_MSGQ_RECEIVE:   "MSGQ_RECEIVE",
+}
+
+#-- must match `enum TN_WaitReason`
+WAIT_REASONS = [
+    "NONE", "SLEEP", "SEM", "EVENT", "DQUE_WSEND", "DQUE_WRECEIVE",
+    "MUTEX_C", "MUTEX_I", "WFIXMEM", "MSGQ_WSEND", "MSGQ_WRECEIVE",
+    "RING_WRECEIVE", "STREAM_WSEND", "STREAM_WRECEIVE",
+    "TASK_NOTIFY", "WHEAP",
+]
+
+#-- must match `enum TN_RCode`
+RCODES = {
+    0: "OK", -1: "TIMEOUT", -2: "OVERFLOW", -3: "WCONTEXT", -4: "WSTATE",
+    -5: "WPARAM", -6: "ILLEGAL_USE", -7: "INVALID_OBJ", -8: "DELETED",
+    -9: "FORCED", -10: "INTERNAL",
+}
+
+_INT_FMT = {1: "B", 2: "H", 4: "I", 8: "Q"}
+
+
+class TraceFormatError(Exception):
+    pass
+
+
+class TraceRec(object):
+    def __init__(self, timestamp, p_obj, param, event):
+        self.timestamp = timestamp
+        self.p_obj = p_obj
+        self.param = param
+        self.event = event
+
+
+class TraceSnapshot(object):
+    """
+    Parses raw snapshot of `struct TN_TraceBuf`.
+    """
+
+    def __init__(self, data):
+        self._data = data
+        self._detect_format()
+        self._parse_header()
+
+    #-- find out byte order and size of `unsigned long` by the magic number
+    def _detect_format(self):
+        for endian in ("<", ">"):
+            for long_size in (4, 8):
+                if len(self._data) < long_size + 4:
+                    continue
+                magic = self._uint_at(0, long_size, endian)
+                if magic == TN_TRACE_MAGIC and self._data[long_size] == long_size:
+                    self.endian = endian
+                    self.long_size = long_size
+                    return
+        raise TraceFormatError("magic number not found: not a trace snapshot")
+
+    def _uint_at(self, offset, size, endian=None):
+        fmt = (endian or self.endian) + _INT_FMT[size]
+        return struct.unpack_from(fmt, self._data, offset)[0]
+
+    @staticmethod
+    def _align(offset, alignment):
+        return (offset + alignment - 1) // alignment * alignment
+
+    def _parse_header(self):
+        off = self.long_size
+        self.ptr_size, self.word_size, self.rec_size = struct.unpack_from(
+            "BBB", self._data, off + 1
+        )
+        off += 4
+
+        off = self._align(off, self.word_size)
+        self.recs_cnt = self._uint_at(off, self.word_size)
+        self.wr_cnt = self._uint_at(off + self.word_size, self.word_size)
+        self.active = self._uint_at(off + 2 * self.word_size, self.word_size)
+        off += 3 * self.word_size
+
+        #-- layout of `struct TN_TraceRec`, assuming natural alignment
+        self._rec_ts_off = 0
+        self._rec_obj_off = self._align(self.long_size, self.ptr_size)
+        self._rec_param_off = self._align(
+            self._rec_obj_off + self.ptr_size, self.word_size
+        )
+        self._rec_event_off = self._rec_param_off + self.word_size
+
+        rec_align = max(self.long_size, self.ptr_size, self.word_size)
+        if self._align(self._rec_event_off + self.word_size, rec_align) \
+                != self.rec_size:
+            raise TraceFormatError(
+                "unexpected record size: %d" % self.rec_size
+            )
+
+        self._recs_off = self._align(off, rec_align)
+        if len(self._data) < self._recs_off + self.recs_cnt * self.rec_size:
+            raise TraceFormatError("snapshot is truncated")
+
+    def _rec_at(self, idx):
+        off = self._recs_off + idx * self.rec_size
+        return TraceRec(
+            timestamp=self._uint_at(off + self._rec_ts_off, self.long_size),
+            p_obj=self._uint_at(off + self._rec_obj_off, self.ptr_size),
+            param=self._uint_at(off + self._rec_param_off, self.word_size),
+            event=self._uint_at(off + self._rec_event_off, self.word_size),
+        )
+
+    def records(self):
+        """
+        Returns records in chronological order: if the buffer has wrapped,
+        the oldest records are already overwritten.
+        """
+        cnt = min(self.wr_cnt, self.recs_cnt)
+        return [
+            self._rec_at((self.wr_cnt - cnt + i) % self.recs_cnt)
+            for i in range(cnt)
+        ]
+
+    def signed_word(self, value):
+        bits = self.word_size * 8
+        if value & (1 << (bits - 1)):
+            value -= 1 << bits
+        return value
+
+    def ts_diff(self, ts_later, ts_earlier):
+        """Difference of two timestamps, taking wraparound into account"""
+        return (ts_later - ts_earlier) % (1 << (self.long_size * 8))
+
+
+class TraceDecoder(object):
+
+    def __init__(self, snapshot, names=None, ts_freq=None):
+        self.snap = snapshot
+        self.names = names or {}
+        self.ts_freq = ts_freq
+
+    def name(self, addr):
+        if addr == 0:
+            return "NULL"
+        return self.names.get(addr, "0x%x" % addr)
+
+    def fmt_time(self, ticks):
+        if self.ts_freq:
+            return "%.3f us" % (ticks * 1e6 / self.ts_freq)
+        return "%d" % ticks
+
+    def describe(self, rec):
+        obj = self.name(rec.p_obj)
+        if rec.event == EV_CONTEXT_SWITCH:
+            return "%s -> %s" % (self.name(rec.param), obj)
+        elif rec.event == EV_TASK_WAIT:
+            reason = WAIT_REASONS[rec.param] \
+                if rec.param < len(WAIT_REASONS) else str(rec.param)
+            return "%s waits for %s" % (obj, reason)
+        elif rec.event == EV_TASK_WAIT_END:
+            rc = self.snap.signed_word(rec.param)
+            return "%s done waiting, rc=%s" % (obj, RCODES.get(rc, str(rc)))
+        elif rec.event in (EV_MUTEX_LOCK, EV_MUTEX_UNLOCK):
+            return "%s by %s" % (obj, self.name(rec.param))
+        elif rec.event in (EV_QUEUE_SEND, EV_QUEUE_RECEIVE):
+            return "%s data=0x%x" % (obj, rec.param)
+        elif rec.event in (EV_MSGQ_SEND, EV_MSGQ_RECEIVE):
+            return "%s buf=0x%x" % (obj, rec.param)
+        elif rec.event == EV_TIMER_FIRE:
+            return "%s func=%s" % (obj, self.name(rec.param))
+        else:
+            return "obj=%s param=0x%x" % (obj, rec.param)
+
+    def print_timeline(self, recs, out):
+        if not recs:
+            out.write("No records\n")
+            return
+
+        ts_first = recs[0].timestamp
+        ts_prev = ts_first
+        for rec in recs:
+            out.write("%14s  %14s  %-15s %s\n" % (
+                self.fmt_time(self.snap.ts_diff(rec.timestamp, ts_first)),
+                self.fmt_time(self.snap.ts_diff(rec.timestamp, ts_prev)),
+                EV_NAMES.get(rec.event, "EV_%d" % rec.event),
+                self.describe(rec),
+            ))
+            ts_prev = rec.timestamp
+
+    def wakeup_latencies(self, recs):
+        """
+        Returns dict: task address -> list of wakeup latencies, i.e. times
+        from TASK_WAIT_END to the CONTEXT_SWITCH to that task.
+        """
+        pending = {}
+        latencies = {}
+        for rec in recs:
+            if rec.event == EV_TASK_WAIT_END:
+                pending.setdefault(rec.p_obj, rec.timestamp)
+            elif rec.event == EV_TASK_WAIT:
+                #-- task started waiting again without being switched to
+                #   (say, it was running already when woken up)
+                pending.pop(rec.p_obj, None)
+            elif rec.event == EV_CONTEXT_SWITCH:
+                if rec.param in pending:
+                    #-- task was running when its wait ended
+                    del pending[rec.param]
+                if rec.p_obj in pending:
+                    latencies.setdefault(rec.p_obj, []).append(
+                        self.snap.ts_diff(
+                            rec.timestamp, pending.pop(rec.p_obj)
+                        )
+                    )
+        return latencies
+
+    def print_latency_histograms(self, recs, out):
+        latencies = self.wakeup_latencies(recs)
+        if not latencies:
+            out.write("\nNo wakeup latencies\n")
+            return
+
+        for task, values in sorted(latencies.items()):
+            out.write("\nWakeup latency of %s: cnt=%d, min=%s, avg=%s, "
+                      "max=%s\n" % (
+                          self.name(task), len(values),
+                          self.fmt_time(min(values)),
+                          self.fmt_time(sum(values) // len(values)),
+                          self.fmt_time(max(values)),
+                      ))
+
+            #-- power-of-two buckets: [0, 1), [1, 2), [2, 4), [4, 8), ...
+            buckets = {}
+            for value in values:
+                bucket = value.bit_length()
+                buckets[bucket] = buckets.get(bucket, 0) + 1
+
+            cnt_max = max(buckets.values())
+            for bucket in range(min(buckets), max(buckets) + 1):
+                lo = 0 if bucket == 0 else (1 << (bucket - 1))
+                hi = 1 << bucket
+                cnt = buckets.get(bucket, 0)
+                out.write("  [%12s .. %12s) %6d %s\n" % (
+                    self.fmt_time(lo), self.fmt_time(hi), cnt,
+                    "#" * ((cnt * 40 + cnt_max - 1) // cnt_max),
+                ))
+
+
+def load_names(path):
+    names = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) < 2:
+                continue
+            try:
+                addr = int(fields[0], 16)
+            except ValueError:
+                continue
+            names[addr] = fields[-1]
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decode TNeo kernel event trace snapshot"
+    )
+    parser.add_argument("snapshot", help="raw snapshot of struct TN_TraceBuf")
+    parser.add_argument("--map", help="file which maps addresses to names")
+    parser.add_argument("--ts-freq", type=float,
+                        help="timestamp frequency, in Hz")
+    args = parser.parse_args()
+
+    with open(args.snapshot, "rb") as f:
+        data = f.read()
+
+    try:
+        snap = TraceSnapshot(data)
+    except TraceFormatError as e:
+        sys.stderr.write("%s: %s\n" % (args.snapshot, e))
+        return 1
+
+    decoder = TraceDecoder(
+        snap,
+        names=load_names(args.map) if args.map else None,
+        ts_freq=args.ts_freq,
+    )
+
+    recs = snap.records()
+    sys.stdout.write(
+        "%s-endian, long: %d, ptr: %d, word: %d; %d records written, "
+        "%d available\n\n" % (
+            "little" if snap.endian == "<" else "big",
+            snap.long_size, snap.ptr_size, snap.word_size,
+            snap.wr_cnt, len(recs),
+        )
+    )
+
+    decoder.print_timeline(recs, sys.stdout)
+    decoder.print_latency_histograms(recs, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())